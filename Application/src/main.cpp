@@ -1,9 +1,9 @@
 #include "Engine/Engine.h"
 
-int main()
+int main(int argc, char** argv)
 {
-    Engine::Get().Init();
-    Engine::Get().Run();
+    Engine::Get().Init(Engine::ParseCommandLine(argc, argv));
+    int exitCode = Engine::Get().Run();
     // TODO: Implement Scene interface
     // auto scene = engine.CreateScene();
     //
@@ -11,5 +11,5 @@ int main()
     // scene->AddModel(ResourceSystem::LoadModel("assets/sponza.obj"));
     // scene->AddLight({ { 0, 10, 0 }, { 1, 1, 1 }, 3.0f });
 
-    return 0;
+    return exitCode;
 }
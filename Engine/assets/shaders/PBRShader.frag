@@ -1,39 +1,111 @@
 #version 450 core
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
 
 #define MAX_POINT_LIGHT 10
+#define CASCADE_COUNT   4
+
+// Cluster grid, must match ClusteredLights.h.
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT  (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+
+// Specialization constants, picked by the renderer settings. Must match the PBR variants in ForwardRenderer::RenderFrame.
+layout(constant_id = 0) const bool POINT_LIGHT_SHADOWS = true;
+layout(constant_id = 1) const int  SHADOW_PCF_RADIUS   = 2; // The directional shadow filter is (2r + 1)^2 taps.
 
 // INs
 layout(location = 0) in vec3  v_Pos;
 layout(location = 1) in vec2  v_UV;
 layout(location = 2) in vec3  v_Normal;
-layout(location = 3) in vec4  v_FragPosLightSpace;
+layout(location = 3) in float v_ViewDepth;
 layout(location = 4) in mat4  v_ViewMatrix;
 layout(location = 8) in mat3 v_TBN;
+layout(location = 11) in vec4 v_Tint;
+#ifdef BINDLESS
+layout(location = 12) flat in uint v_MaterialIndex;
+#endif
 
-layout(set = 0, binding = 0) uniform globalUBO
+// The global uniforms are split by how often they change. Must match the blocks in Renderer.h.
+layout(set = 0, binding = 0) uniform viewUBO
 {
     mat4 viewMatrix;
     mat4 projMatrix;
-    mat4 directionalLightMVP;
-    vec4 dirLightPos;
     vec4 cameraPosition;
     vec4 viewportDimension;
-    vec4 pointLightPositions[MAX_POINT_LIGHT];
-    vec4 pointlightIntensities[MAX_POINT_LIGHT];
-    vec4 pointLightColors[MAX_POINT_LIGHT];
-    vec4 enablePointLightShadows;
+    uvec4 clusteredLightSlices; // x: first light, y: first cluster buffer entry of this frame's slices.
+};
+
+layout(set = 0, binding = 11) uniform frameUBO
+{
+    vec4 dirLightPos;
+    mat4 cascadeViewProjMatrices[CASCADE_COUNT];
+    vec4 cascadeSplits; // Far view depth of each cascade.
+};
+
+layout(set = 0, binding = 13) uniform staticUBO
+{
+    vec4 DOFFramebufferSize;
+    vec4 cameraNearPlane;
+    vec4 cameraFarPlane;
+    vec4 focalDepth;
+    vec4 focalLength;
+    vec4 fstop;
     vec4 directionalLightIntensity;
-    mat4 shadowMatrices[MAX_POINT_LIGHT][6];
+    vec4 enablePointLightShadows;
     vec4 pointFarPlane;
-    vec4 pointLightCount;
 };
 
+#ifdef BINDLESS
+// Every material texture lives in one array. The material of the fragment picks its textures from it. Neighbouring
+// fragments of a draw can belong to different meshes, hence the nonuniform indexing.
+struct Material
+{
+    uint albedo;
+    uint normal;
+    uint roughnessMetallic;
+    uint padding;
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer materialBuffer
+{
+    Material materials[];
+};
+layout(set = 0, binding = 8) uniform sampler2D u_MaterialTextures[];
+
+#define u_DiffuseSampler           u_MaterialTextures[nonuniformEXT(materials[v_MaterialIndex].albedo)]
+#define u_NormalSampler            u_MaterialTextures[nonuniformEXT(materials[v_MaterialIndex].normal)]
+#define u_RoughnessMetallicSampler u_MaterialTextures[nonuniformEXT(materials[v_MaterialIndex].roughnessMetallic)]
+#else
 layout(set = 0, binding = 1) uniform sampler2D u_DiffuseSampler;
 layout(set = 0, binding = 2) uniform sampler2D u_NormalSampler;
 layout(set = 0, binding = 3) uniform sampler2D u_RoughnessMetallicSampler;
-layout(set = 0, binding = 4) uniform sampler2D u_DirectionalShadowMap;
+#endif
+layout(set = 0, binding = 4) uniform sampler2DArray u_DirectionalShadowMap; // One layer per cascade.
 layout(set = 0, binding = 5) uniform samplerCube[5] u_PointShadowMap;
 
+// Point lights binned into view frustum clusters on the CPU. Every cluster holds the range of its light indices. Both
+// buffers hold one slice per frame in flight, the view block points at the slices of this frame.
+struct PointLight
+{
+    vec4 positionRange;  // xyz: world position, w: distance at which the light fades out.
+    vec4 colorIntensity;
+    int  shadowIndex;    // Point shadow cubemap of the light, -1 if it has none.
+    int  padding[3];
+};
+
+layout(std430, set = 0, binding = 9) readonly buffer lightBuffer
+{
+    PointLight lights[];
+};
+layout(std430, set = 0, binding = 10) readonly buffer clusterBuffer
+{
+    // Per slice: CLUSTER_COUNT (first light index, light count) pairs, followed by the light indices.
+    uint clusterData[];
+};
+
 
 layout(location = 0) out vec4 FragColor;
 const float PI = 3.14159265359;
@@ -93,29 +165,43 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
 }
 
 
-float DirectionalShadowCalculation(vec4 fragPosLightSpace, vec3 fragPos, vec3 lightPosition, vec3 normal)
+float DirectionalShadowCalculation(vec3 fragPos, vec3 lightPosition, vec3 normal)
 {
-	vec3 shadowCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
-	float shadowMapDepth  = texture(u_DirectionalShadowMap, shadowCoords.xy).r;
-	float currentDepth = shadowCoords.z;
+	// Pick the first cascade that covers this fragment. Far cascades may be a few frames old so if the fragment falls
+	// outside of the selected one we fall back to the next, coarser cascade.
+	int cascade = 0;
+	while (cascade < CASCADE_COUNT && v_ViewDepth > cascadeSplits[cascade])
+		cascade++;
+
+	vec3 shadowCoords = vec3(0.0);
+	for (; cascade < CASCADE_COUNT; cascade++)
+	{
+		vec4 lightSpacePos = cascadeViewProjMatrices[cascade] * vec4(fragPos, 1.0);
+		shadowCoords = lightSpacePos.xyz / lightSpacePos.w;
+		shadowCoords.xy = shadowCoords.xy * 0.5 + 0.5;
+		if (all(greaterThanEqual(shadowCoords.xy, vec2(0.0))) && all(lessThanEqual(shadowCoords.xy, vec2(1.0))))
+			break;
+	}
 
+	if (cascade == CASCADE_COUNT || shadowCoords.z > 1.0)
+		return 0.0;
+
+	float currentDepth = shadowCoords.z;
 
 	vec3 lightDir = normalize(v_TBN * lightPosition * mat3(v_ViewMatrix));
-	float bias = max(0.001 * (1.0 - dot(normal, lightDir)), 0.001);
+	// Coarser cascades cover more world space per texel so they need a larger bias.
+	float bias = max(0.001 * (1.0 - dot(normal, lightDir)), 0.0005) * (cascade + 1);
 	float shadow = 0.0;
-	vec2 texelSize = 1.0 / textureSize(u_DirectionalShadowMap, 0);
-	for (int x = -1; x <= 8; ++x)
+	vec2 texelSize = 1.0 / vec2(textureSize(u_DirectionalShadowMap, 0).xy);
+	for (int x = -SHADOW_PCF_RADIUS; x <= SHADOW_PCF_RADIUS; ++x)
 	{
-		for (int y = -1; y <= 8; ++y)
+		for (int y = -SHADOW_PCF_RADIUS; y <= SHADOW_PCF_RADIUS; ++y)
 		{
-			float pcfDepth = texture(u_DirectionalShadowMap, shadowCoords.xy + vec2(x, y) * texelSize).r;
+			float pcfDepth = texture(u_DirectionalShadowMap, vec3(shadowCoords.xy + vec2(x, y) * texelSize, cascade)).r;
 			shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
 		}
 	}
-	shadow /= 100.0;
-	if (shadowCoords.z > 1.0)
-		shadow = 0.0;
-
+	shadow /= float((2 * SHADOW_PCF_RADIUS + 1) * (2 * SHADOW_PCF_RADIUS + 1));
 
 	return shadow;
 }
@@ -129,11 +215,26 @@ vec3 sampleOffsetDirections[20] = vec3[]
    vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
 );
 
+// Lights come from the cluster lists, so the index is not uniform across a draw. The cubemaps are picked with constant
+// indices instead of indexing the sampler array with it.
+float SamplePointShadowMap(int index, vec3 direction)
+{
+    switch (index)
+    {
+        case 0: return texture(u_PointShadowMap[0], direction).r;
+        case 1: return texture(u_PointShadowMap[1], direction).r;
+        case 2: return texture(u_PointShadowMap[2], direction).r;
+        case 3: return texture(u_PointShadowMap[3], direction).r;
+        case 4: return texture(u_PointShadowMap[4], direction).r;
+    }
+    return 1.0;
+}
+
 float PointShadowCalculation(int index, vec3 pointLightPosition)
 {
     vec3 fragToLight = v_Pos - pointLightPosition;
     
-    float closestDepth = texture(u_PointShadowMap[index], fragToLight).r;
+    float closestDepth = SamplePointShadowMap(index, fragToLight);
     
     closestDepth *= pointFarPlane.x;
     
@@ -203,7 +304,7 @@ vec3 CalcDirectionalLight(vec3 normal, vec3 viewDir, vec3 dirLightPos, float sha
    return color;
 }
 
-vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 pointLightPos, vec3 albedo, vec3 roughnessMetallic, vec3 lightColor, float intensity, float shadow)
+vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 pointLightPos, float range, vec3 albedo, vec3 roughnessMetallic, vec3 lightColor, float intensity, float shadow)
 {
    float ao  = roughnessMetallic.r;
    float roughness = roughnessMetallic.g;
@@ -224,6 +325,9 @@ vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 pointLightPos, vec3 albedo,
 
    float distance    = length(pointLightPos - v_Pos);
    float attenuation = 1.0 / (constant + linear * distance + quadratic * (distance * distance * distance));  
+   // Fade to zero at the light range so cluster borders don't show.
+   float falloff     = clamp(1.0 - pow(distance / range, 4.0), 0.0, 1.0);
+   attenuation      *= falloff * falloff;
    vec3 radiance     = lightColor * attenuation * intensity;        
    
    // cook-torrance brdf
@@ -250,12 +354,24 @@ vec3 CalcPointLight(vec3 normal, vec3 viewDir, vec3 pointLightPos, vec3 albedo,
 
 const vec4 v05 = vec4(0.5,0.5,0.5,0.5);
 
+// Same exponential depth slicing as ClusteredLights::Update.
+uint GetClusterIndex()
+{
+    uvec2 tile = uvec2(gl_FragCoord.xy / viewportDimension.xy * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y));
+    tile       = min(tile, uvec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+
+    float slice = floor(log(v_ViewDepth / cameraNearPlane.x) * CLUSTER_GRID_Z / log(cameraFarPlane.x / cameraNearPlane.x));
+    uint  z     = uint(clamp(slice, 0.0, float(CLUSTER_GRID_Z - 1)));
+
+    return tile.x + tile.y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+}
+
 
 
 void main()
 {		
    // -------Sample the PBR textures here--------- 
-   vec3 albedo = pow(texture(u_DiffuseSampler, v_UV).rgb, vec3(2.2));
+   vec3 albedo = pow(texture(u_DiffuseSampler, v_UV).rgb, vec3(2.2)) * v_Tint.rgb;
    vec3 roughnessMetallicTex = texture(u_RoughnessMetallicSampler, v_UV).rgb;
    
    
@@ -267,23 +383,26 @@ void main()
    
    vec3 viewDir = normalize(v_TBN * cameraPosition.xyz - v_TBN * v_Pos);
    
-   float directionalShadow = DirectionalShadowCalculation(v_FragPosLightSpace, v_Pos, dirLightPos.xyz, normal);
+   float directionalShadow = DirectionalShadowCalculation(v_Pos, dirLightPos.xyz, normal);
    
    vec3 color = vec3(0.0);
    color += CalcDirectionalLight(normal, viewDir, dirLightPos.xyz, directionalShadow, albedo, roughnessMetallicTex, vec3(1.0, 1.0, 1.0));
 
 
-   for(int i = 0; i < pointLightCount.x; i++)
+   // Only the lights that reach this fragment's cluster.
+   uint  clusterSlice = clusteredLightSlices.y;
+   uint  clusterEntry = clusterSlice + GetClusterIndex() * 2;
+   uvec2 cluster      = uvec2(clusterData[clusterEntry], clusterData[clusterEntry + 1]);
+   uint  lightIndices = clusterSlice + CLUSTER_COUNT * 2;
+   for(uint i = cluster.x; i < cluster.x + cluster.y; i++)
    {
-        if(enablePointLightShadows.x == 1.0)
-        {
-            float pointShadow = PointShadowCalculation(i, pointLightPositions[i].xyz);
-            color += CalcPointLight(normal, viewDir, pointLightPositions[i].xyz, albedo, roughnessMetallicTex, pointLightColors[i].xyz, pointlightIntensities[i].x, pointShadow);
-        }
-        else
-        {
-            color += CalcPointLight(normal, viewDir, pointLightPositions[i].xyz, albedo, roughnessMetallicTex, pointLightColors[i].xyz, pointlightIntensities[i].x, 0.0);
-        }
+        PointLight light = lights[clusteredLightSlices.x + clusterData[lightIndices + i]];
+
+        float pointShadow = 0.0;
+        if(POINT_LIGHT_SHADOWS && light.shadowIndex >= 0)
+            pointShadow = PointShadowCalculation(light.shadowIndex, light.positionRange.xyz);
+
+        color += CalcPointLight(normal, viewDir, light.positionRange.xyz, light.positionRange.w, albedo, roughnessMetallicTex, light.colorIntensity.xyz, light.colorIntensity.w, pointShadow);
    }
 
    
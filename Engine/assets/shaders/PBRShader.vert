@@ -6,37 +6,62 @@ layout(location = 1) in vec2 a_UV;
 layout(location = 2) in vec3 a_Normal;
 layout(location = 3) in vec3 a_Tangent;
 layout(location = 4) in vec3 a_Bitangent;
+#ifdef BINDLESS
+layout(location = 5) in float a_MaterialIndex; // Vertex binding 1, one value per vertex.
+#endif
 
 //OUTs
 layout(location = 0) out vec3 v_Pos;
 layout(location = 1) out vec2 v_UV;
 layout(location = 2) out vec3 v_Normal;
-layout(location = 3) out vec4 v_FragPosLightSpace;
+layout(location = 3) out float v_ViewDepth;
 layout(location = 4) out mat4 v_ViewMatrix;
 layout(location = 8) out smooth mat3 v_TBN;
+layout(location = 11) out vec4 v_Tint;
+#ifdef BINDLESS
+layout(location = 12) flat out uint v_MaterialIndex;
+#endif
 
 
-layout(set = 0, binding = 0) uniform globalUBO
+layout(set = 0, binding = 0) uniform viewUBO
 {
     mat4 viewMatrix;
     mat4 projMatrix;
-    mat4 directionalLightMVP;
 };
 
 layout( push_constant ) uniform modelMat
 {
-	mat4 modelMatrix;
+	mat4 pushModelMatrix;
 };
 
-const mat4 bias = mat4( 
-  0.5, 0.0, 0.0, 0.0,
-  0.0, 0.5, 0.0, 0.0,
-  0.0, 0.0, 1.0, 0.0,
-  0.5, 0.5, 0.0, 1.0 );
+struct InstanceData
+{
+    mat4 transform;
+    vec4 tint;
+};
+
+// Bindless models keep their instance buffer in the per model set.
+#ifdef BINDLESS
+layout(std430, set = 1, binding = 0) readonly buffer instanceBuffer
+#else
+layout(std430, set = 0, binding = 6) readonly buffer instanceBuffer
+#endif
+{
+    InstanceData instances[];
+};
+
+// Matches depthPrepass.vert, whose depth the color pass tests for equality when the pre-pass is enabled.
+invariant gl_Position;
 
 void main()
 {
+    // Instance transforms are applied before the model transform.
+    mat4 modelMatrix            = pushModelMatrix * instances[gl_InstanceIndex].transform;
+    v_Tint                      = instances[gl_InstanceIndex].tint;
     v_UV                        = a_UV;
+#ifdef BINDLESS
+    v_MaterialIndex             = uint(a_MaterialIndex);
+#endif
     v_Pos                       = vec3(modelMatrix * vec4(a_Position, 1.0));
     v_Normal                    = mat3(modelMatrix) * a_Normal;   
 
@@ -50,7 +75,8 @@ void main()
 
     v_TBN                       = transpose(mat3(T, B, N));
 
-    v_FragPosLightSpace         = bias * directionalLightMVP * modelMatrix * vec4(a_Position, 1.0);
+    // Used to pick the shadow cascade in the fragment shader.
+    v_ViewDepth                 = -(viewMatrix * modelMatrix * vec4(a_Position, 1.0)).z;
 
     gl_Position                 = projMatrix * viewMatrix * modelMatrix * vec4(a_Position, 1.0);
 }
\ No newline at end of file
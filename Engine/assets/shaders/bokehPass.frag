@@ -44,7 +44,6 @@ layout(set = 0, binding = 2) uniform globalUBO
 	vec4 DOFFramebufferSize;
 	vec4 cameraNearPlane;
 	vec4 cameraFarPlane;
-	vec4 showDOFFocus;
 	vec4 FocalDepth;
 	vec4 FocalLength;
 	vec4 Fstop;
@@ -55,7 +54,7 @@ layout(set = 0, binding = 2) uniform globalUBO
 float focalDepth;
 float focalLength;
 float fstop;
-bool showFocus = false;
+layout(constant_id = 2) const bool showFocus = false; //picked by the renderer, like the sample counts below
 
 float znear = cameraNearPlane.x; //camera clipping start
 float zfar = cameraFarPlane.x; //camera clipping end
@@ -68,10 +67,11 @@ vec2 texel = vec2(1.0/width,1.0/height);
 //------------------------------------------
 //user variables
 
-int samples = 7; //samples on the first ring
-int rings = 12; //ring count
+//samples and rings are specialization constants, so the ring loops get unrolled. Must match ForwardRenderer::RenderFrame.
+layout(constant_id = 0) const int samples = 7; //samples on the first ring
+layout(constant_id = 1) const int rings = 12; //ring count
 
-bool manualdof = false; //manual dof calculation
+const bool manualdof = false; //manual dof calculation
 float ndofstart = 1.0; //near dof blur start
 float ndofdist = 2.0; //near dof blur falloff distance
 float fdofstart = 1.0; //far dof blur start
@@ -79,12 +79,12 @@ float fdofdist = 3.0; //far dof blur falloff distance
 
 float CoC = 0.03;//circle of confusion size in mm (35mm film = 0.03mm)
 
-bool vignetting = false; //use optical lens vignetting?
+const bool vignetting = false; //use optical lens vignetting?
 float vignout = 1.3; //vignetting outer border
 float vignin = 0.0; //vignetting inner border
 float vignfade = 22.0; //f-stops till vignete fades
 
-bool autofocus = false; //use autofocus in shader? disable if you use external focalDepth value
+const bool autofocus = false; //use autofocus in shader? disable if you use external focalDepth value
 vec2 focus = vec2(0.5,0.5); // autofocus point on screen (0.0,0.0 - left lower corner, 1.0,1.0 - upper right)
 float maxblur = 1.0; //clamp value of max blur (0.0 = no blur,1.0 default)
 
@@ -94,10 +94,10 @@ float gain = 100.0; //highlight gain;
 float bias = 0.1; //bokeh edge bias
 float fringe = 0.7; //bokeh chromatic aberration/fringing
 
-bool noise = true; //use noise instead of pattern for sample dithering
+const bool noise = true; //use noise instead of pattern for sample dithering
 float namount = 0.0001; //dither amount
 
-bool depthblur = false; //blur the depth buffer?
+const bool depthblur = false; //blur the depth buffer?
 float dbsize = 1.25; //depthblursize
 
 /*
@@ -106,7 +106,7 @@ not looking good with small sample and ring count
 looks okay starting from samples = 4, rings = 4
 */
 
-bool pentagon = false; //use pentagon as bokeh shape?
+const bool pentagon = false; //use pentagon as bokeh shape?
 float feather = 0.4; //pentagon shape feather
 
 //------------------------------------------
@@ -238,7 +238,6 @@ void main()
 	focalDepth = FocalDepth.x;
 	focalLength = FocalLength.x;
 	fstop = Fstop.x;
-	showFocus = showDOFFocus.x == 1.0 ?  true : false;
 
 	
 	//scene depth calculation
@@ -13,8 +13,17 @@
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe pointShadowPass.frag -o pointShadowPassFRAG.spv
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe pointShadowPass.vert -o pointShadowPassVERT.spv
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe pointShadowPass.geom -o pointShadowPassGEOM.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe pointShadowPassFace.vert -o pointShadowPassFaceVERT.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe cullDraws.comp -o cullDrawsCOMP.spv
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe PBRShader.vert -o PBRShaderVERT.spv
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe PBRShader.frag -o PBRShaderFRAG.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe -DBINDLESS PBRShader.vert -o PBRShaderBindlessVERT.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe -DBINDLESS PBRShader.frag -o PBRShaderBindlessFRAG.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe -DBINDLESS shadowPass.vert -o shadowPassBindlessVERT.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe -DBINDLESS pointShadowPass.vert -o pointShadowPassBindlessVERT.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe -DBINDLESS pointShadowPassFace.vert -o pointShadowPassFaceBindlessVERT.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe depthPrepass.vert -o depthPrepassVERT.spv
+..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe -DBINDLESS depthPrepass.vert -o depthPrepassBindlessVERT.spv
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe cubemap.frag -o cubemapFRAG.spv
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe cubemap.vert -o cubemapVERT.spv
 ..\..\vendor\VULKAN\1.4.328.1\Bin\glslc.exe Clouds.frag -o CloudsFRAG.spv
@@ -2,8 +2,10 @@
 
 layout(location = 0) in vec3 a_Position;
 
-layout(binding = 0) uniform globalUBO
+// Bound to the view block. The view matrix comes through the push constant without its translation.
+layout(binding = 0) uniform viewUBO
 {
+    mat4 cameraViewMatrix;
     mat4 ProjMat;
 };
 
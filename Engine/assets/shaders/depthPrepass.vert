@@ -0,0 +1,40 @@
+#version 450 core
+
+layout(location = 0) in vec3 a_Position; // Position only vertex stream.
+
+layout(set = 0, binding = 0) uniform globalUBO
+{
+    mat4 viewMatrix;
+    mat4 projMatrix;
+};
+
+layout( push_constant ) uniform modelMat
+{
+	mat4 pushModelMatrix;
+};
+
+struct InstanceData
+{
+    mat4 transform;
+    vec4 tint;
+};
+
+// Bindless models keep their instance buffer in the per model set.
+#ifdef BINDLESS
+layout(std430, set = 1, binding = 0) readonly buffer instanceBuffer
+#else
+layout(std430, set = 0, binding = 6) readonly buffer instanceBuffer
+#endif
+{
+    InstanceData instances[];
+};
+
+// The color pass after the pre-pass tests depth for equality, so the position has to be computed bit for bit the same
+// way as in PBRShader.vert.
+invariant gl_Position;
+
+void main()
+{
+    mat4 modelMatrix = pushModelMatrix * instances[gl_InstanceIndex].transform;
+    gl_Position      = projMatrix * viewMatrix * modelMatrix * vec4(a_Position, 1.0);
+}
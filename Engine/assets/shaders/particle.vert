@@ -19,13 +19,10 @@ layout (location = 5) out float outRowCellSize;
 layout (location = 6) out float outColumnCellSize;
 
 
-layout(set = 0, binding = 0) uniform globalUBO
+layout(set = 0, binding = 0) uniform viewUBO
 {
-	// Most of these members are not being used by this shader since it is shared buffer. Consider optimizing.
     mat4 viewMatrix;
     mat4 projMatrix;
-    mat4 directionalLightMVP;
-    vec4 dirLightPos;
     vec4 cameraPosition;
     vec4 viewportDimension;
 };
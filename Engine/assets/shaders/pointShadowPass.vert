@@ -10,7 +10,23 @@ layout( push_constant ) uniform mvp
 	mat4 modelMat;
 };
 
+struct InstanceData
+{
+    mat4 transform;
+    vec4 tint;
+};
+
+// Bindless models keep their instance buffer in the per model set.
+#ifdef BINDLESS
+layout(std430, set = 1, binding = 0) readonly buffer instanceBuffer
+#else
+layout(std430, set = 0, binding = 6) readonly buffer instanceBuffer
+#endif
+{
+    InstanceData instances[];
+};
+
 void main()
 {
-	gl_Position = modelMat * vec4(a_Position, 1.0);
+	gl_Position = modelMat * instances[gl_InstanceIndex].transform * vec4(a_Position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+#version 450 core
+
+#define MAX_POINT_LIGHT 10
+
+layout(location = 0) in vec3 a_Position;
+
+layout(set = 0, binding = 12) uniform pointShadowUBO
+{
+    mat4 shadowMatrices[MAX_POINT_LIGHT][6];
+};
+
+// Renders a single cubemap face per draw. Used instead of the geometry shader path when per-face draws are enabled.
+layout( push_constant ) uniform mvp
+{
+	mat4 modelMat;
+	vec4 index; // x: point light index, y: cubemap face
+};
+
+struct InstanceData
+{
+    mat4 transform;
+    vec4 tint;
+};
+
+// Bindless models keep their instance buffer in the per model set.
+#ifdef BINDLESS
+layout(std430, set = 1, binding = 0) readonly buffer instanceBuffer
+#else
+layout(std430, set = 0, binding = 6) readonly buffer instanceBuffer
+#endif
+{
+    InstanceData instances[];
+};
+
+layout(location = 0) out vec4 FragPos;
+
+void main()
+{
+	FragPos = modelMat * instances[gl_InstanceIndex].transform * vec4(a_Position, 1.0);
+	gl_Position = shadowMatrices[int(index.x)][int(index.y)] * FragPos;
+}
\ No newline at end of file
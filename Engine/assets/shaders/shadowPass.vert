@@ -2,17 +2,27 @@
 
 layout(location = 0) in vec3 a_Position;
 
+// The light matrix is pushed per cascade so the same pipeline can render into every cascade layer.
+layout( push_constant ) uniform modelMat
+{
+	mat4 modelMatrix;
+	mat4 cascadeViewProjMatrix;
+};
 
-layout(set = 0, binding = 0) uniform globalUBO
+struct InstanceData
 {
-    mat4 viewMat;
-    mat4 projMat;
-    mat4 lightMVP;
+    mat4 transform;
+    vec4 tint;
 };
 
-layout( push_constant ) uniform modelMat
+// Bindless models keep their instance buffer in the per model set.
+#ifdef BINDLESS
+layout(std430, set = 1, binding = 0) readonly buffer instanceBuffer
+#else
+layout(std430, set = 0, binding = 6) readonly buffer instanceBuffer
+#endif
 {
-	mat4 modelMatrix;
+    InstanceData instances[];
 };
 
 out gl_PerVertex 
@@ -22,5 +32,5 @@ out gl_PerVertex
 
 void main()
 {
-	gl_Position = lightMVP * modelMatrix * vec4(a_Position, 1.0);
+	gl_Position = cascadeViewProjMatrix * modelMatrix * instances[gl_InstanceIndex].transform * vec4(a_Position, 1.0);
 }
\ No newline at end of file
@@ -3,18 +3,54 @@
 #include "Scene.h"
 
 #include <memory>
+#include <string>
 
 class VulkanContext;
 class Swapchain;
 class Camera;
 class RendererInterface;
 class Scene;
+class Benchmark;
+
+struct EngineSettings
+{
+    // Renders into offscreen images instead of a window. GLFW is never initialized, so this runs on machines without a
+    // display or GPU, e.g. on lavapipe.
+    bool     Headless = false;
+    uint32_t Width    = 1920;
+    uint32_t Height   = 1080;
+
+    // Headless runs advance by a fixed timestep and stop after FrameCount frames, so they are repeatable.
+    uint32_t FrameCount    = 600;
+    float    FixedTimestep = 1.0f / 60.0f;
+    // The last headless frame is written here as a binary PPM, relative to the Engine directory. Empty skips it.
+    std::string OutputImagePath;
+
+    // Seeds the particles and the light flicker. 0 seeds them from the clock.
+    uint32_t RandomSeed = 0;
+
+    // Plays this camera path instead of taking input and writes CPU and GPU frame time percentiles per path segment to
+    // BenchmarkOutput. Runs with the fixed timestep until the path ends, FrameCount is ignored. The paths are relative to
+    // the Engine directory, an empty output path picks a timestamped one under benchmarks/.
+    std::string BenchmarkPath;
+    std::string BenchmarkOutput;
+    // An earlier report to compare with. Run returns 1 if a segment got slower than the threshold allows.
+    std::string BaselinePath;
+    float       RegressionThreshold = 0.05f;
+    // Frames rendered at the start of the path before measuring.
+    uint32_t WarmupFrames = 60;
+};
 
 class Engine
 {
    public:
-    void Init();
-    void Run();
+    // --headless, --frames <count>, --size <width>x<height>, --timestep <seconds>, --output <path>, --seed <seed>,
+    // --benchmark <camera path>, --benchmark-output <path>, --baseline <path>, --threshold <fraction> and --warmup <frames>.
+    static EngineSettings ParseCommandLine(int InArgc, char** InArgv);
+
+    void Init(const EngineSettings& InSettings = EngineSettings());
+    // Returns the process exit code, non zero when a benchmark regressed.
+    int Run();
 
     static Engine& Get();
 
@@ -31,6 +67,7 @@ class Engine
     Ref<Swapchain>            _Swapchain = nullptr;
     Ref<Camera>               _Camera    = nullptr;
     Unique<VulkanContext>     _Context   = nullptr;
+    Ref<Benchmark>            _Benchmark = nullptr;
 
     Ref<Scene> _ActiveScene              = nullptr;
 
@@ -41,7 +78,8 @@ class Engine
     float CalculateDeltaTime();
 
    private:
-    float _LastFrameTime = 0.0f;
+    EngineSettings _Settings;
+    float          _LastFrameTime = 0.0f;
 
     friend class EngineInternal;
 };
\ No newline at end of file
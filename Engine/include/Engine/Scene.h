@@ -29,6 +29,9 @@ class Scene
     void                           AddModel(Ref<Model> InModel);
     const std::vector<Ref<Model>>& GetModels() const;
 
+    // Places another instance of the model, adding the model to the scene first if needed. Returns the instance index.
+    uint32_t AddModelInstance(Ref<Model> InModel, const glm::mat4& InTransform, const glm::vec4& InTint = glm::vec4(1.0f));
+
     void                      AddLight(const Light& InLight);
     const std::vector<Light>& GetLights() const;
 
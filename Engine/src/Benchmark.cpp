@@ -0,0 +1,261 @@
+#include "Benchmark.h"
+#include "Camera.h"
+#include "EngineInternal.h"
+#include "PhysicalDevice.h"
+
+// External
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+// Differences below this are noise even when they exceed the threshold, e.g. on passes that take a few microseconds.
+constexpr float REGRESSION_NOISE_FLOOR_MS = 0.05f;
+
+// Reads a value back from a report. Every segment is written on its own line, as { "name": ..., "cpu": { ... }, ... }.
+bool ReadReportValue(const std::string& InLine, const std::string& InGroup, const std::string& InKey, float& OutValue)
+{
+    size_t group = InLine.find("\"" + InGroup + "\": {");
+    if (group == std::string::npos)
+        return false;
+
+    size_t end = InLine.find('}', group);
+    size_t key = InLine.find("\"" + InKey + "\": ", group);
+    if (key == std::string::npos || key > end)
+        return false;
+
+    OutValue = strtof(InLine.c_str() + key + InKey.size() + 4, nullptr);
+    return true;
+}
+
+std::string ReadReportName(const std::string& InLine)
+{
+    const std::string prefix = "\"name\": \"";
+    size_t            start  = InLine.find(prefix);
+    if (start == std::string::npos)
+        return std::string();
+
+    start += prefix.size();
+    return InLine.substr(start, InLine.find('"', start) - start);
+}
+} // namespace
+
+Benchmark::Benchmark(const EngineSettings& InSettings, CameraPath&& InPath)
+    : _Settings(InSettings), _Path(std::move(InPath)), _WarmupFrames(InSettings.WarmupFrames)
+{
+    _MeasuredFrameCount = (uint32_t)(_Path.GetDuration() / _Settings.FixedTimestep) + 1;
+    _Samples.reserve(_MeasuredFrameCount);
+
+    PrintInfo(
+        "Benchmarking " + std::to_string(_MeasuredFrameCount) + " frames after " + std::to_string(_WarmupFrames) +
+        " warmup frames.");
+}
+
+float Benchmark::GetPathTime() const
+{
+    // Frame index times the step, so the camera lands on the same spots no matter how long a run has been going.
+    uint32_t measuredFrame = _FrameIndex > _WarmupFrames ? _FrameIndex - _WarmupFrames : 0;
+    return (float)measuredFrame * _Settings.FixedTimestep;
+}
+
+void Benchmark::BeginFrame(Camera& InCamera)
+{
+    _Path.Apply(GetPathTime(), InCamera);
+}
+
+void Benchmark::EndFrame(float InCPUMilliseconds)
+{
+    if (_FrameIndex >= _WarmupFrames && !IsFinished())
+        _Samples.push_back(FrameSample{ _Path.GetSegmentIndex(GetPathTime()), InCPUMilliseconds });
+    _FrameIndex++;
+}
+
+void Benchmark::AddGPUFrameTimes(const std::vector<GPUFrameTime>& InFrameTimes)
+{
+    for (const GPUFrameTime& frameTime : InFrameTimes)
+    {
+        if (frameTime.Frame < _WarmupFrames || frameTime.Frame - _WarmupFrames >= _Samples.size())
+            continue;
+        _Samples[frameTime.Frame - _WarmupFrames].GPUMilliseconds = frameTime.Milliseconds;
+    }
+}
+
+Benchmark::Summary Benchmark::Summarize(uint32_t InSegment, bool InGPU) const
+{
+    std::vector<float> values;
+    for (const FrameSample& sample : _Samples)
+    {
+        if (InSegment != UINT32_MAX && sample.Segment != InSegment)
+            continue;
+
+        float value = InGPU ? sample.GPUMilliseconds : sample.CPUMilliseconds;
+        if (value >= 0.0f)
+            values.push_back(value);
+    }
+
+    Summary summary;
+    if (values.empty())
+        return summary;
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](float p) { return values[std::min(values.size() - 1, (size_t)(p * values.size()))]; };
+
+    float sum = 0.0f;
+    for (float value : values)
+        sum += value;
+
+    summary.Frames  = (uint32_t)values.size();
+    summary.Average = sum / values.size();
+    summary.P50     = percentile(0.50f);
+    summary.P95     = percentile(0.95f);
+    summary.P99     = percentile(0.99f);
+    summary.Maximum = values.back();
+    return summary;
+}
+
+bool Benchmark::WriteReport(const std::string& InPath, const std::string& InBaselinePath) const
+{
+    // Segment name and its line in the report. The total is the last line, named "Total".
+    const std::vector<CameraPath::Segment>& segments = _Path.GetSegments();
+    std::vector<std::pair<std::string, std::string>> lines;
+
+    auto writeSummary = [](std::ostream& InStream, const char* InGroup, const Summary& InSummary)
+    {
+        InStream << "\"" << InGroup << "\": { \"frames\": " << InSummary.Frames << ", \"avg_ms\": " << InSummary.Average
+                 << ", \"p50_ms\": " << InSummary.P50 << ", \"p95_ms\": " << InSummary.P95 << ", \"p99_ms\": " << InSummary.P99
+                 << ", \"max_ms\": " << InSummary.Maximum << " }";
+    };
+    auto writeLine = [&](const std::string& InName, uint32_t InSegment, float InStartTime)
+    {
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(4) << "{ \"name\": \"" << InName << "\", \"start_s\": " << InStartTime << ", ";
+        writeSummary(line, "cpu", Summarize(InSegment, false));
+        line << ", ";
+        writeSummary(line, "gpu", Summarize(InSegment, true));
+        line << " }";
+        lines.emplace_back(InName, line.str());
+    };
+
+    for (uint32_t i = 0; i < segments.size(); i++)
+        writeLine(segments[i].Name, i, segments[i].StartTime);
+    writeLine("Total", UINT32_MAX, 0.0f);
+
+    // Compare the medians and the p95s with the baseline.
+    std::vector<std::string> regressions;
+    if (!InBaselinePath.empty())
+    {
+        std::filesystem::path baselinePath = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/" + InBaselinePath);
+        std::ifstream         baselineFile(baselinePath);
+        if (!baselineFile.is_open())
+        {
+            PrintWarning("Failed to open the baseline " + baselinePath.string() + ", nothing was compared.");
+        }
+        else
+        {
+            std::unordered_map<std::string, std::string> baselineLines;
+            std::string                                  baselineLine;
+            while (std::getline(baselineFile, baselineLine))
+            {
+                std::string name = ReadReportName(baselineLine);
+                if (!name.empty())
+                    baselineLines[name] = baselineLine;
+            }
+
+            for (const auto& [name, line] : lines)
+            {
+                auto baseline = baselineLines.find(name);
+                if (baseline == baselineLines.end())
+                {
+                    PrintWarning("Segment " + name + " is not in the baseline.");
+                    continue;
+                }
+
+                for (const char* group : { "cpu", "gpu" })
+                {
+                    for (const char* key : { "p50_ms", "p95_ms" })
+                    {
+                        float baselineValue = 0.0f, currentValue = 0.0f, baselineFrames = 0.0f, currentFrames = 0.0f;
+                        if (!ReadReportValue(baseline->second, group, key, baselineValue) ||
+                            !ReadReportValue(baseline->second, group, "frames", baselineFrames) ||
+                            !ReadReportValue(line, group, key, currentValue) ||
+                            !ReadReportValue(line, group, "frames", currentFrames) || baselineFrames == 0.0f ||
+                            currentFrames == 0.0f)
+                            continue;
+
+                        float change = baselineValue > 0.0f ? currentValue / baselineValue - 1.0f : 0.0f;
+
+                        std::ostringstream comparison;
+                        comparison << std::fixed << std::setprecision(3) << name << " " << group << " " << key << ": "
+                                   << baselineValue << " -> " << currentValue << " (" << std::showpos
+                                   << std::setprecision(1) << change * 100.0f << "%)";
+
+                        if (change > _Settings.RegressionThreshold &&
+                            currentValue - baselineValue > REGRESSION_NOISE_FLOOR_MS)
+                        {
+                            PrintWarning("Regression: " + comparison.str());
+                            regressions.push_back(
+                                std::string("{ \"segment\": \"") + name + "\", \"metric\": \"" + group + "." + key + "\" }");
+                        }
+                        else
+                        {
+                            PrintInfo(comparison.str());
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::filesystem::path fullPath = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/" + InPath);
+    std::error_code       error;
+    std::filesystem::create_directories(fullPath.parent_path(), error);
+
+    std::ofstream file(fullPath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        PrintWarning("Failed to open " + fullPath.string() + " for writing.");
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(4) << "{\n";
+    file << "  \"path\": \"" << _Settings.BenchmarkPath << "\",\n";
+    file << "  \"device\": \"" << EngineInternal::GetContext().GetPhysicalDevice()->GetVKProperties().deviceName << "\",\n";
+    file << "  \"width\": " << _Settings.Width << ",\n  \"height\": " << _Settings.Height << ",\n";
+    file << "  \"headless\": " << (_Settings.Headless ? "true" : "false") << ",\n";
+    file << "  \"timestep_s\": " << _Settings.FixedTimestep << ",\n  \"seed\": " << _Settings.RandomSeed << ",\n";
+    file << "  \"warmup_frames\": " << _WarmupFrames << ",\n  \"frames\": " << _Samples.size() << ",\n";
+    file << "  \"complete\": " << (IsFinished() ? "true" : "false") << ",\n";
+
+    file << "  \"segments\": [\n";
+    for (size_t i = 0; i + 1 < lines.size(); i++)
+        file << "    " << lines[i].second << (i + 2 < lines.size() ? ",\n" : "\n");
+    file << "  ],\n";
+    file << "  \"total\": " << lines.back().second << ",\n";
+
+    file << "  \"baseline\": \"" << InBaselinePath << "\",\n  \"threshold\": " << _Settings.RegressionThreshold << ",\n";
+    file << "  \"regressions\": [";
+    for (size_t i = 0; i < regressions.size(); i++)
+        file << (i == 0 ? "\n    " : ",\n    ") << regressions[i];
+    file << (regressions.empty() ? "]\n" : "\n  ]\n") << "}\n";
+
+    Summary cpu = Summarize(UINT32_MAX, false);
+    Summary gpu = Summarize(UINT32_MAX, true);
+
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(2) << "Benchmark: CPU p50 " << cpu.P50 << " / p95 " << cpu.P95 << " / p99 "
+           << cpu.P99 << " ms, GPU p50 " << gpu.P50 << " / p95 " << gpu.P95 << " / p99 " << gpu.P99 << " ms. Report written to "
+           << fullPath.string();
+    PrintInfo(result.str());
+
+    if (!regressions.empty())
+    {
+        PrintError(std::to_string(regressions.size()) + " metrics regressed against the baseline.");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "CameraPath.h"
+#include "Engine.h"
+#include "GPUProfiler.h"
+#include "core.h"
+
+// External
+#include <string>
+#include <vector>
+
+class Camera;
+
+// Plays a camera path with a fixed timestep and reports CPU and GPU frame time percentiles per path segment.
+//
+// The first frames hold the camera at the start of the path and aren't measured, so pipeline compiles and first uploads
+// stay out of the numbers. The report is JSON and can be compared against an earlier report used as the baseline. A
+// segment regresses when its p50 or p95 got slower than the baseline by more than the threshold.
+class Benchmark
+{
+   public:
+    Benchmark(const EngineSettings& InSettings, CameraPath&& InPath);
+
+    // Places the camera for the frame about to be rendered.
+    void BeginFrame(Camera& InCamera);
+    // Wall time of the frame that was just submitted, waits for the GPU and the frame pacer included.
+    void EndFrame(float InCPUMilliseconds);
+    // GPU times arrive a few frames late, they are matched to their frames by number.
+    void AddGPUFrameTimes(const std::vector<GPUFrameTime>& InFrameTimes);
+
+    bool IsFinished() const
+    {
+        return _FrameIndex >= _WarmupFrames + _MeasuredFrameCount;
+    }
+
+    // Paths are relative to the Engine directory, an empty baseline path skips the comparison. Returns false if the
+    // report can't be written or a segment regressed.
+    bool WriteReport(const std::string& InPath, const std::string& InBaselinePath) const;
+
+   private:
+    struct FrameSample
+    {
+        uint32_t Segment;
+        float    CPUMilliseconds;
+        float    GPUMilliseconds = -1.0f; // Negative until the GPU time arrived.
+    };
+
+    struct Summary
+    {
+        uint32_t Frames  = 0;
+        float    Average = 0.0f;
+        float    P50     = 0.0f;
+        float    P95     = 0.0f;
+        float    P99     = 0.0f;
+        float    Maximum = 0.0f;
+    };
+
+    // Summarizes the samples of one segment, or of all of them for UINT32_MAX.
+    Summary Summarize(uint32_t InSegment, bool InGPU) const;
+    float   GetPathTime() const;
+
+   private:
+    EngineSettings _Settings;
+    CameraPath     _Path;
+    uint32_t       _WarmupFrames;
+    uint32_t       _MeasuredFrameCount;
+    uint32_t       _FrameIndex = 0; // Frames rendered so far, warmup included.
+
+    std::vector<FrameSample> _Samples; // One per measured frame.
+};
@@ -0,0 +1,226 @@
+#include "BindlessMaterials.h"
+#include "DescriptorSet.h"
+#include "Image.h"
+#include "LogicalDevice.h"
+#include "SamplerCache.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <array>
+
+// Upper bound for the model sets allocated from the table's pool.
+#define BINDLESS_MAX_MODEL_SETS 64
+
+BindlessMaterials::BindlessMaterials(
+    VulkanContext& InContext,
+    uint32_t       InMaxTextures,
+    uint32_t       InMaxMaterials,
+    uint32_t       InPointShadowCount)
+    : _Context(InContext), _MaxTextures(InMaxTextures), _MaxMaterials(InMaxMaterials), _PointShadowCount(InPointShadowCount)
+{
+    ASSERT(_Context.GetDevice()->SupportsBindlessTextures(), "Descriptor indexing is not supported on your GPU.");
+
+    // The texture array is only partially bound and gets new textures while the set is in use by frames in flight, which
+    // needs binding flags the DescriptorSetLayout class does not expose. The uniform buffers are dynamic so each frame in
+    // flight reads its own copy of the global blocks.
+    std::array<VkDescriptorSetLayoutBinding, 10> bindings{};
+    bindings[0] = {
+        0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr
+    };
+    bindings[1] = { 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    bindings[2] = { 5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _PointShadowCount, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    bindings[3] = { 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    bindings[4] = { 8, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _MaxTextures, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    bindings[5] = { 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    bindings[6] = { 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    bindings[7] = { 11, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+    bindings[8] = {
+        12, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_GEOMETRY_BIT, nullptr
+    };
+    bindings[9] = { 13, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr };
+
+    std::array<VkDescriptorBindingFlags, 10> bindingFlags{};
+    bindingFlags[4] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount  = bindingFlags.size();
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext        = &bindingFlagsInfo;
+    layoutInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings    = bindings.data();
+
+    VkDescriptorSetLayout globalLayout;
+    ASSERT(
+        vkCreateDescriptorSetLayout(_Context.GetDevice()->GetVKDevice(), &layoutInfo, nullptr, &globalLayout) == VK_SUCCESS,
+        "Failed to create descriptor set layout!");
+    _GlobalLayout = make_s<DescriptorSetLayout>(globalLayout);
+
+    std::vector<DescriptorSetBindingSpecs> modelLayout{
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_VERTEX_BIT, 0 },
+    };
+    _ModelLayout = make_s<DescriptorSetLayout>(modelLayout);
+
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 4 };
+    poolSizes[1] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 + _PointShadowCount + _MaxTextures };
+    poolSizes[2] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 + BINDLESS_MAX_MODEL_SETS };
+
+    // Model sets are freed when a growing instance buffer moves its model to a new set.
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.poolSizeCount = poolSizes.size();
+    poolInfo.pPoolSizes    = poolSizes.data();
+    poolInfo.maxSets       = 1 + BINDLESS_MAX_MODEL_SETS;
+
+    VkDescriptorPool pool;
+    ASSERT(
+        vkCreateDescriptorPool(_Context.GetDevice()->GetVKDevice(), &poolInfo, nullptr, &pool) == VK_SUCCESS,
+        "Failed to create descriptor pool!");
+    _DescriptorPool = std::make_unique<DescriptorPool>(pool);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = _DescriptorPool->GetDescriptorPool();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &_GlobalLayout->GetDescriptorLayout();
+
+    VkResult rslt = vkAllocateDescriptorSets(_Context.GetDevice()->GetVKDevice(), &allocInfo, &_GlobalSet);
+    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+
+    // Materials are written once at load time, so the buffer stays in host visible memory.
+    VkDeviceSize materialBufferSize = sizeof(MaterialData) * _MaxMaterials;
+    Utils::CreateVKBuffer(
+        materialBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        _MaterialBuffer,
+        _MaterialBufferMemory);
+    vkMapMemory(
+        _Context.GetDevice()->GetVKDevice(), _MaterialBufferMemory, 0, materialBufferSize, 0, (void**)&_MappedMaterialBuffer);
+    Utils::UpdateDescriptorSet(_GlobalSet, _MaterialBuffer, 0, materialBufferSize, 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+BindlessMaterials::~BindlessMaterials()
+{
+    vkUnmapMemory(_Context.GetDevice()->GetVKDevice(), _MaterialBufferMemory);
+    vkDestroyBuffer(_Context.GetDevice()->GetVKDevice(), _MaterialBuffer, nullptr);
+    vkFreeMemory(_Context.GetDevice()->GetVKDevice(), _MaterialBufferMemory, nullptr);
+}
+
+uint32_t BindlessMaterials::RegisterMaterial(
+    const Ref<Image>& InAlbedo,
+    const Ref<Image>& InNormal,
+    const Ref<Image>& InRoughnessMetallic)
+{
+    ASSERT(_MaterialCount < _MaxMaterials, "Bindless material buffer is full.");
+
+    MaterialData material;
+    material.Albedo            = RegisterTexture(InAlbedo);
+    material.Normal            = RegisterTexture(InNormal);
+    material.RoughnessMetallic = RegisterTexture(InRoughnessMetallic);
+
+    _MappedMaterialBuffer[_MaterialCount] = material;
+    return _MaterialCount++;
+}
+
+uint32_t BindlessMaterials::RegisterTexture(const Ref<Image>& InTexture)
+{
+    auto it = _TextureIndices.find(InTexture.get());
+    if (it != _TextureIndices.end())
+        return it->second;
+
+    ASSERT(_Textures.size() < _MaxTextures, "Bindless texture array is full.");
+
+    uint32_t     index   = (uint32_t)_Textures.size();
+    Ref<Sampler> sampler = _Context.GetSamplerCache()->GetTextureSampler(
+        ImageType::COLOR, VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_TRUE);
+    Utils::UpdateDescriptorSet(
+        _GlobalSet, sampler->GetHandle(), InTexture->GetImageView(), 8, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, index);
+
+    _Samplers.push_back(sampler);
+    _Textures.push_back(InTexture);
+    _TextureIndices[InTexture.get()] = index;
+    return index;
+}
+
+void BindlessMaterials::SetUniformBuffer(uint32_t InBinding, VkBuffer InBuffer, VkDeviceSize InOffset, VkDeviceSize InSize)
+{
+    Utils::UpdateDescriptorSet(_GlobalSet, InBuffer, InOffset, InSize, InBinding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+}
+
+void BindlessMaterials::SetShadowMaps(const Ref<Image>& InShadowMap, const std::vector<Ref<Image>>& InPointShadowMaps)
+{
+    ASSERT(InPointShadowMaps.size() <= _PointShadowCount, "More point shadow maps than the global layout can hold.");
+
+    Ref<Sampler> sampler = _Context.GetSamplerCache()->GetTextureSampler(
+        ImageType::DEPTH, VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
+    Utils::UpdateDescriptorSet(
+        _GlobalSet, sampler->GetHandle(), InShadowMap->GetImageView(), 4, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+    _Samplers.push_back(sampler);
+
+    for (uint32_t i = 0; i < InPointShadowMaps.size(); i++)
+    {
+        sampler = _Context.GetSamplerCache()->GetCubemapSampler();
+        Utils::UpdateDescriptorSet(
+            _GlobalSet,
+            sampler->GetHandle(),
+            InPointShadowMaps[i]->GetImageView(),
+            5,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+            i);
+        _Samplers.push_back(sampler);
+    }
+}
+
+void BindlessMaterials::SetLightBuffers(
+    VkBuffer     InLightBuffer,
+    VkDeviceSize InLightBufferSize,
+    VkBuffer     InClusterBuffer,
+    VkDeviceSize InClusterBufferSize)
+{
+    Utils::UpdateDescriptorSet(_GlobalSet, InLightBuffer, 0, InLightBufferSize, 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    Utils::UpdateDescriptorSet(_GlobalSet, InClusterBuffer, 0, InClusterBufferSize, 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+VkDescriptorSet BindlessMaterials::AllocateModelSet()
+{
+    VkDescriptorSet             modelSet;
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = _DescriptorPool->GetDescriptorPool();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &_ModelLayout->GetDescriptorLayout();
+
+    VkResult rslt = vkAllocateDescriptorSets(_Context.GetDevice()->GetVKDevice(), &allocInfo, &modelSet);
+    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+    return modelSet;
+}
+
+void BindlessMaterials::FreeModelSet(VkDescriptorSet InModelSet)
+{
+    vkFreeDescriptorSets(_Context.GetDevice()->GetVKDevice(), _DescriptorPool->GetDescriptorPool(), 1, &InModelSet);
+}
+
+void BindlessMaterials::Bind(
+    const VkCommandBuffer&  InCommandBuffer,
+    const VkPipelineLayout& InPipelineLayout,
+    uint32_t                InUniformOffset)
+{
+    std::array<uint32_t, 4> dynamicOffsets;
+    dynamicOffsets.fill(InUniformOffset);
+    vkCmdBindDescriptorSets(
+        InCommandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        InPipelineLayout,
+        0,
+        1,
+        &_GlobalSet,
+        (uint32_t)dynamicOffsets.size(),
+        dynamicOffsets.data());
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class Image;
+class Sampler;
+class DescriptorPool;
+class DescriptorSetLayout;
+class VulkanContext;
+
+// Material table for descriptor indexing capable devices. Every material texture lives in one large sampler array and
+// every material is an entry of a storage buffer that indexes into it. Together with the uniform buffer and the shadow maps
+// this forms a single global set (set 0) that is bound once per pass. Each model owns a small set (set 1) holding its
+// instance buffer, so a model costs one descriptor bind no matter how many meshes or materials it has.
+//
+// Global set:  0 view uniforms, 4 directional shadow map, 5 point shadow maps, 7 material buffer, 8 material textures,
+//              9 clustered lights, 10 light clusters, 11 frame uniforms, 12 point shadow uniforms, 13 static uniforms.
+// Model set:   0 instance buffer.
+class BindlessMaterials
+{
+   public:
+    BindlessMaterials(VulkanContext& InContext, uint32_t InMaxTextures, uint32_t InMaxMaterials, uint32_t InPointShadowCount);
+    ~BindlessMaterials();
+
+    // Returns the index of the new material in the material buffer. Textures that are already in the table are reused.
+    uint32_t RegisterMaterial(const Ref<Image>& InAlbedo, const Ref<Image>& InNormal, const Ref<Image>& InRoughnessMetallic);
+
+    // The uniform buffers are dynamic, the offset given to Bind is added to InOffset.
+    void SetUniformBuffer(uint32_t InBinding, VkBuffer InBuffer, VkDeviceSize InOffset, VkDeviceSize InSize);
+    void SetShadowMaps(const Ref<Image>& InShadowMap, const std::vector<Ref<Image>>& InPointShadowMaps);
+    void SetLightBuffers(
+        VkBuffer     InLightBuffer,
+        VkDeviceSize InLightBufferSize,
+        VkBuffer     InClusterBuffer,
+        VkDeviceSize InClusterBufferSize);
+
+    VkDescriptorSet AllocateModelSet();
+    // The set must no longer be used by any frame in flight.
+    void FreeModelSet(VkDescriptorSet InModelSet);
+
+    // Binds the global set at set 0. Needs to be repeated after every pipeline bind since the pipelines of different passes
+    // have different push constant ranges. InUniformOffset is the dynamic offset of all four uniform buffers.
+    void Bind(const VkCommandBuffer& InCommandBuffer, const VkPipelineLayout& InPipelineLayout, uint32_t InUniformOffset);
+
+    const Ref<DescriptorSetLayout>& GetGlobalLayout() const
+    {
+        return _GlobalLayout;
+    }
+    const Ref<DescriptorSetLayout>& GetModelLayout() const
+    {
+        return _ModelLayout;
+    }
+
+   private:
+    // Matches the std430 layout of the material buffer in PBRShader.frag.
+    struct MaterialData
+    {
+        uint32_t Albedo            = 0;
+        uint32_t Normal            = 0;
+        uint32_t RoughnessMetallic = 0;
+        uint32_t Padding           = 0;
+    };
+
+    uint32_t RegisterTexture(const Ref<Image>& InTexture);
+
+   private:
+    VulkanContext& _Context;
+    uint32_t       _MaxTextures;
+    uint32_t       _MaxMaterials;
+    uint32_t       _PointShadowCount;
+
+    Ref<DescriptorSetLayout> _GlobalLayout;
+    Ref<DescriptorSetLayout> _ModelLayout;
+    Unique<DescriptorPool>   _DescriptorPool;
+    VkDescriptorSet          _GlobalSet = VK_NULL_HANDLE;
+
+    VkBuffer       _MaterialBuffer       = VK_NULL_HANDLE;
+    VkDeviceMemory _MaterialBufferMemory = VK_NULL_HANDLE;
+    MaterialData*  _MappedMaterialBuffer = nullptr;
+    uint32_t       _MaterialCount        = 0;
+
+    // Images are kept alive by the table since the descriptors refer to their views.
+    std::vector<Ref<Image>>              _Textures;
+    std::unordered_map<Image*, uint32_t> _TextureIndices;
+    std::vector<Ref<Sampler>>            _Samplers;
+};
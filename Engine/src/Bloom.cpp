@@ -1,11 +1,15 @@
 #include "Bloom.h"
 #include "CommandBuffer.h"
+#include "DeletionQueue.h"
 #include "DescriptorSet.h"
 #include "EngineInternal.h"
 #include "Framebuffer.h"
+#include "GPUProfiler.h"
 #include "Image.h"
 #include "LogicalDevice.h"
 #include "Pipeline.h"
+#include "PipelineCache.h"
+#include "SamplerCache.h"
 #include "Surface.h"
 #include "Swapchain.h"
 #include "Utils.h"
@@ -30,12 +34,16 @@ Bloom::Bloom()
     std::vector<VkDescriptorType> types;
     types.clear();
     types.push_back(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-    m_DescriptorPool = std::make_unique<DescriptorPool>(200, types);
+    // Sets are freed individually when a resize replaces them.
+    m_DescriptorPool = std::make_unique<DescriptorPool>(200, types, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
 
     // Create the layouts used in the blur passes and merge.
     m_TwoSamplerLayout = std::make_unique<DescriptorSetLayout>(layout);
     m_OneSamplerLayout = std::make_unique<DescriptorSetLayout>(layout2);
 
+    m_Sampler = EngineInternal::GetContext().GetSamplerCache()->GetTextureSampler(
+        ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
+
     SetupPipelines();
 
     SetupDesciptorSets();
@@ -43,17 +51,6 @@ Bloom::Bloom()
 
 Bloom::~Bloom()
 {
-    vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_BrigtnessFilterSampler, nullptr);
-    vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_MergeSamplerHDR, nullptr);
-    vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_MergeSamplerBloom, nullptr);
-
-    for (int i = 0; i < BLUR_PASS_COUNT; i++)
-    {
-        vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_UpscalingSamplersSecond[i], nullptr);
-        vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_UpscalingSamplersFirst[i], nullptr);
-        vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_BlurSamplers[i], nullptr);
-    }
-
     vkDestroyRenderPass(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_MergeRenderPass, nullptr);
     vkDestroyRenderPass(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_BlurRenderPass, nullptr);
     vkDestroyRenderPass(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_BrightnessIsolationPass, nullptr);
@@ -62,48 +59,89 @@ Bloom::~Bloom()
 void Bloom::ConnectImageResourceToAddBloomTo(const Ref<Image>& frame)
 {
     m_HDRImage = frame;
-    if (m_FirstPassEver)
-    {
-        m_FirstPassEver          = false;
-        m_BrigtnessFilterSampler = Utils::CreateSampler(
-            m_HDRImage, ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
-    }
-    else
-    {
-        vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_BrigtnessFilterSampler, nullptr);
-        m_BrigtnessFilterSampler = Utils::CreateSampler(
-            m_HDRImage, ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
-    }
     Utils::UpdateDescriptorSet(
         m_BrigtnessFilterDescriptorSet,
-        m_BrigtnessFilterSampler,
+        m_Sampler->GetHandle(),
         m_HDRImage->GetImageView(),
         0,
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
     // Merge pass.
-    m_MergeSamplerHDR = Utils::CreateSampler(
-        m_HDRImage, ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
-    m_MergeSamplerBloom = Utils::CreateSampler(
-        m_UpscalingColorBuffers[BLUR_PASS_COUNT - 1],
-        ImageType::COLOR,
-        VK_FILTER_LINEAR,
-        VK_FILTER_LINEAR,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        VK_FALSE);
-
     Utils::UpdateDescriptorSet(
-        m_MergeDescriptorSet, m_MergeSamplerHDR, m_HDRImage->GetImageView(), 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        m_MergeDescriptorSet, m_Sampler->GetHandle(), m_HDRImage->GetImageView(), 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     Utils::UpdateDescriptorSet(
         m_MergeDescriptorSet,
-        m_MergeSamplerBloom,
+        m_Sampler->GetHandle(),
         m_UpscalingColorBuffers[BLUR_PASS_COUNT - 1]->GetImageView(),
         1,
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
-void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
+void Bloom::Resize(const Ref<Image>& frame)
 {
+    ReleaseResources();
+
+    CreateFramebuffers();
+    SetupDesciptorSets();
+    ConnectImageResourceToAddBloomTo(frame);
+}
+
+void Bloom::ReleaseResources()
+{
+    if (!HasResources())
+        return;
+
+    Ref<DeletionQueue> deletionQueue = EngineInternal::GetContext().GetDeletionQueue();
+
+    deletionQueue->Retire(m_BrightnessIsolatedImage);
+    deletionQueue->Retire(Ref<Framebuffer>(std::move(m_BrightnessIsolatedFramebuffer)));
+    deletionQueue->Retire(m_MergeColorBuffer);
+    deletionQueue->Retire(Ref<Framebuffer>(std::move(m_MergeFramebuffer)));
+    for (int i = 0; i < BLUR_PASS_COUNT; i++)
+    {
+        deletionQueue->Retire(m_BlurColorBuffers[i]);
+        deletionQueue->Retire(Ref<Framebuffer>(std::move(m_BlurFramebuffers[i])));
+        deletionQueue->Retire(m_UpscalingColorBuffers[i]);
+        deletionQueue->Retire(Ref<Framebuffer>(std::move(m_UpscalingFramebuffers[i])));
+    }
+
+    std::vector<VkDescriptorSet> descriptorSets = { m_BrigtnessFilterDescriptorSet, m_MergeDescriptorSet };
+    descriptorSets.insert(descriptorSets.end(), std::begin(m_BlurDescriptorSets), std::end(m_BlurDescriptorSets));
+    descriptorSets.insert(descriptorSets.end(), std::begin(m_UpscalingDescriptorSets), std::end(m_UpscalingDescriptorSets));
+
+    VkDevice         device = EngineInternal::GetContext().GetDevice()->GetVKDevice();
+    VkDescriptorPool pool   = m_DescriptorPool->GetDescriptorPool();
+    deletionQueue->Retire(
+        [device, pool, descriptorSets]()
+        { vkFreeDescriptorSets(device, pool, (uint32_t)descriptorSets.size(), descriptorSets.data()); });
+
+    m_BrightnessIsolatedImage = nullptr;
+    m_MergeColorBuffer        = nullptr;
+    for (int i = 0; i < BLUR_PASS_COUNT; i++)
+    {
+        m_BlurColorBuffers[i]      = nullptr;
+        m_UpscalingColorBuffers[i] = nullptr;
+    }
+}
+
+void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer, GPUProfiler* profiler)
+{
+    // No pipeline has a fixed viewport, so they survive resizes and the blur and upscale pipelines are shared by all passes.
+    // The viewport follows the framebuffer being drawn to.
+    auto setViewport = [&cmdBuffer](const Unique<Framebuffer>& framebuffer)
+    {
+        VkViewport viewport{};
+        viewport.width    = (float)framebuffer->GetWidth();
+        viewport.height   = (float)framebuffer->GetHeight();
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.extent = { framebuffer->GetWidth(), framebuffer->GetHeight() };
+        vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+    };
+
     VkClearValue clearValues                                       = { 0.8f, 0.1f, 0.1f, 1.0f };
 
     m_BrightnessFilterRenderPassBeginInfo.sType                    = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -116,8 +154,11 @@ void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
     m_BrightnessFilterRenderPassBeginInfo.renderArea.extent.height = m_BrightnessIsolatedFramebuffer->GetHeight();
     m_BrightnessFilterRenderPassBeginInfo.renderArea.extent.width  = m_BrightnessIsolatedFramebuffer->GetWidth();
 
+    if (profiler)
+        profiler->BeginScope(cmdBuffer, "Brightness");
     CommandBuffer::BeginRenderPass(cmdBuffer, m_BrightnessFilterRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
     CommandBuffer::BindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_BrightnessFilterPipeline);
+    setViewport(m_BrightnessIsolatedFramebuffer);
     vkCmdBindDescriptorSets(
         cmdBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -129,11 +170,14 @@ void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
         nullptr);
     vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
     CommandBuffer::EndRenderPass(cmdBuffer);
+    if (profiler)
+        profiler->EndScope(cmdBuffer);
 
     VkDeviceSize offset = { 0 };
     // Blur pass.
     for (int i = 0; i < BLUR_PASS_COUNT; i++)
     {
+        GPUProfileScope scope(profiler, cmdBuffer, "Downsample " + std::to_string(i));
         clearValues = { 0.8f, 0.1f, 0.1f, 1.0f };
 
         // Downscaling pass
@@ -149,6 +193,7 @@ void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
 
         CommandBuffer::BeginRenderPass(cmdBuffer, m_BlurRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
         CommandBuffer::BindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_BlurPipelines[i]);
+        setViewport(m_BlurFramebuffers[i]);
         vkCmdBindDescriptorSets(
             cmdBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -165,6 +210,7 @@ void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
     // Upscaling pass.
     for (int i = 0; i < BLUR_PASS_COUNT; i++)
     {
+        GPUProfileScope scope(profiler, cmdBuffer, "Upsample " + std::to_string(i));
         clearValues                                             = { 0.8f, 0.1f, 0.1f, 1.0f };
 
         m_UpscalingRenderPassBeginInfo.sType                    = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -179,6 +225,7 @@ void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
 
         CommandBuffer::BeginRenderPass(cmdBuffer, m_UpscalingRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
         CommandBuffer::BindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_UpscalingPipelines[i]);
+        setViewport(m_UpscalingFramebuffers[i]);
         vkCmdBindDescriptorSets(
             cmdBuffer,
             VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -204,8 +251,11 @@ void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
     m_MergeRenderPassBeginInfo.renderArea.extent.height = m_MergeFramebuffer->GetHeight();
     m_MergeRenderPassBeginInfo.renderArea.extent.width  = m_MergeFramebuffer->GetWidth();
 
+    if (profiler)
+        profiler->BeginScope(cmdBuffer, "Merge");
     CommandBuffer::BeginRenderPass(cmdBuffer, m_MergeRenderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
     CommandBuffer::BindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_MergePipeline);
+    setViewport(m_MergeFramebuffer);
     vkCmdBindDescriptorSets(
         cmdBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -217,6 +267,8 @@ void Bloom::ApplyBloom(const VkCommandBuffer& cmdBuffer)
         nullptr);
     vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
     CommandBuffer::EndRenderPass(cmdBuffer);
+    if (profiler)
+        profiler->EndScope(cmdBuffer);
 }
 
 void Bloom::CreateRenderPasses()
@@ -496,32 +548,18 @@ void Bloom::SetupDesciptorSets()
     {
         if (i == 0)
         {
-            m_BlurSamplers[i] = Utils::CreateSampler(
-                m_BrightnessIsolatedImage,
-                ImageType::COLOR,
-                VK_FILTER_LINEAR,
-                VK_FILTER_LINEAR,
-                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                VK_FALSE);
             Utils::UpdateDescriptorSet(
                 m_BlurDescriptorSets[i],
-                m_BlurSamplers[i],
+                m_Sampler->GetHandle(),
                 m_BrightnessIsolatedImage->GetImageView(),
                 0,
                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         }
         else
         {
-            m_BlurSamplers[i] = Utils::CreateSampler(
-                m_BlurColorBuffers[i - 1],
-                ImageType::COLOR,
-                VK_FILTER_LINEAR,
-                VK_FILTER_LINEAR,
-                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                VK_FALSE);
             Utils::UpdateDescriptorSet(
                 m_BlurDescriptorSets[i],
-                m_BlurSamplers[i],
+                m_Sampler->GetHandle(),
                 m_BlurColorBuffers[i - 1]->GetImageView(),
                 0,
                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -534,77 +572,41 @@ void Bloom::SetupDesciptorSets()
         if (i == 0)
         {
             // Grab the last two results.
-            m_UpscalingSamplersFirst[i] = Utils::CreateSampler(
-                m_BlurColorBuffers[a],
-                ImageType::COLOR,
-                VK_FILTER_LINEAR,
-                VK_FILTER_LINEAR,
-                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                VK_FALSE);
-            m_UpscalingSamplersSecond[i] = Utils::CreateSampler(
-                m_BlurColorBuffers[a - 1],
-                ImageType::COLOR,
-                VK_FILTER_LINEAR,
-                VK_FILTER_LINEAR,
-                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                VK_FALSE);
-
             Utils::UpdateDescriptorSet(
                 m_UpscalingDescriptorSets[i],
-                m_UpscalingSamplersFirst[i],
+                m_Sampler->GetHandle(),
                 m_BlurColorBuffers[a]->GetImageView(),
                 0,
                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
             Utils::UpdateDescriptorSet(
                 m_UpscalingDescriptorSets[i],
-                m_UpscalingSamplersSecond[i],
+                m_Sampler->GetHandle(),
                 m_BlurColorBuffers[a - 1]->GetImageView(),
                 1,
                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
         }
         else
         {
-            m_UpscalingSamplersFirst[i] = Utils::CreateSampler(
-                m_UpscalingColorBuffers[i - 1],
-                ImageType::COLOR,
-                VK_FILTER_LINEAR,
-                VK_FILTER_LINEAR,
-                VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                VK_FALSE);
             Utils::UpdateDescriptorSet(
                 m_UpscalingDescriptorSets[i],
-                m_UpscalingSamplersFirst[i],
+                m_Sampler->GetHandle(),
                 m_UpscalingColorBuffers[i - 1]->GetImageView(),
                 0,
                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
             if (a == 0)
             {
-                m_UpscalingSamplersSecond[i] = Utils::CreateSampler(
-                    m_BrightnessIsolatedImage,
-                    ImageType::COLOR,
-                    VK_FILTER_LINEAR,
-                    VK_FILTER_LINEAR,
-                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                    VK_FALSE);
                 Utils::UpdateDescriptorSet(
                     m_UpscalingDescriptorSets[i],
-                    m_UpscalingSamplersSecond[i],
+                    m_Sampler->GetHandle(),
                     m_BrightnessIsolatedImage->GetImageView(),
                     1,
                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
             }
             else
             {
-                m_UpscalingSamplersSecond[i] = Utils::CreateSampler(
-                    m_BlurColorBuffers[a - 1],
-                    ImageType::COLOR,
-                    VK_FILTER_LINEAR,
-                    VK_FILTER_LINEAR,
-                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-                    VK_FALSE);
                 Utils::UpdateDescriptorSet(
                     m_UpscalingDescriptorSets[i],
-                    m_UpscalingSamplersSecond[i],
+                    m_Sampler->GetHandle(),
                     m_BlurColorBuffers[a - 1]->GetImageView(),
                     1,
                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -632,9 +634,10 @@ void Bloom::SetupPipelines()
     specs.PolygonMode             = VK_POLYGON_MODE_FILL;
     specs.VertexShaderPath        = "assets/shaders/quadRenderVERT.spv";
     specs.FragmentShaderPath      = "assets/shaders/brightnessFilterFRAG.spv";
-    specs.ViewportHeight          = m_BrightnessIsolatedFramebuffer->GetHeight();
-    specs.ViewportWidth           = m_BrightnessIsolatedFramebuffer->GetWidth();
-    specs.EnableDynamicStates     = false;
+    // The viewport is set when recording, so the pipelines don't depend on the surface size.
+    specs.ViewportHeight          = UINT32_MAX;
+    specs.ViewportWidth           = UINT32_MAX;
+    specs.EnableDynamicStates     = true;
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask =
@@ -649,7 +652,7 @@ void Bloom::SetupPipelines()
 
     specs.ColorBlendAttachmentState          = colorBlendAttachment;
 
-    m_BrightnessFilterPipeline               = make_s<Pipeline>(EngineInternal::GetContext(), specs);
+    m_BrightnessFilterPipeline               = EngineInternal::GetContext().GetPipelineCache()->GetPipeline(specs);
 
     for (int i = 0; i < BLUR_PASS_COUNT; i++)
     {
@@ -668,9 +671,10 @@ void Bloom::SetupPipelines()
         specs.PolygonMode             = VK_POLYGON_MODE_FILL;
         specs.VertexShaderPath        = "assets/shaders/quadRenderVERT.spv";
         specs.FragmentShaderPath      = "assets/shaders/blurShaderFRAG.spv";
-        specs.ViewportHeight          = m_BlurFramebuffers[i]->GetHeight();
-        specs.ViewportWidth           = m_BlurFramebuffers[i]->GetWidth();
-        specs.EnableDynamicStates     = false;
+        // Every blur and upscale pass shares one pipeline whatever its size.
+        specs.ViewportHeight          = UINT32_MAX;
+        specs.ViewportWidth           = UINT32_MAX;
+        specs.EnableDynamicStates     = true;
 
         colorBlendAttachment.colorWriteMask =
             VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -684,17 +688,15 @@ void Bloom::SetupPipelines()
 
         specs.ColorBlendAttachmentState          = colorBlendAttachment;
 
-        m_BlurPipelines[i]                       = make_s<Pipeline>(EngineInternal::GetContext(), specs);
+        m_BlurPipelines[i]                       = EngineInternal::GetContext().GetPipelineCache()->GetPipeline(specs);
 
         // Blur upscaling passes.
         specs.DescriptorSetLayout = m_TwoSamplerLayout;
         specs.RenderPass          = m_BlurRenderPass;
         specs.VertexShaderPath    = "assets/shaders/quadRenderVERT.spv";
         specs.FragmentShaderPath  = "assets/shaders/upscaleShaderFRAG.spv";
-        specs.ViewportHeight      = m_UpscalingFramebuffers[i]->GetHeight();
-        specs.ViewportWidth       = m_UpscalingFramebuffers[i]->GetWidth();
 
-        m_UpscalingPipelines[i]   = make_s<Pipeline>(EngineInternal::GetContext(), specs);
+        m_UpscalingPipelines[i]   = EngineInternal::GetContext().GetPipelineCache()->GetPipeline(specs);
     }
 
     // Merge pipeline.
@@ -712,8 +714,9 @@ void Bloom::SetupPipelines()
     specs.PolygonMode             = VK_POLYGON_MODE_FILL;
     specs.VertexShaderPath        = "assets/shaders/quadRenderVERT.spv";
     specs.FragmentShaderPath      = "assets/shaders/finalPassShaderFRAG.spv";
-    specs.ViewportHeight          = m_MergeFramebuffer->GetHeight();
-    specs.ViewportWidth           = m_MergeFramebuffer->GetWidth();
+    specs.ViewportHeight          = UINT32_MAX;
+    specs.ViewportWidth           = UINT32_MAX;
+    specs.EnableDynamicStates     = true;
 
     colorBlendAttachment.colorWriteMask =
         VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -727,5 +730,5 @@ void Bloom::SetupPipelines()
 
     specs.ColorBlendAttachmentState          = colorBlendAttachment;
 
-    m_MergePipeline                          = make_u<Pipeline>(EngineInternal::GetContext(), specs);
+    m_MergePipeline                          = EngineInternal::GetContext().GetPipelineCache()->GetPipeline(specs);
 }
@@ -10,6 +10,8 @@ class Image;
 class Pipeline;
 class DescriptorSetLayout;
 class DescriptorPool;
+class Sampler;
+class GPUProfiler;
 class Bloom
 {
    public:
@@ -17,8 +19,18 @@ class Bloom
     ~Bloom();
 
    public:
-    void       ApplyBloom(const VkCommandBuffer& cmdBuffer);
+    // Each step is timed as a child of the profiler's open scope, if a profiler is given.
+    void       ApplyBloom(const VkCommandBuffer& cmdBuffer, GPUProfiler* profiler = nullptr);
     void       ConnectImageResourceToAddBloomTo(const Ref<Image>& frame);
+    // Recreates the size dependent images and the descriptor sets sampling them for the current surface size. Render
+    // passes and pipelines are kept, the old images are retired through the deletion queue.
+    void       Resize(const Ref<Image>& frame);
+    // Retires the size dependent images and descriptor sets while bloom is turned off. Resize brings them back.
+    void       ReleaseResources();
+    bool       HasResources() const
+    {
+        return m_MergeColorBuffer != nullptr;
+    }
     Ref<Image> GetPostProcessedImage()
     {
         return m_MergeColorBuffer;
@@ -30,7 +42,9 @@ class Bloom
     Ref<DescriptorSetLayout> m_TwoSamplerLayout;
     Unique<DescriptorPool>   m_DescriptorPool;
     Ref<DescriptorSetLayout> m_OneSamplerLayout;
-    bool                     m_FirstPassEver = true;
+
+    // Every pass samples its input with the same linear, clamp to edge state.
+    Ref<Sampler> m_Sampler;
 
     // Brigtness filtering resources.
     VkRenderPass          m_BrightnessIsolationPass;
@@ -38,7 +52,6 @@ class Bloom
     Unique<Framebuffer>   m_BrightnessIsolatedFramebuffer;
     Ref<Pipeline>         m_BrightnessFilterPipeline;
     VkDescriptorSet       m_BrigtnessFilterDescriptorSet;
-    VkSampler             m_BrigtnessFilterSampler;
     VkRenderPassBeginInfo m_BrightnessFilterRenderPassBeginInfo;
 
     // Blur downscaling resources.
@@ -48,7 +61,6 @@ class Bloom
     VkRenderPassBeginInfo m_BlurRenderPassBeginInfo;
     VkDescriptorSet       m_BlurDescriptorSets[BLUR_PASS_COUNT];
     Ref<Pipeline>         m_BlurPipelines[BLUR_PASS_COUNT];
-    VkSampler             m_BlurSamplers[BLUR_PASS_COUNT];
 
     // Blur upscaling resources.
     Ref<Pipeline>         m_UpscalingPipelines[BLUR_PASS_COUNT];
@@ -56,12 +68,8 @@ class Bloom
     Ref<Image>            m_UpscalingColorBuffers[BLUR_PASS_COUNT];
     Unique<Framebuffer>   m_UpscalingFramebuffers[BLUR_PASS_COUNT];
     VkDescriptorSet       m_UpscalingDescriptorSets[BLUR_PASS_COUNT];
-    VkSampler             m_UpscalingSamplersFirst[BLUR_PASS_COUNT];
-    VkSampler             m_UpscalingSamplersSecond[BLUR_PASS_COUNT];
 
     // Merge pass resources.
-    VkSampler             m_MergeSamplerBloom;
-    VkSampler             m_MergeSamplerHDR;
     VkDescriptorSet       m_MergeDescriptorSet;
     Ref<Pipeline>         m_MergePipeline;
     VkRenderPass          m_MergeRenderPass;
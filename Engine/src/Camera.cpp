@@ -10,6 +10,9 @@ Camera::Camera(float fov, float aspectRatio) : m_FOV(fov), m_AspectRatio(aspectR
 
 void Camera::OnUpdate(float deltaTime)
 {
+    if (!m_InputEnabled)
+        return;
+
     auto window = EngineInternal::GetContext().GetWindow()->GetNativeWindow();
 
     const glm::vec2& mouse{ GetMouseXOffset(), GetMouseYOffset() };
@@ -35,6 +38,15 @@ void Camera::OnUpdate(float deltaTime)
     UpdateView();
 }
 
+void Camera::SetOrbit(const glm::vec3& focalPoint, float distance, float pitch, float yaw)
+{
+    m_FocalPoint = focalPoint;
+    m_Distance   = distance;
+    m_Pitch      = pitch;
+    m_Yaw        = yaw;
+    UpdateView();
+}
+
 void Camera::UpdateProjection()
 {
     m_AspectRatio          = m_ViewportWidth / m_ViewportHeight;
@@ -24,6 +24,13 @@ class Camera
         m_ViewportWidth = width, m_ViewportHeight = height;
         UpdateProjection();
     }
+    // Places the camera directly, e.g. from a camera path.
+    void SetOrbit(const glm::vec3& focalPoint, float distance, float pitch, float yaw);
+    // OnUpdate ignores mouse and keyboard while disabled.
+    inline void SetInputEnabled(bool enabled)
+    {
+        m_InputEnabled = enabled;
+    }
 
    public:
     // Getters
@@ -35,11 +42,15 @@ class Camera
     {
         return m_Position;
     }
-    float GetPitch()
+    const glm::vec3& GetFocalPoint() const
+    {
+        return m_FocalPoint;
+    }
+    float GetPitch() const
     {
         return m_Pitch;
     }
-    float GetYaw()
+    float GetYaw() const
     {
         return m_Yaw;
     }
@@ -112,4 +123,6 @@ class Camera
     float m_Distance                 = 4.0f;
     float m_ViewportWidth            = 1280;
     float m_ViewportHeight           = 720;
+
+    bool m_InputEnabled              = true;
 };
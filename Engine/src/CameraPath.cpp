@@ -0,0 +1,185 @@
+#include "CameraPath.h"
+#include "Camera.h"
+
+// External
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <glm/gtx/spline.hpp>
+#include <iomanip>
+#include <sstream>
+
+bool CameraPath::Load(const std::string& InPath)
+{
+    std::filesystem::path fullPath = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/" + InPath);
+    std::ifstream         file(fullPath);
+    if (!file.is_open())
+    {
+        PrintError("Failed to open camera path " + fullPath.string());
+        return false;
+    }
+
+    _Keyframes.clear();
+    _Segments.clear();
+    _PendingSegment.clear();
+
+    std::string line;
+    uint32_t    lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream stream(line);
+        std::string        keyword;
+        if (!(stream >> keyword))
+            continue;
+
+        if (keyword == "segment")
+        {
+            std::string name;
+            std::getline(stream >> std::ws, name);
+            name.erase(name.find_last_not_of(" \t\r") + 1);
+            BeginSegment(name.empty() ? "Segment " + std::to_string(_Segments.size()) : name);
+        }
+        else if (keyword == "key")
+        {
+            CameraKeyframe keyframe;
+            if (stream >> keyframe.Time >> keyframe.FocalPoint.x >> keyframe.FocalPoint.y >> keyframe.FocalPoint.z >>
+                keyframe.Distance >> keyframe.Pitch >> keyframe.Yaw)
+                AddKeyframe(keyframe);
+            else
+                PrintWarning(fullPath.filename().string() + ":" + std::to_string(lineNumber) + ": malformed keyframe.");
+        }
+        else
+        {
+            PrintWarning(fullPath.filename().string() + ":" + std::to_string(lineNumber) + ": unknown entry " + keyword + ".");
+        }
+    }
+
+    if (_Keyframes.empty())
+    {
+        PrintError("Camera path " + fullPath.string() + " has no keyframes.");
+        return false;
+    }
+
+    PrintInfo(
+        "Loaded camera path " + fullPath.filename().string() + ": " + std::to_string(_Keyframes.size()) + " keyframes in " +
+        std::to_string(_Segments.size()) + " segments, " + std::to_string(GetDuration()) + " s.");
+    return true;
+}
+
+bool CameraPath::Save(const std::string& InPath) const
+{
+    std::filesystem::path fullPath = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/" + InPath);
+    std::error_code       error;
+    std::filesystem::create_directories(fullPath.parent_path(), error);
+
+    std::ofstream file(fullPath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        PrintWarning("Failed to open " + fullPath.string() + " for writing.");
+        return false;
+    }
+
+    file << "# key <time> <focal x> <focal y> <focal z> <distance> <pitch> <yaw>\n" << std::fixed << std::setprecision(4);
+
+    size_t segment = 0;
+    for (const CameraKeyframe& keyframe : _Keyframes)
+    {
+        while (segment < _Segments.size() && _Segments[segment].StartTime <= keyframe.Time)
+            file << "segment " << _Segments[segment++].Name << "\n";
+
+        file << "key " << keyframe.Time << " " << keyframe.FocalPoint.x << " " << keyframe.FocalPoint.y << " "
+             << keyframe.FocalPoint.z << " " << keyframe.Distance << " " << keyframe.Pitch << " " << keyframe.Yaw << "\n";
+    }
+
+    PrintInfo("Saved camera path with " + std::to_string(_Keyframes.size()) + " keyframes to " + fullPath.string());
+    return true;
+}
+
+void CameraPath::BeginSegment(const std::string& InName)
+{
+    _PendingSegment = InName;
+}
+
+void CameraPath::AddKeyframe(const CameraKeyframe& InKeyframe)
+{
+    if (!_Keyframes.empty() && InKeyframe.Time <= _Keyframes.back().Time)
+    {
+        PrintWarning("Dropping camera keyframe at " + std::to_string(InKeyframe.Time) + " s, times must increase.");
+        return;
+    }
+
+    // Keyframes before the first named segment still belong to one.
+    if (_Keyframes.empty() && _PendingSegment.empty())
+        _PendingSegment = "Path";
+
+    if (!_PendingSegment.empty())
+    {
+        _Segments.push_back(Segment{ _PendingSegment, InKeyframe.Time });
+        _PendingSegment.clear();
+    }
+    _Keyframes.push_back(InKeyframe);
+}
+
+void CameraPath::AddKeyframe(float InTime, const Camera& InCamera)
+{
+    AddKeyframe(
+        CameraKeyframe{ InTime, InCamera.GetFocalPoint(), InCamera.GetDistance(), InCamera.GetPitch(), InCamera.GetYaw() });
+}
+
+CameraKeyframe CameraPath::Evaluate(float InTime) const
+{
+    if (_Keyframes.empty())
+        return CameraKeyframe{};
+    if (InTime <= _Keyframes.front().Time)
+        return _Keyframes.front();
+    if (InTime >= _Keyframes.back().Time)
+        return _Keyframes.back();
+
+    // The keyframe span InTime falls into, and its neighbours as the spline's control points.
+    auto next = std::upper_bound(
+        _Keyframes.begin(),
+        _Keyframes.end(),
+        InTime,
+        [](float time, const CameraKeyframe& keyframe) { return time < keyframe.Time; });
+    size_t i1 = (size_t)(next - _Keyframes.begin());
+    size_t i0 = i1 - 1;
+    size_t im = i0 > 0 ? i0 - 1 : i0;
+    size_t i2 = std::min(i1 + 1, _Keyframes.size() - 1);
+
+    const CameraKeyframe& k0 = _Keyframes[im];
+    const CameraKeyframe& k1 = _Keyframes[i0];
+    const CameraKeyframe& k2 = _Keyframes[i1];
+    const CameraKeyframe& k3 = _Keyframes[i2];
+    float                 t  = (InTime - k1.Time) / (k2.Time - k1.Time);
+
+    auto orbit = [](const CameraKeyframe& keyframe) { return glm::vec3(keyframe.Distance, keyframe.Pitch, keyframe.Yaw); };
+
+    CameraKeyframe result;
+    result.Time       = InTime;
+    result.FocalPoint = glm::catmullRom(k0.FocalPoint, k1.FocalPoint, k2.FocalPoint, k3.FocalPoint, t);
+    glm::vec3 values  = glm::catmullRom(orbit(k0), orbit(k1), orbit(k2), orbit(k3), t);
+    result.Distance   = std::max(values.x, 0.0f);
+    result.Pitch      = values.y;
+    result.Yaw        = values.z;
+    return result;
+}
+
+void CameraPath::Apply(float InTime, Camera& InCamera) const
+{
+    CameraKeyframe keyframe = Evaluate(InTime);
+    InCamera.SetOrbit(keyframe.FocalPoint, keyframe.Distance, keyframe.Pitch, keyframe.Yaw);
+}
+
+uint32_t CameraPath::GetSegmentIndex(float InTime) const
+{
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < _Segments.size(); i++)
+    {
+        if (_Segments[i].StartTime <= InTime)
+            index = i;
+    }
+    return index;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+class Camera;
+
+struct CameraKeyframe
+{
+    float     Time = 0.0f; // Seconds from the start of the path.
+    glm::vec3 FocalPoint{ 0.0f };
+    float     Distance = 4.0f;
+    float     Pitch    = 0.0f;
+    float     Yaw      = 0.0f;
+};
+
+// A keyframed orbit camera, split into named segments that benchmarks report separately.
+//
+// Paths are plain text, one entry per line, # starts a comment:
+//     segment <name>
+//     key <time> <focal x> <focal y> <focal z> <distance> <pitch> <yaw>
+// A segment starts with the first keyframe after it. Keyframe times must increase. The camera moves on a Catmull-Rom
+// spline through the keyframes, so recorded paths with jittery samples still play back smoothly.
+class CameraPath
+{
+   public:
+    struct Segment
+    {
+        std::string Name;
+        float       StartTime = 0.0f;
+    };
+
+    // Paths are relative to the Engine directory. Load replaces the current path.
+    bool Load(const std::string& InPath);
+    bool Save(const std::string& InPath) const;
+
+    // The next keyframe starts the segment.
+    void BeginSegment(const std::string& InName);
+    // Keyframes added out of order are dropped.
+    void AddKeyframe(const CameraKeyframe& InKeyframe);
+    void AddKeyframe(float InTime, const Camera& InCamera);
+
+    // Clamps to the ends of the path.
+    CameraKeyframe Evaluate(float InTime) const;
+    void           Apply(float InTime, Camera& InCamera) const;
+    uint32_t       GetSegmentIndex(float InTime) const;
+
+    float GetDuration() const
+    {
+        return _Keyframes.empty() ? 0.0f : _Keyframes.back().Time;
+    }
+    bool IsEmpty() const
+    {
+        return _Keyframes.empty();
+    }
+    const std::vector<Segment>& GetSegments() const
+    {
+        return _Segments;
+    }
+
+   private:
+    std::vector<CameraKeyframe> _Keyframes;
+    std::vector<Segment>        _Segments;
+    std::string                 _PendingSegment; // Named by BeginSegment, waiting for its first keyframe.
+};
@@ -0,0 +1,259 @@
+#include "ClusteredLights.h"
+#include "LogicalDevice.h"
+#include "Tracer.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Radiance below which a light is considered to have no effect. Together with the attenuation in PBRShader.frag this
+// decides the range of every light. The shader fades lights out towards their range so the cut is not visible.
+#define CLUSTERED_LIGHT_CUTOFF 0.001f
+
+ClusteredLights::ClusteredLights(
+    VulkanContext& InContext,
+    uint32_t       InMaxLights,
+    uint32_t       InMaxLightIndices,
+    uint32_t       InFramesInFlight)
+    : _Context(InContext), _MaxLights(InMaxLights), _MaxLightIndices(InMaxLightIndices), _FramesInFlight(InFramesInFlight)
+{
+    _LightBufferSize = sizeof(PointLightData) * _MaxLights * _FramesInFlight;
+    Utils::CreateVKBuffer(
+        _LightBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        _LightBuffer,
+        _LightBufferMemory);
+    vkMapMemory(_Context.GetDevice()->GetVKDevice(), _LightBufferMemory, 0, _LightBufferSize, 0, (void**)&_MappedLightBuffer);
+
+    _ClusterBufferSize = sizeof(uint32_t) * GetClusterSliceOffset(_FramesInFlight);
+    Utils::CreateVKBuffer(
+        _ClusterBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        _ClusterBuffer,
+        _ClusterBufferMemory);
+    vkMapMemory(
+        _Context.GetDevice()->GetVKDevice(), _ClusterBufferMemory, 0, _ClusterBufferSize, 0, (void**)&_MappedClusterBuffer);
+
+    // Empty clusters until the first Update of each frame.
+    for (uint32_t frame = 0; frame < _FramesInFlight; frame++)
+        memset(_MappedClusterBuffer + GetClusterSliceOffset(frame), 0, sizeof(uint32_t) * CLUSTER_COUNT * 2);
+
+    _Lights.reserve(_MaxLights);
+    _ClusterMin.resize(CLUSTER_COUNT);
+    _ClusterMax.resize(CLUSTER_COUNT);
+}
+
+ClusteredLights::~ClusteredLights()
+{
+    vkUnmapMemory(_Context.GetDevice()->GetVKDevice(), _LightBufferMemory);
+    vkDestroyBuffer(_Context.GetDevice()->GetVKDevice(), _LightBuffer, nullptr);
+    vkFreeMemory(_Context.GetDevice()->GetVKDevice(), _LightBufferMemory, nullptr);
+
+    vkUnmapMemory(_Context.GetDevice()->GetVKDevice(), _ClusterBufferMemory);
+    vkDestroyBuffer(_Context.GetDevice()->GetVKDevice(), _ClusterBuffer, nullptr);
+    vkFreeMemory(_Context.GetDevice()->GetVKDevice(), _ClusterBufferMemory, nullptr);
+}
+
+void ClusteredLights::Clear()
+{
+    _Lights.clear();
+}
+
+void ClusteredLights::AddLight(const glm::vec3& InPosition, const glm::vec3& InColor, float InIntensity, int32_t InShadowIndex)
+{
+    ASSERT(_Lights.size() < _MaxLights, "Clustered light buffer is full.");
+
+    PointLightData light;
+    light.PositionRange  = glm::vec4(InPosition, GetLightRange(InIntensity));
+    light.ColorIntensity = glm::vec4(InColor, InIntensity);
+    light.ShadowIndex    = InShadowIndex;
+    _Lights.push_back(light);
+}
+
+float ClusteredLights::GetLightRange(float InIntensity)
+{
+    // Solves intensity / (1 + 20d + 20d^3) = cutoff for d. The left side falls monotonically so a bisection is enough.
+    float target = InIntensity / CLUSTERED_LIGHT_CUTOFF;
+    if (target <= 1.0f)
+        return 0.0f;
+
+    float low  = 0.0f;
+    float high = std::cbrt(target / 20.0f) + 1.0f;
+    for (int i = 0; i < 24; i++)
+    {
+        float d = (low + high) * 0.5f;
+        if (1.0f + 20.0f * d + 20.0f * d * d * d < target)
+            low = d;
+        else
+            high = d;
+    }
+    return high;
+}
+
+void ClusteredLights::BuildClusterBounds(const glm::mat4& InProjection, float InNearPlane, float InFarPlane)
+{
+    // View space rays through the corners of every tile. Points at a given view depth are found by scaling the ray.
+    glm::mat4              inverseProjection = glm::inverse(InProjection);
+    std::vector<glm::vec3> rays((CLUSTER_GRID_X + 1) * (CLUSTER_GRID_Y + 1));
+    for (uint32_t y = 0; y <= CLUSTER_GRID_Y; y++)
+    {
+        for (uint32_t x = 0; x <= CLUSTER_GRID_X; x++)
+        {
+            glm::vec2 ndc   = glm::vec2((float)x / CLUSTER_GRID_X, (float)y / CLUSTER_GRID_Y) * 2.0f - 1.0f;
+            glm::vec4 point = inverseProjection * glm::vec4(ndc, 1.0f, 1.0f);
+            glm::vec3 ray   = glm::vec3(point) / point.w;
+
+            rays[y * (CLUSTER_GRID_X + 1) + x] = ray / -ray.z; // Unit view depth.
+        }
+    }
+
+    for (uint32_t z = 0; z < CLUSTER_GRID_Z; z++)
+    {
+        float sliceNear = InNearPlane * std::pow(InFarPlane / InNearPlane, (float)z / CLUSTER_GRID_Z);
+        float sliceFar  = InNearPlane * std::pow(InFarPlane / InNearPlane, (float)(z + 1) / CLUSTER_GRID_Z);
+
+        for (uint32_t y = 0; y < CLUSTER_GRID_Y; y++)
+        {
+            for (uint32_t x = 0; x < CLUSTER_GRID_X; x++)
+            {
+                glm::vec3 clusterMin = glm::vec3(std::numeric_limits<float>::max());
+                glm::vec3 clusterMax = glm::vec3(-std::numeric_limits<float>::max());
+                for (uint32_t corner = 0; corner < 4; corner++)
+                {
+                    const glm::vec3& ray = rays[(y + (corner >> 1)) * (CLUSTER_GRID_X + 1) + x + (corner & 1)];
+                    clusterMin           = glm::min(clusterMin, glm::min(ray * sliceNear, ray * sliceFar));
+                    clusterMax           = glm::max(clusterMax, glm::max(ray * sliceNear, ray * sliceFar));
+                }
+
+                uint32_t cluster     = x + y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+                _ClusterMin[cluster] = clusterMin;
+                _ClusterMax[cluster] = clusterMax;
+            }
+        }
+    }
+
+    _ClusterProjection = InProjection;
+    _ClusterDepthRange = glm::vec2(InNearPlane, InFarPlane);
+}
+
+void ClusteredLights::Update(
+    uint32_t         InFrameIndex,
+    const glm::mat4& InView,
+    const glm::mat4& InProjection,
+    float            InNearPlane,
+    float            InFarPlane)
+{
+    TRACE_FUNCTION();
+
+    if (InProjection != _ClusterProjection || glm::vec2(InNearPlane, InFarPlane) != _ClusterDepthRange)
+        BuildClusterBounds(InProjection, InNearPlane, InFarPlane);
+
+    // Same slice distribution as PBRShader.frag.
+    const float sliceScale = CLUSTER_GRID_Z / std::log(InFarPlane / InNearPlane);
+    auto        depthSlice = [&](float depth)
+    {
+        float slice = std::floor(std::log(depth / InNearPlane) * sliceScale);
+        return (uint32_t)std::clamp(slice, 0.0f, (float)(CLUSTER_GRID_Z - 1));
+    };
+    auto screenTile = [](float ndc, uint32_t tileCount)
+    {
+        float tile = std::floor((ndc * 0.5f + 0.5f) * tileCount);
+        return (uint32_t)std::clamp(tile, 0.0f, (float)(tileCount - 1));
+    };
+
+    _LightClusterPairs.clear();
+    _VisibleLightCount = 0;
+    for (uint32_t i = 0; i < _Lights.size(); i++)
+    {
+        glm::vec3 center = glm::vec3(InView * glm::vec4(glm::vec3(_Lights[i].PositionRange), 1.0f));
+        float     range  = _Lights[i].PositionRange.w;
+        float     depth  = -center.z;
+        if (range <= 0.0f || depth + range < InNearPlane || depth - range > InFarPlane)
+            continue;
+
+        float minDepth = std::max(depth - range, InNearPlane);
+        float maxDepth = std::min(depth + range, InFarPlane);
+
+        // Screen bounds of the light. The corners of its view space box, clipped to the depths above, are all in front of
+        // the camera, so their projection encloses the projected sphere.
+        glm::vec2 ndcMin = glm::vec2(std::numeric_limits<float>::max());
+        glm::vec2 ndcMax = glm::vec2(-std::numeric_limits<float>::max());
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            glm::vec4 point = glm::vec4(
+                center.x + ((corner & 1) ? range : -range),
+                center.y + ((corner & 2) ? range : -range),
+                (corner & 4) ? -minDepth : -maxDepth,
+                1.0f);
+            glm::vec4 clip = InProjection * point;
+            glm::vec2 ndc  = glm::vec2(clip) / clip.w;
+            ndcMin         = glm::min(ndcMin, ndc);
+            ndcMax         = glm::max(ndcMax, ndc);
+        }
+        if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f)
+            continue;
+
+        uint32_t minX = screenTile(ndcMin.x, CLUSTER_GRID_X);
+        uint32_t maxX = screenTile(ndcMax.x, CLUSTER_GRID_X);
+        uint32_t minY = screenTile(ndcMin.y, CLUSTER_GRID_Y);
+        uint32_t maxY = screenTile(ndcMax.y, CLUSTER_GRID_Y);
+        uint32_t minZ = depthSlice(minDepth);
+        uint32_t maxZ = depthSlice(maxDepth);
+
+        // The tile range is a box around the sphere. Clusters in its corners are rejected with an exact sphere test.
+        size_t pairCount = _LightClusterPairs.size();
+        for (uint32_t z = minZ; z <= maxZ; z++)
+        {
+            for (uint32_t y = minY; y <= maxY; y++)
+            {
+                for (uint32_t x = minX; x <= maxX; x++)
+                {
+                    uint32_t  cluster = x + y * CLUSTER_GRID_X + z * CLUSTER_GRID_X * CLUSTER_GRID_Y;
+                    glm::vec3 closest = glm::clamp(center, _ClusterMin[cluster], _ClusterMax[cluster]);
+                    glm::vec3 delta   = center - closest;
+                    if (glm::dot(delta, delta) <= range * range)
+                        _LightClusterPairs.push_back(glm::uvec2(cluster, i));
+                }
+            }
+        }
+        if (_LightClusterPairs.size() > pairCount)
+            _VisibleLightCount++;
+    }
+
+    // Counting sort of the pairs into per cluster lists. Lights that don't fit into the index buffer are dropped.
+    _ClusterData.assign(CLUSTER_COUNT * 2, 0);
+    for (const glm::uvec2& pair : _LightClusterPairs)
+        _ClusterData[pair.x * 2 + 1]++;
+
+    uint32_t offset = 0;
+    for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+    {
+        _ClusterData[cluster * 2] = offset;
+        offset += _ClusterData[cluster * 2 + 1];
+        _ClusterData[cluster * 2 + 1] = 0;
+    }
+
+    _LightIndexCount = std::min((uint32_t)_LightClusterPairs.size(), _MaxLightIndices);
+    _ClusterData.resize(CLUSTER_COUNT * 2 + _LightIndexCount);
+    for (const glm::uvec2& pair : _LightClusterPairs)
+    {
+        uint32_t slot = _ClusterData[pair.x * 2] + _ClusterData[pair.x * 2 + 1];
+        if (slot < _LightIndexCount)
+        {
+            _ClusterData[CLUSTER_COUNT * 2 + slot] = pair.y;
+            _ClusterData[pair.x * 2 + 1]++;
+        }
+    }
+
+    // Earlier frames may still be reading their own slices.
+    memcpy(_MappedLightBuffer + GetLightSliceOffset(InFrameIndex), _Lights.data(), sizeof(PointLightData) * _Lights.size());
+    memcpy(
+        _MappedClusterBuffer + GetClusterSliceOffset(InFrameIndex),
+        _ClusterData.data(),
+        sizeof(uint32_t) * _ClusterData.size());
+}
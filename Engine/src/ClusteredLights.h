@@ -0,0 +1,129 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <glm/glm.hpp>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// Cluster grid. The screen is split into CLUSTER_GRID_X * CLUSTER_GRID_Y tiles and the view depth between the camera near
+// and far planes into CLUSTER_GRID_Z exponential slices. Must match PBRShader.frag.
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT  (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+
+// Froxel based light assignment for the forward pass. Point lights live in a storage buffer and are binned into the
+// clusters of the camera frustum every frame, so a fragment only evaluates the lights whose range touches its cluster.
+// Every light gets a finite range, derived from its intensity and the attenuation used in PBRShader.frag.
+//
+// Light buffer:   one PointLightData per light.
+// Cluster buffer: CLUSTER_COUNT (offset, count) pairs followed by the light indices they point into.
+//
+// Both buffers live in host visible memory and hold one slice per frame in flight, so the CPU never overwrites lights a
+// frame still executing reads. The shader finds its frame's slices through the offsets in the view uniforms.
+class ClusteredLights
+{
+   public:
+    ClusteredLights(VulkanContext& InContext, uint32_t InMaxLights, uint32_t InMaxLightIndices, uint32_t InFramesInFlight);
+    ~ClusteredLights();
+
+    void Clear();
+    // InShadowIndex selects the point shadow cubemap of the light, -1 for lights without one.
+    void AddLight(const glm::vec3& InPosition, const glm::vec3& InColor, float InIntensity, int32_t InShadowIndex = -1);
+
+    // Bins the lights added since the last Clear into the clusters of the given camera and uploads both into the slices of
+    // the given frame.
+    void Update(
+        uint32_t         InFrameIndex,
+        const glm::mat4& InView,
+        const glm::mat4& InProjection,
+        float            InNearPlane,
+        float            InFarPlane);
+
+    // Distance at which a light of the given intensity falls below the cutoff of the shader's attenuation.
+    static float GetLightRange(float InIntensity);
+
+    VkBuffer GetLightBuffer() const
+    {
+        return _LightBuffer;
+    }
+    VkDeviceSize GetLightBufferSize() const
+    {
+        return _LightBufferSize;
+    }
+    VkBuffer GetClusterBuffer() const
+    {
+        return _ClusterBuffer;
+    }
+    VkDeviceSize GetClusterBufferSize() const
+    {
+        return _ClusterBufferSize;
+    }
+    // First element of the frame's slice, in lights and in uints of the cluster buffer.
+    uint32_t GetLightSliceOffset(uint32_t InFrameIndex) const
+    {
+        return InFrameIndex * _MaxLights;
+    }
+    uint32_t GetClusterSliceOffset(uint32_t InFrameIndex) const
+    {
+        return InFrameIndex * (CLUSTER_COUNT * 2 + _MaxLightIndices);
+    }
+    uint32_t GetLightCount() const
+    {
+        return (uint32_t)_Lights.size();
+    }
+    uint32_t GetVisibleLightCount() const
+    {
+        return _VisibleLightCount;
+    }
+    uint32_t GetLightIndexCount() const
+    {
+        return _LightIndexCount;
+    }
+
+   private:
+    // Matches the std430 layout of the light buffer in PBRShader.frag.
+    struct PointLightData
+    {
+        glm::vec4 PositionRange  = glm::vec4(0.0f);
+        glm::vec4 ColorIntensity = glm::vec4(0.0f);
+        int32_t   ShadowIndex    = -1;
+        int32_t   Padding[3]     = {};
+    };
+
+    // Rebuilds the view space bounds of every cluster. Only needed when the projection changes.
+    void BuildClusterBounds(const glm::mat4& InProjection, float InNearPlane, float InFarPlane);
+
+   private:
+    VulkanContext& _Context;
+    uint32_t       _MaxLights;
+    uint32_t       _MaxLightIndices;
+    uint32_t       _FramesInFlight;
+
+    VkBuffer        _LightBuffer         = VK_NULL_HANDLE;
+    VkDeviceMemory  _LightBufferMemory   = VK_NULL_HANDLE;
+    VkDeviceSize    _LightBufferSize     = 0;
+    PointLightData* _MappedLightBuffer   = nullptr;
+    VkBuffer        _ClusterBuffer       = VK_NULL_HANDLE;
+    VkDeviceMemory  _ClusterBufferMemory = VK_NULL_HANDLE;
+    VkDeviceSize    _ClusterBufferSize   = 0;
+    uint32_t*       _MappedClusterBuffer = nullptr;
+
+    std::vector<PointLightData> _Lights;
+
+    // View space bounds of every cluster and the projection they were built for.
+    std::vector<glm::vec3> _ClusterMin;
+    std::vector<glm::vec3> _ClusterMax;
+    glm::mat4              _ClusterProjection = glm::mat4(0.0f);
+    glm::vec2              _ClusterDepthRange = glm::vec2(0.0f);
+
+    // Scratch space of Update, kept around so binning does not allocate every frame.
+    std::vector<glm::uvec2> _LightClusterPairs; // x: cluster, y: light.
+    std::vector<uint32_t>   _ClusterData;
+
+    uint32_t _VisibleLightCount = 0;
+    uint32_t _LightIndexCount   = 0;
+};
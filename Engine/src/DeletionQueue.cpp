@@ -0,0 +1,34 @@
+#include "DeletionQueue.h"
+
+DeletionQueue::~DeletionQueue()
+{
+    Flush();
+}
+
+void DeletionQueue::Retire(std::function<void()> InDestroy)
+{
+    _Entries.push_back(Entry{ _Frame, std::move(InDestroy) });
+}
+
+void DeletionQueue::NextFrame()
+{
+    _Frame++;
+
+    // Entries are in retirement order, so the ones that are old enough are at the front.
+    while (!_Entries.empty() && _Frame - _Entries.front().Frame >= _FrameLatency)
+    {
+        std::function<void()> destroy = std::move(_Entries.front().Destroy);
+        _Entries.pop_front();
+        destroy();
+    }
+}
+
+void DeletionQueue::Flush()
+{
+    while (!_Entries.empty())
+    {
+        std::function<void()> destroy = std::move(_Entries.front().Destroy);
+        _Entries.pop_front();
+        destroy();
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <deque>
+#include <functional>
+#include <memory>
+
+// Destroys GPU resources once the frames that may still use them have finished. Replacing a resource then needs neither
+// vkDeviceWaitIdle nor a wait on the frames in flight: the old one is retired and released a few frames later. Only used
+// from the render thread.
+class DeletionQueue
+{
+   public:
+    DeletionQueue() = default;
+    ~DeletionQueue();
+
+    // Number of frames that can be recorded or executing at the same time.
+    void SetFrameLatency(uint32_t InFrameLatency)
+    {
+        _FrameLatency = InFrameLatency;
+    }
+    uint32_t GetFrameLatency() const
+    {
+        return _FrameLatency;
+    }
+
+    // InDestroy runs once every frame that was in flight when it was retired has finished.
+    void Retire(std::function<void()> InDestroy);
+    // Keeps InResource alive until every frame that was in flight when it was retired has finished.
+    template <typename T>
+    void Retire(const Ref<T>& InResource)
+    {
+        if (InResource)
+            Retire([resource = InResource]() mutable { resource.reset(); });
+    }
+
+    // Starts a new frame. Must be called once per submitted frame, after the fence of the oldest frame in flight was waited
+    // on. Frames that are skipped without a submit must not call it.
+    void NextFrame();
+    // Releases everything right away. The device must be idle.
+    void Flush();
+
+    uint32_t GetPendingCount() const
+    {
+        return (uint32_t)_Entries.size();
+    }
+
+   private:
+    struct Entry
+    {
+        uint64_t              Frame;
+        std::function<void()> Destroy;
+    };
+
+   private:
+    std::deque<Entry> _Entries;
+    uint64_t          _Frame        = 0;
+    uint32_t          _FrameLatency = 1;
+};
@@ -114,7 +114,10 @@
 //	vkDestroyDescriptorSetLayout(EngineInternal::GetContext().GetDevice()->GetVKDevice(),
 // m_DescriptorSetLayout, nullptr);
 // }
-DescriptorPool::DescriptorPool(uint32_t maximumDescriptorCount, std::vector<VkDescriptorType> types)
+DescriptorPool::DescriptorPool(
+    uint32_t                      maximumDescriptorCount,
+    std::vector<VkDescriptorType> types,
+    VkDescriptorPoolCreateFlags   flags)
 {
     std::vector<VkDescriptorPoolSize> poolSizes;
     poolSizes.resize(types.size());
@@ -125,6 +128,7 @@ DescriptorPool::DescriptorPool(uint32_t maximumDescriptorCount, std::vector<VkDe
     }
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags         = flags;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes    = poolSizes.data();
     poolInfo.maxSets       = maximumDescriptorCount; // Increase this value as you reach the limit of
@@ -157,6 +161,23 @@ DescriptorSetLayout::DescriptorSetLayout(const std::vector<DescriptorSetBindingS
             bindings[i].stageFlags         = layout[i].ShaderStage;
             bindings[i].pImmutableSamplers = nullptr;
         }
+        else if (layout[i].Type == Type::STORAGE_BUFFER)
+        {
+            bindings[i].binding            = layout[i].Binding;
+            bindings[i].descriptorCount    = layout[i].Count;
+            bindings[i].descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].stageFlags         = layout[i].ShaderStage;
+            bindings[i].pImmutableSamplers = nullptr;
+        }
+        else if (layout[i].Type == Type::UNIFORM_BUFFER_DYNAMIC)
+        {
+            bindings[i].binding            = layout[i].Binding;
+            bindings[i].descriptorCount    = layout[i].Count;
+            bindings[i].descriptorType     = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            bindings[i].stageFlags         = layout[i].ShaderStage;
+            bindings[i].pImmutableSamplers = nullptr;
+            m_DynamicOffsetCount += layout[i].Count;
+        }
         else
         {
             // For the texture sampler in the fragment shader
@@ -14,7 +14,10 @@ enum class Type
     TEXTURE_SAMPLER_ROUGHNESSMETALLIC,
     TEXTURE_SAMPLER_CUBEMAP,
     UNIFORM_BUFFER,
-    TEXTURE_SAMPLER_POINTSHADOWMAP
+    TEXTURE_SAMPLER_POINTSHADOWMAP,
+    STORAGE_BUFFER,
+    // The offset into the buffer is given when the set is bound, see DescriptorSetLayout::GetDynamicOffsetCount.
+    UNIFORM_BUFFER_DYNAMIC
 };
 struct DescriptorSetBindingSpecs
 {
@@ -43,10 +46,16 @@ class DescriptorSetLayout
     {
         return m_DescriptorSetLayout;
     }
+    // Number of dynamic offsets vkCmdBindDescriptorSets takes for a set with this layout.
+    uint32_t GetDynamicOffsetCount()
+    {
+        return m_DynamicOffsetCount;
+    }
 
    private:
     VkDescriptorSetLayout                  m_DescriptorSetLayout = VK_NULL_HANDLE;
     std::vector<DescriptorSetBindingSpecs> m_SetLayout;
+    uint32_t                               m_DynamicOffsetCount = 0;
 };
 class DescriptorPool
 {
@@ -56,7 +65,10 @@ class DescriptorPool
     {
         m_DescriptorPool = pool;
     }
-    DescriptorPool(uint32_t maximumDescriptorCount, std::vector<VkDescriptorType> dscTypes);
+    DescriptorPool(
+        uint32_t                      maximumDescriptorCount,
+        std::vector<VkDescriptorType> dscTypes,
+        VkDescriptorPoolCreateFlags   flags = 0);
     ~DescriptorPool();
     const VkDescriptorPool& GetDescriptorPool() const
     {
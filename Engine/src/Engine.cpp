@@ -1,37 +1,195 @@
+#include "Benchmark.h"
 #include "Camera.h"
 #include "EngineInternal.h"
+#include "PipelineCache.h"
 #include "Renderer/Renderer.h"
 #include "Surface.h"
 #include "Swapchain.h"
+#include "Tracer.h"
+#include "Utils.h"
 #include "VulkanContext.h"
 #include "Window.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+
 Engine& Engine::Get()
 {
     static Engine instance;
     return instance;
 }
 
-void Engine::Init()
+EngineSettings Engine::ParseCommandLine(int InArgc, char** InArgv)
 {
-    _Context = std::make_unique<VulkanContext>();
-    _Context->Init();
+    EngineSettings settings;
+    for (int i = 1; i < InArgc; i++)
+    {
+        const char* argument = InArgv[i];
+        const char* value    = i + 1 < InArgc ? InArgv[i + 1] : nullptr;
+
+        if (strcmp(argument, "--headless") == 0)
+        {
+            settings.Headless = true;
+        }
+        else if (strcmp(argument, "--frames") == 0 && value)
+        {
+            settings.FrameCount = (uint32_t)std::max(1, atoi(value));
+            i++;
+        }
+        else if (strcmp(argument, "--timestep") == 0 && value)
+        {
+            settings.FixedTimestep = (float)atof(value);
+            i++;
+        }
+        else if (strcmp(argument, "--size") == 0 && value)
+        {
+            std::string size      = value;
+            size_t      separator = size.find('x');
+            uint32_t    width     = separator != std::string::npos ? (uint32_t)atoi(size.substr(0, separator).c_str()) : 0;
+            uint32_t    height    = separator != std::string::npos ? (uint32_t)atoi(size.substr(separator + 1).c_str()) : 0;
+            if (width > 0 && height > 0)
+            {
+                settings.Width  = width;
+                settings.Height = height;
+            }
+            else
+            {
+                PrintWarning("Ignoring --size " + std::string(value) + ", expected <width>x<height>.");
+            }
+            i++;
+        }
+        else if (strcmp(argument, "--output") == 0 && value)
+        {
+            settings.OutputImagePath = value;
+            i++;
+        }
+        else if (strcmp(argument, "--seed") == 0 && value)
+        {
+            settings.RandomSeed = (uint32_t)strtoul(value, nullptr, 10);
+            i++;
+        }
+        else if (strcmp(argument, "--benchmark") == 0 && value)
+        {
+            settings.BenchmarkPath = value;
+            i++;
+        }
+        else if (strcmp(argument, "--benchmark-output") == 0 && value)
+        {
+            settings.BenchmarkOutput = value;
+            i++;
+        }
+        else if (strcmp(argument, "--baseline") == 0 && value)
+        {
+            settings.BaselinePath = value;
+            i++;
+        }
+        else if (strcmp(argument, "--threshold") == 0 && value)
+        {
+            settings.RegressionThreshold = (float)atof(value);
+            i++;
+        }
+        else if (strcmp(argument, "--warmup") == 0 && value)
+        {
+            settings.WarmupFrames = (uint32_t)std::max(0, atoi(value));
+            i++;
+        }
+        else
+        {
+            PrintWarning("Unknown command line argument: " + std::string(argument));
+        }
+    }
+
+    // Benchmarks are only comparable when every run sees the same particles and flicker.
+    if (!settings.BenchmarkPath.empty() && settings.RandomSeed == 0)
+        settings.RandomSeed = 1;
+    return settings;
+}
+
+void Engine::Init(const EngineSettings& InSettings)
+{
+    _Settings = InSettings;
+
+    // Startup and the first frames are always captured, the UI can export them or start a new capture.
+    Tracer::BeginCapture(300);
+    TRACE_THREAD_NAME("Main");
+    TRACE_FUNCTION();
 
-    _Swapchain = make_s<Swapchain>(*_Context);
+    using Clock      = std::chrono::high_resolution_clock;
+    auto elapsedTime = [](Clock::time_point start)
+    { return std::chrono::duration<float, std::milli>(Clock::now() - start).count(); };
+
+    auto startupStart = Clock::now();
+
+    auto phaseStart   = Clock::now();
+    _Context          = std::make_unique<VulkanContext>();
+    _Context->Init(_Settings.Headless, { _Settings.Width, _Settings.Height });
+    float contextTime = elapsedTime(phaseStart);
+
+    phaseStart          = Clock::now();
+    _Swapchain          = make_s<Swapchain>(*_Context);
+    float swapchainTime = elapsedTime(phaseStart);
 
     _Camera =
         make_s<Camera>(45.0f, _Context->GetSurface()->GetVKExtent().width / (float)_Context->GetSurface()->GetVKExtent().height);
 
-    _Renderer = std::make_unique<ForwardRenderer>(*_Context, _Swapchain, _Camera);
+    phaseStart = Clock::now();
+    _Renderer  = std::make_unique<ForwardRenderer>(*_Context, _Swapchain, _Camera, _Settings.RandomSeed);
     _Renderer->Init();
+    float rendererTime = elapsedTime(phaseStart);
+
+    if (!_Settings.BenchmarkPath.empty())
+    {
+        CameraPath path;
+        if (path.Load(_Settings.BenchmarkPath))
+        {
+            _Benchmark = make_s<Benchmark>(_Settings, std::move(path));
+            _Camera->SetInputEnabled(false);
+            if (GPUProfiler* profiler = _Renderer->GetGPUProfiler())
+                profiler->SetFrameTimeRecording(true);
+        }
+    }
+
+    phaseStart = Clock::now();
     // TODO: Move out of renderer into UI layer.
     _Renderer->InitImGui();
+    float imguiTime = elapsedTime(phaseStart);
+
+    // Pipelines are still compiling in the background at this point. They are reported after the first frame, which
+    // waited for every pipeline it draws with.
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1) << "Startup took " << elapsedTime(startupStart) << " ms (context "
+           << contextTime << " ms, swapchain " << swapchainTime << " ms, renderer " << rendererTime << " ms, ImGui "
+           << imguiTime << " ms).";
+    PrintInfo(report.str());
 }
 
-void Engine::Run()
+int Engine::Run()
 {
-    while (!_Context->GetWindow()->ShouldClose())
+    using Clock = std::chrono::high_resolution_clock;
+
+    bool     firstFrame = true;
+    uint32_t frameIndex = 0;
+
+    auto keepRunning = [this, &frameIndex]()
     {
+        bool windowOpen = _Settings.Headless || !_Context->GetWindow()->ShouldClose();
+        if (_Benchmark)
+            return windowOpen && !_Benchmark->IsFinished();
+        return _Settings.Headless ? frameIndex < _Settings.FrameCount : windowOpen;
+    };
+
+    while (keepRunning())
+    {
+        TRACE_FRAME_MARK();
+        TRACE_ZONE("Frame");
+
+        if (_Benchmark)
+            _Benchmark->BeginFrame(*_Camera);
+        auto frameStart = Clock::now();
+
         float deltaTime = CalculateDeltaTime();
 
         _Renderer->PollEvents();
@@ -45,9 +203,54 @@ void Engine::Run()
         _Renderer->RenderFrame(deltaTime);
 
         _Renderer->EndFrame();
+        frameIndex++;
+
+        if (_Benchmark)
+        {
+            _Benchmark->EndFrame(std::chrono::duration<float, std::milli>(Clock::now() - frameStart).count());
+            if (GPUProfiler* profiler = _Renderer->GetGPUProfiler())
+                _Benchmark->AddGPUFrameTimes(profiler->TakeFrameTimes());
+        }
+
+        if (firstFrame)
+        {
+            if (!_Settings.Headless)
+            {
+                PrintInfo(
+                    "First frame submitted " + std::to_string((int)(glfwGetTime() * 1000.0)) + " ms after the window opened.");
+            }
+            _Context->GetPipelineCache()->PrintReport();
+            firstFrame = false;
+        }
+    }
+
+    if (_Settings.Headless)
+    {
+        PrintInfo("Rendered " + std::to_string(frameIndex) + " headless frames.");
+        if (!_Settings.OutputImagePath.empty())
+            _Renderer->SaveLastFrame(_Settings.OutputImagePath);
+    }
+
+    int exitCode = 0;
+    if (_Benchmark)
+    {
+        // The last frames in flight haven't been read back yet.
+        if (GPUProfiler* profiler = _Renderer->GetGPUProfiler())
+        {
+            profiler->CollectAll();
+            _Benchmark->AddGPUFrameTimes(profiler->TakeFrameTimes());
+        }
+
+        std::string outputPath = _Settings.BenchmarkOutput.empty()
+            ? "benchmarks/results_" + Utils::GetTimestampString() + ".json"
+            : _Settings.BenchmarkOutput;
+        if (!_Benchmark->WriteReport(outputPath, _Settings.BaselinePath))
+            exitCode = 1;
+        _Benchmark.reset();
     }
 
     Shutdown();
+    return exitCode;
 }
 
 void Engine::Shutdown()
@@ -79,6 +282,10 @@ void Engine::Shutdown()
 
 float Engine::CalculateDeltaTime()
 {
+    // Headless runs and benchmarks must not depend on how fast the machine is.
+    if (_Settings.Headless || _Benchmark)
+        return _Settings.FixedTimestep;
+
     const float currentTime = static_cast<float>(glfwGetTime());
     const float deltaTime   = currentTime - _LastFrameTime;
     _LastFrameTime          = currentTime;
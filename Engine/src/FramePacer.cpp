@@ -0,0 +1,150 @@
+#include "FramePacer.h"
+#include "LogicalDevice.h"
+#include "Tracer.h"
+#include "VulkanContext.h"
+
+// External
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <thread>
+
+FramePacer::FramePacer(VulkanContext& InContext) : _Context(InContext)
+{
+    Ref<LogicalDevice> device = _Context.GetDevice();
+    if (device->SupportsPresentWait())
+    {
+        _WaitForPresentKHR = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(device->GetVKDevice(), "vkWaitForPresentKHR");
+    }
+
+    // Headless runs have no monitor to pace against.
+    const GLFWvidmode* videoMode   = _Context.IsHeadless() ? nullptr : glfwGetVideoMode(glfwGetPrimaryMonitor());
+    double             refreshRate = videoMode && videoMode->refreshRate > 0 ? videoMode->refreshRate : 60.0;
+
+    _RefreshInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / refreshRate));
+
+    _InputTime      = Clock::now();
+    _NextFrameStart = _InputTime;
+}
+
+void FramePacer::BeginFrame(VkSwapchainKHR InSwapchain, VkFence InFence)
+{
+    TRACE_FUNCTION();
+
+    Clock::time_point start = Clock::now();
+
+    if (_WaitForPresentKHR)
+    {
+        CollectPresentedFrames(InSwapchain, _WaitForPresent);
+    }
+    else
+    {
+        // The frame slot is reused next, so this wait is coming anyway. Doing it before input is polled keeps the input
+        // fresh.
+        vkWaitForFences(_Context.GetDevice()->GetVKDevice(), 1, &InFence, VK_TRUE, UINT64_MAX);
+        CollectCompletedFrames();
+    }
+
+    LimitFrameRate();
+
+    float waitTime  = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    _PacingWaitTime = _PacingWaitTime * 0.9f + waitTime * 0.1f;
+}
+
+void FramePacer::MarkInputSampled()
+{
+    _InputTime = Clock::now();
+}
+
+void FramePacer::OnPresent(VkPresentInfoKHR& InOutPresentInfo, VkSwapchainKHR InSwapchain, VkFence InFence)
+{
+    _PresentId++;
+    _PendingFrames.push_back(PendingFrame{ _PresentId, InSwapchain, InFence, _InputTime });
+
+    if (!_WaitForPresentKHR)
+        return;
+
+    _PresentIdInfo.sType          = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    _PresentIdInfo.pNext          = InOutPresentInfo.pNext;
+    _PresentIdInfo.swapchainCount = 1;
+    _PresentIdInfo.pPresentIds    = &_PresentId;
+    InOutPresentInfo.pNext        = &_PresentIdInfo;
+}
+
+void FramePacer::CollectPresentedFrames(VkSwapchainKHR InSwapchain, bool InWaitForPrevious)
+{
+    VkDevice device = _Context.GetDevice()->GetVKDevice();
+
+    // Present ids belong to their swapchain. Frames presented to a replaced one are never waited on, the swapchain may
+    // already be destroyed.
+    std::erase_if(_PendingFrames, [InSwapchain](const PendingFrame& frame) { return frame.Swapchain != InSwapchain; });
+
+    while (!_PendingFrames.empty())
+    {
+        const PendingFrame& frame = _PendingFrames.front();
+
+        // Only the newest frame may still be queued for display when the next one starts. The timeout keeps a minimized or
+        // occluded window from stalling the loop.
+        bool     block   = InWaitForPrevious && frame.PresentId < _PresentId;
+        uint64_t timeout = block ? 100'000'000ull : 0;
+
+        VkResult result = _WaitForPresentKHR(device, frame.Swapchain, frame.PresentId, timeout);
+        if (result == VK_TIMEOUT)
+            break;
+
+        if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+            AddLatencySample(Clock::now() - frame.InputTime);
+        _PendingFrames.pop_front();
+    }
+}
+
+void FramePacer::CollectCompletedFrames()
+{
+    VkDevice device = _Context.GetDevice()->GetVKDevice();
+
+    // Fences are only reset after the pacer saw them signaled, so a signaled fence still belongs to the pending frame.
+    while (!_PendingFrames.empty() && vkGetFenceStatus(device, _PendingFrames.front().Fence) == VK_SUCCESS)
+    {
+        AddLatencySample(Clock::now() - _PendingFrames.front().InputTime + _RefreshInterval);
+        _PendingFrames.pop_front();
+    }
+}
+
+void FramePacer::LimitFrameRate()
+{
+    Clock::time_point now = Clock::now();
+    if (_FrameCap <= 0)
+    {
+        _NextFrameStart = now;
+        return;
+    }
+
+    Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / _FrameCap));
+
+    // A frame that ran late starts the schedule over instead of rushing the ones after it.
+    if (now > _NextFrameStart + period)
+        _NextFrameStart = now;
+
+    Clock::time_point wakeUp = _NextFrameStart - _SpinMargin;
+    if (now < wakeUp)
+    {
+        std::this_thread::sleep_until(wakeUp);
+
+        // Keep the margin just above the oversleeps we actually get. It decays slowly so a single hiccup doesn't make the
+        // loop spin for good.
+        Clock::duration oversleep = Clock::now() - wakeUp;
+        _SpinMargin               = std::max(oversleep + oversleep / 4, _SpinMargin - _SpinMargin / 64);
+        _SpinMargin               = std::clamp<Clock::duration>(
+            _SpinMargin, std::chrono::microseconds(200), std::chrono::milliseconds(4));
+    }
+
+    while (Clock::now() < _NextFrameStart)
+        std::this_thread::yield();
+
+    _NextFrameStart += period;
+}
+
+void FramePacer::AddLatencySample(Clock::duration InLatency)
+{
+    float latency = std::chrono::duration<float, std::milli>(InLatency).count();
+    _Latency      = _Latency == 0.0f ? latency : _Latency * 0.9f + latency * 0.1f;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <chrono>
+#include <deque>
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// Paces the render loop so input is sampled as late as possible and frames don't pile up in front of the display.
+//
+// BeginFrame runs right before input is polled. It holds the CPU back until the frame can start without queuing behind
+// older ones: with VK_KHR_present_wait until the previous frame reached the display, otherwise until the in flight fence of
+// the frame slot is signaled. An optional frame cap then sleeps for most of the remaining time and spins for the last
+// stretch, since a sleep can overshoot by a scheduler tick.
+//
+// Every present carries an id. Once a frame is known to be on screen, the time since its input was sampled is folded into
+// a running input to present latency. Without present wait, the completion of the frame's fence plus one refresh interval
+// stands in for the moment it was shown.
+class FramePacer
+{
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    FramePacer(VulkanContext& InContext);
+
+    // InFence is the in flight fence of the frame slot about to be recorded.
+    void BeginFrame(VkSwapchainKHR InSwapchain, VkFence InFence);
+    void MarkInputSampled();
+    // Chains the present id of the frame into InOutPresentInfo. InFence is the fence its submission signals.
+    void OnPresent(VkPresentInfoKHR& InOutPresentInfo, VkSwapchainKHR InSwapchain, VkFence InFence);
+
+    // Frames per second, 0 turns the cap off.
+    void SetFrameCap(int InFramesPerSecond)
+    {
+        _FrameCap = InFramesPerSecond;
+    }
+    // Waits for the previous present before sampling input. Ignored without VK_KHR_present_wait.
+    void SetWaitForPresent(bool InWaitForPresent)
+    {
+        _WaitForPresent = InWaitForPresent;
+    }
+
+    bool SupportsPresentWait() const
+    {
+        return _WaitForPresentKHR != nullptr;
+    }
+    // Smoothed over the last frames, in milliseconds.
+    float GetInputToPresentLatency() const
+    {
+        return _Latency;
+    }
+    float GetPacingWaitTime() const
+    {
+        return _PacingWaitTime;
+    }
+
+   private:
+    struct PendingFrame
+    {
+        uint64_t          PresentId;
+        VkSwapchainKHR    Swapchain;
+        VkFence           Fence;
+        Clock::time_point InputTime;
+    };
+
+    void CollectPresentedFrames(VkSwapchainKHR InSwapchain, bool InWaitForPrevious);
+    void CollectCompletedFrames();
+    void LimitFrameRate();
+    void AddLatencySample(Clock::duration InLatency);
+
+   private:
+    VulkanContext&          _Context;
+    PFN_vkWaitForPresentKHR _WaitForPresentKHR = nullptr;
+
+    int  _FrameCap       = 0;
+    bool _WaitForPresent = true;
+
+    uint64_t                 _PresentId = 0;
+    VkPresentIdKHR           _PresentIdInfo{};
+    std::deque<PendingFrame> _PendingFrames;
+    Clock::time_point        _InputTime;
+    Clock::duration          _RefreshInterval;
+
+    Clock::time_point _NextFrameStart;
+    Clock::duration   _SpinMargin = std::chrono::milliseconds(2); // Grows with the worst oversleep seen.
+
+    float _Latency        = 0.0f;
+    float _PacingWaitTime = 0.0f;
+};
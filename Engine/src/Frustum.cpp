@@ -0,0 +1,84 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4& InViewProjection)
+{
+    // Gribb & Hartmann plane extraction. glm matrices are column major so we read the rows manually.
+    glm::vec4 row0 = glm::vec4(InViewProjection[0][0], InViewProjection[1][0], InViewProjection[2][0], InViewProjection[3][0]);
+    glm::vec4 row1 = glm::vec4(InViewProjection[0][1], InViewProjection[1][1], InViewProjection[2][1], InViewProjection[3][1]);
+    glm::vec4 row2 = glm::vec4(InViewProjection[0][2], InViewProjection[1][2], InViewProjection[2][2], InViewProjection[3][2]);
+    glm::vec4 row3 = glm::vec4(InViewProjection[0][3], InViewProjection[1][3], InViewProjection[2][3], InViewProjection[3][3]);
+
+    _Planes[0]     = row3 + row0; // Left
+    _Planes[1]     = row3 - row0; // Right
+    _Planes[2]     = row3 + row1; // Bottom
+    _Planes[3]     = row3 - row1; // Top
+    // The near plane assumes a [-1, 1] depth range. For [0, 1] projections this is slightly looser which is fine for culling.
+    _Planes[4]     = row3 + row2; // Near
+    _Planes[5]     = row3 - row2; // Far
+
+    for (auto& plane : _Planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+}
+
+Frustum::Frustum(const glm::vec3& InMin, const glm::vec3& InMax)
+{
+    _Planes[0] = glm::vec4(1.0f, 0.0f, 0.0f, -InMin.x);
+    _Planes[1] = glm::vec4(-1.0f, 0.0f, 0.0f, InMax.x);
+    _Planes[2] = glm::vec4(0.0f, 1.0f, 0.0f, -InMin.y);
+    _Planes[3] = glm::vec4(0.0f, -1.0f, 0.0f, InMax.y);
+    _Planes[4] = glm::vec4(0.0f, 0.0f, 1.0f, -InMin.z);
+    _Planes[5] = glm::vec4(0.0f, 0.0f, -1.0f, InMax.z);
+}
+
+bool Frustum::IntersectsAABB(const glm::vec3& InMin, const glm::vec3& InMax) const
+{
+    for (const auto& plane : _Planes)
+    {
+        // Pick the corner that is furthest along the plane normal.
+        glm::vec3 positive = glm::vec3(plane.x >= 0.0f ? InMax.x : InMin.x,
+                                       plane.y >= 0.0f ? InMax.y : InMin.y,
+                                       plane.z >= 0.0f ? InMax.z : InMin.z);
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& InCenter, float InRadius) const
+{
+    for (const auto& plane : _Planes)
+    {
+        if (glm::dot(glm::vec3(plane), InCenter) + plane.w < -InRadius)
+            return false;
+    }
+    return true;
+}
+
+void Frustum::TransformAABB(
+    const glm::mat4& InTransform,
+    const glm::vec3& InMin,
+    const glm::vec3& InMax,
+    glm::vec3&       OutMin,
+    glm::vec3&       OutMax)
+{
+    // Arvo's method. Avoids transforming all 8 corners.
+    glm::vec3 translation = glm::vec3(InTransform[3]);
+    OutMin                = translation;
+    OutMax                = translation;
+
+    for (int column = 0; column < 3; column++)
+    {
+        for (int row = 0; row < 3; row++)
+        {
+            float a = InTransform[column][row] * InMin[column];
+            float b = InTransform[column][row] * InMax[column];
+            OutMin[row] += glm::min(a, b);
+            OutMax[row] += glm::max(a, b);
+        }
+    }
+}
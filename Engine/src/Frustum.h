@@ -0,0 +1,36 @@
+#pragma once
+#include "core.h"
+
+#include <array>
+#include <glm/glm.hpp>
+
+// Six clip planes extracted from a view-projection matrix. Used to cull draws on the CPU.
+class Frustum
+{
+   public:
+    Frustum() = default;
+    Frustum(const glm::mat4& InViewProjection);
+    // Axis aligned box volume. Used for views without a single projection such as point light cubemaps.
+    Frustum(const glm::vec3& InMin, const glm::vec3& InMax);
+
+    // Conservative test. Returns false only when the box is completely outside one of the planes.
+    bool IntersectsAABB(const glm::vec3& InMin, const glm::vec3& InMax) const;
+    bool IntersectsSphere(const glm::vec3& InCenter, float InRadius) const;
+
+    const std::array<glm::vec4, 6>& GetPlanes() const
+    {
+        return _Planes;
+    }
+
+    // Transforms a local space box with the given matrix and returns the world space box that encloses it.
+    static void TransformAABB(
+        const glm::mat4& InTransform,
+        const glm::vec3& InMin,
+        const glm::vec3& InMax,
+        glm::vec3&       OutMin,
+        glm::vec3&       OutMax);
+
+   private:
+    // xyz: plane normal pointing inside, w: distance.
+    std::array<glm::vec4, 6> _Planes;
+};
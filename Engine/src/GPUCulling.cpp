@@ -0,0 +1,379 @@
+#include "GPUCulling.h"
+#include "Buffer.h"
+#include "DeletionQueue.h"
+#include "DescriptorSet.h"
+#include "Frustum.h"
+#include "LogicalDevice.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "Pipeline.h"
+#include "PipelineCache.h"
+#include "Tracer.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <cstring>
+
+// Must match the local size of cullDraws.comp.
+#define CULL_WORKGROUP_SIZE 64
+
+GPUCulling::GPUCulling(VulkanContext& InContext, uint32_t InMaxViewCount, uint32_t InFramesInFlight)
+    : _Context(InContext), _MaxViewCount(InMaxViewCount), _FramesInFlight(InFramesInFlight)
+{
+    std::vector<DescriptorSetBindingSpecs> cullLayout{
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0 },
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_COMPUTE_BIT, 1 },
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_COMPUTE_BIT, 2 },
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_COMPUTE_BIT, 3 },
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_COMPUTE_BIT, 4 },
+    };
+    _DescriptorSetLayout = make_s<DescriptorSetLayout>(cullLayout);
+    // Sets are freed when a model's records are rebuilt.
+    _DescriptorPool = std::make_unique<DescriptorPool>(
+        100,
+        std::vector<VkDescriptorType>{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+        VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+
+    VkPushConstantRange cullPushConstant{};
+    cullPushConstant.offset     = 0;
+    cullPushConstant.size       = sizeof(glm::mat4) + sizeof(glm::uvec4) * 2;
+    cullPushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    Pipeline::Specs cullSpecs{};
+    cullSpecs.DescriptorSetLayout = _DescriptorSetLayout;
+    cullSpecs.ComputeShaderPath   = "assets/shaders/cullDrawsCOMP.spv";
+    cullSpecs.PushConstantRanges  = { cullPushConstant };
+    _CullPipeline                 = _Context.GetPipelineCache()->GetPipeline(cullSpecs);
+
+    VkDeviceSize viewBufferSize = sizeof(glm::vec4) * 6 * _MaxViewCount * _FramesInFlight;
+    Utils::CreateVKBuffer(
+        viewBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        _ViewBuffer,
+        _ViewBufferMemory);
+    vkMapMemory(_Context.GetDevice()->GetVKDevice(), _ViewBufferMemory, 0, viewBufferSize, 0, (void**)&_MappedViewBuffer);
+
+    // Views that are never set reject everything.
+    _ViewPlanes.resize(6 * _MaxViewCount, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+}
+
+GPUCulling::~GPUCulling()
+{
+    for (auto& draws : _ModelDraws)
+    {
+        DestroyDrawBuffers(draws);
+    }
+    vkUnmapMemory(_Context.GetDevice()->GetVKDevice(), _ViewBufferMemory);
+    vkDestroyBuffer(_Context.GetDevice()->GetVKDevice(), _ViewBuffer, nullptr);
+    vkFreeMemory(_Context.GetDevice()->GetVKDevice(), _ViewBufferMemory, nullptr);
+}
+
+void GPUCulling::Register(const Ref<Model>& InModel)
+{
+    ASSERT(InModel->GetInstanceBuffer() != VK_NULL_HANDLE, "GPU culling needs a model with an instance buffer.");
+
+    ModelDraws draws;
+    draws.Target = InModel;
+    BuildDrawRecords(draws);
+    _ModelDraws.push_back(draws);
+}
+
+void GPUCulling::BuildDrawRecords(ModelDraws& InDraws)
+{
+    // Always a new set. The previous one may still be used by frames in flight and must not be updated.
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = _DescriptorPool->GetDescriptorPool();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &_DescriptorSetLayout->GetDescriptorLayout();
+
+    VkResult rslt = vkAllocateDescriptorSets(_Context.GetDevice()->GetVKDevice(), &allocInfo, &InDraws.DescriptorSet);
+    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+
+    const std::vector<Mesh*>&            meshes        = InDraws.Target->GetMeshes();
+    const std::vector<Model::DrawRange>& ranges        = InDraws.Target->GetMeshRanges();
+    const std::vector<Model::DrawRange>& batches       = InDraws.Target->GetDrawBatches();
+    const uint32_t                       instanceCount = InDraws.Target->GetInstanceCount();
+
+    // Records are grouped by batch so the commands of a batch form one contiguous region for vkCmdDrawIndexedIndirectCount.
+    std::vector<DrawRecord> records;
+    records.reserve(ranges.size() * instanceCount);
+    InDraws.BatchFirstRecord.assign(batches.size(), 0);
+    InDraws.BatchRecordCount.assign(batches.size(), 0);
+
+    uint32_t batchIndex = 0;
+    for (int i = 0; i < ranges.size(); i++)
+    {
+        // Mesh ranges are sorted by first index and every batch covers a run of them.
+        while (ranges[i].FirstIndex >= batches[batchIndex].FirstIndex + batches[batchIndex].IndexCount)
+        {
+            batchIndex++;
+            InDraws.BatchFirstRecord[batchIndex] = (uint32_t)records.size();
+        }
+
+        for (uint32_t instance = 0; instance < instanceCount; instance++)
+        {
+            DrawRecord record;
+            record.FirstIndex    = ranges[i].FirstIndex;
+            record.IndexCount    = ranges[i].IndexCount;
+            record.VertexOffset  = ranges[i].VertexOffset;
+            record.BatchIndex    = batchIndex;
+            record.InstanceIndex = instance;
+            record.CommandBase   = InDraws.BatchFirstRecord[batchIndex];
+            record.BoundsMin     = glm::vec4(meshes[i]->GetBoundsMin(), 1.0f);
+            record.BoundsMax     = glm::vec4(meshes[i]->GetBoundsMax(), 1.0f);
+            records.push_back(record);
+            InDraws.BatchRecordCount[batchIndex]++;
+        }
+    }
+    InDraws.RecordCount    = (uint32_t)records.size();
+    InDraws.InstanceCount  = instanceCount;
+    InDraws.InstanceBuffer = InDraws.Target->GetInstanceBuffer();
+
+    // Records only change with the instance count so they stay in host visible memory.
+    VkDeviceSize recordBufferSize = sizeof(DrawRecord) * records.size();
+    Utils::CreateVKBuffer(
+        recordBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        InDraws.RecordBuffer,
+        InDraws.RecordBufferMemory);
+
+    void* mappedRecords;
+    vkMapMemory(_Context.GetDevice()->GetVKDevice(), InDraws.RecordBufferMemory, 0, recordBufferSize, 0, &mappedRecords);
+    memcpy(mappedRecords, records.data(), recordBufferSize);
+    vkUnmapMemory(_Context.GetDevice()->GetVKDevice(), InDraws.RecordBufferMemory);
+
+    // One command slot per record and view, one counter per batch and view.
+    VkDeviceSize indirectBufferSize = sizeof(VkDrawIndexedIndirectCommand) * records.size() * _MaxViewCount;
+    Utils::CreateVKBuffer(
+        indirectBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        InDraws.IndirectBuffer,
+        InDraws.IndirectBufferMemory);
+
+    VkDeviceSize countBufferSize = sizeof(uint32_t) * batches.size() * _MaxViewCount;
+    Utils::CreateVKBuffer(
+        countBufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        InDraws.CountBuffer,
+        InDraws.CountBufferMemory);
+
+    Utils::UpdateDescriptorSet(
+        InDraws.DescriptorSet, InDraws.RecordBuffer, 0, recordBufferSize, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    Utils::UpdateDescriptorSet(
+        InDraws.DescriptorSet, InDraws.InstanceBuffer, 0, VK_WHOLE_SIZE, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    Utils::UpdateDescriptorSet(InDraws.DescriptorSet, _ViewBuffer, 0, VK_WHOLE_SIZE, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    Utils::UpdateDescriptorSet(
+        InDraws.DescriptorSet, InDraws.IndirectBuffer, 0, indirectBufferSize, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    Utils::UpdateDescriptorSet(
+        InDraws.DescriptorSet, InDraws.CountBuffer, 0, countBufferSize, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+}
+
+void GPUCulling::DestroyDrawBuffers(ModelDraws& InDraws)
+{
+    if (InDraws.RecordBuffer == VK_NULL_HANDLE)
+        return;
+
+    VkDevice device = _Context.GetDevice()->GetVKDevice();
+    vkDestroyBuffer(device, InDraws.RecordBuffer, nullptr);
+    vkFreeMemory(device, InDraws.RecordBufferMemory, nullptr);
+    vkDestroyBuffer(device, InDraws.IndirectBuffer, nullptr);
+    vkFreeMemory(device, InDraws.IndirectBufferMemory, nullptr);
+    vkDestroyBuffer(device, InDraws.CountBuffer, nullptr);
+    vkFreeMemory(device, InDraws.CountBufferMemory, nullptr);
+    InDraws.RecordBuffer = VK_NULL_HANDLE;
+}
+
+void GPUCulling::RetireDrawBuffers(ModelDraws& InDraws)
+{
+    VkDevice         device = _Context.GetDevice()->GetVKDevice();
+    VkDescriptorPool pool   = _DescriptorPool->GetDescriptorPool();
+    _Context.GetDeletionQueue()->Retire(
+        [device,
+         pool,
+         descriptorSet        = InDraws.DescriptorSet,
+         recordBuffer         = InDraws.RecordBuffer,
+         recordBufferMemory   = InDraws.RecordBufferMemory,
+         indirectBuffer       = InDraws.IndirectBuffer,
+         indirectBufferMemory = InDraws.IndirectBufferMemory,
+         countBuffer          = InDraws.CountBuffer,
+         countBufferMemory    = InDraws.CountBufferMemory]()
+        {
+            vkFreeDescriptorSets(device, pool, 1, &descriptorSet);
+            vkDestroyBuffer(device, recordBuffer, nullptr);
+            vkFreeMemory(device, recordBufferMemory, nullptr);
+            vkDestroyBuffer(device, indirectBuffer, nullptr);
+            vkFreeMemory(device, indirectBufferMemory, nullptr);
+            vkDestroyBuffer(device, countBuffer, nullptr);
+            vkFreeMemory(device, countBufferMemory, nullptr);
+        });
+    InDraws.DescriptorSet = VK_NULL_HANDLE;
+    InDraws.RecordBuffer  = VK_NULL_HANDLE;
+}
+
+void GPUCulling::SetView(uint32_t InViewIndex, const Frustum& InFrustum)
+{
+    ASSERT(InViewIndex < _MaxViewCount, "View index out of range.");
+
+    for (int i = 0; i < 6; i++)
+    {
+        _ViewPlanes[InViewIndex * 6 + i] = InFrustum.GetPlanes()[i];
+    }
+}
+
+void GPUCulling::Dispatch(const VkCommandBuffer& InCommandBuffer, uint32_t InFrameIndex)
+{
+    TRACE_FUNCTION();
+
+    // Instance count changes invalidate the records. Frames in flight may still read the old buffers and set, so the
+    // records are rebuilt into new ones and the old ones are retired.
+    for (auto& draws : _ModelDraws)
+    {
+        if (draws.InstanceCount != draws.Target->GetInstanceCount() ||
+            draws.InstanceBuffer != draws.Target->GetInstanceBuffer())
+        {
+            RetireDrawBuffers(draws);
+            BuildDrawRecords(draws);
+        }
+    }
+
+    const uint32_t firstView = InFrameIndex * _MaxViewCount;
+    memcpy(_MappedViewBuffer + firstView * 6, _ViewPlanes.data(), sizeof(glm::vec4) * _ViewPlanes.size());
+
+    // Last frame's indirect reads have to finish before the counters are reset and the commands are rewritten.
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        InCommandBuffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+
+    for (const auto& draws : _ModelDraws)
+    {
+        vkCmdFillBuffer(InCommandBuffer, draws.CountBuffer, 0, VK_WHOLE_SIZE, 0);
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        InCommandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+
+    vkCmdBindPipeline(InCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _CullPipeline->GetHandle());
+    for (const auto& draws : _ModelDraws)
+    {
+        struct CullParameters
+        {
+            glm::mat4  ModelMatrix;
+            glm::uvec4 CullInfo;
+            glm::uvec4 InstanceInfo;
+        };
+
+        CullParameters parameters;
+        parameters.ModelMatrix  = draws.Target->GetTransform();
+        parameters.CullInfo     = glm::uvec4(draws.RecordCount, draws.BatchRecordCount.size(), firstView, _MaxViewCount);
+        parameters.InstanceInfo = glm::uvec4(draws.Target->GetFirstInstance(), 0, 0, 0);
+
+        vkCmdBindDescriptorSets(
+            InCommandBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            _CullPipeline->GetPipelineLayout(),
+            0,
+            1,
+            &draws.DescriptorSet,
+            0,
+            nullptr);
+        vkCmdPushConstants(
+            InCommandBuffer,
+            _CullPipeline->GetPipelineLayout(),
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(CullParameters),
+            &parameters);
+        vkCmdDispatch(InCommandBuffer, (draws.RecordCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, _MaxViewCount, 1);
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(
+        InCommandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+}
+
+void GPUCulling::DrawIndexed(
+    const VkCommandBuffer&  InCommandBuffer,
+    const VkPipelineLayout& InPipelineLayout,
+    const Ref<Model>&       InModel,
+    uint32_t                InViewIndex,
+    bool                    InPositionsOnly)
+{
+    const ModelDraws* draws = nullptr;
+    for (const auto& modelDraws : _ModelDraws)
+    {
+        if (modelDraws.Target == InModel)
+            draws = &modelDraws;
+    }
+    ASSERT(draws, "Model was not registered for GPU culling.");
+
+    InModel->BindGeometry(InCommandBuffer, InPipelineLayout, InPositionsOnly);
+
+    // Batches of bindless models have no set of their own, the global set is bound by the caller.
+    const std::vector<Model::DrawRange>& batches        = InModel->GetDrawBatches();
+    const std::vector<uint32_t>&         dynamicOffsets = InModel->GetDynamicOffsets();
+    for (int i = 0; i < batches.size(); i++)
+    {
+        if (batches[i].DescriptorSet != VK_NULL_HANDLE)
+        {
+            vkCmdBindDescriptorSets(
+                InCommandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                InPipelineLayout,
+                0,
+                1,
+                &batches[i].DescriptorSet,
+                (uint32_t)dynamicOffsets.size(),
+                dynamicOffsets.data());
+        }
+
+        VkDeviceSize commandOffset =
+            sizeof(VkDrawIndexedIndirectCommand) * ((VkDeviceSize)InViewIndex * draws->RecordCount + draws->BatchFirstRecord[i]);
+        VkDeviceSize countOffset = sizeof(uint32_t) * ((VkDeviceSize)InViewIndex * batches.size() + i);
+        vkCmdDrawIndexedIndirectCount(
+            InCommandBuffer,
+            draws->IndirectBuffer,
+            commandOffset,
+            draws->CountBuffer,
+            countOffset,
+            draws->BatchRecordCount[i],
+            sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <glm/glm.hpp>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class Model;
+class Frustum;
+class Pipeline;
+class DescriptorPool;
+class DescriptorSetLayout;
+class VulkanContext;
+
+// GPU driven draw submission. Every registered model is expanded into draw records (one per mesh and instance) that live
+// in a storage buffer. A compute pass culls the records against every view of the frame and writes
+// VkDrawIndexedIndirectCommands together with a per material draw count. Drawing a model for a view then costs one
+// vkCmdDrawIndexedIndirectCount per material, independent of how many meshes or instances it has.
+class GPUCulling
+{
+   public:
+    GPUCulling(VulkanContext& InContext, uint32_t InMaxViewCount, uint32_t InFramesInFlight);
+    ~GPUCulling();
+
+    // The model must have been created with a layout that contains the instance storage buffer.
+    void Register(const Ref<Model>& InModel);
+
+    // Views are rewritten every frame before Dispatch. Unused view slots are simply never drawn.
+    void SetView(uint32_t InViewIndex, const Frustum& InFrustum);
+
+    // Culls every registered model against every view. Must be recorded outside of a render pass, before any draw.
+    void Dispatch(const VkCommandBuffer& InCommandBuffer, uint32_t InFrameIndex);
+
+    // Binds the model's geometry and draws whatever survived culling for the given view. The model matrix push
+    // constant is left to the caller, same as Model::DrawIndexed. InPositionsOnly binds the position stream for depth only
+    // pipelines.
+    void DrawIndexed(
+        const VkCommandBuffer&  InCommandBuffer,
+        const VkPipelineLayout& InPipelineLayout,
+        const Ref<Model>&       InModel,
+        uint32_t                InViewIndex,
+        bool                    InPositionsOnly = false);
+
+   private:
+    // Matches the std430 layout of cullDraws.comp.
+    struct DrawRecord
+    {
+        uint32_t  FirstIndex    = 0;
+        uint32_t  IndexCount    = 0;
+        int32_t   VertexOffset  = 0;
+        uint32_t  BatchIndex    = 0;
+        uint32_t  InstanceIndex = 0;
+        uint32_t  CommandBase   = 0; // First record of the batch. Commands of a batch are packed from here.
+        uint32_t  Padding[2]    = {};
+        glm::vec4 BoundsMin     = glm::vec4(0.0f);
+        glm::vec4 BoundsMax     = glm::vec4(0.0f);
+    };
+
+    struct ModelDraws
+    {
+        Ref<Model>            Target;
+        uint32_t              RecordCount          = 0;
+        uint32_t              InstanceCount        = 0;
+        VkBuffer              InstanceBuffer       = VK_NULL_HANDLE;
+        std::vector<uint32_t> BatchFirstRecord;
+        std::vector<uint32_t> BatchRecordCount;
+
+        VkBuffer              RecordBuffer         = VK_NULL_HANDLE;
+        VkDeviceMemory        RecordBufferMemory   = VK_NULL_HANDLE;
+        VkBuffer              IndirectBuffer       = VK_NULL_HANDLE;
+        VkDeviceMemory        IndirectBufferMemory = VK_NULL_HANDLE;
+        VkBuffer              CountBuffer          = VK_NULL_HANDLE;
+        VkDeviceMemory        CountBufferMemory    = VK_NULL_HANDLE;
+        VkDescriptorSet       DescriptorSet        = VK_NULL_HANDLE;
+    };
+
+    // Creates new buffers and a new descriptor set. The current ones have to be retired or destroyed first.
+    void BuildDrawRecords(ModelDraws& InDraws);
+    void DestroyDrawBuffers(ModelDraws& InDraws);
+    void RetireDrawBuffers(ModelDraws& InDraws);
+
+   private:
+    VulkanContext& _Context;
+    uint32_t       _MaxViewCount;
+    uint32_t       _FramesInFlight;
+
+    Ref<DescriptorSetLayout> _DescriptorSetLayout;
+    Unique<DescriptorPool>   _DescriptorPool;
+    Ref<Pipeline>            _CullPipeline;
+
+    // Six planes per view, one region per frame in flight so the CPU never writes planes the GPU is still reading.
+    VkBuffer               _ViewBuffer       = VK_NULL_HANDLE;
+    VkDeviceMemory         _ViewBufferMemory = VK_NULL_HANDLE;
+    glm::vec4*             _MappedViewBuffer = nullptr;
+    std::vector<glm::vec4> _ViewPlanes;
+
+    std::vector<ModelDraws> _ModelDraws;
+};
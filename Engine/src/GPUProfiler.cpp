@@ -0,0 +1,352 @@
+#include "GPUProfiler.h"
+#include "LogicalDevice.h"
+#include "PhysicalDevice.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+// External
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <imgui.h>
+#include <iomanip>
+
+GPUProfiler::GPUProfiler(VulkanContext& InContext, uint32_t InFramesInFlight, uint32_t InMaxScopesPerFrame)
+    : _Context(InContext), _MaxQueries(InMaxScopesPerFrame * 2)
+{
+    Ref<PhysicalDevice> physicalDevice = _Context.GetPhysicalDevice();
+    _TimestampValidBits = physicalDevice->GetQueueFamilies()[_Context._QueueFamilies.GraphicsFamily].Props.timestampValidBits;
+    _TimestampPeriod    = physicalDevice->GetVKProperties().limits.timestampPeriod;
+    if (!IsSupported())
+    {
+        PrintWarning("The graphics queue doesn't support timestamps, GPU profiling is disabled.");
+        return;
+    }
+
+    VkQueryPoolCreateInfo createInfo{};
+    createInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = _MaxQueries;
+
+    _Frames.resize(InFramesInFlight);
+    for (FrameQueries& frame : _Frames)
+    {
+        ASSERT(
+            vkCreateQueryPool(_Context.GetDevice()->GetVKDevice(), &createInfo, nullptr, &frame.Pool) == VK_SUCCESS,
+            "Failed to create timestamp query pool!");
+    }
+}
+
+GPUProfiler::~GPUProfiler()
+{
+    for (FrameQueries& frame : _Frames)
+        vkDestroyQueryPool(_Context.GetDevice()->GetVKDevice(), frame.Pool, nullptr);
+}
+
+void GPUProfiler::BeginFrame(const VkCommandBuffer& InCommandBuffer, uint32_t InFrameIndex)
+{
+    _CurrentFrame = nullptr;
+    _OpenScopes.clear();
+    if (!IsSupported())
+        return;
+
+    FrameQueries& frame = _Frames[InFrameIndex];
+    Collect(frame);
+
+    // Numbered even when not timed, so the numbers keep matching the caller's frames.
+    uint64_t frameNumber = _FrameNumber++;
+    if (!_Enabled)
+        return;
+
+    vkCmdResetQueryPool(InCommandBuffer, frame.Pool, 0, _MaxQueries);
+    frame.Number  = frameNumber;
+    _CurrentFrame = &frame;
+}
+
+std::vector<GPUFrameTime> GPUProfiler::TakeFrameTimes()
+{
+    std::vector<GPUFrameTime> frameTimes = std::move(_FrameTimes);
+    _FrameTimes.clear();
+    return frameTimes;
+}
+
+void GPUProfiler::CollectAll()
+{
+    vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
+
+    // Oldest first, so the frame times stay in order.
+    std::vector<FrameQueries*> pending;
+    for (FrameQueries& frame : _Frames)
+    {
+        if (frame.QueryCount > 0)
+            pending.push_back(&frame);
+    }
+    std::sort(
+        pending.begin(), pending.end(), [](const FrameQueries* a, const FrameQueries* b) { return a->Number < b->Number; });
+
+    for (FrameQueries* frame : pending)
+        Collect(*frame);
+}
+
+void GPUProfiler::EndFrame(const VkCommandBuffer& InCommandBuffer)
+{
+    while (!_OpenScopes.empty())
+        EndScope(InCommandBuffer);
+    _CurrentFrame = nullptr;
+}
+
+uint32_t GPUProfiler::AllocateQuery()
+{
+    if (_CurrentFrame->QueryCount == _MaxQueries)
+        return UINT32_MAX;
+    return _CurrentFrame->QueryCount++;
+}
+
+void GPUProfiler::BeginScope(const VkCommandBuffer& InCommandBuffer, const std::string& InName)
+{
+    if (!_CurrentFrame)
+        return;
+
+    ScopeRecord scope;
+    scope.Name       = InName;
+    scope.Depth      = (uint32_t)_OpenScopes.size();
+    scope.Path       = _OpenScopes.empty() ? InName : _CurrentFrame->Scopes[_OpenScopes.back()].Path + "/" + InName;
+    scope.BeginQuery = AllocateQuery();
+
+    if (scope.BeginQuery != UINT32_MAX)
+        vkCmdWriteTimestamp(InCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _CurrentFrame->Pool, scope.BeginQuery);
+
+    _OpenScopes.push_back((uint32_t)_CurrentFrame->Scopes.size());
+    _CurrentFrame->Scopes.push_back(std::move(scope));
+}
+
+void GPUProfiler::EndScope(const VkCommandBuffer& InCommandBuffer)
+{
+    if (!_CurrentFrame || _OpenScopes.empty())
+        return;
+
+    ScopeRecord& scope = _CurrentFrame->Scopes[_OpenScopes.back()];
+    _OpenScopes.pop_back();
+
+    // A scope that didn't get its begin query is dropped as a whole.
+    if (scope.BeginQuery == UINT32_MAX)
+        return;
+
+    scope.EndQuery = AllocateQuery();
+    if (scope.EndQuery != UINT32_MAX)
+        vkCmdWriteTimestamp(InCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _CurrentFrame->Pool, scope.EndQuery);
+}
+
+void GPUProfiler::Collect(FrameQueries& InFrame)
+{
+    if (InFrame.QueryCount == 0)
+    {
+        InFrame.Scopes.clear();
+        return;
+    }
+
+    // Value and availability of every query. The frame's fence was waited on, so anything unavailable was never written,
+    // e.g. because the frame slot was skipped after a change of the frames in flight.
+    std::vector<uint64_t> results(InFrame.QueryCount * 2);
+    VkResult              result = vkGetQueryPoolResults(
+        _Context.GetDevice()->GetVKDevice(),
+        InFrame.Pool,
+        0,
+        InFrame.QueryCount,
+        results.size() * sizeof(uint64_t),
+        results.data(),
+        sizeof(uint64_t) * 2,
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result == VK_SUCCESS)
+    {
+        const uint64_t validMask = _TimestampValidBits >= 64 ? UINT64_MAX : (1ull << _TimestampValidBits) - 1;
+
+        _LastFrameOrder.clear();
+        for (const ScopeRecord& scope : InFrame.Scopes)
+        {
+            if (scope.BeginQuery == UINT32_MAX || scope.EndQuery == UINT32_MAX)
+                continue;
+            if (results[scope.BeginQuery * 2 + 1] == 0 || results[scope.EndQuery * 2 + 1] == 0)
+                continue;
+
+            uint64_t ticks        = (results[scope.EndQuery * 2] - results[scope.BeginQuery * 2]) & validMask;
+            float    milliseconds = (float)(ticks * (double)_TimestampPeriod / 1e6);
+
+            ScopeStats& stats = _Stats[scope.Path];
+            stats.Name        = scope.Name;
+            stats.Depth       = scope.Depth;
+            stats.Last        = milliseconds;
+            if (stats.History.size() < HISTORY_LENGTH)
+                stats.History.push_back(milliseconds);
+            else
+                stats.History[stats.Next] = milliseconds;
+            stats.Next = (stats.Next + 1) % HISTORY_LENGTH;
+
+            _LastFrameOrder.push_back(scope.Path);
+
+            if (_RecordFrameTimes && scope.Depth == 0)
+                _FrameTimes.push_back(GPUFrameTime{ InFrame.Number, milliseconds });
+        }
+        _CollectedFrameCount++;
+    }
+
+    InFrame.Scopes.clear();
+    InFrame.QueryCount = 0;
+}
+
+GPUProfiler::Summary GPUProfiler::Summarize(const ScopeStats& InStats) const
+{
+    Summary summary;
+    if (InStats.History.empty())
+        return summary;
+
+    std::vector<float> sorted = InStats.History;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&sorted](float p) { return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))]; };
+
+    float sum = 0.0f;
+    for (float sample : sorted)
+        sum += sample;
+
+    summary.Average = sum / sorted.size();
+    summary.Minimum = sorted.front();
+    summary.Maximum = sorted.back();
+    summary.P50     = percentile(0.50f);
+    summary.P95     = percentile(0.95f);
+    summary.P99     = percentile(0.99f);
+    return summary;
+}
+
+namespace
+{
+// Creates the parent directories of an Engine relative path and opens it.
+std::ofstream OpenExportFile(const std::string& InPath, std::filesystem::path& OutFullPath)
+{
+    OutFullPath = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/" + InPath);
+
+    std::error_code error;
+    std::filesystem::create_directories(OutFullPath.parent_path(), error);
+    return std::ofstream(OutFullPath, std::ios::trunc);
+}
+} // namespace
+
+void GPUProfiler::DrawOverlay()
+{
+    ImGui::Begin("GPU Profiler");
+
+    if (!IsSupported())
+    {
+        ImGui::Text("Timestamps are not supported by the graphics queue.");
+        ImGui::End();
+        return;
+    }
+
+    bool enabled = _Enabled;
+    if (ImGui::Checkbox("Enabled", &enabled))
+        SetEnabled(enabled);
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV"))
+        ExportCSV("profiles/gpu_profile_" + Utils::GetTimestampString() + ".csv");
+    ImGui::SameLine();
+    if (ImGui::Button("Export JSON"))
+        ExportJSON("profiles/gpu_profile_" + Utils::GetTimestampString() + ".json");
+
+    ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("GPU scopes", 6, flags))
+    {
+        ImGui::TableSetupColumn("Pass", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Last");
+        ImGui::TableSetupColumn("Avg");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableHeadersRow();
+
+        // Rows follow the order of the last frame, which is depth first, so indenting by depth draws the tree.
+        for (const std::string& path : _LastFrameOrder)
+        {
+            const ScopeStats& stats   = _Stats.at(path);
+            Summary           summary = Summarize(stats);
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::SetCursorPosX(ImGui::GetCursorPosX() + stats.Depth * 12.0f);
+            ImGui::TextUnformatted(stats.Name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.Last);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", summary.Average);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", summary.P50);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", summary.P95);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", summary.P99);
+        }
+        ImGui::EndTable();
+    }
+    ImGui::Text("Milliseconds over the last %u frames.", std::min<uint32_t>(HISTORY_LENGTH, (uint32_t)_CollectedFrameCount));
+
+    ImGui::End();
+}
+
+bool GPUProfiler::ExportCSV(const std::string& InPath) const
+{
+    std::filesystem::path fullPath;
+    std::ofstream         file = OpenExportFile(InPath, fullPath);
+    if (!file.is_open())
+    {
+        PrintWarning("Failed to open " + fullPath.string() + " for writing.");
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(4) << "scope,samples,avg_ms,min_ms,max_ms,p50_ms,p95_ms,p99_ms\n";
+    for (const std::string& path : _LastFrameOrder)
+    {
+        const ScopeStats& stats   = _Stats.at(path);
+        Summary           summary = Summarize(stats);
+        file << path << ',' << stats.History.size() << ',' << summary.Average << ',' << summary.Minimum << ','
+             << summary.Maximum << ',' << summary.P50 << ',' << summary.P95 << ',' << summary.P99 << '\n';
+    }
+
+    PrintInfo("Exported the GPU profile to " + fullPath.string());
+    return true;
+}
+
+bool GPUProfiler::ExportJSON(const std::string& InPath) const
+{
+    std::filesystem::path fullPath;
+    std::ofstream         file = OpenExportFile(InPath, fullPath);
+    if (!file.is_open())
+    {
+        PrintWarning("Failed to open " + fullPath.string() + " for writing.");
+        return false;
+    }
+
+    // Scope names are our own pass names, none of them needs escaping.
+    file << std::fixed << std::setprecision(4) << "{\n  \"scopes\": [";
+    for (size_t i = 0; i < _LastFrameOrder.size(); i++)
+    {
+        const ScopeStats& stats   = _Stats.at(_LastFrameOrder[i]);
+        Summary           summary = Summarize(stats);
+
+        file << (i == 0 ? "\n" : ",\n") << "    { \"path\": \"" << _LastFrameOrder[i] << "\", \"depth\": " << stats.Depth
+             << ", \"avg_ms\": " << summary.Average << ", \"min_ms\": " << summary.Minimum << ", \"max_ms\": "
+             << summary.Maximum << ", \"p50_ms\": " << summary.P50 << ", \"p95_ms\": " << summary.P95
+             << ", \"p99_ms\": " << summary.P99 << ", \"samples_ms\": [";
+
+        // Oldest sample first.
+        for (size_t s = 0; s < stats.History.size(); s++)
+        {
+            size_t index = stats.History.size() < HISTORY_LENGTH ? s : (stats.Next + s) % HISTORY_LENGTH;
+            file << (s == 0 ? "" : ", ") << stats.History[index];
+        }
+        file << "] }";
+    }
+    file << "\n  ]\n}\n";
+
+    PrintInfo("Exported the GPU profile to " + fullPath.string());
+    return true;
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// GPU time of a whole frame. Frames are numbered in the order BeginFrame was called, starting at 0.
+struct GPUFrameTime
+{
+    uint64_t Frame;
+    float    Milliseconds;
+};
+
+// Measures GPU time per pass with timestamp queries.
+//
+// Scopes nest, so passes can be broken down into their steps. Every frame in flight has its own query pool. A pool is read
+// back when its frame slot comes around again, after its fence was waited on, so reading results never stalls. Timings are
+// kept per scope path (e.g. "Frame/Bloom/Downsample 2") over the last HISTORY_LENGTH frames, which the overlay and the
+// exports turn into averages and percentiles.
+class GPUProfiler
+{
+   public:
+    static constexpr uint32_t HISTORY_LENGTH = 256;
+
+    GPUProfiler(VulkanContext& InContext, uint32_t InFramesInFlight, uint32_t InMaxScopesPerFrame = 128);
+    ~GPUProfiler();
+
+    // Collects what InFrameIndex recorded last time and resets its queries. Must be recorded before anything else that is
+    // timed, outside of a render pass.
+    void BeginFrame(const VkCommandBuffer& InCommandBuffer, uint32_t InFrameIndex);
+    // Closes scopes left open.
+    void EndFrame(const VkCommandBuffer& InCommandBuffer);
+
+    void BeginScope(const VkCommandBuffer& InCommandBuffer, const std::string& InName);
+    void EndScope(const VkCommandBuffer& InCommandBuffer);
+
+    // Takes effect with the next frame.
+    void SetEnabled(bool InEnabled)
+    {
+        _Enabled = InEnabled;
+    }
+    bool IsEnabled() const
+    {
+        return _Enabled;
+    }
+    // False when the graphics queue has no timestamp support.
+    bool IsSupported() const
+    {
+        return _TimestampValidBits != 0;
+    }
+
+    // A window with the scope tree of the last collected frame and the statistics of every scope.
+    void DrawOverlay();
+
+    // One row per scope: path, sample count, average, minimum, maximum and percentiles in milliseconds. The JSON export
+    // also has the raw history. Paths are relative to the Engine directory. Returns false if the file can't be written.
+    bool ExportCSV(const std::string& InPath) const;
+    bool ExportJSON(const std::string& InPath) const;
+
+    // While recording, the time of the outermost scope of every collected frame is kept until taken. Frames are only
+    // collected when their slot comes around again, CollectAll waits for the device and collects the rest.
+    void SetFrameTimeRecording(bool InRecord)
+    {
+        _RecordFrameTimes = InRecord;
+    }
+    std::vector<GPUFrameTime> TakeFrameTimes();
+    void                      CollectAll();
+
+   private:
+    struct ScopeRecord
+    {
+        std::string Path;
+        std::string Name;
+        uint32_t    Depth;
+        uint32_t    BeginQuery;
+        uint32_t    EndQuery = UINT32_MAX;
+    };
+
+    struct FrameQueries
+    {
+        VkQueryPool              Pool = VK_NULL_HANDLE;
+        std::vector<ScopeRecord> Scopes;
+        uint32_t                 QueryCount = 0;
+        uint64_t                 Number     = 0;
+    };
+
+    struct ScopeStats
+    {
+        std::string        Name;
+        uint32_t           Depth = 0;
+        std::vector<float> History; // Ring buffer of HISTORY_LENGTH samples in milliseconds.
+        uint32_t           Next  = 0;
+        float              Last  = 0.0f;
+    };
+
+    struct Summary
+    {
+        float Average = 0.0f;
+        float Minimum = 0.0f;
+        float Maximum = 0.0f;
+        float P50     = 0.0f;
+        float P95     = 0.0f;
+        float P99     = 0.0f;
+    };
+
+    void     Collect(FrameQueries& InFrame);
+    Summary  Summarize(const ScopeStats& InStats) const;
+    uint32_t AllocateQuery();
+
+   private:
+    VulkanContext& _Context;
+    uint32_t       _MaxQueries;
+    uint32_t       _TimestampValidBits = 0;
+    float          _TimestampPeriod    = 1.0f; // Nanoseconds per tick.
+    bool           _Enabled            = true;
+
+    std::vector<FrameQueries> _Frames;
+    FrameQueries*             _CurrentFrame = nullptr; // Null while the frame isn't timed.
+    std::vector<uint32_t>     _OpenScopes;
+
+    std::unordered_map<std::string, ScopeStats> _Stats;
+    std::vector<std::string>                    _LastFrameOrder; // Scope paths of the last collected frame, depth first.
+    uint64_t                                    _CollectedFrameCount = 0;
+    uint64_t                                    _FrameNumber         = 0;
+
+    bool                      _RecordFrameTimes = false;
+    std::vector<GPUFrameTime> _FrameTimes;
+};
+
+// Times the enclosing block. Does nothing when the profiler is null.
+class GPUProfileScope
+{
+   public:
+    GPUProfileScope(GPUProfiler* InProfiler, const VkCommandBuffer& InCommandBuffer, const std::string& InName)
+        : _Profiler(InProfiler), _CommandBuffer(InCommandBuffer)
+    {
+        if (_Profiler)
+            _Profiler->BeginScope(_CommandBuffer, InName);
+    }
+    ~GPUProfileScope()
+    {
+        if (_Profiler)
+            _Profiler->EndScope(_CommandBuffer);
+    }
+
+    GPUProfileScope(const GPUProfileScope&)            = delete;
+    GPUProfileScope& operator=(const GPUProfileScope&) = delete;
+
+   private:
+    GPUProfiler*    _Profiler;
+    VkCommandBuffer _CommandBuffer;
+};
@@ -3,6 +3,7 @@
 #include "Image.h"
 #include "LogicalDevice.h"
 #include "PhysicalDevice.h"
+#include "Tracer.h"
 #include "Utils.h"
 #include "VulkanContext.h"
 #define STB_IMAGE_IMPLEMENTATION
@@ -10,6 +11,8 @@
 // This constructor is to be used when you want to initialize a VkImage with as a color/texture buffer:
 Image::Image(std::vector<std::string> textures, VkFormat imageFormat) : m_ImageFormat(imageFormat)
 {
+    TRACE_FUNCTION();
+
     stbi_uc*     pixels = nullptr;
     stbi_uc*     cubemapTextures[6];
     VkDeviceSize imageSize;
@@ -128,17 +131,28 @@ Image::Image(std::vector<std::string> textures, VkFormat imageFormat) : m_ImageF
     }
 }
 
-Image::Image(uint32_t width, uint32_t height, VkFormat imageFormat, VkImageUsageFlags usageFlags, ImageType imageType)
+Image::Image(
+    uint32_t          width,
+    uint32_t          height,
+    VkFormat          imageFormat,
+    VkImageUsageFlags usageFlags,
+    ImageType         imageType,
+    uint32_t          layerCount)
     : m_ImageFormat(imageFormat)
 {
-    m_Width  = width;
-    m_Height = height;
+    m_Width      = width;
+    m_Height     = height;
+    m_LayerCount = layerCount;
     SetupImage(width, height, m_ImageFormat, usageFlags, imageType);
     m_MipLevels = 1;
 }
 
 Image::~Image()
 {
+    for (auto& layerView : m_LayerImageViews)
+    {
+        vkDestroyImageView(EngineInternal::GetContext().GetDevice()->GetVKDevice(), layerView, nullptr);
+    }
     vkDestroyImageView(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_ImageView, nullptr);
     vkDestroyImage(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_Image, nullptr);
     vkFreeMemory(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_ImageMemory, nullptr);
@@ -202,6 +216,8 @@ void Image::TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayo
 
 void Image::CopyBufferToImage(const VkBuffer& buffer, uint32_t width, uint32_t height)
 {
+    TRACE_FUNCTION();
+
     VkCommandBuffer singleCmdBuffer;
     VkCommandPool   singleCmdPool;
     CommandBuffer::CreateCommandBufferPool(EngineInternal::GetContext()._QueueFamilies.TransferFamily, singleCmdPool);
@@ -281,10 +297,17 @@ void Image::SetupImage(uint32_t width, uint32_t height, VkFormat imageFormat, Vk
 
     if (m_IsCubemap)
     {
-        layerCount  = 6;
-        arrayLayers = 6;
-        viewType    = VK_IMAGE_VIEW_TYPE_CUBE;
-        flags       = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        layerCount   = 6;
+        arrayLayers  = 6;
+        viewType     = VK_IMAGE_VIEW_TYPE_CUBE;
+        flags        = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+        m_LayerCount = 6;
+    }
+    else if (m_LayerCount > 1)
+    {
+        layerCount  = m_LayerCount;
+        arrayLayers = m_LayerCount;
+        viewType    = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
     }
 
     // VK Image creation.
@@ -339,10 +362,28 @@ void Image::SetupImage(uint32_t width, uint32_t height, VkFormat imageFormat, Vk
     ASSERT(
         vkCreateImageView(EngineInternal::GetContext().GetDevice()->GetVKDevice(), &viewInfo, nullptr, &m_ImageView) == VK_SUCCESS,
         "Failed to create texture image view!");
+
+    // Array images and cubemaps also get one view per layer so that each layer can be rendered to separately.
+    if (layerCount > 1)
+    {
+        m_LayerImageViews.resize(layerCount);
+        for (uint32_t i = 0; i < layerCount; i++)
+        {
+            viewInfo.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.subresourceRange.baseArrayLayer = i;
+            viewInfo.subresourceRange.layerCount     = 1;
+            ASSERT(
+                vkCreateImageView(
+                    EngineInternal::GetContext().GetDevice()->GetVKDevice(), &viewInfo, nullptr, &m_LayerImageViews[i]) == VK_SUCCESS,
+                "Failed to create layer image view!");
+        }
+    }
 }
 
 void Image::GenerateMipmaps()
 {
+    TRACE_FUNCTION();
+
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(
         EngineInternal::GetContext().GetPhysicalDevice()->GetVKPhysicalDevice(), m_ImageFormat, &formatProperties);
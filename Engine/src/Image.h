@@ -14,7 +14,15 @@ class Image
 {
    public:
     Image(std::vector<std::string> textures, VkFormat imageFormat);
-    Image(uint32_t width, uint32_t height, VkFormat imageFormat, VkImageUsageFlags usageFlags, ImageType imageType);
+    // A layerCount greater than 1 creates a 2D array image. Array and cubemap layers additionally get their own 2D view so
+    // they can be used as framebuffer attachments.
+    Image(
+        uint32_t          width,
+        uint32_t          height,
+        VkFormat          imageFormat,
+        VkImageUsageFlags usageFlags,
+        ImageType         imageType,
+        uint32_t          layerCount = 1);
 
     const VkImage& GetVKImage()
     {
@@ -28,6 +36,10 @@ class Image
     {
         return m_ImageView;
     }
+    const VkImageView& GetLayerImageView(uint32_t layer)
+    {
+        return m_LayerImageViews[layer];
+    }
     ~Image();
 
     uint32_t GetHeight()
@@ -50,6 +62,10 @@ class Image
     {
         return m_MipLevels;
     }
+    uint32_t GetLayerCount()
+    {
+        return m_LayerCount;
+    }
 
    private:
     void TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
@@ -67,10 +83,13 @@ class Image
     VkDeviceMemory m_ImageMemory = VK_NULL_HANDLE;
     VkImageView    m_ImageView   = VK_NULL_HANDLE;
 
+    std::vector<VkImageView> m_LayerImageViews;
+
     VkFormat m_ImageFormat;
 
-    uint32_t m_MipLevels = 1;
-    bool     m_IsCubemap = false;
+    uint32_t m_MipLevels  = 1;
+    uint32_t m_LayerCount = 1;
+    bool     m_IsCubemap  = false;
 
     VkDeviceSize             m_ImageSize;
     VkDeviceSize             m_LayerSize;
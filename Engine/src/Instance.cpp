@@ -60,7 +60,7 @@ void Instance::DestroyDebugUtilsMessengerEXT(
         func(instance, debugMessenger, pAllocator);
     }
 }
-Instance::Instance()
+Instance::Instance(bool headless) : m_Headless(headless)
 {
     PrintInfo("Enumerating instance extensions...");
     PrintAvailableExtensions();
@@ -170,10 +170,14 @@ void Instance::PrintAvailableExtensions()
 }
 const std::vector<const char*> Instance::GetRequiredExtensions(bool isValLayersSupported)
 {
-    const char** glfwExtensions;
-    uint32_t     extensionCount = 0;
-    glfwExtensions              = glfwGetRequiredInstanceExtensions(&extensionCount);
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + extensionCount);
+    std::vector<const char*> extensions;
+    if (!m_Headless)
+    {
+        const char** glfwExtensions;
+        uint32_t     extensionCount = 0;
+        glfwExtensions              = glfwGetRequiredInstanceExtensions(&extensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + extensionCount);
+    }
 
     if (isValLayersSupported)
     {
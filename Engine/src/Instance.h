@@ -16,7 +16,8 @@ class Instance
 
    public:
     // Constructors / Destructors
-    Instance();
+    // Headless instances don't ask GLFW for the surface extensions, GLFW isn't initialized then.
+    Instance(bool headless = false);
     ~Instance();
 
    public:
@@ -52,6 +53,7 @@ class Instance
    private:
     VkInstance                     m_Instance         = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT       m_DebugMessenger   = VK_NULL_HANDLE;
+    bool                           m_Headless         = false;
     const std::vector<const char*> m_ValidationLayers = {
         "VK_LAYER_KHRONOS_validation",
     };
@@ -77,17 +77,75 @@ LogicalDevice::LogicalDevice(std::vector<const char*> extensions) : m_DeviceExte
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.geometryShader    = VK_TRUE;
 
-    constexpr VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_feature{
+    // Indirect draws with a GPU written draw count. Optional, the renderer falls back to CPU draws without them.
+    const VkPhysicalDeviceFeatures& supportedFeatures = EngineInternal::GetContext().GetPhysicalDevice()->GetVKFeatures();
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId{};
+    supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait{};
+    supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    supportedPresentWait.pNext = &supportedPresentId;
+    VkPhysicalDeviceVulkan12Features supported12Features{};
+    supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    supported12Features.pNext = &supportedPresentWait;
+    VkPhysicalDeviceFeatures2 supportedFeatures2{};
+    supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures2.pNext = &supported12Features;
+    vkGetPhysicalDeviceFeatures2(EngineInternal::GetContext().GetPhysicalDevice()->GetVKPhysicalDevice(), &supportedFeatures2);
+
+    m_SupportsDrawIndirectCount = supported12Features.drawIndirectCount && supportedFeatures.multiDrawIndirect &&
+        supportedFeatures.drawIndirectFirstInstance;
+    deviceFeatures.multiDrawIndirect         = m_SupportsDrawIndirectCount;
+    deviceFeatures.drawIndirectFirstInstance = m_SupportsDrawIndirectCount;
+
+    // Descriptor indexing for the bindless material table. Optional, models fall back to one descriptor set per mesh.
+    m_SupportsBindlessTextures = supported12Features.descriptorIndexing && supported12Features.runtimeDescriptorArray &&
+        supported12Features.shaderSampledImageArrayNonUniformIndexing && supported12Features.descriptorBindingPartiallyBound &&
+        supported12Features.descriptorBindingSampledImageUpdateAfterBind;
+
+    // Present ids and waiting on them let the frame pacer measure when frames reach the display. Optional, pacing falls
+    // back to the in flight fences without them. Headless devices never present.
+    const Ref<PhysicalDevice>& physicalDevice = EngineInternal::GetContext().GetPhysicalDevice();
+    m_SupportsPresentWait = !EngineInternal::GetContext().IsHeadless() &&
+        physicalDevice->SupportsExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        physicalDevice->SupportsExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME) && supportedPresentId.presentId &&
+        supportedPresentWait.presentWait;
+    if (m_SupportsPresentWait)
+    {
+        m_DeviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        m_DeviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeature{};
+    presentIdFeature.sType     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeature.presentId = m_SupportsPresentWait;
+
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeature{};
+    presentWaitFeature.sType       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeature.pNext       = &presentIdFeature;
+    presentWaitFeature.presentWait = m_SupportsPresentWait;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_feature{
         .sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+        .pNext            = m_SupportsPresentWait ? &presentWaitFeature : nullptr,
         .dynamicRendering = VK_TRUE,
     };
 
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType                                        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext                                        = &dynamic_rendering_feature;
+    vulkan12Features.drawIndirectCount                            = m_SupportsDrawIndirectCount;
+    vulkan12Features.descriptorIndexing                           = m_SupportsBindlessTextures;
+    vulkan12Features.runtimeDescriptorArray                       = m_SupportsBindlessTextures;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing    = m_SupportsBindlessTextures;
+    vulkan12Features.descriptorBindingPartiallyBound              = m_SupportsBindlessTextures;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = m_SupportsBindlessTextures;
+
     VkPhysicalDeviceFeatures pDeviceFeatures[] = { deviceFeatures };
 
     // Create info for the device.
     VkDeviceCreateInfo CI{};
     CI.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    CI.pNext                   = &dynamic_rendering_feature;
+    CI.pNext                   = &vulkan12Features;
     CI.queueCreateInfoCount    = deviceQueueCreateInfos.size();
     CI.pQueueCreateInfos       = deviceQueueCreateInfos.data();
     CI.pEnabledFeatures        = pDeviceFeatures;
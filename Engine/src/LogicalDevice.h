@@ -23,6 +23,21 @@ class LogicalDevice
     {
         return m_TransferQueue;
     }
+    // True when vkCmdDrawIndexedIndirectCount, multi draw indirect and non zero firstInstance are enabled.
+    bool SupportsDrawIndirectCount() const
+    {
+        return m_SupportsDrawIndirectCount;
+    }
+    // True when runtime sized, non uniformly indexed and partially bound sampler arrays are enabled.
+    bool SupportsBindlessTextures() const
+    {
+        return m_SupportsBindlessTextures;
+    }
+    // True when VK_KHR_present_id and VK_KHR_present_wait are enabled.
+    bool SupportsPresentWait() const
+    {
+        return m_SupportsPresentWait;
+    }
 
    private:
     VkQueueFamilyProperties GetQueueFamilyProps(uint64_t queueFamilyIndex);
@@ -33,6 +48,10 @@ class LogicalDevice
     VkQueue  m_TransferQueue = VK_NULL_HANDLE;
     VkQueue  m_ComputeQueue  = VK_NULL_HANDLE;
 
+    bool m_SupportsDrawIndirectCount = false;
+    bool m_SupportsBindlessTextures  = false;
+    bool m_SupportsPresentWait       = false;
+
     std::vector<const char*> m_Layers;
     std::vector<const char*> m_DeviceExtensions;
 };
@@ -0,0 +1,173 @@
+#include "DeletionQueue.h"
+#include "DescriptorSet.h"
+#include "EngineInternal.h"
+#include "Image.h"
+#include "LogicalDevice.h"
+#include "Material.h"
+#include "SamplerCache.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <functional>
+
+Material::Material(
+    const Ref<Image>&               InAlbedo,
+    const Ref<Image>&               InNormal,
+    const Ref<Image>&               InRoughnessMetallic,
+    const Ref<DescriptorPool>&      InPool,
+    const Ref<DescriptorSetLayout>& InLayout,
+    const Ref<Image>&               InShadowMap,
+    const std::vector<Ref<Image>>&  InPointShadows)
+    : _Pool(InPool),
+      _Layout(InLayout),
+      _Albedo(InAlbedo),
+      _Normal(InNormal),
+      _RoughnessMetallic(InRoughnessMetallic),
+      _ShadowMap(InShadowMap),
+      _PointShadows(InPointShadows)
+{
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = InPool->GetDescriptorPool();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &InLayout->GetDescriptorLayout();
+
+    VkResult rslt = vkAllocateDescriptorSets(EngineInternal::GetContext().GetDevice()->GetVKDevice(), &allocInfo, &_DescriptorSet);
+    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+
+    Ref<SamplerCache> samplerCache = EngineInternal::GetContext().GetSamplerCache();
+    for (const auto& bindingSpecs : InLayout->GetBindingSpecs())
+    {
+        Ref<Sampler> sampler;
+        if (bindingSpecs.Type == Type::TEXTURE_SAMPLER_NORMAL)
+        {
+            sampler = samplerCache->GetTextureSampler(
+                ImageType::COLOR, VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_TRUE);
+            Utils::UpdateDescriptorSet(
+                _DescriptorSet,
+                sampler->GetHandle(),
+                _Normal->GetImageView(),
+                bindingSpecs.Binding,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            _Samplers.push_back(sampler);
+        }
+        else if (bindingSpecs.Type == Type::TEXTURE_SAMPLER_DIFFUSE)
+        {
+            sampler = samplerCache->GetTextureSampler(
+                ImageType::COLOR, VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_TRUE);
+            Utils::UpdateDescriptorSet(
+                _DescriptorSet,
+                sampler->GetHandle(),
+                _Albedo->GetImageView(),
+                bindingSpecs.Binding,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            _Samplers.push_back(sampler);
+        }
+        else if (bindingSpecs.Type == Type::TEXTURE_SAMPLER_ROUGHNESSMETALLIC)
+        {
+            sampler = samplerCache->GetTextureSampler(
+                ImageType::COLOR, VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_TRUE);
+            Utils::UpdateDescriptorSet(
+                _DescriptorSet,
+                sampler->GetHandle(),
+                _RoughnessMetallic->GetImageView(),
+                bindingSpecs.Binding,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            _Samplers.push_back(sampler);
+        }
+        else if (bindingSpecs.Type == Type::TEXTURE_SAMPLER_SHADOWMAP)
+        {
+            sampler = samplerCache->GetTextureSampler(
+                ImageType::DEPTH, VK_FILTER_NEAREST, VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
+            Utils::UpdateDescriptorSet(
+                _DescriptorSet,
+                sampler->GetHandle(),
+                _ShadowMap->GetImageView(),
+                bindingSpecs.Binding,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+            _Samplers.push_back(sampler);
+        }
+        else if (bindingSpecs.Type == Type::TEXTURE_SAMPLER_POINTSHADOWMAP)
+        {
+            for (size_t i = 0; i < _PointShadows.size(); i++)
+            {
+                sampler = samplerCache->GetCubemapSampler();
+                Utils::UpdateDescriptorSet(
+                    _DescriptorSet,
+                    sampler->GetHandle(),
+                    _PointShadows[i]->GetImageView(),
+                    bindingSpecs.Binding,
+                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                    i);
+                _Samplers.push_back(sampler);
+            }
+        }
+    }
+}
+
+void Material::RenewDescriptorSet()
+{
+    VkDevice device = EngineInternal::GetContext().GetDevice()->GetVKDevice();
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = _Pool->GetDescriptorPool();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &_Layout->GetDescriptorLayout();
+
+    VkDescriptorSet renewedSet;
+    VkResult        rslt = vkAllocateDescriptorSets(device, &allocInfo, &renewedSet);
+    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+
+    // Copying also keeps the bindings written by others, like the uniform buffers the renderer binds after loading.
+    std::vector<VkCopyDescriptorSet> copies;
+    for (const auto& bindingSpecs : _Layout->GetBindingSpecs())
+    {
+        VkCopyDescriptorSet copy{};
+        copy.sType           = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
+        copy.srcSet          = _DescriptorSet;
+        copy.srcBinding      = bindingSpecs.Binding;
+        copy.dstSet          = renewedSet;
+        copy.dstBinding      = bindingSpecs.Binding;
+        copy.descriptorCount = bindingSpecs.Count;
+        copies.push_back(copy);
+    }
+    vkUpdateDescriptorSets(device, 0, nullptr, (uint32_t)copies.size(), copies.data());
+
+    EngineInternal::GetContext().GetDeletionQueue()->Retire(
+        [device, pool = _Pool, oldSet = _DescriptorSet]()
+        { vkFreeDescriptorSets(device, pool->GetDescriptorPool(), 1, &oldSet); });
+    _DescriptorSet = renewedSet;
+}
+
+Material::Key Material::MakeKey(
+    const Ref<Image>&               InAlbedo,
+    const Ref<Image>&               InNormal,
+    const Ref<Image>&               InRoughnessMetallic,
+    const Ref<DescriptorSetLayout>& InLayout)
+{
+    Key key;
+    key.Albedo            = InAlbedo.get();
+    key.Normal            = InNormal.get();
+    key.RoughnessMetallic = InRoughnessMetallic.get();
+    key.Layout            = InLayout.get();
+    return key;
+}
+
+bool Material::Key::operator==(const Key& InOther) const
+{
+    return Albedo == InOther.Albedo && Normal == InOther.Normal && RoughnessMetallic == InOther.RoughnessMetallic &&
+        Layout == InOther.Layout;
+}
+
+size_t Material::KeyHash::operator()(const Key& InKey) const
+{
+    size_t hash    = 0;
+    auto   combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+
+    combine(std::hash<Image*>()(InKey.Albedo));
+    combine(std::hash<Image*>()(InKey.Normal));
+    combine(std::hash<Image*>()(InKey.RoughnessMetallic));
+    combine(std::hash<DescriptorSetLayout*>()(InKey.Layout));
+    return hash;
+}
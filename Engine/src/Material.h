@@ -0,0 +1,71 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class Image;
+class Sampler;
+class DescriptorPool;
+class DescriptorSetLayout;
+
+// A descriptor set holding one unique combination of PBR textures. Meshes that use the same textures with the same layout
+// share a material, so they share its descriptor set and can be drawn without rebinding in between.
+class Material
+{
+   public:
+    // Identifies a material by the images it binds and the layout it was written for.
+    struct Key
+    {
+        Image*               Albedo            = nullptr;
+        Image*               Normal            = nullptr;
+        Image*               RoughnessMetallic = nullptr;
+        DescriptorSetLayout* Layout            = nullptr;
+
+        bool operator==(const Key& InOther) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& InKey) const;
+    };
+
+   public:
+    Material(
+        const Ref<Image>&               InAlbedo,
+        const Ref<Image>&               InNormal,
+        const Ref<Image>&               InRoughnessMetallic,
+        const Ref<DescriptorPool>&      InPool,
+        const Ref<DescriptorSetLayout>& InLayout,
+        const Ref<Image>&               InShadowMap    = nullptr,
+        const std::vector<Ref<Image>>&  InPointShadows = std::vector<Ref<Image>>());
+
+    static Key MakeKey(
+        const Ref<Image>&               InAlbedo,
+        const Ref<Image>&               InNormal,
+        const Ref<Image>&               InRoughnessMetallic,
+        const Ref<DescriptorSetLayout>& InLayout);
+
+    const VkDescriptorSet& GetDescriptorSet() const
+    {
+        return _DescriptorSet;
+    }
+
+    // Moves the material to a new set holding the same descriptors, so a binding can be rewritten while frames in flight
+    // still use the old set. The old set is freed through the deletion queue.
+    void RenewDescriptorSet();
+
+   private:
+    VkDescriptorSet           _DescriptorSet = VK_NULL_HANDLE;
+    std::vector<Ref<Sampler>> _Samplers;
+    Ref<DescriptorPool>       _Pool;
+    Ref<DescriptorSetLayout>  _Layout;
+
+    // Kept alive as long as the descriptor set refers to their views.
+    Ref<Image>              _Albedo;
+    Ref<Image>              _Normal;
+    Ref<Image>              _RoughnessMetallic;
+    Ref<Image>              _ShadowMap;
+    std::vector<Ref<Image>> _PointShadows;
+};
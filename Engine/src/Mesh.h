@@ -14,6 +14,8 @@ class DescriptorPool;
 class DescriptorSetLayout;
 class Image;
 class CubemapTexture;
+class Sampler;
+class Material;
 class Mesh
 {
     friend class Model;
@@ -35,9 +37,15 @@ class Mesh
     {
         return m_RoughnessMetallic;
     }
-    Ref<Image> GetShadowMap()
+    // Index into the bindless material buffer. Only meaningful for meshes of a bindless model.
+    uint32_t GetMaterialIndex()
     {
-        return m_ShadowMap;
+        return m_MaterialIndex;
+    }
+    // Null for skybox and bindless meshes.
+    const Ref<Material>& GetMaterial()
+    {
+        return m_Material;
     }
     Ref<Image> GetCubeMap()
     {
@@ -51,6 +59,15 @@ class Mesh
     {
         return m_Indices.size();
     }
+    // Object space bounding box of the vertex positions.
+    const glm::vec3& GetBoundsMin()
+    {
+        return m_BoundsMin;
+    }
+    const glm::vec3& GetBoundsMax()
+    {
+        return m_BoundsMax;
+    }
 
    private:
     Mesh() = default;
@@ -60,10 +77,15 @@ class Mesh
         const Ref<Image>&            diffuseTexture,
         const Ref<Image>&            normalTexture,
         const Ref<Image>&            roughnessMetallicTexture,
-        Ref<DescriptorPool>          pool,
-        Ref<DescriptorSetLayout>     layout,
-        const Ref<Image>&            shadowMap    = nullptr,
-        std::vector<Ref<Image>>      pointShadows = std::vector<Ref<Image>>());
+        const Ref<Material>&         material);
+    // Bindless meshes have no descriptor set of their own. Their textures are reached through the material index.
+    Mesh(
+        const std::vector<float>&    vertices,
+        const std::vector<uint32_t>& indices,
+        const Ref<Image>&            diffuseTexture,
+        const Ref<Image>&            normalTexture,
+        const Ref<Image>&            roughnessMetallicTexture,
+        uint32_t                     materialIndex);
     Mesh(
         const float*             vertices,
         uint32_t                 vertexCount,
@@ -73,20 +95,23 @@ class Mesh
     ~Mesh();
 
    private:
-    VkDescriptorSet        m_DescriptorSet;
-    std::vector<VkSampler> m_Samplers;
+    VkDescriptorSet m_DescriptorSet = VK_NULL_HANDLE;
+    Ref<Sampler>    m_Sampler       = nullptr; // Sampled by the descriptor set of a cubemap mesh, from the SamplerCache.
+    Ref<Material>   m_Material      = nullptr;
+    uint32_t        m_MaterialIndex = 0;
 
     // Raw vertices and indices stored in a continues memory.
     // |_Vertex1(pos-normal-tangent-bitangent)__V2__V3__V4__...__Vn__|
     std::vector<float>    m_Vertices;
     std::vector<uint32_t> m_Indices;
 
+    glm::vec3 m_BoundsMin = glm::vec3(0.0f);
+    glm::vec3 m_BoundsMax = glm::vec3(0.0f);
+
     // PBR textures.
     Ref<Image> m_Albedo            = nullptr;
     Ref<Image> m_Normals           = nullptr;
     Ref<Image> m_RoughnessMetallic = nullptr;
-    Ref<Image> m_ShadowMap         = nullptr;
     // Cubemap texture, in case a mesh is created as a cubemap.
-    Ref<Image>              m_CubemapTexture = nullptr;
-    std::vector<Ref<Image>> m_PointShadows;
+    Ref<Image> m_CubemapTexture = nullptr;
 };
@@ -1,7 +1,11 @@
+#include "BindlessMaterials.h"
 #include "Buffer.h",
 #include "CommandBuffer.h"
+#include "DeletionQueue.h"
 #include "DescriptorSet.h"
+#include "EngineInternal.h"
 #include "Framebuffer.h"
+#include "Frustum.h"
 #include "Image.h"
 #include "LogicalDevice.h"
 #include "Mesh.h"
@@ -10,8 +14,12 @@
 #include "Pipeline.h"
 #include "Surface.h"
 #include "Swapchain.h"
+#include "Tracer.h"
+#include "Utils.h"
 #include "VulkanContext.h"
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -21,6 +29,7 @@ Model::~Model()
     {
         delete m_Meshes[i];
     }
+    DestroyInstanceBuffer();
 }
 Model::Model(
     const std::string&       path,
@@ -31,6 +40,40 @@ Model::Model(
     std::vector<Ref<Image>>  pointShadows)
     : m_FullPath(path), m_Flags(flags), m_DefaultShadowMap(shadowMap), m_DefaultPointShadowMaps(pointShadows)
 {
+    LoadScene(pool, layout);
+    m_DynamicOffsets.assign(layout->GetDynamicOffsetCount(), 0);
+
+    // Layouts with a vertex stage storage buffer get an instance buffer. It starts with a single identity instance so the
+    // model can be drawn without ever touching the instancing API.
+    for (const auto& bindingSpecs : layout->GetBindingSpecs())
+    {
+        if (bindingSpecs.Type == Type::STORAGE_BUFFER && (bindingSpecs.ShaderStage & VK_SHADER_STAGE_VERTEX_BIT))
+            m_InstanceBinding = bindingSpecs.Binding;
+    }
+    if (m_InstanceBinding >= 0)
+    {
+        CreateInstanceBuffer(1);
+        UploadInstances();
+    }
+}
+
+Model::Model(const std::string& path, LoadingFlags flags, Ref<BindlessMaterials> materials)
+    : m_FullPath(path), m_Flags(flags), m_Materials(materials)
+{
+    TRACE_FUNCTION();
+
+    LoadScene(nullptr, nullptr);
+
+    m_ModelDescriptorSet = m_Materials->AllocateModelSet();
+    m_InstanceBinding    = 0;
+    CreateInstanceBuffer(1);
+    UploadInstances();
+}
+
+void Model::LoadScene(const Ref<DescriptorPool>& pool, const Ref<DescriptorSetLayout>& layout)
+{
+    TRACE_FUNCTION();
+
     m_Directory = std::string(m_FullPath).substr(0, std::string(m_FullPath).find_last_of("\\/"));
     Assimp::Importer importer;
     const aiScene*   scene = importer.ReadFile(
@@ -41,27 +84,92 @@ Model::Model(
     // Process the model in a recursive way.
     ProcessNode(scene->mRootNode, scene, pool, layout);
 
+    // Group the meshes by material, in the order the materials were first seen, so every material is bound only once.
+    if (!m_Materials)
+    {
+        std::unordered_map<Material*, uint32_t> firstSeen;
+        for (const auto& mesh : m_Meshes)
+        {
+            firstSeen.emplace(mesh->GetMaterial().get(), (uint32_t)firstSeen.size());
+        }
+        std::stable_sort(
+            m_Meshes.begin(),
+            m_Meshes.end(),
+            [&firstSeen](Mesh* a, Mesh* b) { return firstSeen[a->GetMaterial().get()] < firstSeen[b->GetMaterial().get()]; });
+    }
+
     std::vector<float>    verticesAll;
     std::vector<uint32_t> indicesAll;
+    std::vector<float>    materialIndicesAll;
 
-    // TO DO : There might be data copying in the vectors check it. Convert to
-    // pointers if that is the case.
-
+    size_t totalVertexFloats = 0;
+    size_t totalIndices      = 0;
     for (const auto& mesh : m_Meshes)
     {
-        for (const auto& data : mesh->m_Indices)
+        totalVertexFloats += mesh->m_Vertices.size();
+        totalIndices += mesh->m_Indices.size();
+    }
+    verticesAll.reserve(totalVertexFloats);
+    indicesAll.reserve(totalIndices);
+
+    // All meshes live in one vertex and one index buffer. Each mesh is drawn with firstIndex/vertexOffset instead of
+    // rebinding the buffers. Consecutive meshes that share a material have their indices rebased onto the first mesh of
+    // the run so the whole run can be drawn with a single call. Bindless models pick their textures per vertex, so all of
+    // their meshes form one run.
+    const uint32_t floatsPerVertex = GetFloatsPerVertex();
+    uint32_t       vertexBase      = 0;
+    uint32_t       batchBase       = 0;
+    for (int i = 0; i < m_Meshes.size(); i++)
+    {
+        Mesh* mesh         = m_Meshes[i];
+        bool  sameMaterial = i > 0 && (m_Materials || mesh->m_Material == m_Meshes[i - 1]->m_Material);
+
+        if (!sameMaterial)
+            batchBase = vertexBase;
+
+        DrawRange range;
+        range.FirstIndex    = (uint32_t)indicesAll.size();
+        range.IndexCount    = (uint32_t)mesh->m_Indices.size();
+        range.VertexOffset  = (int32_t)batchBase;
+        range.DescriptorSet = sameMaterial ? m_MeshRanges.back().DescriptorSet : mesh->GetDescriptorSet();
+
+        for (const auto& index : mesh->m_Indices)
         {
-            indicesAll.push_back(data);
+            indicesAll.push_back(index + (vertexBase - batchBase));
         }
-        for (const auto& data : mesh->m_Vertices)
+        verticesAll.insert(verticesAll.end(), mesh->m_Vertices.begin(), mesh->m_Vertices.end());
+        if (m_Materials)
         {
-            verticesAll.push_back(data);
+            size_t vertexCount = mesh->m_Vertices.size() / floatsPerVertex;
+            materialIndicesAll.insert(materialIndicesAll.end(), vertexCount, (float)mesh->m_MaterialIndex);
         }
+
+        if (sameMaterial)
+            m_DrawBatches.back().IndexCount += range.IndexCount;
+        else
+            m_DrawBatches.push_back(range);
+
+        m_MeshRanges.push_back(range);
+        vertexBase += (uint32_t)(mesh->m_Vertices.size() / floatsPerVertex);
     }
 
     // Create the VB and IB.
     m_VBO = std::make_unique<VertexBuffer>(verticesAll);
     m_IBO = std::make_unique<IndexBuffer>(indicesAll);
+    if (m_Materials)
+        m_MaterialVBO = std::make_unique<VertexBuffer>(materialIndicesAll);
+
+    // Positions are the first three floats of every vertex.
+    if (m_Flags & LOAD_VERTEX_POSITIONS)
+    {
+        std::vector<float> positionsAll;
+        positionsAll.reserve(verticesAll.size() / floatsPerVertex * 3);
+        for (size_t i = 0; i < verticesAll.size(); i += floatsPerVertex)
+        {
+            positionsAll.insert(positionsAll.end(), verticesAll.begin() + i, verticesAll.begin() + i + 3);
+        }
+        m_PositionVBO = std::make_unique<VertexBuffer>(positionsAll);
+    }
 }
 
 Model::Model(
@@ -73,6 +181,7 @@ Model::Model(
     : m_FullPath("No path. Not loaded from a file"), m_DefaultCubeMap(cubemapTex), m_Flags(NONE)
 {
     m_Meshes.emplace_back(new Mesh(vertices, vertexCount, m_DefaultCubeMap, pool, layout));
+    m_DynamicOffsets.assign(layout->GetDynamicOffsetCount(), 0);
     m_VertexSize = sizeof(float);
     m_VBO        = std::make_unique<VertexBuffer>(m_Meshes[0]->m_Vertices);
 }
@@ -101,14 +210,22 @@ Mesh* Model::ProcessMesh(
     const Ref<DescriptorPool>&      pool,
     const Ref<DescriptorSetLayout>& layout)
 {
+    TRACE_FUNCTION();
+
     std::vector<float>    vertices;
     std::vector<uint32_t> indices;
     Ref<Image>            diffuseTexture;
     Ref<Image>            normalTexture;
     Ref<Image>            roughnessMetallicTexture;
+    glm::vec3             boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3             boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
 
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
+        glm::vec3 position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        boundsMin          = glm::min(boundsMin, position);
+        boundsMax          = glm::max(boundsMax, position);
+
         if (m_Flags & LOAD_VERTEX_POSITIONS)
         {
             // Vertex Positions
@@ -203,20 +320,262 @@ Mesh* Model::ProcessMesh(
             aiTextureType_UNKNOWN,
             m_RoughnessMetallicCache); // Load RoughnessMetallic (.gltf) texture
     }
-    return new Mesh(
-        vertices,
-        indices,
-        diffuseTexture,
-        normalTexture,
-        roughnessMetallicTexture,
-        pool,
-        layout,
-        m_DefaultShadowMap,
-        m_DefaultPointShadowMaps);
+    Mesh* processedMesh = nullptr;
+    if (m_Materials)
+    {
+        uint32_t materialIndex = m_Materials->RegisterMaterial(diffuseTexture, normalTexture, roughnessMetallicTexture);
+        processedMesh = new Mesh(vertices, indices, diffuseTexture, normalTexture, roughnessMetallicTexture, materialIndex);
+    }
+    else
+    {
+        Material::Key  key      = Material::MakeKey(diffuseTexture, normalTexture, roughnessMetallicTexture, layout);
+        Ref<Material>& material = m_MaterialInstances[key];
+        if (!material)
+        {
+            material = make_s<Material>(
+                diffuseTexture,
+                normalTexture,
+                roughnessMetallicTexture,
+                pool,
+                layout,
+                m_DefaultShadowMap,
+                m_DefaultPointShadowMaps);
+        }
+        processedMesh = new Mesh(vertices, indices, diffuseTexture, normalTexture, roughnessMetallicTexture, material);
+    }
+
+    if (mesh->mNumVertices > 0)
+    {
+        processedMesh->m_BoundsMin = boundsMin;
+        processedMesh->m_BoundsMax = boundsMax;
+    }
+    return processedMesh;
+}
+
+void Model::CreateInstanceBuffer(uint32_t capacity)
+{
+    // One slice per frame in flight. A new buffer holds nothing yet, so every slice is outdated.
+    m_InstanceSliceVersions.assign(EngineInternal::GetContext().GetDeletionQueue()->GetFrameLatency(), 0);
+
+    VkDeviceSize bufferSize = sizeof(InstanceData) * capacity * m_InstanceSliceVersions.size();
+    Utils::CreateVKBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        m_InstanceBuffer,
+        m_InstanceBufferMemory);
+    vkMapMemory(
+        EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_InstanceBufferMemory, 0, bufferSize, 0, &m_MappedInstanceBuffer);
+    m_InstanceCapacity = capacity;
+
+    if (m_Materials)
+    {
+        Utils::UpdateDescriptorSet(
+            m_ModelDescriptorSet, m_InstanceBuffer, 0, bufferSize, m_InstanceBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        return;
+    }
+    for (const auto& [key, material] : m_MaterialInstances)
+    {
+        Utils::UpdateDescriptorSet(
+            material->GetDescriptorSet(), m_InstanceBuffer, 0, bufferSize, m_InstanceBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    }
+}
+
+void Model::DestroyInstanceBuffer()
+{
+    if (m_InstanceBuffer == VK_NULL_HANDLE)
+        return;
+
+    vkUnmapMemory(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_InstanceBufferMemory);
+    vkDestroyBuffer(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_InstanceBuffer, nullptr);
+    vkFreeMemory(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_InstanceBufferMemory, nullptr);
+    m_InstanceBuffer       = VK_NULL_HANDLE;
+    m_InstanceBufferMemory = VK_NULL_HANDLE;
+    m_MappedInstanceBuffer = nullptr;
+    m_InstanceCapacity     = 0;
+}
+
+void Model::GrowInstanceBuffer(uint32_t capacity)
+{
+    Ref<DeletionQueue> deletionQueue = EngineInternal::GetContext().GetDeletionQueue();
+    VkDevice           device        = EngineInternal::GetContext().GetDevice()->GetVKDevice();
+
+    // Frames in flight keep reading the old buffer through the old sets. A set that pending command buffers use must not
+    // be updated, so the model moves to new sets and both are retired.
+    deletionQueue->Retire(
+        [device, buffer = m_InstanceBuffer, memory = m_InstanceBufferMemory]()
+        {
+            vkUnmapMemory(device, memory);
+            vkDestroyBuffer(device, buffer, nullptr);
+            vkFreeMemory(device, memory, nullptr);
+        });
+    m_InstanceBuffer       = VK_NULL_HANDLE;
+    m_InstanceBufferMemory = VK_NULL_HANDLE;
+    m_MappedInstanceBuffer = nullptr;
+
+    if (m_Materials)
+    {
+        deletionQueue->Retire([materials = m_Materials, oldSet = m_ModelDescriptorSet]() { materials->FreeModelSet(oldSet); });
+        m_ModelDescriptorSet = m_Materials->AllocateModelSet();
+    }
+    else
+    {
+        std::unordered_map<VkDescriptorSet, VkDescriptorSet> renewedSets;
+        for (const auto& [key, material] : m_MaterialInstances)
+        {
+            VkDescriptorSet oldSet = material->GetDescriptorSet();
+            material->RenewDescriptorSet();
+            renewedSets[oldSet] = material->GetDescriptorSet();
+        }
+        for (auto& range : m_MeshRanges)
+        {
+            range.DescriptorSet = renewedSets[range.DescriptorSet];
+        }
+        for (auto& batch : m_DrawBatches)
+        {
+            batch.DescriptorSet = renewedSets[batch.DescriptorSet];
+        }
+        for (auto& mesh : m_Meshes)
+        {
+            mesh->m_DescriptorSet = mesh->m_Material->GetDescriptorSet();
+        }
+    }
+
+    CreateInstanceBuffer(capacity);
+}
+
+void Model::WriteInstances(uint32_t first, uint32_t count)
+{
+    // The other slices are brought up to date when their frames come around.
+    bool sliceUpToDate = m_InstanceSliceVersions[m_InstanceSlice] == m_InstanceVersion;
+    m_InstanceVersion++;
+    if (!sliceUpToDate)
+    {
+        UploadInstances();
+        return;
+    }
+
+    InstanceData* slice = static_cast<InstanceData*>(m_MappedInstanceBuffer) + GetFirstInstance();
+    memcpy(slice + first, m_Instances.data() + first, sizeof(InstanceData) * count);
+    m_InstanceSliceVersions[m_InstanceSlice] = m_InstanceVersion;
+}
+
+void Model::UploadInstances()
+{
+    InstanceData* slice = static_cast<InstanceData*>(m_MappedInstanceBuffer) + GetFirstInstance();
+    if (m_Instances.empty())
+    {
+        InstanceData identity;
+        memcpy(slice, &identity, sizeof(InstanceData));
+    }
+    else
+    {
+        memcpy(slice, m_Instances.data(), sizeof(InstanceData) * m_Instances.size());
+    }
+    m_InstanceSliceVersions[m_InstanceSlice] = m_InstanceVersion;
+}
+
+void Model::BeginFrame(uint32_t frameIndex, uint32_t uniformOffset)
+{
+    std::fill(m_DynamicOffsets.begin(), m_DynamicOffsets.end(), uniformOffset);
+
+    if (m_InstanceBinding < 0)
+        return;
+
+    ASSERT(frameIndex < m_InstanceSliceVersions.size(), "Frame index out of range.");
+    m_InstanceSlice = frameIndex;
+    if (m_InstanceSliceVersions[m_InstanceSlice] != m_InstanceVersion)
+        UploadInstances();
+}
+
+uint32_t Model::AddInstance(const glm::mat4& transform, const glm::vec4& tint)
+{
+    ASSERT(m_InstanceBinding >= 0, "This model's descriptor set layout has no instance buffer binding.");
+
+    m_Instances.push_back({ transform, tint });
+    if (m_Instances.size() > m_InstanceCapacity)
+    {
+        GrowInstanceBuffer(std::max<uint32_t>(m_InstanceCapacity * 2, (uint32_t)m_Instances.size()));
+        m_InstanceVersion++;
+        UploadInstances();
+    }
+    else
+    {
+        WriteInstances((uint32_t)m_Instances.size() - 1, 1);
+    }
+    m_InstanceBoundsOutdated = true;
+    return (uint32_t)m_Instances.size() - 1;
+}
+
+void Model::SetInstance(uint32_t index, const glm::mat4& transform, const glm::vec4& tint)
+{
+    ASSERT(index < m_Instances.size(), "Instance index out of range.");
+
+    m_Instances[index] = { transform, tint };
+    WriteInstances(index, 1);
+    m_InstanceBoundsOutdated = true;
+}
+
+void Model::ClearInstances()
+{
+    m_Instances.clear();
+    if (m_MappedInstanceBuffer)
+    {
+        m_InstanceVersion++;
+        UploadInstances();
+    }
+    m_InstanceBoundsOutdated = true;
+}
+
+void Model::UpdateInstanceBounds()
+{
+    m_InstanceBoundsMin.resize(m_Meshes.size());
+    m_InstanceBoundsMax.resize(m_Meshes.size());
+
+    for (int i = 0; i < m_Meshes.size(); i++)
+    {
+        if (m_Instances.empty())
+        {
+            m_InstanceBoundsMin[i] = m_Meshes[i]->GetBoundsMin();
+            m_InstanceBoundsMax[i] = m_Meshes[i]->GetBoundsMax();
+            continue;
+        }
+
+        m_InstanceBoundsMin[i] = glm::vec3(std::numeric_limits<float>::max());
+        m_InstanceBoundsMax[i] = glm::vec3(std::numeric_limits<float>::lowest());
+        for (const auto& instance : m_Instances)
+        {
+            glm::vec3 instanceMin;
+            glm::vec3 instanceMax;
+            Frustum::TransformAABB(
+                instance.Transform, m_Meshes[i]->GetBoundsMin(), m_Meshes[i]->GetBoundsMax(), instanceMin, instanceMax);
+            m_InstanceBoundsMin[i] = glm::min(m_InstanceBoundsMin[i], instanceMin);
+            m_InstanceBoundsMax[i] = glm::max(m_InstanceBoundsMax[i], instanceMax);
+        }
+    }
+    m_InstanceBoundsOutdated = false;
+}
+
+uint32_t Model::GetFloatsPerVertex() const
+{
+    uint32_t floatCount = 0;
+    if (m_Flags & LOAD_VERTEX_POSITIONS)
+        floatCount += 3;
+    if (m_Flags & LOAD_UV)
+        floatCount += 2;
+    if (m_Flags & LOAD_NORMALS)
+        floatCount += 3;
+    if (m_Flags & LOAD_TANGENT)
+        floatCount += 3;
+    if (m_Flags & LOAD_BITANGENT)
+        floatCount += 3;
+    return floatCount;
 }
 
 Ref<Image> Model::LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::vector<Ref<Image>>& cache)
 {
+    TRACE_FUNCTION();
+
     Ref<Image>  textureOUT;
     std::string folderName = m_Directory.substr(m_Directory.find_last_of("\\/") + 1, m_Directory.length());
 
@@ -261,22 +620,128 @@ Ref<Image> Model::LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std:
     return textureOUT;
 }
 
-void Model::DrawIndexed(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout)
+void Model::GetWorldBounds(glm::vec3& outMin, glm::vec3& outMax)
 {
-    VkDeviceSize vertexOffset = 0;
-    VkDeviceSize indexOffset  = 0;
+    if (m_InstanceBoundsOutdated)
+        UpdateInstanceBounds();
 
+    glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
     for (int i = 0; i < m_Meshes.size(); i++)
+    {
+        boundsMin = glm::min(boundsMin, m_InstanceBoundsMin[i]);
+        boundsMax = glm::max(boundsMax, m_InstanceBoundsMax[i]);
+    }
+    Frustum::TransformAABB(m_Transform, boundsMin, boundsMax, outMin, outMax);
+}
+
+void Model::BindGeometry(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout, bool positionsOnly)
+{
+    VkDeviceSize offsets[] = { 0, 0 };
+    if (positionsOnly)
+    {
+        ASSERT(m_PositionVBO, "Model was loaded without vertex positions.");
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_PositionVBO->GetVKBuffer(), offsets);
+    }
+    else if (m_Materials)
+    {
+        VkBuffer vertexBuffers[] = { m_VBO->GetVKBuffer(), m_MaterialVBO->GetVKBuffer() };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+    }
+    else
+    {
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VBO->GetVKBuffer(), offsets);
+    }
+    if (m_Materials)
     {
         vkCmdBindDescriptorSets(
-            commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_Meshes[i]->GetDescriptorSet(), 0, nullptr);
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VBO->GetVKBuffer(), &vertexOffset);
-        vkCmdBindIndexBuffer(commandBuffer, m_IBO->GetVKBuffer(), indexOffset, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(commandBuffer, GetMeshes()[i]->GetIndexCount(), 1, 0, 0, 0);
+            commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &m_ModelDescriptorSet, 0, nullptr);
+    }
+    vkCmdBindIndexBuffer(commandBuffer, m_IBO->GetVKBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void Model::DrawIndexed(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout)
+{
+    VkDescriptorSet boundDescriptor = VK_NULL_HANDLE;
+
+    BindGeometry(commandBuffer, pipelineLayout);
+
+    for (const auto& batch : m_DrawBatches)
+    {
+        if (batch.DescriptorSet != boundDescriptor)
+        {
+            vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout,
+                0,
+                1,
+                &batch.DescriptorSet,
+                (uint32_t)m_DynamicOffsets.size(),
+                m_DynamicOffsets.data());
+            boundDescriptor = batch.DescriptorSet;
+        }
+        vkCmdDrawIndexed(
+            commandBuffer, batch.IndexCount, GetInstanceCount(), batch.FirstIndex, batch.VertexOffset, GetFirstInstance());
+    }
+}
+
+void Model::DrawIndexed(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout, const Frustum& cullingFrustum)
+{
+    VkDescriptorSet boundDescriptor = VK_NULL_HANDLE;
+    DrawRange       pending;
+
+    BindGeometry(commandBuffer, pipelineLayout);
+
+    auto flush = [&]()
+    {
+        if (pending.IndexCount == 0)
+            return;
+        if (pending.DescriptorSet != boundDescriptor)
+        {
+            vkCmdBindDescriptorSets(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                pipelineLayout,
+                0,
+                1,
+                &pending.DescriptorSet,
+                (uint32_t)m_DynamicOffsets.size(),
+                m_DynamicOffsets.data());
+            boundDescriptor = pending.DescriptorSet;
+        }
+        vkCmdDrawIndexed(
+            commandBuffer, pending.IndexCount, GetInstanceCount(), pending.FirstIndex, pending.VertexOffset, GetFirstInstance());
+        pending.IndexCount = 0;
+    };
+
+    // A mesh is drawn for all instances if any of them is visible.
+    if (m_InstanceBoundsOutdated)
+        UpdateInstanceBounds();
 
-        vertexOffset += m_Meshes[i]->GetVertexCount() * sizeof(float);
-        indexOffset += m_Meshes[i]->GetIndexCount() * sizeof(uint32_t);
+    for (int i = 0; i < m_Meshes.size(); i++)
+    {
+        glm::vec3 worldMin;
+        glm::vec3 worldMax;
+        Frustum::TransformAABB(m_Transform, m_InstanceBoundsMin[i], m_InstanceBoundsMax[i], worldMin, worldMax);
+
+        if (!cullingFrustum.IntersectsAABB(worldMin, worldMax))
+            continue;
+
+        // Visible neighbours of the same batch are contiguous in the index buffer, so they are drawn together.
+        const DrawRange& range = m_MeshRanges[i];
+        if (pending.IndexCount > 0 && range.FirstIndex == pending.FirstIndex + pending.IndexCount &&
+            range.VertexOffset == pending.VertexOffset && range.DescriptorSet == pending.DescriptorSet)
+        {
+            pending.IndexCount += range.IndexCount;
+        }
+        else
+        {
+            flush();
+            pending = range;
+        }
     }
+    flush();
 }
 
 void Model::Draw(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout)
@@ -284,11 +749,66 @@ void Model::Draw(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& p
     // Currently used only to draw skyboxes/cubes. Extend if you need it.
     VkDeviceSize vertexOffset = 0;
     vkCmdBindDescriptorSets(
-        commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_Meshes[0]->GetDescriptorSet(), 0, nullptr);
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout,
+        0,
+        1,
+        &m_Meshes[0]->GetDescriptorSet(),
+        (uint32_t)m_DynamicOffsets.size(),
+        m_DynamicOffsets.data());
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VBO->GetVKBuffer(), &vertexOffset);
     vkCmdDraw(commandBuffer, 36, 1, 0, 0);
 }
 
+void Model::DrawDepthOnly(
+    const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout, const glm::vec3& viewPosition)
+{
+    BindGeometry(commandBuffer, pipelineLayout, true);
+
+    // Every material set of the model holds the same uniform and instance buffers, so one bind covers all meshes.
+    if (!m_Materials && !m_DrawBatches.empty())
+    {
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0,
+            1,
+            &m_DrawBatches[0].DescriptorSet,
+            (uint32_t)m_DynamicOffsets.size(),
+            m_DynamicOffsets.data());
+    }
+
+    if (m_InstanceBoundsOutdated)
+        UpdateInstanceBounds();
+
+    // Sort by the distance to the closest point of each mesh's bounds. Nearby meshes fill the depth buffer first so the
+    // fragments of the meshes behind them fail the early depth test.
+    m_DepthOrder.resize(m_Meshes.size());
+    m_DepthDistances.resize(m_Meshes.size());
+    for (uint32_t i = 0; i < m_Meshes.size(); i++)
+    {
+        glm::vec3 worldMin;
+        glm::vec3 worldMax;
+        Frustum::TransformAABB(m_Transform, m_InstanceBoundsMin[i], m_InstanceBoundsMax[i], worldMin, worldMax);
+
+        m_DepthOrder[i]     = i;
+        m_DepthDistances[i] = glm::length(glm::clamp(viewPosition, worldMin, worldMax) - viewPosition);
+    }
+    std::sort(
+        m_DepthOrder.begin(),
+        m_DepthOrder.end(),
+        [this](uint32_t a, uint32_t b) { return m_DepthDistances[a] < m_DepthDistances[b]; });
+
+    for (const auto& meshIndex : m_DepthOrder)
+    {
+        const DrawRange& range = m_MeshRanges[meshIndex];
+        vkCmdDrawIndexed(
+            commandBuffer, range.IndexCount, GetInstanceCount(), range.FirstIndex, range.VertexOffset, GetFirstInstance());
+    }
+}
+
 void Model::Rotate(const float degree, const float& x, const float& y, const float& z)
 {
     m_Transform = glm::rotate(m_Transform, glm::radians(degree), glm::vec3(x, y, z));
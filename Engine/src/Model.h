@@ -1,4 +1,5 @@
 #pragma once
+#include "Material.h"
 #include "core.h"
 // External
 #define GLM_ENABLE_EXPERIMENTAL
@@ -8,6 +9,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/matrix.hpp>
+#include <unordered_map>
 #include <vector>
 #include <vulkan/vulkan.h>
 
@@ -45,10 +47,28 @@ class DescriptorSetLayout;
 class Pipeline;
 class Framebuffer;
 class CommandBuffer;
+class Frustum;
+class BindlessMaterials;
 enum class DescriptorPrimitive;
 class Model
 {
    public:
+    // A range of the model's index buffer that can be drawn with a single vkCmdDrawIndexed call.
+    struct DrawRange
+    {
+        uint32_t        FirstIndex    = 0;
+        uint32_t        IndexCount    = 0;
+        int32_t         VertexOffset  = 0;
+        VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+    };
+
+    // One element of the instance storage buffer. Matches the std430 layout used by the shaders.
+    struct InstanceData
+    {
+        glm::mat4 Transform = glm::mat4(1.0f);
+        glm::vec4 Tint      = glm::vec4(1.0f);
+    };
+
     Model() = default;
     ~Model();
     // This constructor is used to construct a model that contains at least one
@@ -60,6 +80,10 @@ class Model
         Ref<DescriptorSetLayout> layout,
         Ref<Image>               shadowMap    = nullptr,
         std::vector<Ref<Image>>  pointShadows = std::vector<Ref<Image>>());
+    // Same as above but the materials are registered in the bindless material table. All meshes are merged into a single
+    // draw batch and a per vertex material index selects the textures in the shader. The model only owns a set holding
+    // its instance buffer, bound at set 1.
+    Model(const std::string& path, LoadingFlags flags, Ref<BindlessMaterials> materials);
     // This constructor is used to construct a single meshed model (skybox).
     Model(
         const float*             vertices,
@@ -76,6 +100,16 @@ class Model
     {
         return m_Meshes.size();
     }
+    // Number of unique texture sets, which is also the number of descriptor sets the meshes use.
+    int GetMaterialCount()
+    {
+        return m_MaterialInstances.size();
+    }
+    // The unique materials of the model. Writing a binding of a material's set updates every mesh that uses it.
+    const std::unordered_map<Material::Key, Ref<Material>, Material::KeyHash>& GetMaterials()
+    {
+        return m_MaterialInstances;
+    }
     glm::mat4& GetTransform()
     {
         return m_Transform;
@@ -88,15 +122,67 @@ class Model
     {
         return m_IBO;
     }
+    // Consecutive meshes that share a material are merged into one range.
+    const std::vector<DrawRange>& GetDrawBatches()
+    {
+        return m_DrawBatches;
+    }
+    // One range per mesh, in the same order as GetMeshes().
+    const std::vector<DrawRange>& GetMeshRanges()
+    {
+        return m_MeshRanges;
+    }
+
+    // Instancing. Every DrawIndexed call draws all instances of the model with one draw per batch. Instance transforms are
+    // applied before the model transform. A model without any added instances is drawn once with an identity instance.
+    // Only available when the model's descriptor set layout has a STORAGE_BUFFER binding.
+    uint32_t AddInstance(const glm::mat4& transform, const glm::vec4& tint = glm::vec4(1.0f));
+    void     SetInstance(uint32_t index, const glm::mat4& transform, const glm::vec4& tint = glm::vec4(1.0f));
+    void     ClearInstances();
+    uint32_t GetInstanceCount()
+    {
+        return m_Instances.empty() ? 1 : (uint32_t)m_Instances.size();
+    }
+    // The instance buffer has one slice per frame in flight. Changes only go to the slice of the frame being recorded, the
+    // other slices catch up when their frames come around. Call once per frame before the model is drawn, culled or its
+    // instances are changed. uniformOffset is used for every dynamic uniform buffer of the model's sets.
+    void BeginFrame(uint32_t frameIndex, uint32_t uniformOffset);
+    // Dynamic offsets to bind the model's sets with, one per dynamic uniform buffer of its layout.
+    const std::vector<uint32_t>& GetDynamicOffsets()
+    {
+        return m_DynamicOffsets;
+    }
+    // First instance of the current slice. Draws add it to the instance index.
+    uint32_t GetFirstInstance()
+    {
+        return m_InstanceSlice * m_InstanceCapacity;
+    }
+    // Replaced when the instance count outgrows its capacity. The old buffer is retired through the deletion queue.
+    VkBuffer GetInstanceBuffer()
+    {
+        return m_InstanceBuffer;
+    }
 
     void Rotate(const float degree, const float& x, const float& y, const float& z);
     void Translate(const float& x, const float& y, const float& z);
     void Scale(const float& x, const float& y, const float& z);
 
+    // World space bounds of every mesh and instance.
+    void GetWorldBounds(glm::vec3& outMin, glm::vec3& outMax);
+
+    // Binds the vertex and index buffers, and the model set of a bindless model. With positionsOnly, the vertex positions
+    // are bound alone at binding 0 from a separate tightly packed buffer, for depth only passes.
+    void BindGeometry(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout, bool positionsOnly = false);
     void DrawIndexed(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout);
+    // Same as above but skips the meshes whose world space bounds fall outside of the given frustum.
+    void DrawIndexed(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout, const Frustum& cullingFrustum);
     void Draw(const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout);
+    // Depth pre-pass. Draws every mesh with the position stream, sorted front to back from the given view position.
+    void DrawDepthOnly(
+        const VkCommandBuffer& commandBuffer, const VkPipelineLayout& pipelineLayout, const glm::vec3& viewPosition);
 
    private:
+    void LoadScene(const Ref<DescriptorPool>& pool, const Ref<DescriptorSetLayout>& layout);
     void ProcessNode(aiNode* node, const aiScene* scene, const Ref<DescriptorPool>& pool, const Ref<DescriptorSetLayout>& layout);
     Mesh* ProcessMesh(
         aiMesh*                         mesh,
@@ -104,6 +190,14 @@ class Model
         const Ref<DescriptorPool>&      pool,
         const Ref<DescriptorSetLayout>& layout);
     Ref<Image> LoadMaterialTextures(aiMaterial* mat, aiTextureType type, std::vector<Ref<Image>>& cache);
+    uint32_t   GetFloatsPerVertex() const;
+    void       CreateInstanceBuffer(uint32_t capacity);
+    void       DestroyInstanceBuffer();
+    void       GrowInstanceBuffer(uint32_t capacity);
+    // Writes the given instances to the current slice, or all of them if the slice missed earlier changes.
+    void WriteInstances(uint32_t first, uint32_t count);
+    void UploadInstances();
+    void       UpdateInstanceBounds();
 
    private:
     mutable glm::mat4  m_Transform = glm::mat4(1.0f);
@@ -114,12 +208,47 @@ class Model
     std::vector<Ref<Image>> m_NormalsCache;
     std::vector<Ref<Image>> m_RoughnessMetallicCache;
 
+    // Meshes with identical textures share one material and its descriptor set.
+    std::unordered_map<Material::Key, Ref<Material>, Material::KeyHash> m_MaterialInstances;
+
     // Vertex & Index Buffers
     Unique<VertexBuffer> m_VBO = nullptr;
     Unique<IndexBuffer>  m_IBO = nullptr;
+    // Bindless only. One float per vertex holding the material index of its mesh, bound at vertex binding 1.
+    Unique<VertexBuffer> m_MaterialVBO = nullptr;
+    // Vertex positions only, in the same order as m_VBO. Used by the depth pre-pass.
+    Unique<VertexBuffer> m_PositionVBO = nullptr;
+
+    Ref<BindlessMaterials> m_Materials          = nullptr;
+    VkDescriptorSet        m_ModelDescriptorSet = VK_NULL_HANDLE;
+    // Set by BeginFrame. Empty for bindless models, whose set 0 is bound by BindlessMaterials.
+    std::vector<uint32_t> m_DynamicOffsets;
 
     size_t m_VertexSize        = 0;
 
+    // Per mesh ranges used by the culled draw path, and the merged ranges used when everything is drawn.
+    std::vector<DrawRange> m_MeshRanges;
+    std::vector<DrawRange> m_DrawBatches;
+
+    // Instance storage buffer. Persistently mapped, grows by doubling. The capacity is per slice.
+    std::vector<InstanceData> m_Instances;
+    VkBuffer                  m_InstanceBuffer         = VK_NULL_HANDLE;
+    VkDeviceMemory            m_InstanceBufferMemory   = VK_NULL_HANDLE;
+    void*                     m_MappedInstanceBuffer   = nullptr;
+    uint32_t                  m_InstanceCapacity       = 0;
+    int32_t                   m_InstanceBinding        = -1;
+    bool                      m_InstanceBoundsOutdated = true;
+    // Bumped by every change. A slice is up to date when it holds the current version.
+    uint64_t              m_InstanceVersion = 1;
+    std::vector<uint64_t> m_InstanceSliceVersions;
+    uint32_t              m_InstanceSlice = 0;
+    // Per mesh bounds enclosing every instance, in model space. Used by the culled draw path.
+    std::vector<glm::vec3> m_InstanceBoundsMin;
+    std::vector<glm::vec3> m_InstanceBoundsMax;
+    // Scratch space of the depth pre-pass sort, kept to avoid allocating every frame.
+    std::vector<uint32_t> m_DepthOrder;
+    std::vector<float>    m_DepthDistances;
+
     std::string m_FullPath;
     std::string m_Directory;
 
@@ -3,6 +3,8 @@
 #include "Image.h"
 #include "LogicalDevice.h"
 #include "ParticleSystem.h"
+#include "SamplerCache.h"
+#include "Tracer.h"
 #include "Utils.h"
 #include "VulkanContext.h"
 // External
@@ -36,6 +38,9 @@ ParticleSystem::ParticleSystem(
     m_EmitterPos          = specs.EmitterPos;
     m_MinVel              = specs.MinVel;
     m_MaxVel              = specs.MaxVel;
+
+    // Seeded before the first particles are spawned, so a fixed seed repeats the whole simulation.
+    rndEngine.seed(specs.Seed != 0 ? specs.Seed : (unsigned)time(nullptr));
     SetupParticles();
 }
 ParticleSystem::~ParticleSystem()
@@ -49,7 +54,6 @@ ParticleSystem::~ParticleSystem()
         vkDestroyBuffer(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_TrailBuffer, nullptr);
     if (m_TrailLength > 0)
         vkFreeMemory(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_TrailBufferMemory, nullptr);
-    vkDestroySampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), m_ParticleSampler, nullptr);
 }
 float ParticleSystem::rnd(float min, float max)
 {
@@ -157,8 +161,6 @@ void ParticleSystem::SetupParticles()
         memcpy(m_MappedTrailsBuffer, m_Trails.data(), m_TrailBufferSize);
     }
 
-    rndEngine.seed((unsigned)time(nullptr));
-
     // Create the sampler for the particle texture.
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -179,15 +181,13 @@ void ParticleSystem::SetupParticles()
     samplerInfo.minLod                  = 0.0f;
     samplerInfo.maxLod                  = 0.0f;
 
-    ASSERT(
-        vkCreateSampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), &samplerInfo, nullptr, &m_ParticleSampler) == VK_SUCCESS,
-        "Failed to create particle sampler!");
+    m_ParticleSampler = EngineInternal::GetContext().GetSamplerCache()->Get(samplerInfo);
 
     // Write the desriptor set with the above sampler.
     VkDescriptorImageInfo imageInfo{};
     imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     imageInfo.imageView   = m_ParticleTexture->GetImageView();
-    imageInfo.sampler     = m_ParticleSampler;
+    imageInfo.sampler     = m_ParticleSampler->GetHandle();
 
     VkWriteDescriptorSet descriptorWrite{};
     descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -200,22 +200,22 @@ void ParticleSystem::SetupParticles()
     vkUpdateDescriptorSets(EngineInternal::GetContext().GetDevice()->GetVKDevice(), 1, &descriptorWrite, 0, nullptr);
 }
 
-void ParticleSystem::SetUBO(VkBuffer& buffer, size_t writeRange, size_t offset)
+void ParticleSystem::SetUBO(const VkBuffer& buffer, size_t writeRange, size_t offset)
 {
-    m_ParticleUBOBuffer = &buffer;
+    m_ParticleUBOBuffer = buffer;
 
     VkWriteDescriptorSet   descriptorWrite{};
     VkDescriptorBufferInfo bufferInfo{};
 
-    bufferInfo.buffer                = *m_ParticleUBOBuffer;
-    bufferInfo.offset                = 0;
+    bufferInfo.buffer                = m_ParticleUBOBuffer;
+    bufferInfo.offset                = offset;
     bufferInfo.range                 = writeRange;
 
     descriptorWrite.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrite.dstSet           = m_DescriptorSet;
     descriptorWrite.dstBinding       = 0;
     descriptorWrite.dstArrayElement  = 0;
-    descriptorWrite.descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrite.descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptorWrite.descriptorCount  = 1;
     descriptorWrite.pBufferInfo      = &bufferInfo;
     descriptorWrite.pImageInfo       = nullptr; // Optional
@@ -226,6 +226,8 @@ void ParticleSystem::SetUBO(VkBuffer& buffer, size_t writeRange, size_t offset)
 
 void ParticleSystem::UpdateParticles(float deltaTime)
 {
+    TRACE_FUNCTION();
+
     float particleTimer = deltaTime * 0.01f;
     deltaTimeSum += deltaTime;
     for (uint64_t i = 0; i < m_Particles.size(); i++)
@@ -290,12 +292,13 @@ void ParticleSystem::UpdateParticles(float deltaTime)
     }
 }
 
-void ParticleSystem::Draw(const VkCommandBuffer& cmdBuffer, const VkPipelineLayout& pipelineLayout)
+void ParticleSystem::Draw(const VkCommandBuffer& cmdBuffer, const VkPipelineLayout& pipelineLayout, uint32_t uniformOffset)
 {
     // IMPORTANT: The shared pipeline for particle systems must be bound outside
     // the class.
     VkDeviceSize offsets[1] = { 0 };
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+    vkCmdBindDescriptorSets(
+        cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &m_DescriptorSet, 1, &uniformOffset);
     vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &m_ParticleBuffer, offsets);
     vkCmdDraw(cmdBuffer, m_ParticleCount, 1, 0, 0);
 
@@ -11,6 +11,7 @@
 const float M_PI = 3.14159265359;
 
 class Image;
+class Sampler;
 struct Particle
 {
     glm::vec4 Position;
@@ -43,6 +44,7 @@ struct ParticleSpecs
     glm::vec3 EmitterPos;
     glm::vec3 MinVel;
     glm::vec3 MaxVel;
+    uint32_t  Seed             = 0; // 0 seeds from the clock.
 };
 
 class DescriptorSetLayout;
@@ -100,14 +102,14 @@ class ParticleSystem
     size_t         m_TrailBufferSize;
     void*          m_MappedTrailsBuffer;
 
-    VkSampler  m_ParticleSampler;
-    Ref<Image> m_ParticleTexture;
+    Ref<Sampler> m_ParticleSampler;
+    Ref<Image>   m_ParticleTexture;
 
     VkDescriptorSet m_DescriptorSet;
 
    private:
     // Link the global UBO with this member from outside of the class.
-    VkBuffer* m_ParticleUBOBuffer;
+    VkBuffer m_ParticleUBOBuffer = VK_NULL_HANDLE;
 
     float rnd(float min, float max);
     void  InitParticle(Particle* particle, glm::vec3 emitterPos);
@@ -115,11 +117,12 @@ class ParticleSystem
     void  SetupParticles();
 
    public:
-    void        SetUBO(VkBuffer& buffer, size_t writeRange, size_t offset);
+    void        SetUBO(const VkBuffer& buffer, size_t writeRange, size_t offset);
     void        UpdateParticles(float deltaTime);
     inline void SetEmitterPosition(const glm::vec3& pos)
     {
         m_EmitterPos = pos;
     }
-    void Draw(const VkCommandBuffer& cmdBuffer, const VkPipelineLayout& pipelineLayout);
+    // uniformOffset is the dynamic offset of the UBO linked with SetUBO.
+    void Draw(const VkCommandBuffer& cmdBuffer, const VkPipelineLayout& pipelineLayout, uint32_t uniformOffset);
 };
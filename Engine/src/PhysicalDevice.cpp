@@ -1,6 +1,7 @@
 #include "Instance.h"
 #include "PhysicalDevice.h"
 
+#include <cstring>
 #include <string>
 PhysicalDevice::PhysicalDevice(const VkInstance& instance, const VkPhysicalDevice& physicalDevice)
     : m_PhysicalDevice(physicalDevice)
@@ -50,6 +51,16 @@ PhysicalDevice::PhysicalDevice(const VkInstance& instance, const VkPhysicalDevic
     // m_Properties.deviceName << std::endl;
 }
 
+bool PhysicalDevice::SupportsExtension(const char* extensionName) const
+{
+    for (const VkExtensionProperties& extension : m_SupportedExtensions)
+    {
+        if (strcmp(extension.extensionName, extensionName) == 0)
+            return true;
+    }
+    return false;
+}
+
 uint64_t PhysicalDevice::FindQueueFamily(VkQueueFlags queueFlags)
 {
     uint64_t familyIndex = s_InvalidQueueFamilyIndex; // init to an invalid index. -1 is invaild.
@@ -2,14 +2,21 @@
 #include "DescriptorSet.h"
 #include "LogicalDevice.h"
 #include "Pipeline.h"
+#include "PipelineCache.h"
+#include "ShaderModuleCache.h"
 #include "Surface.h"
 #include "Swapchain.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
 #include "Utils.h"
+#include "VulkanContext.h"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
 Pipeline::Pipeline(VulkanContext& InContext, const Specs& InSpecs) : _Specs(InSpecs), _Context(InContext)
 {
-    Init();
+    Build();
 }
 Pipeline::~Pipeline()
 {
@@ -18,53 +25,83 @@ Pipeline::~Pipeline()
 void Pipeline::Resize()
 {
     Cleanup();
-    Init();
+    Build();
+}
+
+void Pipeline::Build()
+{
+    TRACE_FUNCTION();
+
+    // The job only reads _Specs and writes the handles, nothing else touches them until Wait returns.
+    _Compilation = _Context.GetThreadPool()->Submit([this] { Init(); });
+}
+
+void Pipeline::Wait() const
+{
+    // get rethrows what the job threw, so a failed compile surfaces at the first user instead of as a null handle.
+    if (_Compilation.valid())
+        _Compilation.get();
 }
 
 void Pipeline::Cleanup()
 {
+    // Only waits, a failed compile left null handles that are safe to destroy and the destructor must not throw.
+    if (_Compilation.valid())
+        _Compilation.wait();
     vkDestroyPipeline(_Context.GetDevice()->GetVKDevice(), _Pipeline, nullptr);
     vkDestroyPipelineLayout(_Context.GetDevice()->GetVKDevice(), _PipelineLayout, nullptr);
 }
 
 VkPipeline Pipeline::GetHandle() const
 {
+    Wait();
     return _Pipeline;
 }
 VkPipelineLayout Pipeline::GetPipelineLayout() const
 {
+    Wait();
     return _PipelineLayout;
 }
 
 void Pipeline::Init()
 {
+    if (_Specs.ComputeShaderPath != "None")
+    {
+        InitCompute();
+        return;
+    }
+
     _DynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
 
     // ------------------------------------------------------------------------
     // Shader stages
     // ------------------------------------------------------------------------
+    // Modules come from the shader module cache and stay referenced for the lifetime of the pipeline, so pipelines sharing a
+    // shader share its module and a resize doesn't reload it.
+    _ShaderModules.clear();
     std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
-    auto loadShader = [&](const std::string& path, VkShaderStageFlagBits stage) -> VkShaderModule
+    std::vector<VkSpecializationMapEntry>        specializationEntries;
+    VkSpecializationInfo                         specializationInfo = GetSpecializationInfo(specializationEntries);
+    auto loadShader = [&](const std::string& path, VkShaderStageFlagBits stage)
     {
         if (path.empty() || path == "None")
-            return VK_NULL_HANDLE;
+            return;
 
-        auto           code   = Utils::ReadFile(path);
-        VkShaderModule module = CreateShaderModule(code);
+        Ref<ShaderModule> module = _Context.GetShaderModuleCache()->Get(path);
+        _ShaderModules.push_back(module);
 
         VkPipelineShaderStageCreateInfo stageInfo{};
-        stageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        stageInfo.stage  = stage;
-        stageInfo.module = module;
-        stageInfo.pName  = "main";
+        stageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageInfo.stage               = stage;
+        stageInfo.module              = module->GetHandle();
+        stageInfo.pName               = "main";
+        stageInfo.pSpecializationInfo = _Specs.SpecializationConstants.empty() ? nullptr : &specializationInfo;
         shaderStages.push_back(stageInfo);
-
-        return module;
     };
 
-    VkShaderModule vertShaderModule = loadShader(_Specs.VertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
-    VkShaderModule fragShaderModule = loadShader(_Specs.FragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
-    VkShaderModule geomShaderModule = loadShader(_Specs.GeometryShaderPath, VK_SHADER_STAGE_GEOMETRY_BIT);
+    loadShader(_Specs.VertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
+    loadShader(_Specs.FragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
+    loadShader(_Specs.GeometryShaderPath, VK_SHADER_STAGE_GEOMETRY_BIT);
 
     // ------------------------------------------------------------------------
     // Vertex input
@@ -189,10 +226,12 @@ void Pipeline::Init()
     // ------------------------------------------------------------------------
     // Pipeline layout
     // ------------------------------------------------------------------------
+    std::vector<VkDescriptorSetLayout> setLayouts = GetSetLayouts();
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts    = &_Specs.DescriptorSetLayout->GetDescriptorLayout();
+    pipelineLayoutInfo.setLayoutCount = setLayouts.size();
+    pipelineLayoutInfo.pSetLayouts    = setLayouts.data();
 
     if (_Specs.PushConstantRanges.size() > 0)
     {
@@ -234,39 +273,159 @@ void Pipeline::Init()
     pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE; // Optional
     pipelineInfo.basePipelineIndex   = -1; // Optional
 
+    Ref<PipelineCache> pipelineCache = _Context.GetPipelineCache();
+    auto               start         = PipelineCache::Clock::now();
     ASSERT(
-        vkCreateGraphicsPipelines(_Context.GetDevice()->GetVKDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_Pipeline) ==
-            VK_SUCCESS,
+        vkCreateGraphicsPipelines(
+            _Context.GetDevice()->GetVKDevice(), pipelineCache->GetHandle(), 1, &pipelineInfo, nullptr, &_Pipeline) == VK_SUCCESS,
         "Failed to create graphics pipeline!");
-
-    // ------------------------------------------------------------------------
-    // Cleanup temporary shader modules
-    // ------------------------------------------------------------------------
-    if (_Specs.FragmentShaderPath != "None")
-    {
-        vkDestroyShaderModule(_Context.GetDevice()->GetVKDevice(), fragShaderModule, nullptr);
-    }
-    if (_Specs.VertexShaderPath != "None")
+    pipelineCache->RecordPipelineCreation(start, PipelineCache::Clock::now());
+}
+std::vector<VkDescriptorSetLayout> Pipeline::GetSetLayouts() const
+{
+    std::vector<VkDescriptorSetLayout> setLayouts = { _Specs.DescriptorSetLayout->GetDescriptorLayout() };
+    for (const auto& layout : _Specs.ExtraDescriptorSetLayouts)
     {
-        vkDestroyShaderModule(_Context.GetDevice()->GetVKDevice(), vertShaderModule, nullptr);
+        setLayouts.push_back(layout->GetDescriptorLayout());
     }
-    if (_Specs.GeometryShaderPath != "None")
+    return setLayouts;
+}
+VkSpecializationInfo Pipeline::GetSpecializationInfo(std::vector<VkSpecializationMapEntry>& OutEntries) const
+{
+    OutEntries.resize(_Specs.SpecializationConstants.size());
+    for (uint32_t i = 0; i < OutEntries.size(); i++)
     {
-        vkDestroyShaderModule(_Context.GetDevice()->GetVKDevice(), geomShaderModule, nullptr);
+        OutEntries[i].constantID = i;
+        OutEntries[i].offset     = i * sizeof(uint32_t);
+        OutEntries[i].size       = sizeof(uint32_t);
     }
+
+    VkSpecializationInfo info{};
+    info.mapEntryCount = static_cast<uint32_t>(OutEntries.size());
+    info.pMapEntries   = OutEntries.data();
+    info.dataSize      = _Specs.SpecializationConstants.size() * sizeof(uint32_t);
+    info.pData         = _Specs.SpecializationConstants.data();
+    return info;
 }
-VkShaderModule Pipeline::CreateShaderModule(const std::vector<char>& InShaderCode)
+void Pipeline::InitCompute()
 {
-    VkShaderModuleCreateInfo createInfo{};
+    _ShaderModules = { _Context.GetShaderModuleCache()->Get(_Specs.ComputeShaderPath) };
 
-    createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = InShaderCode.size();
-    createInfo.pCode    = reinterpret_cast<const uint32_t*>(InShaderCode.data());
+    std::vector<VkDescriptorSetLayout> setLayouts = GetSetLayouts();
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = setLayouts.size();
+    pipelineLayoutInfo.pSetLayouts            = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = _Specs.PushConstantRanges.size();
+    pipelineLayoutInfo.pPushConstantRanges    = _Specs.PushConstantRanges.empty() ? nullptr : _Specs.PushConstantRanges.data();
 
-    VkShaderModule shaderModule;
     ASSERT(
-        vkCreateShaderModule(_Context.GetDevice()->GetVKDevice(), &createInfo, nullptr, &shaderModule) == VK_SUCCESS,
-        "Failed to create shader module!");
+        vkCreatePipelineLayout(_Context.GetDevice()->GetVKDevice(), &pipelineLayoutInfo, nullptr, &_PipelineLayout) == VK_SUCCESS,
+        "Failed to create pipeline layout");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = _ShaderModules[0]->GetHandle();
+    pipelineInfo.stage.pName  = "main";
+    pipelineInfo.layout       = _PipelineLayout;
+
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    VkSpecializationInfo                  specializationInfo = GetSpecializationInfo(specializationEntries);
+    if (!_Specs.SpecializationConstants.empty())
+        pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+
+    Ref<PipelineCache> pipelineCache = _Context.GetPipelineCache();
+    auto               start         = PipelineCache::Clock::now();
+    ASSERT(
+        vkCreateComputePipelines(
+            _Context.GetDevice()->GetVKDevice(), pipelineCache->GetHandle(), 1, &pipelineInfo, nullptr, &_Pipeline) == VK_SUCCESS,
+        "Failed to create compute pipeline!");
+    pipelineCache->RecordPipelineCreation(start, PipelineCache::Clock::now());
+}
+
+bool Pipeline::Specs::operator==(const Specs& InOther) const
+{
+    auto equalRanges = [](const VkPushConstantRange& a, const VkPushConstantRange& b)
+    { return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size; };
+    auto equalBindings = [](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b)
+    { return a.binding == b.binding && a.stride == b.stride && a.inputRate == b.inputRate; };
+    auto equalAttributes = [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b)
+    { return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset; };
+
+    const VkPipelineColorBlendAttachmentState& blend      = ColorBlendAttachmentState;
+    const VkPipelineColorBlendAttachmentState& otherBlend = InOther.ColorBlendAttachmentState;
+
+    return RenderPass == InOther.RenderPass && DescriptorSetLayout == InOther.DescriptorSetLayout &&
+        ExtraDescriptorSetLayouts == InOther.ExtraDescriptorSetLayouts && VertexShaderPath == InOther.VertexShaderPath &&
+        FragmentShaderPath == InOther.FragmentShaderPath && GeometryShaderPath == InOther.GeometryShaderPath &&
+        ComputeShaderPath == InOther.ComputeShaderPath && PolygonMode == InOther.PolygonMode && CullMode == InOther.CullMode &&
+        FrontFace == InOther.FrontFace && EnableDepthBias == InOther.EnableDepthBias &&
+        DepthBiasConstantFactor == InOther.DepthBiasConstantFactor && DepthBiasClamp == InOther.DepthBiasClamp &&
+        DepthBiasSlopeFactor == InOther.DepthBiasSlopeFactor && EnableDepthTesting == InOther.EnableDepthTesting &&
+        EnableDepthWriting == InOther.EnableDepthWriting && DepthCompareOp == InOther.DepthCompareOp &&
+        ViewportWidth == InOther.ViewportWidth && ViewportHeight == InOther.ViewportHeight &&
+        std::equal(PushConstantRanges.begin(),
+                   PushConstantRanges.end(),
+                   InOther.PushConstantRanges.begin(),
+                   InOther.PushConstantRanges.end(),
+                   equalRanges) &&
+        PrimitiveTopology == InOther.PrimitiveTopology && blend.blendEnable == otherBlend.blendEnable &&
+        blend.srcColorBlendFactor == otherBlend.srcColorBlendFactor &&
+        blend.dstColorBlendFactor == otherBlend.dstColorBlendFactor && blend.colorBlendOp == otherBlend.colorBlendOp &&
+        blend.srcAlphaBlendFactor == otherBlend.srcAlphaBlendFactor &&
+        blend.dstAlphaBlendFactor == otherBlend.dstAlphaBlendFactor && blend.alphaBlendOp == otherBlend.alphaBlendOp &&
+        blend.colorWriteMask == otherBlend.colorWriteMask &&
+        std::equal(VertexBindings.begin(),
+                   VertexBindings.end(),
+                   InOther.VertexBindings.begin(),
+                   InOther.VertexBindings.end(),
+                   equalBindings) &&
+        std::equal(VertexAttributes.begin(),
+                   VertexAttributes.end(),
+                   InOther.VertexAttributes.begin(),
+                   InOther.VertexAttributes.end(),
+                   equalAttributes) &&
+        EnableDynamicStates == InOther.EnableDynamicStates && SpecializationConstants == InOther.SpecializationConstants;
+}
+
+size_t Pipeline::SpecsHash::operator()(const Specs& InSpecs) const
+{
+    // Only hashes the fields that tell pipelines apart in practice. operator== checks the rest.
+    size_t hash    = 0;
+    auto   combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+
+    combine(std::hash<VkRenderPass>()(InSpecs.RenderPass));
+    combine(std::hash<DescriptorSetLayout*>()(InSpecs.DescriptorSetLayout.get()));
+    combine(std::hash<std::string>()(InSpecs.VertexShaderPath));
+    combine(std::hash<std::string>()(InSpecs.FragmentShaderPath));
+    combine(std::hash<std::string>()(InSpecs.GeometryShaderPath));
+    combine(std::hash<std::string>()(InSpecs.ComputeShaderPath));
+    combine(std::hash<int>()(InSpecs.CullMode));
+    combine(std::hash<int>()(InSpecs.DepthCompareOp));
+    combine(std::hash<uint32_t>()(InSpecs.EnableDepthWriting));
+    combine(std::hash<uint32_t>()(InSpecs.ViewportWidth));
+    combine(std::hash<uint32_t>()(InSpecs.ViewportHeight));
+    combine(std::hash<size_t>()(InSpecs.VertexAttributes.size()));
+    for (uint32_t constant : InSpecs.SpecializationConstants)
+        combine(std::hash<uint32_t>()(constant));
+    return hash;
+}
+
+PipelineVariants::PipelineVariants(VulkanContext& InContext, const Pipeline::Specs& InSpecs)
+    : _Context(&InContext), _Specs(InSpecs)
+{
+}
+
+const Ref<Pipeline>& PipelineVariants::Get(const std::vector<uint32_t>& InConstants)
+{
+    auto it = _Pipelines.find(InConstants);
+    if (it != _Pipelines.end())
+        return it->second;
 
-    return shaderModule;
+    Pipeline::Specs specs         = _Specs;
+    specs.SpecializationConstants = InConstants;
+    return _Pipelines[InConstants] = _Context->GetPipelineCache()->GetPipeline(specs);
 }
@@ -2,10 +2,13 @@
 #include "core.h"
 
 // External
+#include <future>
 #include <glm/glm.hpp>
+#include <map>
 #include <vector>
 #include <vulkan/vulkan.h>
 class DescriptorSetLayout;
+class ShaderModule;
 class VulkanContext;
 class Pipeline
 {
@@ -14,9 +17,13 @@ class Pipeline
     {
         VkRenderPass                                   RenderPass;
         Ref<DescriptorSetLayout>                       DescriptorSetLayout;
+        // Bound at set 1, 2, ... after DescriptorSetLayout.
+        std::vector<Ref<class DescriptorSetLayout>>    ExtraDescriptorSetLayouts;
         std::string                                    VertexShaderPath   = "None";
         std::string                                    FragmentShaderPath = "None";
         std::string                                    GeometryShaderPath = "None";
+        // When set, a compute pipeline is created and every graphics related field is ignored.
+        std::string                                    ComputeShaderPath  = "None";
         VkPolygonMode                                  PolygonMode;
         VkCullModeFlags                                CullMode;
         VkFrontFace                                    FrontFace;
@@ -35,25 +42,65 @@ class Pipeline
         std::vector<VkVertexInputBindingDescription>   VertexBindings      = {};
         std::vector<VkVertexInputAttributeDescription> VertexAttributes    = {};
         bool                                           EnableDynamicStates = true;
+        // Value of the specialization constant with constant_id N at index N. Bools are passed as VkBool32. Every stage
+        // gets the same constants, IDs a shader doesn't declare are ignored.
+        std::vector<uint32_t>                          SpecializationConstants = {};
+
+        // Compares every field that ends up in the pipeline, so equal specs produce interchangeable pipelines.
+        bool operator==(const Specs& InOther) const;
+    };
+
+    struct SpecsHash
+    {
+        size_t operator()(const Specs& InSpecs) const;
     };
 
    public:
+    // The pipeline is compiled on the context's thread pool. The constructor returns right away and the first call that
+    // needs the handle or the layout waits for the compilation to finish, so pipelines that are created together compile
+    // in parallel and nothing waits for a pipeline it doesn't use yet.
     Pipeline(VulkanContext& InContext, const Specs& InSpecs);
     ~Pipeline();
     void Resize();
 
     VkPipeline       GetHandle() const;
     VkPipelineLayout GetPipelineLayout() const;
+    // Blocks until the compilation job finished and rethrows anything it threw.
+    void             Wait() const;
+
+   private:
+    void                               Build();
+    void                               Init();
+    void                               InitCompute();
+    void                               Cleanup();
+    std::vector<VkDescriptorSetLayout> GetSetLayouts() const;
+    VkSpecializationInfo               GetSpecializationInfo(std::vector<VkSpecializationMapEntry>& OutEntries) const;
 
    private:
-    void           Init();
-    void           Cleanup();
-    VkShaderModule CreateShaderModule(const std::vector<char>& InShaderCode);
+    VkPipeline                     _Pipeline       = VK_NULL_HANDLE;
+    VkPipelineLayout               _PipelineLayout = VK_NULL_HANDLE;
+    std::vector<VkDynamicState>    _DynamicStates;
+    Specs                          _Specs;
+    VulkanContext&                 _Context;
+    std::shared_future<void>       _Compilation;
+    std::vector<Ref<ShaderModule>> _ShaderModules;
+};
+
+// Permutations of one pipeline that only differ in their specialization constants. The shaders branch on settings with
+// constants instead of uniforms, so the driver unrolls their loops and drops the dead branches. Every variant that was
+// requested stays alive, switching a setting back and forth compiles each permutation once.
+class PipelineVariants
+{
+   public:
+    PipelineVariants() = default;
+    // InSpecs.SpecializationConstants is ignored, the constants of each variant are given to Get.
+    PipelineVariants(VulkanContext& InContext, const Pipeline::Specs& InSpecs);
+
+    // The pipeline of a new permutation starts compiling on the thread pool and is returned right away.
+    const Ref<Pipeline>& Get(const std::vector<uint32_t>& InConstants);
 
    private:
-    VkPipeline                  _Pipeline;
-    VkPipelineLayout            _PipelineLayout;
-    std::vector<VkDynamicState> _DynamicStates;
-    Specs                       _Specs;
-    VulkanContext&              _Context;
+    VulkanContext*                                 _Context = nullptr;
+    Pipeline::Specs                                _Specs;
+    std::map<std::vector<uint32_t>, Ref<Pipeline>> _Pipelines;
 };
@@ -0,0 +1,185 @@
+#include "LogicalDevice.h"
+#include "PhysicalDevice.h"
+#include "PipelineCache.h"
+#include "VulkanContext.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+PipelineCache::PipelineCache(VulkanContext& InContext, const std::string& InFilePath)
+    : _Context(InContext), _FilePath(InFilePath)
+{
+    std::vector<char> data;
+    std::ifstream     file(_FilePath, std::ios::ate | std::ios::binary);
+    if (file.is_open())
+    {
+        data.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(data.data(), data.size());
+
+        _LoadStatus = Validate(data);
+        if (!_LoadStatus.empty())
+            data.clear();
+    }
+    else
+    {
+        _LoadStatus = "no cache file";
+    }
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = data.size();
+    createInfo.pInitialData    = data.empty() ? nullptr : data.data();
+
+    ASSERT(
+        vkCreatePipelineCache(_Context.GetDevice()->GetVKDevice(), &createInfo, nullptr, &_Cache) == VK_SUCCESS,
+        "Failed to create pipeline cache!");
+
+    _LoadedSize = data.size();
+    if (_LoadStatus.empty())
+        PrintInfo("Loaded pipeline cache (" + std::to_string(_LoadedSize) + " bytes) from " + _FilePath);
+    else
+        PrintWarning("Starting with an empty pipeline cache: " + _LoadStatus + ".");
+}
+
+PipelineCache::~PipelineCache()
+{
+    Save();
+    vkDestroyPipelineCache(_Context.GetDevice()->GetVKDevice(), _Cache, nullptr);
+}
+
+void PipelineCache::Save()
+{
+    size_t size = 0;
+    vkGetPipelineCacheData(_Context.GetDevice()->GetVKDevice(), _Cache, &size, nullptr);
+
+    std::vector<char> data(size);
+    if (size == 0 || vkGetPipelineCacheData(_Context.GetDevice()->GetVKDevice(), _Cache, &size, data.data()) != VK_SUCCESS)
+    {
+        PrintWarning("Failed to read back the pipeline cache, it won't be saved.");
+        return;
+    }
+
+    // Written next to the target and renamed over it, so a crash while saving can't leave a truncated cache behind.
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(_FilePath).parent_path(), error);
+
+    std::string   tempPath = _FilePath + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        PrintWarning("Failed to open " + tempPath + " for writing, the pipeline cache won't be saved.");
+        return;
+    }
+    file.write(data.data(), size);
+    file.close();
+
+    std::filesystem::rename(tempPath, _FilePath, error);
+    if (error)
+        PrintWarning("Failed to save the pipeline cache: " + error.message());
+}
+
+std::string PipelineCache::Validate(const std::vector<char>& InData) const
+{
+    VkPipelineCacheHeaderVersionOne header{};
+    if (InData.size() < sizeof(header))
+        return "cache file is truncated";
+
+    memcpy(&header, InData.data(), sizeof(header));
+
+    const VkPhysicalDeviceProperties& properties = _Context.GetPhysicalDevice()->GetVKProperties();
+    if (header.headerSize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+        return "unknown cache header";
+    if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID)
+        return "cache was written by a different GPU";
+    if (memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        return "cache was written by a different driver version";
+
+    return "";
+}
+
+Ref<Pipeline> PipelineCache::GetPipeline(const Pipeline::Specs& InSpecs)
+{
+    std::lock_guard<std::mutex> lock(_PipelineMutex);
+
+    auto it = _Pipelines.find(InSpecs);
+    if (it != _Pipelines.end())
+    {
+        if (Ref<Pipeline> pipeline = it->second.lock())
+        {
+            _SharedPipelineCount++;
+            return pipeline;
+        }
+    }
+
+    // The keys hold references to their descriptor set layouts, so entries of destroyed pipelines are dropped here.
+    std::erase_if(_Pipelines, [](const auto& entry) { return entry.second.expired(); });
+
+    Ref<Pipeline> pipeline = make_s<Pipeline>(_Context, InSpecs);
+    _Pipelines[InSpecs]    = pipeline;
+    return pipeline;
+}
+
+uint32_t PipelineCache::RebuildPipelinesUsing(const std::vector<std::string>& InShaderPaths)
+{
+    auto usesShader = [&InShaderPaths](const Pipeline::Specs& specs)
+    {
+        for (const std::string& path : InShaderPaths)
+        {
+            if (specs.VertexShaderPath == path || specs.FragmentShaderPath == path || specs.GeometryShaderPath == path ||
+                specs.ComputeShaderPath == path)
+                return true;
+        }
+        return false;
+    };
+
+    std::lock_guard<std::mutex> lock(_PipelineMutex);
+
+    uint32_t rebuiltCount = 0;
+    for (const auto& [specs, weakPipeline] : _Pipelines)
+    {
+        Ref<Pipeline> pipeline = weakPipeline.lock();
+        if (pipeline && usesShader(specs))
+        {
+            pipeline->Resize();
+            rebuiltCount++;
+        }
+    }
+    return rebuiltCount;
+}
+
+void PipelineCache::RecordPipelineCreation(Clock::time_point InStart, Clock::time_point InEnd)
+{
+    float milliseconds = std::chrono::duration<float, std::milli>(InEnd - InStart).count();
+
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _PipelineCount++;
+    _CreationTime += milliseconds;
+    _SlowestTime = std::max(_SlowestTime, milliseconds);
+    _FirstStart  = std::min(_FirstStart, InStart);
+    _LastEnd     = std::max(_LastEnd, InEnd);
+}
+
+void PipelineCache::PrintReport()
+{
+    uint32_t sharedPipelineCount;
+    {
+        std::lock_guard<std::mutex> lock(_PipelineMutex);
+        sharedPipelineCount = _SharedPipelineCount;
+    }
+
+    std::lock_guard<std::mutex> lock(_Mutex);
+
+    float wallTime = _PipelineCount > 0 ? std::chrono::duration<float, std::milli>(_LastEnd - _FirstStart).count() : 0.0f;
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(1) << "Pipeline cache: "
+           << (_LoadStatus.empty() ? "warm, " + std::to_string(_LoadedSize) + " bytes" : _LoadStatus) << ". Created "
+           << _PipelineCount << " pipelines in " << wallTime << " ms (" << _CreationTime << " ms summed, slowest "
+           << _SlowestTime << " ms), " << sharedPipelineCount << " requests shared an existing pipeline.";
+    PrintInfo(report.str());
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "core.h"
+#include "Pipeline.h"
+
+// External
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// VkPipelineCache shared by every pipeline of the context and persisted between runs. The driver keys the cached binaries
+// on the full pipeline state, so a warm run skips shader compilation for every pipeline that did not change.
+//
+// The file is only handed to the driver when its header matches the current device. Data from another GPU or driver
+// version is dropped and the cache starts out empty.
+//
+// On top of that, pipelines are deduplicated by their specs. Requesting a pipeline whose specs match one that is still
+// alive returns that pipeline instead of creating another VkPipeline with the same state.
+class PipelineCache
+{
+   public:
+    PipelineCache(VulkanContext& InContext, const std::string& InFilePath);
+    ~PipelineCache();
+
+    // Writes the current contents of the cache to disk.
+    void Save();
+
+    VkPipelineCache GetHandle() const
+    {
+        return _Cache;
+    }
+
+    // Returns the live pipeline created from equal specs, or creates it. Only weak references are held, holders keep their
+    // pipelines alive. Resizing a shared pipeline resizes it for every holder.
+    Ref<Pipeline> GetPipeline(const Pipeline::Specs& InSpecs);
+
+    // Rebuilds every live pipeline that uses one of the given shaders. The GPU must not be using them. Returns the number
+    // of rebuilt pipelines.
+    uint32_t RebuildPipelinesUsing(const std::vector<std::string>& InShaderPaths);
+
+    using Clock = std::chrono::high_resolution_clock;
+
+    // Called by Pipeline for every pipeline it creates, with the time its vkCreate*Pipelines call started and ended.
+    // Pipelines are created on several threads, so the report shows the wall clock span next to the summed time.
+    void RecordPipelineCreation(Clock::time_point InStart, Clock::time_point InEnd);
+    void PrintReport();
+
+   private:
+    // Returns an empty string when the data can be used by this device, the reason it can't otherwise.
+    std::string Validate(const std::vector<char>& InData) const;
+
+   private:
+    VulkanContext&  _Context;
+    std::string     _FilePath;
+    VkPipelineCache _Cache = VK_NULL_HANDLE;
+
+    std::string _LoadStatus;
+    size_t      _LoadedSize = 0;
+
+    std::mutex                                                                        _PipelineMutex;
+    std::unordered_map<Pipeline::Specs, std::weak_ptr<Pipeline>, Pipeline::SpecsHash> _Pipelines;
+    uint32_t                                                                          _SharedPipelineCount = 0;
+
+    std::mutex        _Mutex;
+    uint32_t          _PipelineCount = 0;
+    float             _CreationTime  = 0.0f;
+    float             _SlowestTime   = 0.0f;
+    Clock::time_point _FirstStart    = Clock::time_point::max();
+    Clock::time_point _LastEnd       = Clock::time_point::min();
+};
@@ -22,7 +22,7 @@ void RenderPass::CreateRenderPass()
         desc.storeOp        = attachment.StoreOp;
         desc.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        desc.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+        desc.initialLayout  = attachment.InitialLayout;
         desc.finalLayout    = attachment.FinalLayout;
 
         attachments.push_back(desc);
@@ -14,6 +14,8 @@ class RenderPass
         VkAttachmentLoadOp  LoadOp;
         VkAttachmentStoreOp StoreOp;
         VkClearValue        ClearValue;
+        // Only needs to be set when the attachment is loaded (LOAD_OP_LOAD) and its previous contents matter.
+        VkImageLayout InitialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     };
 
     struct CreateInfo
@@ -1,17 +1,24 @@
 #include "Bloom.h"
 #include "Camera.h"
 #include "CommandBuffer.h"
+#include "DeletionQueue.h"
 #include "DescriptorSet.h"
 #include "EngineInternal.h"
 #include "Framebuffer.h"
+#include "Frustum.h"
 #include "Instance.h"
 #include "LogicalDevice.h"
 #include "Mesh.h"
 #include "Model.h"
 #include "ParticleSystem.h"
 #include "PhysicalDevice.h"
+#include "PipelineCache.h"
+#include "Tracer.h"
 // #include "Pipeline.h"
 #include "Renderer.h"
+#include "SamplerCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderModuleCache.h"
 #include "Surface.h"
 #include "Swapchain.h"
 #include "Utils.h"
@@ -19,56 +26,90 @@
 #include "Window.h"
 
 #include <Curl.h>
+#include <algorithm>
 #include <filesystem>
 #include <iostream>
 
-ForwardRenderer::ForwardRenderer(VulkanContext& InContext, Ref<Swapchain> InSwapchain, Ref<Camera> InCamera)
-    : _Context(InContext), _Swapchain(InSwapchain), _Camera(InCamera)
+ForwardRenderer::ForwardRenderer(
+    VulkanContext& InContext,
+    Ref<Swapchain> InSwapchain,
+    Ref<Camera>    InCamera,
+    uint32_t       InRandomSeed)
+    : _Context(InContext), _Swapchain(InSwapchain), _Camera(InCamera), _RandomSeed(InRandomSeed)
 {
+    gen.seed(_RandomSeed != 0 ? _RandomSeed : rd());
 }
 
 void ForwardRenderer::Init()
 {
+    TRACE_FUNCTION();
+
+    // Frames in flight can be lowered at runtime, but never raised above this.
+    _Context.GetDeletionQueue()->SetFrameLatency(MAX_FRAMES_IN_FLIGHT);
+    _FramePacer  = std::make_unique<FramePacer>(_Context);
+    _GPUProfiler = std::make_unique<GPUProfiler>(_Context, MAX_FRAMES_IN_FLIGHT);
     CreateSynchronizationPrimitives();
     UpdateViewport_Scissor();
 
-    globalParametersUBO.pointLightCount = glm::vec4(5);
+    pointLightCount = 5;
 
     // Set the point light colors here.
-    globalParametersUBO.pointLightColors[0] = glm::vec4(0.97, 0.76, 0.46, 1.0);
-    globalParametersUBO.pointLightColors[1] = glm::vec4(0.97, 0.76, 0.46, 1.0);
-    globalParametersUBO.pointLightColors[2] = glm::vec4(0.97, 0.76, 0.46, 1.0);
-    globalParametersUBO.pointLightColors[3] = glm::vec4(0.97, 0.76, 0.46, 1.0);
-    globalParametersUBO.pointLightColors[4] = glm::vec4(1.0, 0.0, 0.0, 1.0);
+    pointLightColors[0] = glm::vec4(0.97, 0.76, 0.46, 1.0);
+    pointLightColors[1] = glm::vec4(0.97, 0.76, 0.46, 1.0);
+    pointLightColors[2] = glm::vec4(0.97, 0.76, 0.46, 1.0);
+    pointLightColors[3] = glm::vec4(0.97, 0.76, 0.46, 1.0);
+    pointLightColors[4] = glm::vec4(1.0, 0.0, 0.0, 1.0);
 
     CurlNoise::SetCurlSettings(false, 4.0f, 6, 1.0, 0.0);
-    pointShadowMaps.resize(globalParametersUBO.pointLightCount.x);
-    _PointShadowMapFramebuffers.resize(globalParametersUBO.pointLightCount.x);
+    pointShadowMaps.resize(pointLightCount);
+    _PointShadowMapFramebuffers.resize(pointLightCount);
+    _PointShadowFaceFramebuffers.resize(pointLightCount);
+
+    // Every face starts out stale so the scheduler fills the cubemaps in over the first few frames.
+    std::array<uint32_t, 6> staleFaces;
+    staleFaces.fill(UINT32_MAX);
+    _PointShadowFaceAges.assign(pointLightCount, staleFaces);
+    _PointShadowCachedPositions.assign(pointLightCount, glm::vec3(0.0f));
+    _PointShadowMapInitialized.assign(pointLightCount, false);
 
     std::vector<DescriptorSetBindingSpecs> hdrLayout{
-        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER,
-                                   sizeof(GlobalParametersUBO),
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC,
+                                   sizeof(ViewUBO),
                                    1,
-                                   VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_GEOMETRY_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                                   0 },
+                                   VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   GLOBAL_BINDING_VIEW },
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_DIFFUSE, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 1 },
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_NORMAL, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 2 },
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_ROUGHNESSMETALLIC, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 3 },
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_SHADOWMAP, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 4 },
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_POINTSHADOWMAP, UINT64_MAX, 5, VK_SHADER_STAGE_FRAGMENT_BIT, 5 },
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_VERTEX_BIT, 6 }, // Instances
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 9 }, // Lights
+        DescriptorSetBindingSpecs{ Type::STORAGE_BUFFER, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 10 }, // Clusters
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC,
+                                   sizeof(FrameUBO),
+                                   1,
+                                   VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   GLOBAL_BINDING_FRAME },
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC,
+                                   sizeof(PointShadowUBO),
+                                   1,
+                                   VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_GEOMETRY_BIT,
+                                   GLOBAL_BINDING_POINT_SHADOW },
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC,
+                                   sizeof(StaticUBO),
+                                   1,
+                                   VK_SHADER_STAGE_FRAGMENT_BIT,
+                                   GLOBAL_BINDING_STATIC },
     };
 
     std::vector<DescriptorSetBindingSpecs> SkyboxLayout{
-        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER, sizeof(glm::mat4), 1, VK_SHADER_STAGE_VERTEX_BIT, 0 },
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC, sizeof(glm::mat4), 1, VK_SHADER_STAGE_VERTEX_BIT, 0 },
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_CUBEMAP, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 1 }
     };
 
     std::vector<DescriptorSetBindingSpecs> ParticleSystemLayout{
-        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER,
-                                   (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3),
-                                   1,
-                                   VK_SHADER_STAGE_VERTEX_BIT,
-                                   0 }, // Index 0
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC, sizeof(ViewUBO), 1, VK_SHADER_STAGE_VERTEX_BIT, 0 }, // Index 0
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_DIFFUSE, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 1 }, // Index 3
     };
 
@@ -78,22 +119,27 @@ void ForwardRenderer::Init()
     };
 
     std::vector<DescriptorSetBindingSpecs> EmissiveLayout{
-        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER, sizeof(glm::mat4) * 2, 1, VK_SHADER_STAGE_VERTEX_BIT, 0 },
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC, sizeof(glm::mat4) * 2, 1, VK_SHADER_STAGE_VERTEX_BIT, 0 },
     };
 
     std::vector<DescriptorSetBindingSpecs> CubeLayout{
-        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER, sizeof(glm::mat4) * 2, 1, VK_SHADER_STAGE_VERTEX_BIT, 0 },
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC, sizeof(glm::mat4) * 2, 1, VK_SHADER_STAGE_VERTEX_BIT, 0 },
     };
 
     std::vector<DescriptorSetBindingSpecs> BokehPassLayout{
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_DIFFUSE, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 0 },
         DescriptorSetBindingSpecs{ Type::TEXTURE_SAMPLER_DIFFUSE, UINT64_MAX, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 1 },
-        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER, sizeof(glm::vec4) * 7, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 2 },
+        DescriptorSetBindingSpecs{ Type::UNIFORM_BUFFER_DYNAMIC, sizeof(glm::vec4) * 6, 1, VK_SHADER_STAGE_FRAGMENT_BIT, 2 },
     };
 
-    // Create the pool(s) that we need here.
+    // Create the pool(s) that we need here. The post process sets are freed individually when a resize replaces them.
     pool = make_s<DescriptorPool>(
-        200, std::vector<VkDescriptorType>{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER });
+        200,
+        std::vector<VkDescriptorType>{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                       VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                                       VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER },
+        VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
 
     // Descriptor Set Layouts
     particleSystemLayout = make_s<DescriptorSetLayout>(ParticleSystemLayout);
@@ -104,31 +150,30 @@ void ForwardRenderer::Init()
     emissiveLayout       = make_s<DescriptorSetLayout>(EmissiveLayout);
     bokehPassLayout      = make_s<DescriptorSetLayout>(BokehPassLayout);
 
-    // Following are the global Uniform Buffes shared by all shaders.
-    Utils::CreateVKBuffer(
-        sizeof(GlobalParametersUBO),
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        globalParametersUBOBuffer,
-        globalParametersUBOBufferMemory);
-    vkMapMemory(
-        _Context.GetDevice()->GetVKDevice(),
-        globalParametersUBOBufferMemory,
-        0,
-        sizeof(GlobalParametersUBO),
-        0,
-        &mappedGlobalParametersModelUBOBuffer);
+    // Following are the global uniform blocks shared by all shaders. Each shader binds only the blocks it reads. Every frame
+    // in flight has its own copy, the sets are written once and bound with the dynamic offset of the frame's copy.
+    std::vector<VkDeviceSize> globalBlockSizes(GLOBAL_BLOCK_COUNT);
+    globalBlockSizes[GLOBAL_BLOCK_VIEW]         = sizeof(ViewUBO);
+    globalBlockSizes[GLOBAL_BLOCK_FRAME]        = sizeof(FrameUBO);
+    globalBlockSizes[GLOBAL_BLOCK_POINT_SHADOW] = sizeof(PointShadowUBO);
+    globalBlockSizes[GLOBAL_BLOCK_STATIC]       = sizeof(StaticUBO);
+    _GlobalUniforms = std::make_unique<UniformBlocks>(_Context, globalBlockSizes, MAX_FRAMES_IN_FLIGHT);
+
+    // Point lights reach the PBR shader through per cluster light lists.
+    _ClusteredLights =
+        std::make_unique<ClusteredLights>(_Context, MAX_CLUSTERED_LIGHTS, MAX_CLUSTER_LIGHT_INDICES, MAX_FRAMES_IN_FLIGHT);
 
     // Create an image for the shadowmap. We will render to this image when
-    // we are doing a shadow pass.
+    // we are doing a shadow pass. Each cascade gets its own layer.
     directionalShadowMapImage = make_s<Image>(
-        SHADOW_DIM,
-        SHADOW_DIM,
+        CASCADE_SHADOW_DIM,
+        CASCADE_SHADOW_DIM,
         VK_FORMAT_D32_SFLOAT,
         (VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT),
-        ImageType::DEPTH);
+        ImageType::DEPTH,
+        CASCADE_COUNT);
 
-    for (int i = 0; i < globalParametersUBO.pointLightCount.x; i++)
+    for (int i = 0; i < pointLightCount; i++)
     {
         pointShadowMaps[i] = make_s<Image>(
             POUNT_SHADOW_DIM,
@@ -138,24 +183,38 @@ void ForwardRenderer::Init()
             ImageType::DEPTH_CUBEMAP);
     }
 
-    // Allocate final pass descriptor Set.
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool     = pool->GetDescriptorPool();
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts        = &swapchainLayout->GetDescriptorLayout();
-
-    VkResult rslt = vkAllocateDescriptorSets(_Context.GetDevice()->GetVKDevice(), &allocInfo, &finalPassDescriptorSet);
-    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
-
-    // Allocate bokeh pass descriptor Set.
-    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool     = pool->GetDescriptorPool();
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts        = &bokehPassLayout->GetDescriptorLayout();
-
-    rslt                         = vkAllocateDescriptorSets(_Context.GetDevice()->GetVKDevice(), &allocInfo, &bokehDescriptorSet);
-    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+    // With descriptor indexing, the PBR models share one global set and pick their textures by material index.
+    if (_Context.GetDevice()->SupportsBindlessTextures())
+    {
+        _BindlessMaterials =
+            make_s<BindlessMaterials>(_Context, BINDLESS_MAX_TEXTURES, BINDLESS_MAX_MATERIALS, BINDLESS_POINT_SHADOW_MAPS);
+        _BindlessMaterials->SetUniformBuffer(
+            GLOBAL_BINDING_VIEW,
+            _GlobalUniforms->GetBuffer(),
+            _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW),
+            sizeof(ViewUBO));
+        _BindlessMaterials->SetUniformBuffer(
+            GLOBAL_BINDING_FRAME,
+            _GlobalUniforms->GetBuffer(),
+            _GlobalUniforms->GetOffset(GLOBAL_BLOCK_FRAME),
+            sizeof(FrameUBO));
+        _BindlessMaterials->SetUniformBuffer(
+            GLOBAL_BINDING_POINT_SHADOW,
+            _GlobalUniforms->GetBuffer(),
+            _GlobalUniforms->GetOffset(GLOBAL_BLOCK_POINT_SHADOW),
+            sizeof(PointShadowUBO));
+        _BindlessMaterials->SetUniformBuffer(
+            GLOBAL_BINDING_STATIC,
+            _GlobalUniforms->GetBuffer(),
+            _GlobalUniforms->GetOffset(GLOBAL_BLOCK_STATIC),
+            sizeof(StaticUBO));
+        _BindlessMaterials->SetShadowMaps(directionalShadowMapImage, pointShadowMaps);
+        _BindlessMaterials->SetLightBuffers(
+            _ClusteredLights->GetLightBuffer(),
+            _ClusteredLights->GetLightBufferSize(),
+            _ClusteredLights->GetClusterBuffer(),
+            _ClusteredLights->GetClusterBufferSize());
+    }
 
     // Setup resources.
     CreateSwapchainRenderPass();
@@ -170,71 +229,132 @@ void ForwardRenderer::Init()
 
     SetupFinalPassPipeline();
     SetupPBRPipeline();
+    SetupDepthPrepassPipeline();
     SetupShadowPassPipeline();
     SetupSkyboxPipeline();
     SetupCubePipeline();
     SetupPointShadowPassPipeline();
+    SetupPointShadowPassPerFacePipeline();
     SetupEmissiveObjectPipeline();
     SetupParticleSystemPipeline();
     SetupBokehPassPipeline();
 
-    // Directional light shadowmap framebuffer.
-    std::vector<VkImageView> attachments = { directionalShadowMapImage->GetImageView() };
+    // Directional light shadowmap framebuffers. One per cascade layer.
+    std::vector<VkImageView> attachments;
+    _CascadeShadowMapFramebuffers.resize(CASCADE_COUNT);
+    for (uint32_t i = 0; i < CASCADE_COUNT; i++)
+    {
+        attachments = { directionalShadowMapImage->GetLayerImageView(i) };
 
-    _DirectionalShadowMapFramebuffer =
-        make_s<Framebuffer>(_ShadowMapRenderPass->GetHandle(), attachments, SHADOW_DIM, SHADOW_DIM);
+        _CascadeShadowMapFramebuffers[i] =
+            make_s<Framebuffer>(_ShadowMapRenderPass->GetHandle(), attachments, CASCADE_SHADOW_DIM, CASCADE_SHADOW_DIM);
+    }
 
     // Framebuffers need for point light shadows. (Dependent on the number
     // of point lights in the scene)
-    for (int i = 0; i < globalParametersUBO.pointLightCount.x; i++)
+    for (int i = 0; i < pointLightCount; i++)
     {
         attachments = { pointShadowMaps[i]->GetImageView() };
 
         _PointShadowMapFramebuffers[i] =
             make_s<Framebuffer>(_PointShadowRenderPass->GetHandle(), attachments, POUNT_SHADOW_DIM, POUNT_SHADOW_DIM, 6);
+
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            attachments = { pointShadowMaps[i]->GetLayerImageView(face) };
+
+            _PointShadowFaceFramebuffers[i][face] =
+                make_s<Framebuffer>(_PointShadowRenderPass->GetHandle(), attachments, POUNT_SHADOW_DIM, POUNT_SHADOW_DIM);
+        }
     }
 
+    // PBR models go through the bindless material table when there is one. Otherwise every mesh gets its own set.
+    auto loadPBRModel = [&](const std::string& path)
+    {
+        LoadingFlags flags = LOAD_VERTEX_POSITIONS | LOAD_NORMALS | LOAD_BITANGENT | LOAD_TANGENT | LOAD_UV;
+        if (_BindlessMaterials)
+            return make_s<Model>(path, flags, _BindlessMaterials);
+
+        Ref<Model> pbrModel = make_s<Model>(path, flags, pool, PBRLayout, directionalShadowMapImage, pointShadowMaps);
+        // Meshes that share a material share its set, so every set is written once.
+        for (const auto& [key, material] : pbrModel->GetMaterials())
+        {
+            const VkDescriptorSet& descriptorSet = material->GetDescriptorSet();
+            Utils::UpdateDescriptorSet(
+                descriptorSet,
+                _GlobalUniforms->GetBuffer(),
+                _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW),
+                sizeof(ViewUBO),
+                GLOBAL_BINDING_VIEW,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+            Utils::UpdateDescriptorSet(
+                descriptorSet,
+                _GlobalUniforms->GetBuffer(),
+                _GlobalUniforms->GetOffset(GLOBAL_BLOCK_FRAME),
+                sizeof(FrameUBO),
+                GLOBAL_BINDING_FRAME,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+            Utils::UpdateDescriptorSet(
+                descriptorSet,
+                _GlobalUniforms->GetBuffer(),
+                _GlobalUniforms->GetOffset(GLOBAL_BLOCK_POINT_SHADOW),
+                sizeof(PointShadowUBO),
+                GLOBAL_BINDING_POINT_SHADOW,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+            Utils::UpdateDescriptorSet(
+                descriptorSet,
+                _GlobalUniforms->GetBuffer(),
+                _GlobalUniforms->GetOffset(GLOBAL_BLOCK_STATIC),
+                sizeof(StaticUBO),
+                GLOBAL_BINDING_STATIC,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+            Utils::UpdateDescriptorSet(
+                descriptorSet,
+                _ClusteredLights->GetLightBuffer(),
+                0,
+                _ClusteredLights->GetLightBufferSize(),
+                9,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+            Utils::UpdateDescriptorSet(
+                descriptorSet,
+                _ClusteredLights->GetClusterBuffer(),
+                0,
+                _ClusteredLights->GetClusterBufferSize(),
+                10,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        }
+        return pbrModel;
+    };
+
     // Loading the model Sponza
-    model = make_s<Model>(
-        std::string(SOLUTION_DIR) + "Engine/assets/models/Sponza/scene.gltf",
-        LOAD_VERTEX_POSITIONS | LOAD_NORMALS | LOAD_BITANGENT | LOAD_TANGENT | LOAD_UV,
-        pool,
-        PBRLayout,
-        directionalShadowMapImage,
-        pointShadowMaps);
+    model = loadPBRModel(std::string(SOLUTION_DIR) + "Engine/assets/models/Sponza/scene.gltf");
     model->Scale(0.005f, 0.005f, 0.005f);
 
-    for (int i = 0; i < model->GetMeshCount(); i++)
+    // Decorative lights fill the lower part of the atrium. The fixed seed keeps the layout the same between runs.
+    glm::vec3 sponzaMin, sponzaMax;
+    model->GetWorldBounds(sponzaMin, sponzaMax);
+    std::mt19937                          lightGen(1337);
+    std::uniform_real_distribution<float> unitDistr(0.0f, 1.0f);
+    for (int i = 0; i < MAX_DECORATIVE_LIGHTS; i++)
     {
-        Utils::UpdateDescriptorSet(
-            model->GetMeshes()[i]->GetDescriptorSet(), globalParametersUBOBuffer, 0, sizeof(GlobalParametersUBO), 0);
+        glm::vec3 position = glm::vec3(
+            glm::mix(sponzaMin.x, sponzaMax.x, 0.05f + 0.9f * unitDistr(lightGen)),
+            glm::mix(sponzaMin.y, sponzaMax.y, 0.02f + 0.25f * unitDistr(lightGen)),
+            glm::mix(sponzaMin.z, sponzaMax.z, 0.05f + 0.9f * unitDistr(lightGen)));
+        float     intensity = 0.2f + 0.6f * unitDistr(lightGen);
+        glm::vec3 color     = glm::vec3(1.0f, 0.3f + 0.6f * unitDistr(lightGen), 0.1f + 0.4f * unitDistr(lightGen));
+
+        _DecorativeLightPositions.push_back(glm::vec4(position, intensity));
+        _DecorativeLightColors.push_back(color);
     }
 
     // Loading the model Malenia's Helmet.
-    model2 = make_s<Model>(
-        std::string(SOLUTION_DIR) + "Engine/assets/models/MaleniaHelmet/scene.gltf",
-        LOAD_VERTEX_POSITIONS | LOAD_NORMALS | LOAD_BITANGENT | LOAD_TANGENT | LOAD_UV,
-        pool,
-        PBRLayout,
-        directionalShadowMapImage,
-        pointShadowMaps);
+    model2 = loadPBRModel(std::string(SOLUTION_DIR) + "Engine/assets/models/MaleniaHelmet/scene.gltf");
     model2->Translate(0.0, 2.0f, 0.0);
     model2->Rotate(90, 0, 1, 0);
     model2->Scale(0.7f, 0.7f, 0.7f);
 
-    for (int i = 0; i < model2->GetMeshCount(); i++)
-    {
-        Utils::UpdateDescriptorSet(
-            model2->GetMeshes()[i]->GetDescriptorSet(), globalParametersUBOBuffer, 0, sizeof(GlobalParametersUBO), 0);
-    }
-
-    torch = make_s<Model>(
-        std::string(SOLUTION_DIR) + "Engine/assets/models/torch/scene.gltf",
-        LOAD_VERTEX_POSITIONS | LOAD_NORMALS | LOAD_BITANGENT | LOAD_TANGENT | LOAD_UV,
-        pool,
-        PBRLayout,
-        directionalShadowMapImage,
-        pointShadowMaps);
+    torch = loadPBRModel(std::string(SOLUTION_DIR) + "Engine/assets/models/torch/scene.gltf");
 
     torch1modelMatrix = glm::translate(torch1modelMatrix, glm::vec3(2.450f, 1.3f, 0.810f));
     torch1modelMatrix = glm::scale(torch1modelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
@@ -252,32 +372,41 @@ void ForwardRenderer::Init()
     torch4modelMatrix = glm::scale(torch4modelMatrix, glm::vec3(0.3f, 0.3f, 0.3f));
     torch4modelMatrix = glm::rotate(torch4modelMatrix, glm::radians(-90.0f), glm::vec3(0, 1, 0));
 
-    for (int i = 0; i < torch->GetMeshCount(); i++)
+    // The torches are drawn as 4 instances of the same model.
+    torch->AddInstance(torch1modelMatrix);
+    torch->AddInstance(torch2modelMatrix);
+    torch->AddInstance(torch3modelMatrix);
+    torch->AddInstance(torch4modelMatrix);
+
+    // Models drawn through the GPU culled indirect path.
+    if (_Context.GetDevice()->SupportsDrawIndirectCount())
     {
-        Utils::UpdateDescriptorSet(
-            torch->GetMeshes()[i]->GetDescriptorSet(), globalParametersUBOBuffer, 0, sizeof(GlobalParametersUBO), 0);
+        _GPUCulling = std::make_unique<GPUCulling>(_Context, GPU_CULL_VIEW_COUNT, MAX_FRAMES_IN_FLIGHT);
+        _GPUCulling->Register(model);
+        _GPUCulling->Register(model2);
+        _GPUCulling->Register(torch);
     }
 
     SetupParticleSystems();
 
     // Set the positions of the point lights in the scene we have 4 torches.
-    globalParametersUBO.pointLightPositions[0] =
+    pointLightPositions[0] =
         glm::vec4(glm::vec3(torch1modelMatrix[3].x, torch1modelMatrix[3].y + 0.22f, torch1modelMatrix[3].z - 0.02f), 1.0f);
-    globalParametersUBO.pointLightPositions[1] =
+    pointLightPositions[1] =
         glm::vec4(glm::vec3(torch2modelMatrix[3].x, torch2modelMatrix[3].y + 0.22f, torch2modelMatrix[3].z + 0.02f), 1.0f);
-    globalParametersUBO.pointLightPositions[2] =
+    pointLightPositions[2] =
         glm::vec4(glm::vec3(torch3modelMatrix[3].x, torch3modelMatrix[3].y + 0.22f, torch3modelMatrix[3].z - 0.02f), 1.0f);
-    globalParametersUBO.pointLightPositions[3] =
+    pointLightPositions[3] =
         glm::vec4(glm::vec3(torch4modelMatrix[3].x, torch4modelMatrix[3].y + 0.22f, torch4modelMatrix[3].z + 0.02f), 1.0f);
-    globalParametersUBO.cameraNearPlane           = glm::vec4(_Camera->GetNearClip());
-    globalParametersUBO.cameraFarPlane            = glm::vec4(_Camera->GetFarClip());
-    globalParametersUBO.focalDepth                = glm::vec4(1.5f);
-    globalParametersUBO.focalLength               = glm::vec4(15.0f);
-    globalParametersUBO.fstop                     = glm::vec4(6.0f);
-    globalParametersUBO.pointLightPositions[4]    = glm::vec4(-0.3f, 3.190, -0.180, 1.0f);
-    globalParametersUBO.pointLightIntensities[4]  = glm::vec4(50.0f);
-    globalParametersUBO.directionalLightIntensity = glm::vec4(10.0);
-    globalParametersUBO.pointFarPlane             = glm::vec4(pointFarPlane);
+    staticUBO.cameraNearPlane           = glm::vec4(_Camera->GetNearClip());
+    staticUBO.cameraFarPlane            = glm::vec4(_Camera->GetFarClip());
+    staticUBO.focalDepth                = glm::vec4(1.5f);
+    staticUBO.focalLength               = glm::vec4(15.0f);
+    staticUBO.fstop                     = glm::vec4(6.0f);
+    pointLightPositions[4]              = glm::vec4(-0.3f, 3.190, -0.180, 1.0f);
+    pointLightIntensities[4]            = glm::vec4(50.0f);
+    staticUBO.directionalLightIntensity = glm::vec4(10.0);
+    staticUBO.pointFarPlane             = glm::vec4(pointFarPlane);
 
     model3                                        = make_s<Model>(
         Utils::NormalizePath(std::string(SOLUTION_DIR) + "Engine/assets/models/sword/scene.gltf"),
@@ -289,10 +418,15 @@ void ForwardRenderer::Init()
     model3->Rotate(90, 0, 1, 0);
     model3->Scale(0.7f, 0.7f, 0.7f);
 
-    for (int i = 0; i < model3->GetMeshCount(); i++)
+    for (const auto& [key, material] : model3->GetMaterials())
     {
         Utils::UpdateDescriptorSet(
-            model3->GetMeshes()[i]->GetDescriptorSet(), globalParametersUBOBuffer, 0, sizeof(glm::mat4) * 2, 0);
+            material->GetDescriptorSet(),
+            _GlobalUniforms->GetBuffer(),
+            0,
+            sizeof(glm::mat4) * 2,
+            0,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
     }
 
     // Vertex data for the skybox.
@@ -332,13 +466,23 @@ void ForwardRenderer::Init()
     // Create the mesh for the skybox.
     skybox = make_s<Model>(cubeVertices, vertexCount, cubemap, pool, skyboxLayout);
     Utils::UpdateDescriptorSet(
-        skybox->GetMeshes()[0]->GetDescriptorSet(), globalParametersUBOBuffer, sizeof(glm::mat4), sizeof(glm::mat4), 0);
+        skybox->GetMeshes()[0]->GetDescriptorSet(),
+        _GlobalUniforms->GetBuffer(),
+        0,
+        sizeof(glm::mat4) * 2,
+        0,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 
     // A cube model to depict/debug point lights.
     cube = make_s<Model>(cubeVertices, vertexCount, nullptr, pool, cubeLayout);
 
     Utils::UpdateDescriptorSet(
-        cube->GetMeshes()[0]->GetDescriptorSet(), globalParametersUBOBuffer, 0, sizeof(glm::mat4) + sizeof(glm::mat4), 0);
+        cube->GetMeshes()[0]->GetDescriptorSet(),
+        _GlobalUniforms->GetBuffer(),
+        0,
+        sizeof(glm::mat4) + sizeof(glm::mat4),
+        0,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 
     CommandBuffer::CreateCommandBufferPool(_Context._QueueFamilies.GraphicsFamily, cmdPool);
 
@@ -350,41 +494,70 @@ void ForwardRenderer::Init()
     bloomAgent = make_s<Bloom>();
     bloomAgent->ConnectImageResourceToAddBloomTo(HDRColorImage);
 
-    finalPassSampler = Utils::CreateSampler(
-        bokehPassImage, ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
+    // The final and bokeh passes all sample with the same linear, clamp to edge state.
+    postProcessSampler = _Context.GetSamplerCache()->GetTextureSampler(
+        ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
+
+    AllocatePostProcessDescriptorSets();
+}
 
+void ForwardRenderer::AllocatePostProcessDescriptorSets()
+{
+    VkDevice device = _Context.GetDevice()->GetVKDevice();
+    if (finalPassDescriptorSet != VK_NULL_HANDLE)
+    {
+        std::array<VkDescriptorSet, 2> oldSets = { finalPassDescriptorSet, bokehDescriptorSet };
+        _Context.GetDeletionQueue()->Retire(
+            [device, descriptorPool = pool, oldSets]()
+            { vkFreeDescriptorSets(device, descriptorPool->GetDescriptorPool(), (uint32_t)oldSets.size(), oldSets.data()); });
+    }
+
+    // Allocate final pass descriptor Set.
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = pool->GetDescriptorPool();
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &swapchainLayout->GetDescriptorLayout();
+
+    VkResult rslt = vkAllocateDescriptorSets(device, &allocInfo, &finalPassDescriptorSet);
+    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+
+    // Allocate bokeh pass descriptor Set.
+    allocInfo.pSetLayouts = &bokehPassLayout->GetDescriptorLayout();
+
+    rslt                  = vkAllocateDescriptorSets(device, &allocInfo, &bokehDescriptorSet);
+    ASSERT(rslt == VK_SUCCESS, "Failed to allocate descriptor sets!");
+
+    // Each pass reads the output of the last active one before it: HDR color, then bloom, then the bokeh pass.
+    const Ref<Image>& sceneColor = _BloomActive ? bloomAgent->GetPostProcessedImage() : HDRColorImage;
     Utils::UpdateDescriptorSet(
-        finalPassDescriptorSet, finalPassSampler, bokehPassImage->GetImageView(), 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    bokehPassSceneSampler = Utils::CreateSampler(
-        bloomAgent->GetPostProcessedImage(),
-        ImageType::COLOR,
-        VK_FILTER_LINEAR,
-        VK_FILTER_LINEAR,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        VK_FALSE);
+        finalPassDescriptorSet,
+        postProcessSampler->GetHandle(),
+        _DepthOfFieldActive ? bokehPassImage->GetImageView() : sceneColor->GetImageView(),
+        0,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
     Utils::UpdateDescriptorSet(
         bokehDescriptorSet,
-        bokehPassSceneSampler,
-        bloomAgent->GetPostProcessedImage()->GetImageView(),
+        postProcessSampler->GetHandle(),
+        sceneColor->GetImageView(),
         0,
         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-    bokehPassDepthSampler = Utils::CreateSampler(
-        HDRDepthImage, ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
     Utils::UpdateDescriptorSet(
         bokehDescriptorSet,
-        bokehPassDepthSampler,
+        postProcessSampler->GetHandle(),
         HDRDepthImage->GetImageView(),
         1,
         VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
 
     Utils::UpdateDescriptorSet(
         bokehDescriptorSet,
-        globalParametersUBOBuffer,
-        offsetof(GlobalParametersUBO, DOFFramebufferSize),
-        sizeof(glm::vec4) * 7,
-        2);
+        _GlobalUniforms->GetBuffer(),
+        _GlobalUniforms->GetOffset(GLOBAL_BLOCK_STATIC) + offsetof(StaticUBO, DOFFramebufferSize),
+        sizeof(glm::vec4) * 6,
+        2,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
 }
 
 void ForwardRenderer::CreateSynchronizationPrimitives()
@@ -453,6 +626,15 @@ void ForwardRenderer::SetupPBRPipeline()
     specs.VertexShaderPath        = "assets/shaders/PBRShaderVERT.spv";
     specs.FragmentShaderPath      = "assets/shaders/PBRShaderFRAG.spv";
 
+    // Bindless models use the global set plus a per model set holding the instance buffer.
+    if (_BindlessMaterials)
+    {
+        specs.DescriptorSetLayout       = _BindlessMaterials->GetGlobalLayout();
+        specs.ExtraDescriptorSetLayouts = { _BindlessMaterials->GetModelLayout() };
+        specs.VertexShaderPath          = "assets/shaders/PBRShaderBindlessVERT.spv";
+        specs.FragmentShaderPath        = "assets/shaders/PBRShaderBindlessFRAG.spv";
+    }
+
     VkPushConstantRange pcRange;
     pcRange.offset           = 0;
     pcRange.size             = sizeof(glm::mat4);
@@ -506,7 +688,93 @@ void ForwardRenderer::SetupPBRPipeline()
     specs.VertexBindings              = { bindingDescription };
     specs.VertexAttributes            = attributeDescriptions;
 
-    pipeline                          = make_s<Pipeline>(_Context, specs);
+    // The bindless shaders also read the material index of every vertex from the model's second vertex buffer.
+    if (_BindlessMaterials)
+    {
+        VkVertexInputBindingDescription materialBinding{};
+        materialBinding.binding   = 1;
+        materialBinding.stride    = sizeof(float);
+        materialBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkVertexInputAttributeDescription materialAttribute{};
+        materialAttribute.binding  = 1;
+        materialAttribute.location = 5;
+        materialAttribute.format   = VK_FORMAT_R32_SFLOAT;
+        materialAttribute.offset   = 0;
+
+        specs.VertexBindings.push_back(materialBinding);
+        specs.VertexAttributes.push_back(materialAttribute);
+    }
+
+    PBRVariants = PipelineVariants(_Context, specs);
+
+    // Only the fragments that won the depth pre-pass get shaded.
+    specs.DepthCompareOp     = VK_COMPARE_OP_EQUAL;
+    specs.EnableDepthWriting = VK_FALSE;
+    depthEqualVariants       = PipelineVariants(_Context, specs);
+
+    // Both point shadow permutations are compiled up front, that toggle is flipped the most.
+    std::vector<uint32_t> constants = { VK_FALSE, (uint32_t)directionalShadowPCFRadius };
+    PBRVariants.Get(constants);
+    depthEqualVariants.Get(constants);
+    constants[0]       = VK_TRUE;
+    pipeline           = PBRVariants.Get(constants);
+    depthEqualPipeline = depthEqualVariants.Get(constants);
+}
+
+void ForwardRenderer::SetupDepthPrepassPipeline()
+{
+    Pipeline::Specs specs{};
+    specs.DescriptorSetLayout     = PBRLayout;
+    specs.RenderPass              = _HDRRenderPass->GetHandle();
+    specs.CullMode                = VK_CULL_MODE_BACK_BIT;
+    specs.DepthBiasClamp          = 0.0f;
+    specs.DepthBiasConstantFactor = 0.0f;
+    specs.DepthBiasSlopeFactor    = 0.0f;
+    specs.DepthCompareOp          = VK_COMPARE_OP_LESS;
+    specs.EnableDepthBias         = false;
+    specs.EnableDepthTesting      = VK_TRUE;
+    specs.EnableDepthWriting      = VK_TRUE;
+    specs.FrontFace               = VK_FRONT_FACE_CLOCKWISE;
+    specs.PolygonMode             = VK_POLYGON_MODE_FILL;
+    specs.VertexShaderPath        = "assets/shaders/depthPrepassVERT.spv";
+
+    if (_BindlessMaterials)
+    {
+        specs.DescriptorSetLayout       = _BindlessMaterials->GetGlobalLayout();
+        specs.ExtraDescriptorSetLayouts = { _BindlessMaterials->GetModelLayout() };
+        specs.VertexShaderPath          = "assets/shaders/depthPrepassBindlessVERT.spv";
+    }
+
+    VkPushConstantRange pcRange;
+    pcRange.offset           = 0;
+    pcRange.size             = sizeof(glm::mat4);
+    pcRange.stageFlags       = VK_SHADER_STAGE_VERTEX_BIT;
+
+    specs.PushConstantRanges = { pcRange };
+
+    // Depth only. The color attachment is left untouched.
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = 0;
+    colorBlendAttachment.blendEnable    = VK_FALSE;
+    specs.ColorBlendAttachmentState     = colorBlendAttachment;
+
+    // Reads the model's position only stream.
+    VkVertexInputBindingDescription positionBinding{};
+    positionBinding.binding   = 0;
+    positionBinding.stride    = sizeof(glm::vec3);
+    positionBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription positionAttribute{};
+    positionAttribute.binding  = 0;
+    positionAttribute.location = 0;
+    positionAttribute.format   = VK_FORMAT_R32G32B32_SFLOAT;
+    positionAttribute.offset   = 0;
+
+    specs.VertexBindings       = { positionBinding };
+    specs.VertexAttributes     = { positionAttribute };
+
+    depthPrepassPipeline       = _Context.GetPipelineCache()->GetPipeline(specs);
 }
 void ForwardRenderer::SetupFinalPassPipeline()
 {
@@ -539,7 +807,7 @@ void ForwardRenderer::SetupFinalPassPipeline()
 
     specs.ColorBlendAttachmentState          = colorBlendAttachment;
 
-    finalPassPipeline                        = make_s<Pipeline>(_Context, specs);
+    finalPassPipeline                        = _Context.GetPipelineCache()->GetPipeline(specs);
 }
 void ForwardRenderer::SetupShadowPassPipeline()
 {
@@ -557,13 +825,22 @@ void ForwardRenderer::SetupShadowPassPipeline()
     specs.FrontFace               = VK_FRONT_FACE_CLOCKWISE;
     specs.PolygonMode             = VK_POLYGON_MODE_FILL;
     specs.VertexShaderPath        = "assets/shaders/shadowPassVERT.spv";
-    specs.ViewportHeight          = SHADOW_DIM;
-    specs.ViewportWidth           = SHADOW_DIM;
+    specs.ViewportHeight          = CASCADE_SHADOW_DIM;
+    specs.ViewportWidth           = CASCADE_SHADOW_DIM;
     specs.EnableDynamicStates     = false;
 
+    // Bindless models use the global set plus a per model set holding the instance buffer.
+    if (_BindlessMaterials)
+    {
+        specs.DescriptorSetLayout       = _BindlessMaterials->GetGlobalLayout();
+        specs.ExtraDescriptorSetLayouts = { _BindlessMaterials->GetModelLayout() };
+        specs.VertexShaderPath          = "assets/shaders/shadowPassBindlessVERT.spv";
+    }
+
+    // Model matrix + cascade view projection matrix.
     VkPushConstantRange pcRange;
     pcRange.offset           = 0;
-    pcRange.size             = sizeof(glm::mat4);
+    pcRange.size             = sizeof(glm::mat4) * 2;
     pcRange.stageFlags       = VK_SHADER_STAGE_VERTEX_BIT;
 
     specs.PushConstantRanges = { pcRange };
@@ -596,7 +873,7 @@ void ForwardRenderer::SetupShadowPassPipeline()
     specs.VertexBindings               = { bindingDescription2 };
     specs.VertexAttributes             = attributeDescriptions2;
 
-    shadowPassPipeline                 = make_s<Pipeline>(_Context, specs);
+    shadowPassPipeline                 = _Context.GetPipelineCache()->GetPipeline(specs);
 }
 void ForwardRenderer::SetupPointShadowPassPipeline()
 {
@@ -620,6 +897,14 @@ void ForwardRenderer::SetupPointShadowPassPipeline()
     specs.ViewportWidth           = POUNT_SHADOW_DIM;
     specs.EnableDynamicStates     = false;
 
+    // Bindless models use the global set plus a per model set holding the instance buffer.
+    if (_BindlessMaterials)
+    {
+        specs.DescriptorSetLayout       = _BindlessMaterials->GetGlobalLayout();
+        specs.ExtraDescriptorSetLayouts = { _BindlessMaterials->GetModelLayout() };
+        specs.VertexShaderPath          = "assets/shaders/pointShadowPassBindlessVERT.spv";
+    }
+
     VkPushConstantRange pcRange;
     pcRange.offset     = 0;
     pcRange.size       = sizeof(glm::mat4);
@@ -665,7 +950,68 @@ void ForwardRenderer::SetupPointShadowPassPipeline()
     specs.VertexBindings               = { bindingDescription2 };
     specs.VertexAttributes             = attributeDescriptions2;
 
-    pointShadowPassPipeline            = make_s<Pipeline>(_Context, specs);
+    pointShadowPassPipeline            = _Context.GetPipelineCache()->GetPipeline(specs);
+}
+void ForwardRenderer::SetupPointShadowPassPerFacePipeline()
+{
+    Pipeline::Specs specs{};
+    specs.DescriptorSetLayout     = PBRLayout;
+    specs.RenderPass              = _PointShadowRenderPass->GetHandle();
+    specs.CullMode                = VK_CULL_MODE_BACK_BIT;
+    specs.DepthBiasClamp          = 0.0f;
+    specs.DepthBiasConstantFactor = 1.25f;
+    specs.DepthBiasSlopeFactor    = 1.75f;
+    specs.DepthCompareOp          = VK_COMPARE_OP_LESS_OR_EQUAL;
+    specs.EnableDepthBias         = VK_FALSE;
+    specs.EnableDepthTesting      = VK_TRUE;
+    specs.EnableDepthWriting      = VK_TRUE;
+    specs.FrontFace               = VK_FRONT_FACE_CLOCKWISE;
+    specs.PolygonMode             = VK_POLYGON_MODE_FILL;
+    specs.VertexShaderPath        = "assets/shaders/pointShadowPassFaceVERT.spv";
+    specs.FragmentShaderPath      = "assets/shaders/pointShadowPassFRAG.spv";
+    specs.ViewportHeight          = POUNT_SHADOW_DIM;
+    specs.ViewportWidth           = POUNT_SHADOW_DIM;
+    specs.EnableDynamicStates     = false;
+
+    // Bindless models use the global set plus a per model set holding the instance buffer.
+    if (_BindlessMaterials)
+    {
+        specs.DescriptorSetLayout       = _BindlessMaterials->GetGlobalLayout();
+        specs.ExtraDescriptorSetLayouts = { _BindlessMaterials->GetModelLayout() };
+        specs.VertexShaderPath          = "assets/shaders/pointShadowPassFaceBindlessVERT.spv";
+    }
+
+    // Same layout as the geometry shader path except that the light/face index is read by the vertex shader.
+    VkPushConstantRange pcRange;
+    pcRange.offset     = 0;
+    pcRange.size       = sizeof(glm::mat4) + sizeof(glm::vec4);
+    pcRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkPushConstantRange pcRange2;
+    pcRange2.offset          = sizeof(glm::mat4) + sizeof(glm::vec4);
+    pcRange2.size            = sizeof(glm::vec4) + sizeof(glm::vec4);
+    pcRange2.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    specs.PushConstantRanges = { pcRange, pcRange2 };
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable         = VK_FALSE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+
+    specs.ColorBlendAttachmentState          = colorBlendAttachment;
+
+    // Position only, same vertex input as the geometry shader path.
+    specs.VertexBindings                     = { bindingDescription2 };
+    specs.VertexAttributes                   = attributeDescriptions2;
+
+    pointShadowPassPerFacePipeline           = _Context.GetPipelineCache()->GetPipeline(specs);
 }
 void ForwardRenderer::SetupSkyboxPipeline()
 {
@@ -719,7 +1065,7 @@ void ForwardRenderer::SetupSkyboxPipeline()
     specs.VertexBindings               = { bindingDescription3 };
     specs.VertexAttributes             = attributeDescriptions3;
 
-    skyboxPipeline                     = make_s<Pipeline>(_Context, specs);
+    skyboxPipeline                     = _Context.GetPipelineCache()->GetPipeline(specs);
 }
 void ForwardRenderer::SetupCubePipeline()
 {
@@ -773,7 +1119,7 @@ void ForwardRenderer::SetupCubePipeline()
     specs.VertexBindings               = { bindingDescription3 };
     specs.VertexAttributes             = attributeDescriptions3;
 
-    cubePipeline                       = make_s<Pipeline>(_Context, specs);
+    cubePipeline                       = _Context.GetPipelineCache()->GetPipeline(specs);
 }
 
 void ForwardRenderer::SetupParticleSystemPipeline()
@@ -869,7 +1215,7 @@ void ForwardRenderer::SetupParticleSystemPipeline()
     particleSpecs.VertexBindings       = { bindingDescription4 };
     particleSpecs.VertexAttributes     = attributeDescriptions4;
 
-    particleSystemPipeline             = make_s<Pipeline>(_Context, particleSpecs);
+    particleSystemPipeline             = _Context.GetPipelineCache()->GetPipeline(particleSpecs);
 }
 void ForwardRenderer::SetupEmissiveObjectPipeline()
 {
@@ -924,7 +1270,7 @@ void ForwardRenderer::SetupEmissiveObjectPipeline()
     specs.VertexBindings               = { bindingDescription5 };
     specs.VertexAttributes             = attributeDescriptions5;
 
-    EmissiveObjectPipeline             = make_s<Pipeline>(_Context, specs);
+    EmissiveObjectPipeline             = _Context.GetPipelineCache()->GetPipeline(specs);
 }
 
 void ForwardRenderer::SetupParticleSystems()
@@ -936,6 +1282,10 @@ void ForwardRenderer::SetupParticleSystems()
     dustTexture =
         make_s<Image>(std::vector{ (std::string(SOLUTION_DIR) + "Engine/assets/textures/dust.png") }, VK_FORMAT_R8G8B8A8_SRGB);
 
+    // Every system gets its own seed, derived from the renderer's. Without one they are seeded from the clock.
+    uint32_t particleSeed = _RandomSeed;
+    auto     nextSeed     = [&particleSeed]() { return particleSeed == 0 ? 0u : particleSeed++; };
+
     ParticleSpecs specs{};
     specs.ParticleCount       = 10;
     specs.EnableNoise         = true;
@@ -949,8 +1299,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec3(-1.0f, 0.1f, -1.0f);
     specs.MaxVel              = glm::vec3(1.0f, 2.0f, 1.0f);
 
+    specs.Seed                = nextSeed();
     fireSparks                = make_s<ParticleSystem>(specs, particleTexture, particleSystemLayout, pool);
-    fireSparks->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireSparks->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
 
     specs.ParticleMinLifetime = 0.1f;
     specs.ParticleMaxLifetime = 1.5f;
@@ -964,8 +1315,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec4(0.0f);
     specs.MaxVel              = glm::vec4(0.0f);
 
+    specs.Seed                = nextSeed();
     fireBase                  = make_s<ParticleSystem>(specs, fireTexture, particleSystemLayout, pool);
-    fireBase->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireBase->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
     fireBase->RowOffset       = 0.0f;
     fireBase->RowCellSize     = 0.0833333333333333333333f;
     fireBase->ColumnCellSize  = 0.166666666666666f;
@@ -983,8 +1335,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec3(-1.0f, 0.1f, -1.0f);
     specs.MaxVel              = glm::vec3(1.0f, 2.0f, 1.0f);
 
+    specs.Seed                = nextSeed();
     fireSparks2               = make_s<ParticleSystem>(specs, particleTexture, particleSystemLayout, pool);
-    fireSparks2->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireSparks2->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
 
     specs.ParticleMinLifetime = 0.1f;
     specs.ParticleMaxLifetime = 1.5f;
@@ -998,8 +1351,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec4(0.0f);
     specs.MaxVel              = glm::vec4(0.0f);
 
+    specs.Seed                = nextSeed();
     fireBase2                 = make_s<ParticleSystem>(specs, fireTexture, particleSystemLayout, pool);
-    fireBase2->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireBase2->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
     fireBase2->RowOffset      = 0.0f;
     fireBase2->RowCellSize    = 0.0833333333333333333333f;
     fireBase2->ColumnCellSize = 0.166666666666666f;
@@ -1018,8 +1372,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel = glm::vec3(-1.0f, 0.1f, -1.0f);
     specs.MaxVel = glm::vec3(1.0f, 2.0f, 1.0f);
 
+    specs.Seed   = nextSeed();
     fireSparks3  = make_s<ParticleSystem>(specs, particleTexture, particleSystemLayout, pool);
-    fireSparks3->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireSparks3->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
 
     specs.ParticleMinLifetime = 0.1f;
     specs.ParticleMaxLifetime = 1.5f;
@@ -1033,8 +1388,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec4(0.0f);
     specs.MaxVel              = glm::vec4(0.0f);
 
+    specs.Seed                = nextSeed();
     fireBase3                 = make_s<ParticleSystem>(specs, fireTexture, particleSystemLayout, pool);
-    fireBase3->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireBase3->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
     fireBase3->RowOffset      = 0.0f;
     fireBase3->RowCellSize    = 0.0833333333333333333333f;
     fireBase3->ColumnCellSize = 0.166666666666666f;
@@ -1052,8 +1408,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec3(-1.0f, 0.1f, -1.0f);
     specs.MaxVel              = glm::vec3(1.0f, 2.0f, 1.0f);
 
+    specs.Seed                = nextSeed();
     fireSparks4               = make_s<ParticleSystem>(specs, particleTexture, particleSystemLayout, pool);
-    fireSparks4->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireSparks4->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
 
     specs.ParticleMinLifetime = 0.1f;
     specs.ParticleMaxLifetime = 1.5f;
@@ -1067,8 +1424,9 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec4(0.0f);
     specs.MaxVel              = glm::vec4(0.0f);
 
+    specs.Seed                = nextSeed();
     fireBase4                 = make_s<ParticleSystem>(specs, fireTexture, particleSystemLayout, pool);
-    fireBase4->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    fireBase4->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
     fireBase4->RowOffset      = 0.0f;
     fireBase4->RowCellSize    = 0.0833333333333333333333f;
     fireBase4->ColumnCellSize = 0.166666666666666f;
@@ -1086,14 +1444,17 @@ void ForwardRenderer::SetupParticleSystems()
     specs.MinVel              = glm::vec3(-0.3f, -0.3f, -0.3f);
     specs.MaxVel              = glm::vec3(0.3f, 0.3f, 0.3f);
 
+    specs.Seed                = nextSeed();
     ambientParticles          = make_s<ParticleSystem>(specs, dustTexture, particleSystemLayout, pool);
-    ambientParticles->SetUBO(globalParametersUBOBuffer, (sizeof(glm::mat4) * 3) + (sizeof(glm::vec4) * 3), 0);
+    ambientParticles->SetUBO(_GlobalUniforms->GetBuffer(), sizeof(ViewUBO), _GlobalUniforms->GetOffset(GLOBAL_BLOCK_VIEW));
 }
 
 void ForwardRenderer::CreateSwapchainRenderPass()
 {
+    // Headless frames are never presented, their images are left ready to be copied out instead.
+    VkImageLayout finalLayout = _Context.IsHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     RenderPass::AttachmentInfo colorAttachment{ _Context.GetSurface()->GetVKSurfaceFormat().format,
-                                                VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                                finalLayout,
                                                 VK_ATTACHMENT_LOAD_OP_CLEAR,
                                                 VK_ATTACHMENT_STORE_OP_STORE,
                                                 { 0.0f, 0.0f, 0.0f, 0.0f } }; // Pass two clear values here if this is buggy.
@@ -1181,37 +1542,247 @@ void ForwardRenderer::CreatePointShadowRenderPass()
     RenderPass::CreateInfo shadowRenderPassInfo{ { depthAttachment }, { dep }, true, "Point Light Shadow Render Pass" };
 
     _PointShadowRenderPass = std::make_unique<RenderPass>(_Context, shadowRenderPassInfo);
+
+    // Variant used when only some of the faces are re-rendered. It keeps the previous contents of the cubemap and the
+    // selected faces are cleared manually inside the pass. Compatible with the pass above so pipelines and framebuffers are
+    // shared.
+    depthAttachment.LoadOp        = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.InitialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    // Previous frame's shadow lookups must finish before we write into the map again.
+    VkSubpassDependency readDep{};
+    readDep.srcSubpass    = VK_SUBPASS_EXTERNAL;
+    readDep.dstSubpass    = 0;
+    readDep.srcStageMask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    readDep.srcAccessMask = 0;
+    readDep.dstStageMask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    readDep.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    RenderPass::CreateInfo partialRenderPassInfo{
+        { depthAttachment }, { readDep, dep }, true, "Point Light Shadow Partial Render Pass"
+    };
+
+    _PointShadowPartialRenderPass = std::make_unique<RenderPass>(_Context, partialRenderPassInfo);
 }
 
-void ForwardRenderer::EnableDepthOfField()
+std::vector<uint32_t> ForwardRenderer::SchedulePointShadowFaces(const glm::vec3& InCameraPosition)
 {
-    vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
-    vkDestroySampler(_Context.GetDevice()->GetVKDevice(), finalPassSampler, nullptr);
+    struct FaceCandidate
+    {
+        uint32_t Light;
+        uint32_t Face;
+        float    Priority;
+    };
 
-    finalPassSampler = Utils::CreateSampler(
-        bokehPassImage, ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
-    Utils::UpdateDescriptorSet(
-        finalPassDescriptorSet, finalPassSampler, bokehPassImage->GetImageView(), 0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    const uint32_t        lightCount = (uint32_t)pointLightCount;
+    std::vector<uint32_t> faceMasks(lightCount, 0);
+
+    std::vector<FaceCandidate> candidates;
+    candidates.reserve(lightCount * 6);
+
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        glm::vec3 position = glm::vec3(pointLightPositions[i]);
+
+        // A light that moved invalidates all of its faces.
+        if (glm::distance(position, _PointShadowCachedPositions[i]) > 0.001f)
+        {
+            _PointShadowFaceAges[i].fill(UINT32_MAX);
+            _PointShadowCachedPositions[i] = position;
+        }
+
+        // Bright lights close to the camera matter the most. The small constant keeps dim lights from starving forever.
+        float distance   = glm::distance(position, InCameraPosition);
+        float importance = pointLightIntensities[i].x / (1.0f + distance * distance) + 0.0001f;
+
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            // Faces that were never rendered (or got invalidated) always win.
+            uint32_t age      = _PointShadowFaceAges[i][face];
+            float    priority = age == UINT32_MAX ? FLT_MAX : importance * (1.0f + (float)age);
+            candidates.push_back({ i, face, priority });
+        }
+    }
+
+    uint32_t budget = (uint32_t)std::clamp(pointShadowFaceBudget, 0, (int)candidates.size());
+    std::partial_sort(
+        candidates.begin(),
+        candidates.begin() + budget,
+        candidates.end(),
+        [](const FaceCandidate& a, const FaceCandidate& b) { return a.Priority > b.Priority; });
+
+    for (uint32_t c = 0; c < budget; c++)
+        faceMasks[candidates[c].Light] |= 1u << candidates[c].Face;
+
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            uint32_t& age = _PointShadowFaceAges[i][face];
+            if (faceMasks[i] & (1u << face))
+                age = 0;
+            else if (age < UINT32_MAX - 1)
+                age++;
+        }
+    }
+
+    return faceMasks;
 }
-// Connects the bloom image to the final render pass.
-void ForwardRenderer::DisableDepthOfField()
+
+uint32_t ForwardRenderer::UpdateShadowCascades(const glm::mat4& InCameraView, const glm::mat4& InCameraProjection)
 {
-    vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
-    vkDestroySampler(_Context.GetDevice()->GetVKDevice(), finalPassSampler, nullptr);
-
-    finalPassSampler = Utils::CreateSampler(
-        bloomAgent->GetPostProcessedImage(),
-        ImageType::COLOR,
-        VK_FILTER_LINEAR,
-        VK_FILTER_LINEAR,
-        VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-        VK_FALSE);
-    Utils::UpdateDescriptorSet(
-        finalPassDescriptorSet,
-        finalPassSampler,
-        bloomAgent->GetPostProcessedImage()->GetImageView(),
-        0,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    const float nearClip       = _Camera->GetNearClip();
+    const float farClip        = _Camera->GetFarClip();
+    const float shadowDistance = std::clamp(cascadeShadowDistance, nearClip + 0.01f, farClip);
+
+    // Practical split scheme, a blend of logarithmic and uniform splits.
+    std::array<float, CASCADE_COUNT> splits;
+    for (uint32_t c = 0; c < CASCADE_COUNT; c++)
+    {
+        float p           = (c + 1) / (float)CASCADE_COUNT;
+        float logSplit    = nearClip * std::pow(shadowDistance / nearClip, p);
+        float linearSplit = nearClip + (shadowDistance - nearClip) * p;
+        splits[c]         = cascadeSplitLambda * logSplit + (1.0f - cascadeSplitLambda) * linearSplit;
+    }
+
+    // World space corners of the whole camera frustum. Slices are interpolated along the corner rays.
+    glm::mat4 inverseViewProjection = glm::inverse(InCameraProjection * InCameraView);
+    glm::vec3 nearCorners[4];
+    glm::vec3 farCorners[4];
+    for (int i = 0; i < 4; i++)
+    {
+        float     x         = (i & 1) ? 1.0f : -1.0f;
+        float     y         = (i & 2) ? 1.0f : -1.0f;
+        glm::vec4 nearPoint = inverseViewProjection * glm::vec4(x, y, -1.0f, 1.0f);
+        glm::vec4 farPoint  = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+        nearCorners[i]      = glm::vec3(nearPoint) / nearPoint.w;
+        farCorners[i]       = glm::vec3(farPoint) / farPoint.w;
+    }
+
+    // The light looks from its position towards the origin.
+    glm::vec3 lightDirection = glm::normalize(-glm::vec3(directionalLightPosition));
+    glm::vec3 up             = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    bool      lightMoved     = glm::distance(lightDirection, _CascadeLightDirection) > 0.0001f;
+    _CascadeLightDirection   = lightDirection;
+
+    uint32_t cascadeMask   = 0;
+    float    previousSplit = nearClip;
+    for (uint32_t c = 0; c < CASCADE_COUNT; c++)
+    {
+        float sliceStart = (previousSplit - nearClip) / (farClip - nearClip);
+        float sliceEnd   = (splits[c] - nearClip) / (farClip - nearClip);
+
+        glm::vec3 corners[8];
+        glm::vec3 center = glm::vec3(0.0f);
+        for (int i = 0; i < 4; i++)
+        {
+            corners[i]     = glm::mix(nearCorners[i], farCorners[i], sliceStart);
+            corners[i + 4] = glm::mix(nearCorners[i], farCorners[i], sliceEnd);
+            center += corners[i] + corners[i + 4];
+        }
+        center /= 8.0f;
+
+        // A bounding sphere does not change size when the camera rotates, which keeps the texel size constant.
+        float radius = 0.0f;
+        for (int i = 0; i < 8; i++)
+            radius = std::max(radius, glm::distance(corners[i], center));
+
+        // Cached cascades are fitted with some slack so that they stay valid while the camera moves around.
+        int   interval     = std::max(cascadeUpdateIntervals[c], 1);
+        float fittedRadius = interval > 1 ? radius * 1.25f : radius;
+        fittedRadius       = std::ceil(fittedRadius * 16.0f) / 16.0f;
+
+        bool intervalElapsed = frameCount % interval == 0;
+        bool leftBounds      = glm::distance(center, glm::vec3(_CascadeBounds[c])) + radius > _CascadeBounds[c].w;
+
+        if (!_CascadesInitialized || lightMoved || intervalElapsed || leftBounds)
+        {
+            float     casterExtension = std::max(cascadeCasterExtension, 0.0f);
+            glm::mat4 lightView       = glm::lookAt(center - lightDirection * (fittedRadius + casterExtension), center, up);
+            glm::mat4 lightProjection = glm::orthoRH_ZO(
+                -fittedRadius, fittedRadius, -fittedRadius, fittedRadius, 0.0f, 2.0f * fittedRadius + casterExtension);
+
+            // Snap the projection to whole shadow map texels to avoid shimmering edges when the camera moves.
+            glm::vec4 shadowOrigin  = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            shadowOrigin           *= CASCADE_SHADOW_DIM / 2.0f;
+            glm::vec4 roundedOffset = (glm::round(shadowOrigin) - shadowOrigin) * (2.0f / CASCADE_SHADOW_DIM);
+            lightProjection[3][0] += roundedOffset.x;
+            lightProjection[3][1] += roundedOffset.y;
+
+            _CascadeViewProjMatrices[c] = lightProjection * lightView;
+            _CascadeBounds[c]           = glm::vec4(center, fittedRadius);
+            cascadeMask |= 1u << c;
+        }
+
+        frameUBO.cascadeViewProjMatrices[c] = _CascadeViewProjMatrices[c];
+        frameUBO.cascadeSplits[c]           = splits[c];
+        previousSplit                       = splits[c];
+    }
+
+    _CascadesInitialized = true;
+
+    return cascadeMask;
+}
+
+void ForwardRenderer::ApplyFeatureToggles()
+{
+    TRACE_FUNCTION();
+
+    const bool postProcessChanged = enableBloom != _BloomActive || enableDepthOfField != _DepthOfFieldActive;
+
+    // Resources of a pass that is turned off are retired and only freed once the frames still reading them are done, so
+    // none of this waits on the GPU.
+    if (enableBloom != _BloomActive)
+    {
+        _BloomActive = enableBloom;
+        if (_BloomActive)
+            bloomAgent->Resize(HDRColorImage);
+        else
+            bloomAgent->ReleaseResources();
+    }
+
+    if (enableDepthOfField != _DepthOfFieldActive)
+    {
+        _DepthOfFieldActive = enableDepthOfField;
+        if (_DepthOfFieldActive)
+        {
+            CreateBokehFramebuffer();
+        }
+        else
+        {
+            _Context.GetDeletionQueue()->Retire(bokehPassFramebuffer);
+            _Context.GetDeletionQueue()->Retire(bokehPassImage);
+            bokehPassFramebuffer = nullptr;
+            bokehPassImage       = nullptr;
+        }
+    }
+
+    // The descriptor sets of frames in flight can't be rewritten, the final and bokeh passes get new ones instead.
+    if (postProcessChanged)
+        AllocatePostProcessDescriptorSets();
+
+    // The point shadow maps stay allocated, every material's descriptor set points at them. Only their passes are skipped,
+    // and the cubemaps are redrawn from scratch when the shadows come back.
+    if (pointLightShadows != _PointShadowsActive)
+    {
+        _PointShadowsActive                 = pointLightShadows;
+        staticUBO.enablePointLightShadows.x = _PointShadowsActive ? 1.0f : 0.0f;
+        if (_PointShadowsActive)
+        {
+            for (std::array<uint32_t, 6>& ages : _PointShadowFaceAges)
+                ages.fill(UINT32_MAX);
+        }
+    }
+}
+
+void ForwardRenderer::ApplyQualityPreset(int InPreset)
+{
+    qualityPreset              = InPreset;
+    enableBloom                = InPreset >= 1;
+    pointLightShadows          = InPreset >= 1;
+    enableDepthOfField         = InPreset >= 2;
+    directionalShadowPCFRadius = InPreset;
+    bokehRings                 = InPreset >= 2 ? 12 : 6;
 }
 
 void ForwardRenderer::SetupBokehPassPipeline()
@@ -1231,8 +1802,6 @@ void ForwardRenderer::SetupBokehPassPipeline()
     specs.PolygonMode             = VK_POLYGON_MODE_FILL;
     specs.VertexShaderPath        = "assets/shaders/quadRenderVERT.spv";
     specs.FragmentShaderPath      = "assets/shaders/bokehPassFRAG.spv";
-    specs.ViewportHeight          = bokehPassFramebuffer->GetHeight();
-    specs.ViewportWidth           = bokehPassFramebuffer->GetWidth();
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask =
@@ -1247,7 +1816,9 @@ void ForwardRenderer::SetupBokehPassPipeline()
 
     specs.ColorBlendAttachmentState          = colorBlendAttachment;
 
-    bokehPassPipeline                        = make_s<Pipeline>(_Context, specs);
+    bokehPassVariants                        = PipelineVariants(_Context, specs);
+
+    bokehPassPipeline = bokehPassVariants.Get({ (uint32_t)bokehRingSamples, (uint32_t)bokehRings, showDOFFocus });
 }
 void ForwardRenderer::CreateBokehRenderPass()
 {
@@ -1273,10 +1844,12 @@ void ForwardRenderer::CreateBokehRenderPass()
 
 void ForwardRenderer::CreateSwapchainFramebuffers()
 {
-    if (_SwapchainFramebuffers.size() > 0)
+    // Framebuffers of a previous swapchain may still be used by the frames in flight.
+    for (const Ref<Framebuffer>& framebuffer : _SwapchainFramebuffers)
     {
-        _SwapchainFramebuffers.clear();
+        _Context.GetDeletionQueue()->Retire(framebuffer);
     }
+    _SwapchainFramebuffers.clear();
 
     for (auto imageView : _Swapchain->GetImageViews())
     {
@@ -1295,6 +1868,10 @@ void ForwardRenderer::CreateSwapchainFramebuffers()
 
 void ForwardRenderer::CreateHDRFramebuffer()
 {
+    _Context.GetDeletionQueue()->Retire(_HDRFramebuffer);
+    _Context.GetDeletionQueue()->Retire(HDRColorImage);
+    _Context.GetDeletionQueue()->Retire(HDRDepthImage);
+
     HDRColorImage = make_s<Image>(
         _Context.GetSurface()->GetVKExtent().width,
         _Context.GetSurface()->GetVKExtent().height,
@@ -1320,6 +1897,9 @@ void ForwardRenderer::CreateHDRFramebuffer()
 
 void ForwardRenderer::CreateBokehFramebuffer()
 {
+    _Context.GetDeletionQueue()->Retire(bokehPassFramebuffer);
+    _Context.GetDeletionQueue()->Retire(bokehPassImage);
+
     bokehPassImage = make_s<Image>(
         _Context.GetSurface()->GetVKExtent().width,
         _Context.GetSurface()->GetVKExtent().height,
@@ -1351,17 +1931,18 @@ void ForwardRenderer::Cleanup()
     }
 
     vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
+    _Context.GetDeletionQueue()->Flush();
+
+    _GPUCulling.reset();
+    _ClusteredLights.reset();
+    _GPUProfiler.reset();
 
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
     {
         CommandBuffer::FreeCommandBuffer(cmdBuffers[i], cmdPool, _Context.GetDevice()->GetGraphicsQueue());
     }
     CommandBuffer::DestroyCommandPool(cmdPool);
-    vkDestroySampler(_Context.GetDevice()->GetVKDevice(), finalPassSampler, nullptr);
-    vkDestroySampler(_Context.GetDevice()->GetVKDevice(), bokehPassSceneSampler, nullptr);
-    vkDestroySampler(_Context.GetDevice()->GetVKDevice(), bokehPassDepthSampler, nullptr);
-    vkFreeMemory(_Context.GetDevice()->GetVKDevice(), globalParametersUBOBufferMemory, nullptr);
-    vkDestroyBuffer(_Context.GetDevice()->GetVKDevice(), globalParametersUBOBuffer, nullptr);
+    _GlobalUniforms.reset();
 
     ImGui_ImplVulkan_DestroyFontUploadObjects();
 
@@ -1384,6 +1965,8 @@ void ForwardRenderer::UpdateViewport_Scissor()
 
 void ForwardRenderer::InitImGui()
 {
+    TRACE_FUNCTION();
+
     VkDescriptorPoolSize pool_sizes[]    = { { VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
                                              { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
                                              { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
@@ -1409,7 +1992,12 @@ void ForwardRenderer::InitImGui()
 
     ImGui::CreateContext();
 
-    ImGui_ImplGlfw_InitForVulkan(_Context.GetWindow()->GetNativeWindow(), true);
+    // Without a window there is no platform backend. RenderImGui feeds the display size and time step itself.
+    if (_Context.IsHeadless())
+        ImGui::GetIO().DisplaySize = ImVec2(
+            (float)_Context.GetSurface()->GetVKExtent().width, (float)_Context.GetSurface()->GetVKExtent().height);
+    else
+        ImGui_ImplGlfw_InitForVulkan(_Context.GetWindow()->GetNativeWindow(), true);
 
     init_info.Instance       = _Context.GetInstance()->GetVkInstance();
     init_info.PhysicalDevice = _Context.GetPhysicalDevice()->GetVKPhysicalDevice();
@@ -1450,13 +2038,30 @@ void ForwardRenderer::InitImGui()
 
 void ForwardRenderer::RenderFrame(const float InDeltaTime)
 {
+    TRACE_FUNCTION();
+
     _DeltaTime = InDeltaTime;
     // Begin command buffer recording.
     CommandBuffer::BeginRecording(cmdBuffers[_CurrentBufferIndex]);
 
+    // Reads back the timings this frame slot recorded last time, its fence was waited on in BeginFrame.
+    _GPUProfiler->SetEnabled(gpuProfiling);
+    _GPUProfiler->BeginFrame(cmdBuffers[_CurrentBufferIndex], _CurrentBufferIndex);
+    _GPUProfiler->BeginScope(cmdBuffers[_CurrentBufferIndex], "Frame");
+
     // Timer.
     timer += 7.0f * _DeltaTime;
 
+    // Instance changes of this frame go to the slices of this frame slot, its fence was waited on in BeginFrame. The same
+    // holds for the frame slot's copy of the global uniform blocks, which every set of the frame is bound with.
+    const uint32_t uniformOffset = _GlobalUniforms->GetDynamicOffset(_CurrentBufferIndex);
+    model->BeginFrame(_CurrentBufferIndex, uniformOffset);
+    model2->BeginFrame(_CurrentBufferIndex, uniformOffset);
+    model3->BeginFrame(_CurrentBufferIndex, uniformOffset);
+    torch->BeginFrame(_CurrentBufferIndex, uniformOffset);
+    skybox->BeginFrame(_CurrentBufferIndex, uniformOffset);
+    cube->BeginFrame(_CurrentBufferIndex, uniformOffset);
+
     // Update model matrices here.
     model2->Rotate(2.0f * _DeltaTime, 0, 1, 0);
 
@@ -1471,13 +2076,9 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
     fireBase4->UpdateParticles(_DeltaTime);
     ambientParticles->UpdateParticles(_DeltaTime);
 
-    // Animating the directional light
-    glm::mat4 directionalLightMVP = directionalLightProjectionMatrix *
-        glm::lookAt(glm::vec3(directionalLightPosition.x, directionalLightPosition.y, directionalLightPosition.z),
-                    glm::vec3(0.0f),
-                    glm::vec3(0.0f, 1.0f, 0.0f));
-
     // General data.
+    // CPU side work that depends on the camera (culling, cascade fitting, shadow scheduling, particle sorting) uses the camera
+    // as of recording. The GPU gets the one latched at submit.
     glm::mat4 cameraView = _Camera->GetViewMatrix();
     glm::mat4 cameraProj = _Camera->GetProjectionMatrix();
     glm::vec4 cameraPos  = glm::vec4(_Camera->GetPosition(), 1.0f);
@@ -1485,24 +2086,18 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
     glm::mat4 mat2       = model2->GetTransform();
 
     // Update some of parts of the global UBO buffer
-    globalParametersUBO.viewMatrix          = cameraView;
-    globalParametersUBO.projMatrix          = cameraProj;
-    globalParametersUBO.cameraPosition      = cameraPos;
-    globalParametersUBO.dirLightPos         = directionalLightPosition;
-    globalParametersUBO.directionalLightMVP = directionalLightMVP;
-    globalParametersUBO.viewportDimension =
-        glm::vec4(_Context.GetSurface()->GetVKExtent().width, _Context.GetSurface()->GetVKExtent().height, 0.0f, 0.0f);
-    globalParametersUBO.DOFFramebufferSize.x = bokehPassFramebuffer->GetWidth();
-    globalParametersUBO.DOFFramebufferSize.y = bokehPassFramebuffer->GetHeight();
+    frameUBO.dirLightPos           = directionalLightPosition;
+    staticUBO.DOFFramebufferSize.x = _Context.GetSurface()->GetVKExtent().width;
+    staticUBO.DOFFramebufferSize.y = _Context.GetSurface()->GetVKExtent().height;
 
     // Update point light positions. (Connected to the torch models.)
-    globalParametersUBO.pointLightPositions[0] =
+    pointLightPositions[0] =
         glm::vec4(glm::vec3(torch1modelMatrix[3].x, torch1modelMatrix[3].y + 0.22f, torch1modelMatrix[3].z - 0.02f), 1.0f);
-    globalParametersUBO.pointLightPositions[1] =
+    pointLightPositions[1] =
         glm::vec4(glm::vec3(torch2modelMatrix[3].x, torch2modelMatrix[3].y + 0.22f, torch2modelMatrix[3].z + 0.02f), 1.0f);
-    globalParametersUBO.pointLightPositions[2] =
+    pointLightPositions[2] =
         glm::vec4(glm::vec3(torch3modelMatrix[3].x, torch3modelMatrix[3].y + 0.22f, torch3modelMatrix[3].z - 0.02f), 1.0f);
-    globalParametersUBO.pointLightPositions[3] =
+    pointLightPositions[3] =
         glm::vec4(glm::vec3(torch4modelMatrix[3].x, torch4modelMatrix[3].y + 0.22f, torch4modelMatrix[3].z + 0.02f), 1.0f);
 
     // Update Particle system positions. (Connected to the torch models)
@@ -1529,75 +2124,275 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
     if (lightFlickerRate <= 0.0f)
     {
         lightFlickerRate = 0.1f;
-        std::random_device               rd;
-        std::mt19937                     gen(rd());
         std::uniform_real_distribution<> distr(25.0f, 50.0f);
         std::uniform_real_distribution<> distr2(75.0f, 100.0f);
         std::uniform_real_distribution<> distr3(12.5f, 25.0f);
         std::uniform_real_distribution<> distr4(25.0f, 50.0f);
-        globalParametersUBO.pointLightIntensities[0] = glm::vec4(distr(gen) / 2);
-        globalParametersUBO.pointLightIntensities[1] = glm::vec4(distr2(gen) / 2);
-        globalParametersUBO.pointLightIntensities[2] = glm::vec4(distr3(gen) / 2);
-        globalParametersUBO.pointLightIntensities[3] = glm::vec4(distr4(gen) / 2);
-        globalParametersUBO.pointLightIntensities[4] = glm::vec4(500.0f);
+        pointLightIntensities[0] = glm::vec4(distr(gen) / 2);
+        pointLightIntensities[1] = glm::vec4(distr2(gen) / 2);
+        pointLightIntensities[2] = glm::vec4(distr3(gen) / 2);
+        pointLightIntensities[3] = glm::vec4(distr4(gen) / 2);
+        pointLightIntensities[4] = glm::vec4(500.0f);
     }
 
-    if (globalParametersUBO.enablePointLightShadows.x == 1.0f)
+    const bool useGPUCulling = gpuDrivenDraws && _GPUCulling;
+
+    // Shader permutations of the current settings. Must match the specialization constants of PBRShader.frag and
+    // bokehPass.frag.
+    const std::vector<uint32_t> PBRConstants = { _PointShadowsActive, (uint32_t)directionalShadowPCFRadius };
+    pipeline                                 = PBRVariants.Get(PBRConstants);
+    depthEqualPipeline                       = depthEqualVariants.Get(PBRConstants);
+
+    bokehPassPipeline = bokehPassVariants.Get({ (uint32_t)bokehRingSamples, (uint32_t)bokehRings, showDOFFocus });
+
+    // Cascades that are still valid keep last frame's depth and matrices.
+    uint32_t cascadeMask = UpdateShadowCascades(cameraView, cameraProj);
+
+    // Point light cubemap matrices. Needed before GPU culling, the per face draws are culled against them.
+    for (int i = 0; i < pointLightCount; i++)
     {
-        // Shadow passes ---------
-        glm::mat4 mat  = model->GetTransform();
-        glm::mat4 mat2 = model2->GetTransform();
+        glm::vec3 position = glm::vec3(pointLightPositions[i]);
+
+        pointShadowUBO.shadowMatrices[i][0] = pointLightProjectionMatrix *
+            glm::lookAt(position, position + glm::vec3(1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0));
+        pointShadowUBO.shadowMatrices[i][1] = pointLightProjectionMatrix *
+            glm::lookAt(position, position + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0));
+        pointShadowUBO.shadowMatrices[i][2] =
+            pointLightProjectionMatrix * glm::lookAt(position, position + glm::vec3(0.0, 1.0, 0.0), glm::vec3(0.0, 0.0, 1.0));
+        pointShadowUBO.shadowMatrices[i][3] = pointLightProjectionMatrix *
+            glm::lookAt(position, position + glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, -1.0));
+        pointShadowUBO.shadowMatrices[i][4] = pointLightProjectionMatrix *
+            glm::lookAt(position, position + glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, -1.0, 0.0));
+        pointShadowUBO.shadowMatrices[i][5] = pointLightProjectionMatrix *
+            glm::lookAt(position, position + glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, -1.0, 0.0));
+    }
 
-        // Start shadow pass.---------------------------------------------
-        _ShadowMapRenderPass->Begin(cmdBuffers[_CurrentBufferIndex], *_DirectionalShadowMapFramebuffer);
-        CommandBuffer::BindPipeline(cmdBuffers[_CurrentBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPassPipeline);
+    // GPU culling has to run before the first render pass. Every view of the frame is culled in one go.
+    if (useGPUCulling)
+    {
+        _GPUCulling->SetView(GPU_CULL_VIEW_CAMERA, Frustum(cameraProj * cameraView));
+        for (uint32_t c = 0; c < CASCADE_COUNT; c++)
+        {
+            _GPUCulling->SetView(GPU_CULL_VIEW_FIRST_CASCADE + c, Frustum(_CascadeViewProjMatrices[c]));
+        }
+        // Per face draws cull against the frustum of their face. The geometry shader renders every face in one draw, so
+        // that path uses the first view of the light with a box around everything within its far plane.
+        for (int i = 0; i < pointLightCount; i++)
+        {
+            const uint32_t firstView = GPU_CULL_VIEW_FIRST_POINT_LIGHT + i * 6;
+            if (pointShadowPerFaceDraws)
+            {
+                for (uint32_t face = 0; face < 6; face++)
+                    _GPUCulling->SetView(firstView + face, Frustum(pointShadowUBO.shadowMatrices[i][face]));
+            }
+            else
+            {
+                glm::vec3 position = glm::vec3(pointLightPositions[i]);
+                glm::vec3 extent   = glm::vec3(pointFarPlane);
+                _GPUCulling->SetView(firstView, Frustum(position - extent, position + extent));
+            }
+        }
+        GPUProfileScope scope(_GPUProfiler.get(), cmdBuffers[_CurrentBufferIndex], "GPU culling");
+        _GPUCulling->Dispatch(cmdBuffers[_CurrentBufferIndex], _CurrentBufferIndex);
+    }
+
+    // Binds one of the PBR model pipelines. Bindless pipelines also need the global set, once per pipeline bind.
+    auto bindModelPipeline = [&](const Ref<Pipeline>& modelPipeline)
+    {
+        CommandBuffer::BindPipeline(cmdBuffers[_CurrentBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, modelPipeline);
+        if (_BindlessMaterials)
+            _BindlessMaterials->Bind(cmdBuffers[_CurrentBufferIndex], modelPipeline->GetPipelineLayout(), uniformOffset);
+    };
+
+    // Draws a PBR model with the GPU culled commands of the given view, or with the CPU path when GPU culling is off.
+    auto drawModel = [&](const Ref<Model>& target, VkPipelineLayout pipelineLayout, uint32_t gpuCullView, const Frustum* frustum)
+    {
+        if (useGPUCulling)
+            _GPUCulling->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipelineLayout, target, gpuCullView);
+        else if (frustum)
+            target->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipelineLayout, *frustum);
+        else
+            target->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipelineLayout);
+    };
+
+    // Shadow passes ---------
+    // Start shadow pass.---------------------------------------------
+    _GPUProfiler->BeginScope(cmdBuffers[_CurrentBufferIndex], "Directional shadows");
+    for (uint32_t c = 0; c < CASCADE_COUNT; c++)
+    {
+        if (!(cascadeMask & (1u << c)))
+            continue;
+
+        TRACE_ZONE("Record shadow cascade");
+        Frustum cascadeFrustum(_CascadeViewProjMatrices[c]);
+
+        _ShadowMapRenderPass->Begin(cmdBuffers[_CurrentBufferIndex], *_CascadeShadowMapFramebuffers[c]);
+        bindModelPipeline(shadowPassPipeline);
 
         // Render the objects you want to cast shadows.
+        glm::mat4 pushConstants[2] = { mat, _CascadeViewProjMatrices[c] };
         CommandBuffer::PushConstants(
             cmdBuffers[_CurrentBufferIndex],
             shadowPassPipeline->GetPipelineLayout(),
             VK_SHADER_STAGE_VERTEX_BIT,
             0,
-            sizeof(glm::mat4),
-            &mat);
-        model->DrawIndexed(cmdBuffers[_CurrentBufferIndex], shadowPassPipeline->GetPipelineLayout());
+            sizeof(pushConstants),
+            pushConstants);
+        drawModel(model, shadowPassPipeline->GetPipelineLayout(), GPU_CULL_VIEW_FIRST_CASCADE + c, &cascadeFrustum);
 
+        pushConstants[0] = mat2;
         CommandBuffer::PushConstants(
             cmdBuffers[_CurrentBufferIndex],
             shadowPassPipeline->GetPipelineLayout(),
             VK_SHADER_STAGE_VERTEX_BIT,
             0,
-            sizeof(glm::mat4),
-            &mat2);
-        model2->DrawIndexed(cmdBuffers[_CurrentBufferIndex], shadowPassPipeline->GetPipelineLayout());
+            sizeof(pushConstants),
+            pushConstants);
+        drawModel(model2, shadowPassPipeline->GetPipelineLayout(), GPU_CULL_VIEW_FIRST_CASCADE + c, &cascadeFrustum);
 
         _ShadowMapRenderPass->End(cmdBuffers[_CurrentBufferIndex]);
-        //   End shadow pass.---------------------------------------------
+    }
+    _GPUProfiler->EndScope(cmdBuffers[_CurrentBufferIndex]);
+    //   End shadow pass.---------------------------------------------
+
+    if (_PointShadowsActive)
+    {
+        GPUProfileScope pointShadowsScope(_GPUProfiler.get(), cmdBuffers[_CurrentBufferIndex], "Point shadows");
 
         // Start point shadow pass.--------------------
-        for (int i = 0; i < globalParametersUBO.pointLightCount.x; i++)
+        // Only a fixed budget of cubemap faces is re-rendered each frame, the rest keep their previous contents.
+        std::vector<uint32_t> faceMasks = SchedulePointShadowFaces(glm::vec3(cameraPos));
+        for (int i = 0; i < pointLightCount; i++)
         {
-            _PointShadowRenderPass->Begin(cmdBuffers[_CurrentBufferIndex], *_PointShadowMapFramebuffers[i]);
-            CommandBuffer::BindPipeline(
-                cmdBuffers[_CurrentBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pointShadowPassPipeline);
+            TRACE_ZONE("Record point light shadow");
+            GPUProfileScope lightScope(_GPUProfiler.get(), cmdBuffers[_CurrentBufferIndex], "Point light " + std::to_string(i));
 
             glm::vec3 position = glm::vec3(
-                globalParametersUBO.pointLightPositions[i].x,
-                globalParametersUBO.pointLightPositions[i].y,
-                globalParametersUBO.pointLightPositions[i].z);
-
-            globalParametersUBO.shadowMatrices[i][0] = pointLightProjectionMatrix *
-                glm::lookAt(position, position + glm::vec3(1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0));
-            globalParametersUBO.shadowMatrices[i][1] = pointLightProjectionMatrix *
-                glm::lookAt(position, position + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0, -1.0, 0.0));
-            globalParametersUBO.shadowMatrices[i][2] =
-                pointLightProjectionMatrix * glm::lookAt(position, position + glm::vec3(0.0, 1.0, 0.0), glm::vec3(0.0, 0.0, 1.0));
-            globalParametersUBO.shadowMatrices[i][3] = pointLightProjectionMatrix *
-                glm::lookAt(position, position + glm::vec3(0.0, -1.0, 0.0), glm::vec3(0.0, 0.0, -1.0));
-            globalParametersUBO.shadowMatrices[i][4] = pointLightProjectionMatrix *
-                glm::lookAt(position, position + glm::vec3(0.0, 0.0, 1.0), glm::vec3(0.0, -1.0, 0.0));
-            globalParametersUBO.shadowMatrices[i][5] = pointLightProjectionMatrix *
-                glm::lookAt(position, position + glm::vec3(0.0, 0.0, -1.0), glm::vec3(0.0, -1.0, 0.0));
+                pointLightPositions[i].x,
+                pointLightPositions[i].y,
+                pointLightPositions[i].z);
+
+            const uint32_t faceMask = faceMasks[i];
+
+            if (pointShadowPerFaceDraws)
+            {
+                struct FacePC
+                {
+                    glm::vec4 lightPos;
+                    glm::vec4 farPlane;
+                };
+
+                FacePC facePC;
+                facePC.lightPos = glm::vec4(position, 1.0f);
+                facePC.farPlane = glm::vec4(pointFarPlane);
+
+                for (uint32_t face = 0; face < 6; face++)
+                {
+                    // Faces that are not scheduled are skipped, except for the very first frame where every face has to
+                    // be cleared once to get the whole cubemap into a readable layout.
+                    const bool scheduled = faceMask & (1u << face);
+                    if (!scheduled && _PointShadowMapInitialized[i])
+                        continue;
+
+                    _PointShadowRenderPass->Begin(cmdBuffers[_CurrentBufferIndex], *_PointShadowFaceFramebuffers[i][face]);
+                    if (scheduled)
+                    {
+                        bindModelPipeline(pointShadowPassPerFacePipeline);
+
+                        Frustum faceFrustum(pointShadowUBO.shadowMatrices[i][face]);
+
+                        // x: light index, y: the cubemap face this draw renders to.
+                        glm::vec4 faceIndex = glm::vec4(i, face, 0.0f, 0.0f);
+
+                        CommandBuffer::PushConstants(
+                            cmdBuffers[_CurrentBufferIndex],
+                            pointShadowPassPerFacePipeline->GetPipelineLayout(),
+                            VK_SHADER_STAGE_FRAGMENT_BIT,
+                            sizeof(glm::mat4) + sizeof(glm::vec4),
+                            sizeof(glm::vec4) + sizeof(glm::vec4),
+                            &facePC);
+                        CommandBuffer::PushConstants(
+                            cmdBuffers[_CurrentBufferIndex],
+                            pointShadowPassPerFacePipeline->GetPipelineLayout(),
+                            VK_SHADER_STAGE_VERTEX_BIT,
+                            sizeof(glm::mat4),
+                            sizeof(glm::vec4),
+                            &faceIndex);
+
+                        CommandBuffer::PushConstants(
+                            cmdBuffers[_CurrentBufferIndex],
+                            pointShadowPassPerFacePipeline->GetPipelineLayout(),
+                            VK_SHADER_STAGE_VERTEX_BIT,
+                            0,
+                            sizeof(glm::mat4),
+                            &mat);
+                        drawModel(
+                            model,
+                            pointShadowPassPerFacePipeline->GetPipelineLayout(),
+                            GPU_CULL_VIEW_FIRST_POINT_LIGHT + i * 6 + face,
+                            &faceFrustum);
+
+                        CommandBuffer::PushConstants(
+                            cmdBuffers[_CurrentBufferIndex],
+                            pointShadowPassPerFacePipeline->GetPipelineLayout(),
+                            VK_SHADER_STAGE_VERTEX_BIT,
+                            0,
+                            sizeof(glm::mat4),
+                            &mat2);
+                        drawModel(
+                            model2,
+                            pointShadowPassPerFacePipeline->GetPipelineLayout(),
+                            GPU_CULL_VIEW_FIRST_POINT_LIGHT + i * 6 + face,
+                            &faceFrustum);
+                    }
+                    _PointShadowRenderPass->End(cmdBuffers[_CurrentBufferIndex]);
+                }
+                _PointShadowMapInitialized[i] = true;
+                continue;
+            }
+
+            // A map that was never written has to go through the clearing pass once, even if none of its faces were
+            // picked, so that it is in a valid layout when the PBR pass samples it.
+            if (faceMask == 0 && _PointShadowMapInitialized[i])
+                continue;
+
+            RenderPass* shadowPass = _PointShadowRenderPass.get();
+            if (faceMask == 0x3F || !_PointShadowMapInitialized[i])
+            {
+                shadowPass->Begin(cmdBuffers[_CurrentBufferIndex], *_PointShadowMapFramebuffers[i]);
+                _PointShadowMapInitialized[i] = true;
+
+                if (faceMask == 0)
+                {
+                    shadowPass->End(cmdBuffers[_CurrentBufferIndex]);
+                    continue;
+                }
+            }
+            else
+            {
+                shadowPass = _PointShadowPartialRenderPass.get();
+                shadowPass->Begin(cmdBuffers[_CurrentBufferIndex], *_PointShadowMapFramebuffers[i]);
+
+                // Clear only the layers we are about to redraw.
+                VkClearAttachment clearAttachment{};
+                clearAttachment.aspectMask              = VK_IMAGE_ASPECT_DEPTH_BIT;
+                clearAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+                std::vector<VkClearRect> clearRects;
+                for (uint32_t face = 0; face < 6; face++)
+                {
+                    if ((faceMask & (1u << face)) == 0)
+                        continue;
+                    VkClearRect rect{};
+                    rect.rect.extent    = { POUNT_SHADOW_DIM, POUNT_SHADOW_DIM };
+                    rect.baseArrayLayer = face;
+                    rect.layerCount     = 1;
+                    clearRects.push_back(rect);
+                }
+                vkCmdClearAttachments(
+                    cmdBuffers[_CurrentBufferIndex], 1, &clearAttachment, (uint32_t)clearRects.size(), clearRects.data());
+            }
+            bindModelPipeline(pointShadowPassPipeline);
 
             struct PC
             {
@@ -1605,7 +2400,8 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
                 glm::vec4 farPlane;
             };
 
-            glm::vec4 pointLightIndex = glm::vec4(i);
+            // x: light index, y: mask of the faces the geometry shader should emit.
+            glm::vec4 pointLightIndex = glm::vec4(i, faceMask, 0.0f, 0.0f);
 
             PC pc;
             pc.lightPos = glm::vec4(position, 1.0f);
@@ -1632,7 +2428,7 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
                 sizeof(glm::mat4) + sizeof(glm::vec4),
                 sizeof(glm::vec4) + sizeof(glm::vec4),
                 &pc);
-            model->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pointShadowPassPipeline->GetPipelineLayout());
+            drawModel(model, pointShadowPassPipeline->GetPipelineLayout(), GPU_CULL_VIEW_FIRST_POINT_LIGHT + i * 6, nullptr);
 
             CommandBuffer::PushConstants(
                 cmdBuffers[_CurrentBufferIndex],
@@ -1655,16 +2451,18 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
                 sizeof(glm::mat4) + sizeof(glm::vec4),
                 sizeof(glm::vec4) + sizeof(glm::vec4),
                 &pc);
-            model2->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pointShadowPassPipeline->GetPipelineLayout());
+            drawModel(model2, pointShadowPassPipeline->GetPipelineLayout(), GPU_CULL_VIEW_FIRST_POINT_LIGHT + i * 6, nullptr);
 
-            _PointShadowRenderPass->End(cmdBuffers[_CurrentBufferIndex]);
+            shadowPass->End(cmdBuffers[_CurrentBufferIndex]);
             //   End point shadow pass.----------------------
         }
         // Shadow passes end  ----
     }
 
-    // Copy the global UBO data from CPU to GPU.
-    memcpy(mappedGlobalParametersModelUBOBuffer, &globalParametersUBO, sizeof(GlobalParametersUBO));
+    // Copy the global uniform blocks from CPU to GPU. Only the parts that changed since the last upload are written.
+    _UniformUploadSize = _GlobalUniforms->Upload(GLOBAL_BLOCK_FRAME, _CurrentBufferIndex, &frameUBO);
+    _UniformUploadSize += _GlobalUniforms->Upload(GLOBAL_BLOCK_POINT_SHADOW, _CurrentBufferIndex, &pointShadowUBO);
+    _UniformUploadSize += _GlobalUniforms->Upload(GLOBAL_BLOCK_STATIC, _CurrentBufferIndex, &staticUBO);
 
     // TO DO: The animation sprite sheet offsets are hardcoded here. We
     // could use a better system to automatically calculate these variables.
@@ -1708,8 +2506,62 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
         }
         ct++;
     }
+    // The torch matrices live in the instance buffer, they are needed by the depth pre-pass already.
+    torch->SetInstance(0, torch1modelMatrix);
+    torch->SetInstance(1, torch2modelMatrix);
+    torch->SetInstance(2, torch3modelMatrix);
+    torch->SetInstance(3, torch4modelMatrix);
+
     // Begin HDR rendering------------------------------------------
+    _GPUProfiler->BeginScope(cmdBuffers[_CurrentBufferIndex], "HDR");
     _HDRRenderPass->Begin(cmdBuffers[_CurrentBufferIndex], *_HDRFramebuffer);
+
+    // Depth pre-pass of the PBR models. Models are drawn front to back by the distance to their closest point, and the
+    // meshes of each model are sorted the same way on the CPU path.
+    if (depthPrepass)
+    {
+        glm::vec3                 viewPosition = glm::vec3(cameraPos);
+        std::array<Ref<Model>, 3> opaqueModels = { model, model2, torch };
+        std::array<float, 3>      distances;
+        for (size_t i = 0; i < opaqueModels.size(); i++)
+        {
+            glm::vec3 worldMin;
+            glm::vec3 worldMax;
+            opaqueModels[i]->GetWorldBounds(worldMin, worldMax);
+            distances[i] = glm::length(glm::clamp(viewPosition, worldMin, worldMax) - viewPosition);
+        }
+        std::array<int, 3> order = { 0, 1, 2 };
+        std::sort(order.begin(), order.end(), [&distances](int a, int b) { return distances[a] < distances[b]; });
+
+        bindModelPipeline(depthPrepassPipeline);
+        vkCmdSetViewport(cmdBuffers[_CurrentBufferIndex], 0, 1, &_DynamicViewport);
+        vkCmdSetScissor(cmdBuffers[_CurrentBufferIndex], 0, 1, &_DynamicScissor);
+        for (const auto& i : order)
+        {
+            glm::mat4 transform = opaqueModels[i]->GetTransform();
+            CommandBuffer::PushConstants(
+                cmdBuffers[_CurrentBufferIndex],
+                depthPrepassPipeline->GetPipelineLayout(),
+                VK_SHADER_STAGE_VERTEX_BIT,
+                0,
+                sizeof(glm::mat4),
+                &transform);
+            if (useGPUCulling)
+            {
+                _GPUCulling->DrawIndexed(
+                    cmdBuffers[_CurrentBufferIndex],
+                    depthPrepassPipeline->GetPipelineLayout(),
+                    opaqueModels[i],
+                    GPU_CULL_VIEW_CAMERA,
+                    true);
+            }
+            else
+            {
+                opaqueModels[i]->DrawDepthOnly(
+                    cmdBuffers[_CurrentBufferIndex], depthPrepassPipeline->GetPipelineLayout(), viewPosition);
+            }
+        }
+    }
     //  Drawing the skybox.
     glm::mat4 skyBoxView = glm::mat4(glm::mat3(cameraView));
     CommandBuffer::BindPipeline(cmdBuffers[_CurrentBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, skyboxPipeline);
@@ -1737,9 +2589,9 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
     lightCubeMat           = glm::translate(
         lightCubeMat,
         glm::vec3(
-            globalParametersUBO.pointLightPositions[4].x,
-            globalParametersUBO.pointLightPositions[4].y,
-            globalParametersUBO.pointLightPositions[4].z));
+            pointLightPositions[4].x,
+            pointLightPositions[4].y,
+            pointLightPositions[4].z));
     lightCubeMat         = glm::scale(lightCubeMat, glm::vec3(0.05f));
     lightCubePC.modelMat = lightCubeMat;
     lightCubePC.color    = glm::vec4(4.5f, 1.0f, 1.0f, 1.0f);
@@ -1765,58 +2617,40 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
     cloudsPC.modelMat   = cloudsMat;
     cloudsPC.color      = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 
-    // Drawing the Sponza.
-    CommandBuffer::BindPipeline(cmdBuffers[_CurrentBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    // Drawing the Sponza. After a depth pre-pass only the visible fragments are shaded.
+    const Ref<Pipeline>& PBRPipeline = depthPrepass ? depthEqualPipeline : pipeline;
+    bindModelPipeline(PBRPipeline);
     vkCmdSetViewport(cmdBuffers[_CurrentBufferIndex], 0, 1, &_DynamicViewport);
     vkCmdSetScissor(cmdBuffers[_CurrentBufferIndex], 0, 1, &_DynamicScissor);
     CommandBuffer::PushConstants(
-        cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &mat);
-    model->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout());
+        cmdBuffers[_CurrentBufferIndex],
+        PBRPipeline->GetPipelineLayout(),
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0,
+        sizeof(glm::mat4),
+        &mat);
+    drawModel(model, PBRPipeline->GetPipelineLayout(), GPU_CULL_VIEW_CAMERA, nullptr);
 
     // Drawing the helmet.
     CommandBuffer::PushConstants(
-        cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &mat2);
-    model2->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout());
-
-    // Drawing 4 torches.
-    for (int i = 0; i < torch->GetMeshCount(); i++)
-    {
-        CommandBuffer::PushConstants(
-            cmdBuffers[_CurrentBufferIndex],
-            pipeline->GetPipelineLayout(),
-            VK_SHADER_STAGE_VERTEX_BIT,
-            0,
-            sizeof(glm::mat4),
-            &torch1modelMatrix);
-        torch->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout());
-
-        CommandBuffer::PushConstants(
-            cmdBuffers[_CurrentBufferIndex],
-            pipeline->GetPipelineLayout(),
-            VK_SHADER_STAGE_VERTEX_BIT,
-            0,
-            sizeof(glm::mat4),
-            &torch2modelMatrix);
-        torch->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout());
-
-        CommandBuffer::PushConstants(
-            cmdBuffers[_CurrentBufferIndex],
-            pipeline->GetPipelineLayout(),
-            VK_SHADER_STAGE_VERTEX_BIT,
-            0,
-            sizeof(glm::mat4),
-            &torch3modelMatrix);
-        torch->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout());
+        cmdBuffers[_CurrentBufferIndex],
+        PBRPipeline->GetPipelineLayout(),
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0,
+        sizeof(glm::mat4),
+        &mat2);
+    drawModel(model2, PBRPipeline->GetPipelineLayout(), GPU_CULL_VIEW_CAMERA, nullptr);
 
-        CommandBuffer::PushConstants(
-            cmdBuffers[_CurrentBufferIndex],
-            pipeline->GetPipelineLayout(),
-            VK_SHADER_STAGE_VERTEX_BIT,
-            0,
-            sizeof(glm::mat4),
-            &torch4modelMatrix);
-        torch->DrawIndexed(cmdBuffers[_CurrentBufferIndex], pipeline->GetPipelineLayout());
-    }
+    // Drawing 4 torches. One instanced draw per batch.
+    glm::mat4 torchMat = torch->GetTransform();
+    CommandBuffer::PushConstants(
+        cmdBuffers[_CurrentBufferIndex],
+        PBRPipeline->GetPipelineLayout(),
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0,
+        sizeof(glm::mat4),
+        &torchMat);
+    drawModel(torch, PBRPipeline->GetPipelineLayout(), GPU_CULL_VIEW_CAMERA, nullptr);
 
     pushConst swordPC;
     // Draw the emissive sword.
@@ -1853,10 +2687,10 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
         0,
         sizeof(glm::vec4),
         &sparkBrigtness);
-    fireSparks->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
-    fireSparks2->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
-    fireSparks3->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
-    fireSparks4->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
+    fireSparks->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
+    fireSparks2->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
+    fireSparks3->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
+    fireSparks4->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
 
     CommandBuffer::PushConstants(
         cmdBuffers[_CurrentBufferIndex],
@@ -1865,10 +2699,10 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
         0,
         sizeof(glm::vec4),
         &flameBrigthness);
-    fireBase->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
-    fireBase2->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
-    fireBase3->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
-    fireBase4->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
+    fireBase->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
+    fireBase2->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
+    fireBase3->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
+    fireBase4->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
 
     CommandBuffer::PushConstants(
         cmdBuffers[_CurrentBufferIndex],
@@ -1877,17 +2711,24 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
         0,
         sizeof(glm::vec4),
         &dustBrigthness);
-    ambientParticles->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout());
+    ambientParticles->Draw(cmdBuffers[_CurrentBufferIndex], particleSystemPipeline->GetPipelineLayout(), uniformOffset);
 
     _HDRRenderPass->End(cmdBuffers[_CurrentBufferIndex]);
+    _GPUProfiler->EndScope(cmdBuffers[_CurrentBufferIndex]);
     //   End HDR Rendering ------------------------------------------
 
     // Post processing begin ---------------------------
 
-    bloomAgent->ApplyBloom(cmdBuffers[_CurrentBufferIndex]);
+    if (_BloomActive)
+    {
+        GPUProfileScope scope(_GPUProfiler.get(), cmdBuffers[_CurrentBufferIndex], "Bloom");
+        bloomAgent->ApplyBloom(cmdBuffers[_CurrentBufferIndex], _GPUProfiler.get());
+    }
 
-    if (enableDepthOfField)
+    if (_DepthOfFieldActive)
     {
+        GPUProfileScope scope(_GPUProfiler.get(), cmdBuffers[_CurrentBufferIndex], "Bokeh");
+
         //// Bokeh Pass start---------------------
 
         bokehRenderPass->Begin(cmdBuffers[_CurrentBufferIndex], *bokehPassFramebuffer);
@@ -1903,8 +2744,8 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
             0,
             1,
             &bokehDescriptorSet,
-            0,
-            nullptr);
+            1,
+            &uniformOffset);
         vkCmdDraw(cmdBuffers[_CurrentBufferIndex], 3, 1, 0, 0);
 
         bokehRenderPass->End(cmdBuffers[_CurrentBufferIndex]);
@@ -1967,39 +2808,160 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
 
     ImGui::DragFloat3("Torch 4", *t4, 0.01f, -10, 10);
 
-    float* p3[3] = { &globalParametersUBO.pointLightPositions[4].x,
-                     &globalParametersUBO.pointLightPositions[4].y,
-                     &globalParametersUBO.pointLightPositions[4].z };
+    float* p3[3] = { &pointLightPositions[4].x,
+                     &pointLightPositions[4].y,
+                     &pointLightPositions[4].z };
 
     ImGui::DragFloat3("point light", *p3, 0.01f, -10, 10);
 
-    if (ImGui::Checkbox("Point light shadows", &pointLightShadows))
+    const char* qualityPresets[] = { "Low", "Medium", "High" };
+    if (ImGui::Combo("Quality preset", &qualityPreset, qualityPresets, IM_ARRAYSIZE(qualityPresets)))
+        ApplyQualityPreset(qualityPreset);
+
+    ImGui::Checkbox("Point light shadows", &pointLightShadows);
+
+    ImGui::SliderInt("Point shadow faces / frame", &pointShadowFaceBudget, 0, MAX_POINT_LIGHT_COUNT * 6);
+    ImGui::Checkbox("Point shadows: per-face draws", &pointShadowPerFaceDraws);
+    ImGui::BeginDisabled(!_GPUCulling);
+    ImGui::Checkbox("GPU-driven draws", &gpuDrivenDraws);
+    ImGui::EndDisabled();
+    ImGui::Checkbox("Depth pre-pass", &depthPrepass);
+    ImGui::SliderInt("Decorative lights", &decorativeLightCount, 0, MAX_DECORATIVE_LIGHTS);
+    ImGui::DragFloat("Shadow distance", &cascadeShadowDistance, 0.5f, 1.0f, 500.0f);
+    ImGui::SliderFloat("Cascade split lambda", &cascadeSplitLambda, 0.0f, 1.0f);
+
+    ImGui::Checkbox("Enable Bloom", &enableBloom);
+    ImGui::Checkbox("Enable Depth of Field", &enableDepthOfField);
+
+    ImGui::Checkbox("Show DOF focus", &showDOFFocus);
+
+    ImGui::SliderInt("Shadow PCF radius", &directionalShadowPCFRadius, 0, 3);
+    ImGui::SliderInt("Bokeh rings", &bokehRings, 1, 16);
+    ImGui::SliderInt("Bokeh ring samples", &bokehRingSamples, 1, 12);
+
+    ImGui::DragFloat("Focal Depth", &staticUBO.focalDepth.x, 0.01f, -10, 10);
+    ImGui::DragFloat("Focal Length", &staticUBO.focalLength.x, 0.01f, -10, 10);
+    ImGui::DragFloat("Fstop", &staticUBO.fstop.x, 0.01f, -10, 10);
+
+    // Frame pacing. A new present mode recreates the swapchain before the next frame.
+    auto presentModeName = [](VkPresentModeKHR mode) -> const char*
     {
-        pointLightShadows ? globalParametersUBO.enablePointLightShadows.x = 1.0f :
-                            globalParametersUBO.enablePointLightShadows.x = 0.0f;
+        switch (mode)
+        {
+            case VK_PRESENT_MODE_IMMEDIATE_KHR:
+                return "Immediate";
+            case VK_PRESENT_MODE_MAILBOX_KHR:
+                return "Mailbox";
+            case VK_PRESENT_MODE_FIFO_KHR:
+                return "FIFO";
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+                return "FIFO relaxed";
+            default:
+                return nullptr;
+        }
+    };
+    ImGui::BeginDisabled(_Context.IsHeadless());
+    if (ImGui::BeginCombo("Present mode", presentModeName(_Swapchain->GetPresentMode())))
+    {
+        for (VkPresentModeKHR mode : _Swapchain->GetSupportedPresentModes())
+        {
+            if (presentModeName(mode) == nullptr)
+                continue;
+            if (ImGui::Selectable(presentModeName(mode), mode == _Swapchain->GetPresentMode()))
+            {
+                _Swapchain->SetPreferredPresentMode(mode);
+                _SwapchainOutOfDate = true;
+            }
+        }
+        ImGui::EndCombo();
     }
+    ImGui::EndDisabled();
+    ImGui::SliderInt("Frames in flight", &framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+    ImGui::SliderInt("Frame cap (0 = off)", &frameRateCap, 0, 240);
+    ImGui::BeginDisabled(!_FramePacer->SupportsPresentWait());
+    ImGui::Checkbox("Wait for previous present", &waitForPresent);
+    ImGui::EndDisabled();
+    ImGui::Text(
+        "Input to present: %.1f ms (%s), pacing wait %.1f ms",
+        _FramePacer->GetInputToPresentLatency(),
+        _FramePacer->SupportsPresentWait() ? "present wait" : "estimated",
+        _FramePacer->GetPacingWaitTime());
 
-    if (ImGui::Checkbox("Enable Depth of Field", &enableDepthOfField))
+    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    ImGui::Text("Samplers: %u", _Context.GetSamplerCache()->GetSamplerCount());
+    // Bindless models reach their textures through the material buffer and have no material descriptor sets.
+    ImGui::Text(
+        "Material descriptor sets: %d",
+        model->GetMaterialCount() + model2->GetMaterialCount() + torch->GetMaterialCount());
+    ImGui::Text("Shader modules: %u", _Context.GetShaderModuleCache()->GetModuleCount());
+
+    Ref<ShaderCompiler> shaderCompiler = _Context.GetShaderCompiler();
+    ImGui::BeginDisabled(!shaderCompiler->IsAvailable());
+    ImGui::Checkbox("Hot reload shaders", &hotReloadShaders);
+    bool optimizeShaders = shaderCompiler->GetOptimization();
+    if (ImGui::Checkbox("Optimize shaders", &optimizeShaders))
     {
-        enableDepthOfField ? EnableDepthOfField() : DisableDepthOfField();
+        // Takes effect with the next reload, which picks up every shader built with the other setting.
+        shaderCompiler->SetOptimization(optimizeShaders);
     }
-
-    if (ImGui::Checkbox("Show DOF focus", &showDOFFocus))
+    ImGui::EndDisabled();
+    ImGui::Text(
+        "Shader compiles: %u, disk cache hits: %u",
+        shaderCompiler->GetCompileCount(),
+        shaderCompiler->GetDiskCacheHitCount());
+    ImGui::Text("Uniform upload: %llu bytes", (unsigned long long)_UniformUploadSize);
+    ImGui::Text(
+        "Clustered lights: %u visible of %u, %u cluster entries",
+        _ClusteredLights->GetVisibleLightCount(),
+        _ClusteredLights->GetLightCount(),
+        _ClusteredLights->GetLightIndexCount());
+    ImGui::Checkbox("GPU profiling", &gpuProfiling);
+#if ENABLE_CPU_TRACING
+    ImGui::SliderInt("CPU trace frames", &cpuTraceFrames, 1, 2000);
+    if (ImGui::Button("Capture CPU trace"))
+        Tracer::BeginCapture((uint32_t)cpuTraceFrames);
+    ImGui::SameLine();
+    if (ImGui::Button("Export CPU trace"))
+        Tracer::Export("profiles/cpu_trace_" + Utils::GetTimestampString() + ".json");
+    ImGui::Text(
+        "CPU trace: %s, %llu events, %llu dropped",
+        Tracer::IsCapturing() ? "capturing" : "stopped",
+        (unsigned long long)Tracer::GetEventCount(),
+        (unsigned long long)Tracer::GetDroppedEventCount());
+#endif
+    // Recorded paths can be played back with --benchmark.
+    if (ImGui::Button(_RecordedPath ? "Stop and save camera path" : "Record camera path"))
     {
-        showDOFFocus ? globalParametersUBO.showDOFFocus.x = 1.0f : globalParametersUBO.showDOFFocus.x = 0.0f;
+        if (_RecordedPath)
+        {
+            _RecordedPath->Save("benchmarks/recorded_" + Utils::GetTimestampString() + ".campath");
+            _RecordedPath.reset();
+        }
+        else
+        {
+            _RecordedPath     = std::make_unique<CameraPath>();
+            _RecordingTime    = 0.0f;
+            _NextKeyframeTime = 0.0f;
+        }
+    }
+    if (_RecordedPath)
+    {
+        ImGui::SameLine();
+        if (ImGui::Button("New segment"))
+            _RecordedPath->BeginSegment("Segment " + std::to_string(_RecordedPath->GetSegments().size()));
+        ImGui::SameLine();
+        ImGui::Text("%.1f s", _RecordingTime);
     }
-
-    ImGui::DragFloat("Focal Depth", &globalParametersUBO.focalDepth.x, 0.01f, -10, 10);
-    ImGui::DragFloat("Focal Length", &globalParametersUBO.focalLength.x, 0.01f, -10, 10);
-    ImGui::DragFloat("Fstop", &globalParametersUBO.fstop.x, 0.01f, -10, 10);
-
-    ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
     ImGui::End();
 
+    if (gpuProfiling)
+        _GPUProfiler->DrawOverlay();
+
     ImGui::Render();
 
     // Start final scene render pass (to
     // swapchain).-------------------------------
+    _GPUProfiler->BeginScope(cmdBuffers[_CurrentBufferIndex], "Final");
     _SwapchainRenderPass->Begin(cmdBuffers[_CurrentBufferIndex], *_SwapchainFramebuffers[_CurrentSwapchainImageIndex]);
 
     CommandBuffer::BindPipeline(cmdBuffers[_CurrentBufferIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, finalPassPipeline);
@@ -2017,20 +2979,32 @@ void ForwardRenderer::RenderFrame(const float InDeltaTime)
     vkCmdDraw(cmdBuffers[_CurrentBufferIndex], 3, 1, 0, 0);
 
     ImDrawData* draw_data = ImGui::GetDrawData();
+    _GPUProfiler->BeginScope(cmdBuffers[_CurrentBufferIndex], "ImGui");
     ImGui_ImplVulkan_RenderDrawData(draw_data, cmdBuffers[_CurrentBufferIndex]);
+    _GPUProfiler->EndScope(cmdBuffers[_CurrentBufferIndex]);
 
     _SwapchainRenderPass->End(cmdBuffers[_CurrentBufferIndex]);
+    _GPUProfiler->EndScope(cmdBuffers[_CurrentBufferIndex]);
     //  End the command buffer recording
     //  phase(swapchain).-------------------------------.
 
+    // Closes the frame scope.
+    _GPUProfiler->EndFrame(cmdBuffers[_CurrentBufferIndex]);
     CommandBuffer::EndRecording(cmdBuffers[_CurrentBufferIndex]);
+
+    frameCount++;
 }
 
 void ForwardRenderer::RenderImGui()
 {
+    TRACE_FUNCTION();
+
     // ImGui
     ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
+    if (_Context.IsHeadless())
+        ImGui::GetIO().DeltaTime = _DeltaTime > 0.0f ? _DeltaTime : 1.0f / 60.0f;
+    else
+        ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
     // ImGui::Begin("Shaders:");
     //  bool breakFrame = false;
@@ -2087,118 +3061,214 @@ void ForwardRenderer::RenderImGui()
 
 bool ForwardRenderer::BeginFrame()
 {
+    TRACE_FUNCTION();
+
     auto device = _Context.GetDevice()->GetVKDevice();
 
-    vkWaitForFences(device, 1, &_InFlightFences[_CurrentBufferIndex], VK_TRUE, UINT64_MAX);
-    vkResetFences(device, 1, &_InFlightFences[_CurrentBufferIndex]);
+    ReloadChangedShaders();
 
-    VkResult result;
+    {
+        TRACE_ZONE("Wait for frame slot");
+        vkWaitForFences(device, 1, &_InFlightFences[_CurrentBufferIndex], VK_TRUE, UINT64_MAX);
+    }
 
-    result = vkAcquireNextImageKHR(
-        device,
-        _Swapchain->GetHandle(),
-        UINT64_MAX,
-        _AcquireFinishedSemaphores[_CurrentBufferIndex],
-        VK_NULL_HANDLE,
-        &_CurrentSwapchainImageIndex);
+    // Headless images have a fixed size and are used in order. A frame slot always renders into the same image, so the
+    // fence just waited on also guards it.
+    if (_Context.IsHeadless())
+    {
+        ApplyFeatureToggles();
+        _CurrentSwapchainImageIndex = _CurrentBufferIndex % _Swapchain->GetImageCount();
+        vkResetFences(device, 1, &_InFlightFences[_CurrentBufferIndex]);
+        _Context.GetDeletionQueue()->NextFrame();
+        return true;
+    }
+
+    // Resizing between frames leaves no acquired image or signaled semaphore behind.
+    if (_SwapchainOutOfDate || _Context.GetWindow()->IsWindowResized())
+    {
+        HandleWindowResize();
+        return false;
+    }
+
+    // Toggles flipped while the last frame was recorded take effect from this frame on.
+    ApplyFeatureToggles();
+
+    VkResult result;
+    {
+        TRACE_ZONE("vkAcquireNextImageKHR");
+        result = vkAcquireNextImageKHR(
+            device,
+            _Swapchain->GetHandle(),
+            UINT64_MAX,
+            _AcquireFinishedSemaphores[_CurrentBufferIndex],
+            VK_NULL_HANDLE,
+            &_CurrentSwapchainImageIndex);
+    }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _Context.GetWindow()->IsWindowResized())
+    if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        HandleWindowResize(result);
+        // Nothing was acquired, so the fence stays signaled for the next try.
+        _SwapchainOutOfDate = true;
         return false;
     }
 
-    ASSERT(result == VK_SUCCESS, "Failed to acquire next image.");
+    // A suboptimal image is still rendered and presented, the swapchain is recreated before the next frame.
+    ASSERT(result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR, "Failed to acquire next image.");
+    _SwapchainOutOfDate = result == VK_SUBOPTIMAL_KHR;
+
+    // Only frames that are submitted advance the deletion queue. The early returns above wait on a fence that is already
+    // signaled, so counting them would release resources the earlier frames in flight may still be using.
+    vkResetFences(device, 1, &_InFlightFences[_CurrentBufferIndex]);
+    _Context.GetDeletionQueue()->NextFrame();
     return true;
 }
 
-void ForwardRenderer::HandleWindowResize(VkResult InResult)
+void ForwardRenderer::LatchCamera()
 {
-    if (InResult == VK_ERROR_OUT_OF_DATE_KHR || _Context.GetWindow()->IsWindowResized() || InResult == VK_SUBOPTIMAL_KHR)
+    TRACE_FUNCTION();
+
+    // Input that arrived while the frame was recorded still makes it into this frame. Headless runs have no input, the
+    // camera only moves when it is placed from code.
+    if (!_Context.IsHeadless())
     {
-        vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
+        glfwPollEvents();
+        if (!ImGui::GetIO().WantCaptureMouse)
+        {
+            _Camera->OnUpdate(_DeltaTime);
+        }
+    }
+    _FramePacer->MarkInputSampled();
 
-        // Wait if the window is minimized.
-        int width = 0, height = 0;
-        glfwGetFramebufferSize(_Context.GetWindow()->GetNativeWindow(), &width, &height);
-        while (width == 0 || height == 0)
+    // A keyframe every quarter second is plenty, playback smooths the path with a spline.
+    if (_RecordedPath)
+    {
+        if (_RecordingTime >= _NextKeyframeTime)
         {
-            glfwGetFramebufferSize(_Context.GetWindow()->GetNativeWindow(), &width, &height);
-            glfwWaitEvents();
+            _RecordedPath->AddKeyframe(_RecordingTime, *_Camera);
+            _NextKeyframeTime += 0.25f;
         }
+        _RecordingTime += _DeltaTime;
+    }
 
-        _Swapchain->Recreate();
+    glm::mat4 cameraView = _Camera->GetViewMatrix();
+    glm::mat4 cameraProj = _Camera->GetProjectionMatrix();
 
-        // WindowResize()
-        UpdateViewport_Scissor();
-        CreateSwapchainFramebuffers(); // Works?
-        CreateHDRFramebuffer();
+    viewUBO.viewMatrix     = cameraView;
+    viewUBO.projMatrix     = cameraProj;
+    viewUBO.cameraPosition = glm::vec4(_Camera->GetPosition(), 1.0f);
+    viewUBO.viewportDimension =
+        glm::vec4(_Context.GetSurface()->GetVKExtent().width, _Context.GetSurface()->GetVKExtent().height, 0.0f, 0.0f);
+    viewUBO.clusteredLightSlices = glm::uvec4(
+        _ClusteredLights->GetLightSliceOffset(_CurrentBufferIndex),
+        _ClusteredLights->GetClusterSliceOffset(_CurrentBufferIndex),
+        0,
+        0);
+    // Goes straight into the frame slot's view block. Its fence was waited on in BeginFrame, and vkQueueSubmit makes host
+    // writes made before it visible to the frame, so nothing has to be recorded for it.
+    _UniformUploadSize += _GlobalUniforms->Upload(GLOBAL_BLOCK_VIEW, _CurrentBufferIndex, &viewUBO);
+
+    // Bin the point lights into the camera clusters. Fragments find their cluster with the latched camera, so the lights
+    // are binned with it too. The shadow casting lights keep the index of their cubemap.
+    _ClusteredLights->Clear();
+    for (int i = 0; i < pointLightCount; i++)
+    {
+        _ClusteredLights->AddLight(
+            glm::vec3(pointLightPositions[i]),
+            glm::vec3(pointLightColors[i]),
+            pointLightIntensities[i].x,
+            i);
+    }
+    for (int i = 0; i < decorativeLightCount; i++)
+    {
+        _ClusteredLights->AddLight(
+            glm::vec3(_DecorativeLightPositions[i]), _DecorativeLightColors[i], _DecorativeLightPositions[i].w);
+    }
+    _ClusteredLights->Update(_CurrentBufferIndex, cameraView, cameraProj, _Camera->GetNearClip(), _Camera->GetFarClip());
+}
+
+void ForwardRenderer::ReloadChangedShaders()
+{
+    TRACE_FUNCTION();
+
+    Ref<ShaderCompiler> shaderCompiler = _Context.GetShaderCompiler();
+    if (!hotReloadShaders || !shaderCompiler->IsAvailable() || _Context.IsHeadless())
+        return;
+
+    double time = glfwGetTime();
+    if (time - _LastShaderPollTime < 0.5)
+        return;
+    _LastShaderPollTime = time;
+
+    std::vector<std::string> changedShaders = shaderCompiler->CollectChangedShaders();
+    if (changedShaders.empty())
+        return;
+
+    // Pipelines are rebuilt in place, so frames in flight must be done with them.
+    vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
+
+    uint32_t rebuiltCount = _Context.GetPipelineCache()->RebuildPipelinesUsing(changedShaders);
+    PrintInfo(
+        "Reloaded " + std::to_string(changedShaders.size()) + " shaders, rebuilt " + std::to_string(rebuiltCount) +
+        " pipelines.");
+}
+
+void ForwardRenderer::HandleWindowResize()
+{
+    TRACE_FUNCTION();
 
-        // Experimental. TO DO: Carry this part into the post processing
-        // pipeline. Do it like how you did with Bloom.
-        // CreateBokehRenderPass();
+    // Wait if the window is minimized.
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(_Context.GetWindow()->GetNativeWindow(), &width, &height);
+    while (width == 0 || height == 0)
+    {
+        glfwGetFramebufferSize(_Context.GetWindow()->GetNativeWindow(), &width, &height);
+        glfwWaitEvents();
+    }
+
+    // Nothing waits for the GPU here. Pipelines use dynamic viewports and render passes don't depend on the size, so only
+    // the size dependent images, their framebuffers and the descriptor sets sampling them are replaced. The frames in
+    // flight keep using the old ones, which the deletion queue releases once those frames are done.
+    _Swapchain->Recreate();
+
+    UpdateViewport_Scissor();
+    CreateSwapchainFramebuffers();
+    CreateHDRFramebuffer();
+    if (_DepthOfFieldActive)
         CreateBokehFramebuffer();
-        SetupBokehPassPipeline();
-
-        bloomAgent = make_s<Bloom>();
-        bloomAgent->ConnectImageResourceToAddBloomTo(HDRColorImage);
-
-        vkDestroySampler(_Context.GetDevice()->GetVKDevice(), finalPassSampler, nullptr);
-        vkDestroySampler(_Context.GetDevice()->GetVKDevice(), bokehPassDepthSampler, nullptr);
-        vkDestroySampler(_Context.GetDevice()->GetVKDevice(), bokehPassSceneSampler, nullptr);
-
-        finalPassSampler = Utils::CreateSampler(
-            bokehPassImage,
-            ImageType::COLOR,
-            VK_FILTER_LINEAR,
-            VK_FILTER_LINEAR,
-            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-            VK_FALSE);
-        Utils::UpdateDescriptorSet(
-            finalPassDescriptorSet,
-            finalPassSampler,
-            bokehPassImage->GetImageView(),
-            0,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-        bokehPassSceneSampler = Utils::CreateSampler(
-            bloomAgent->GetPostProcessedImage(),
-            ImageType::COLOR,
-            VK_FILTER_LINEAR,
-            VK_FILTER_LINEAR,
-            VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
-            VK_FALSE);
-        Utils::UpdateDescriptorSet(
-            bokehDescriptorSet,
-            bokehPassSceneSampler,
-            bloomAgent->GetPostProcessedImage()->GetImageView(),
-            0,
-            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    if (_BloomActive)
+        bloomAgent->Resize(HDRColorImage);
+    AllocatePostProcessDescriptorSets();
+
+    // Presents to the old swapchain may still wait on the rendering complete semaphores, and the new one may have a
+    // different image count.
+    VkDevice device = _Context.GetDevice()->GetVKDevice();
+    for (VkSemaphore semaphore : _RenderingCompleteSemaphores)
+    {
+        _Context.GetDeletionQueue()->Retire([device, semaphore]() { vkDestroySemaphore(device, semaphore, nullptr); });
+    }
 
-        bokehPassDepthSampler = Utils::CreateSampler(
-            HDRDepthImage, ImageType::COLOR, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_FALSE);
-        Utils::UpdateDescriptorSet(
-            bokehDescriptorSet,
-            bokehPassDepthSampler,
-            HDRDepthImage->GetImageView(),
-            1,
-            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
-        // ~WindowResize()
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        _Context.GetWindow()->OnResize();
-        _Camera->SetViewportSize(_Context.GetSurface()->GetVKExtent().width, _Context.GetSurface()->GetVKExtent().height);
-        ImGui::EndFrame();
-        CreateSynchronizationPrimitives();
+    _RenderingCompleteSemaphores.resize(_Swapchain->GetImageCount());
+    for (VkSemaphore& semaphore : _RenderingCompleteSemaphores)
+    {
+        ASSERT(
+            vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) == VK_SUCCESS,
+            "Failed to create rendering complete semaphore.");
     }
+
+    _SwapchainOutOfDate = false;
+    _Context.GetWindow()->OnResize();
+    _Camera->SetViewportSize(_Context.GetSurface()->GetVKExtent().width, _Context.GetSurface()->GetVKExtent().height);
 }
 
 void ForwardRenderer::EndFrame()
 {
+    TRACE_FUNCTION();
+
     VkResult result;
-    if (!ImGui::GetIO().WantCaptureMouse)
-    {
-        _Camera->OnUpdate(_DeltaTime);
-    }
+    LatchCamera();
 
     auto queue                        = _Context.GetDevice()->GetGraphicsQueue();
     auto swapchainHandle              = _Swapchain->GetHandle();
@@ -2206,18 +3276,23 @@ void ForwardRenderer::EndFrame()
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
     VkSubmitInfo         submitInfo{};
 
+    // Nothing is acquired or presented in headless mode, so there is nothing to wait on or signal.
+    const uint32_t semaphoreCount   = _Context.IsHeadless() ? 0 : 1;
     submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount   = 1;
+    submitInfo.waitSemaphoreCount   = semaphoreCount;
     submitInfo.pWaitSemaphores      = &_AcquireFinishedSemaphores[_CurrentBufferIndex];
     submitInfo.pWaitDstStageMask    = waitStages;
     submitInfo.commandBufferCount   = 1;
     submitInfo.pCommandBuffers      = &cmdBuffers[_CurrentBufferIndex];
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = semaphoreCount;
     submitInfo.pSignalSemaphores    = &_RenderingCompleteSemaphores[_CurrentSwapchainImageIndex];
 
-    ASSERT(
-        vkQueueSubmit(queue, 1, &submitInfo, _InFlightFences[_CurrentBufferIndex]) == VK_SUCCESS,
-        "Failed to submit draw command buffer!");
+    {
+        TRACE_ZONE("vkQueueSubmit");
+        ASSERT(
+            vkQueueSubmit(queue, 1, &submitInfo, _InFlightFences[_CurrentBufferIndex]) == VK_SUCCESS,
+            "Failed to submit draw command buffer!");
+    }
 
     VkSwapchainKHR   swapchain = swapchainHandle;
     VkPresentInfoKHR presentInfo{};
@@ -2229,14 +3304,50 @@ void ForwardRenderer::EndFrame()
     presentInfo.pSwapchains        = &swapchain;
     presentInfo.pImageIndices      = &_CurrentSwapchainImageIndex;
     presentInfo.pResults           = nullptr;
+    _FramePacer->OnPresent(presentInfo, swapchain, _InFlightFences[_CurrentBufferIndex]);
 
-    result                         = vkQueuePresentKHR(queue, &presentInfo);
-    ASSERT(result == VK_SUCCESS, "Failed to present swap chain image!");
+    // Headless frames still go through the pacer, which then measures input to completion of the frame.
+    if (!_Context.IsHeadless())
+    {
+        {
+            TRACE_ZONE("vkQueuePresentKHR");
+            result = vkQueuePresentKHR(queue, &presentInfo);
+        }
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+            _SwapchainOutOfDate = true;
+        else
+            ASSERT(result == VK_SUCCESS, "Failed to present swap chain image!");
+    }
 
-    _CurrentBufferIndex = ++_CurrentBufferIndex % _ConcurrentAllowedFrameCount;
+    // A new frame count takes effect here. Slots dropped by lowering it are simply not waited on again until it is raised.
+    _ConcurrentAllowedFrameCount = (uint32_t)std::clamp(framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+    _CurrentBufferIndex          = (_CurrentBufferIndex + 1) % _ConcurrentAllowedFrameCount;
 }
 
 void ForwardRenderer::PollEvents()
 {
-    glfwPollEvents();
+    TRACE_FUNCTION();
+
+    // Input is sampled only once the frame is allowed to start, so the CPU doesn't run ahead of the display with stale
+    // input.
+    _FramePacer->SetFrameCap(frameRateCap);
+    _FramePacer->SetWaitForPresent(waitForPresent);
+    _FramePacer->BeginFrame(_Swapchain->GetHandle(), _InFlightFences[_CurrentBufferIndex]);
+
+    if (!_Context.IsHeadless())
+        glfwPollEvents();
+    _FramePacer->MarkInputSampled();
+}
+
+bool ForwardRenderer::SaveLastFrame(const std::string& InPath)
+{
+    if (!_Context.IsHeadless())
+    {
+        PrintWarning("Frames can only be saved in headless mode, presented images can't be read back.");
+        return false;
+    }
+
+    // BeginFrame picks the image, so it still points at the one the last frame rendered into.
+    vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
+    return _Swapchain->SaveImage(_CurrentSwapchainImageIndex, InPath);
 }
@@ -1,9 +1,17 @@
 #pragma once
 // #include "OVKLib.h"
+#include "BindlessMaterials.h"
+#include "CameraPath.h"
+#include "ClusteredLights.h"
+#include "FramePacer.h"
+#include "GPUCulling.h"
+#include "GPUProfiler.h"
 #include "Pipeline.h"
 #include "Renderer/RenderPass.h"
+#include "UniformBlocks.h"
 
 // TODO: Move somewhere else
+#include <array>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 #include <random>
@@ -19,25 +27,58 @@ class ParticleSystem;
 class DescriptorSetLayout;
 class Bloom;
 class DescriptorPool;
+class Sampler;
 
 #define MAX_FRAMES_IN_FLIGHT  3
 #define MAX_POINT_LIGHT_COUNT 10
-#define SHADOW_DIM            10000
+#define CASCADE_COUNT         4
+#define CASCADE_SHADOW_DIM    2048
 #define POUNT_SHADOW_DIM      1000
 
+// GPU culling view slots. Every view gets its own region of indirect commands. Point lights get one view per cubemap
+// face, indexed GPU_CULL_VIEW_FIRST_POINT_LIGHT + light * 6 + face.
+#define GPU_CULL_VIEW_CAMERA            0
+#define GPU_CULL_VIEW_FIRST_CASCADE     1
+#define GPU_CULL_VIEW_FIRST_POINT_LIGHT (GPU_CULL_VIEW_FIRST_CASCADE + CASCADE_COUNT)
+#define GPU_CULL_VIEW_COUNT             (GPU_CULL_VIEW_FIRST_POINT_LIGHT + MAX_POINT_LIGHT_COUNT * 6)
+
+// Capacity of the bindless material table.
+#define BINDLESS_MAX_TEXTURES      1024
+#define BINDLESS_MAX_MATERIALS     1024
+#define BINDLESS_POINT_SHADOW_MAPS 5 // Size of u_PointShadowMap in PBRShader.frag.
+
+// Capacity of the clustered light buffers. A light counts once per cluster it touches against the index capacity.
+#define MAX_CLUSTERED_LIGHTS      1024
+#define MAX_CLUSTER_LIGHT_INDICES (CLUSTER_COUNT * 32)
+#define MAX_DECORATIVE_LIGHTS     512
+
+// Blocks of the global uniform buffer and the bindings they use in the PBR layouts. Ordered by how often they change.
+#define GLOBAL_BLOCK_VIEW         0 // Camera. Changes whenever the camera moves.
+#define GLOBAL_BLOCK_FRAME        1 // Directional light and cascades.
+#define GLOBAL_BLOCK_POINT_SHADOW 2 // Point light cubemap matrices. Changes when a light moves.
+#define GLOBAL_BLOCK_STATIC       3 // Settings that only change from the UI.
+#define GLOBAL_BLOCK_COUNT        4
+
+#define GLOBAL_BINDING_VIEW         0
+#define GLOBAL_BINDING_FRAME        11
+#define GLOBAL_BINDING_POINT_SHADOW 12
+#define GLOBAL_BINDING_STATIC       13
+
 class RendererInterface
 {
    public:
-    virtual ~RendererInterface()              = default;
-
-    virtual void Init()                       = 0; // Initialize renderer resources
-    virtual bool BeginFrame()                 = 0; // Start command buffer/frame
-    virtual void RenderFrame(float DeltaTime) = 0; // Render the main scene
-    virtual void EndFrame()                   = 0; // Submit frame
-    virtual void InitImGui()                  = 0; // Submit frame
-    virtual void PollEvents()                 = 0; // Submit frame
-    virtual void RenderImGui()                = 0; // Submit frame
-    virtual void Cleanup()                    = 0; // Submit frame
+    virtual ~RendererInterface()                          = default;
+
+    virtual void Init()                                   = 0; // Initialize renderer resources
+    virtual bool BeginFrame()                             = 0; // Start command buffer/frame
+    virtual void RenderFrame(float DeltaTime)             = 0; // Render the main scene
+    virtual void EndFrame()                               = 0; // Submit frame
+    virtual void InitImGui()                              = 0; // Submit frame
+    virtual void PollEvents()                             = 0; // Submit frame
+    virtual void RenderImGui()                            = 0; // Submit frame
+    virtual void Cleanup()                                = 0; // Submit frame
+    virtual bool SaveLastFrame(const std::string& InPath) = 0; // Write the last rendered image to disk (headless only)
+    virtual GPUProfiler* GetGPUProfiler()                 = 0; // GPU frame timing, null if the renderer has none
 };
 
 class ForwardRenderer : public RendererInterface
@@ -46,39 +87,100 @@ class ForwardRenderer : public RendererInterface
     VkDescriptorPool          imguiPool;
     ImGui_ImplVulkan_InitInfo init_info;
 
+    // Feature toggles only request a change. ApplyFeatureToggles picks them up at the start of the next frame, disabled
+    // passes are skipped and their render targets are retired through the deletion queue.
     bool pointLightShadows  = true;
     bool showDOFFocus       = false;
     bool enableDepthOfField = true;
-
-    struct GlobalParametersUBO
+    bool enableBloom        = true;
+    int  qualityPreset      = 2; // Low, Medium, High. Sets the toggles above and the shader permutations.
+
+    // Point shadows are rendered with one culled draw per cubemap face instead of the geometry shader that amplifies every
+    // triangle to all six faces. Both pipelines are kept alive so this can be flipped at runtime.
+    bool pointShadowPerFaceDraws = false;
+
+    // Culling and draw submission of the PBR models happen on the GPU. A compute pass fills indirect draw buffers for the
+    // camera, every cascade and every point light. Ignored when the device has no vkCmdDrawIndexedIndirectCount support.
+    bool gpuDrivenDraws = false;
+
+    // Lays down the depth of the PBR models with a position only pass, front to back, before shading them with an equal
+    // depth test. Every pixel then runs the PBR fragment shader once, no matter how much overdraw the scene has.
+    bool depthPrepass = false;
+
+    // Shader sources are watched and the pipelines using a changed shader are rebuilt in place. Needs shaderc at runtime.
+    bool hotReloadShaders = true;
+
+    // Frame pacing. Fewer frames in flight and waiting for the previous present shorten input to present latency at the
+    // cost of throughput. The frame cap sleeps away the spare time of every frame, 0 turns it off.
+    int  framesInFlight = MAX_FRAMES_IN_FLIGHT;
+    int  frameRateCap   = 0;
+    bool waitForPresent = true;
+
+    // Times every pass with GPU timestamps and shows the breakdown in its own window.
+    bool gpuProfiling = true;
+
+    // Length of the CPU trace captures started from the UI.
+    int cpuTraceFrames = 300;
+
+    // Small shadowless point lights scattered around Sponza on top of the torches. They only exist in the clustered light
+    // buffer, so they cost shading time only in the clusters they reach.
+    int decorativeLightCount = 0;
+
+    // Maximum number of point light cubemap faces re-rendered per frame. Faces that are not picked keep the depth
+    // they were last rendered with.
+    int pointShadowFaceBudget = 12;
+
+    // Quality settings baked into the PBR and bokeh shaders as specialization constants. Every combination is its own
+    // pipeline, compiled the first time it is used.
+    int directionalShadowPCFRadius = 2; // The directional shadow filter is (2r + 1)^2 taps.
+    int bokehRings                 = 12;
+    int bokehRingSamples           = 7; // Samples on the first ring, every further ring adds as many.
+
+    // Directional light cascades. Splits are distributed between the camera near plane and cascadeShadowDistance,
+    // blending logarithmic and uniform distribution by cascadeSplitLambda.
+    float cascadeShadowDistance  = 60.0f;
+    float cascadeSplitLambda     = 0.85f;
+    float cascadeCasterExtension = 50.0f; // How far behind a cascade casters are still captured.
+    // A cascade is re-rendered every N frames. Cached cascades are also refreshed when the camera leaves their bounds or
+    // the light moves.
+    std::array<int, CASCADE_COUNT> cascadeUpdateIntervals = { 1, 1, 2, 4 };
+
+    // Global shader data, split into blocks by how often it changes. The alignment in a struct equals to the largest base
+    // alignemnt of any of its members. In this case all of the members need to be aligned to a vec4 format.
+    struct ViewUBO
     {
-        // The alignment in a struct equals to the largest base alignemnt of any
-        // of its members. In this case all of the members need to be aligned to
-        // a vec4 format.
         glm::mat4 viewMatrix;
         glm::mat4 projMatrix;
-        glm::mat4 directionalLightMVP;
-        glm::vec4 dirLightPos;
         glm::vec4 cameraPosition;
         glm::vec4 viewportDimension;
-        glm::vec4 pointLightPositions[MAX_POINT_LIGHT_COUNT];
-        glm::vec4 pointLightIntensities[MAX_POINT_LIGHT_COUNT];
-        glm::vec4 pointLightColors[MAX_POINT_LIGHT_COUNT];
-        glm::vec4 enablePointLightShadows = glm::vec4(1.0f);
-        glm::vec4 directionalLightIntensity;
+        // x: first light, y: first cluster buffer entry of this frame's slices of the clustered light buffers.
+        glm::uvec4 clusteredLightSlices;
+    };
+
+    struct FrameUBO
+    {
+        glm::vec4 dirLightPos;
+        glm::mat4 cascadeViewProjMatrices[CASCADE_COUNT];
+        glm::vec4 cascadeSplits; // Far view depth of each cascade.
+    };
+
+    struct PointShadowUBO
+    {
         glm::mat4 shadowMatrices[MAX_POINT_LIGHT_COUNT][6];
-        glm::vec4 pointFarPlane;
-        glm::vec4 pointLightCount;
-        // padding
-        float padding[12];
-        // padding
+    };
+
+    struct StaticUBO
+    {
+        // The first six members are all bokehPass.frag reads.
         glm::vec4 DOFFramebufferSize;
         glm::vec4 cameraNearPlane;
         glm::vec4 cameraFarPlane;
-        glm::vec4 showDOFFocus;
         glm::vec4 focalDepth;
         glm::vec4 focalLength;
         glm::vec4 fstop;
+        glm::vec4 directionalLightIntensity;
+        glm::vec4 enablePointLightShadows = glm::vec4(1.0f);
+        glm::vec4 pointFarPlane;
     };
 
     // Attachments. Each framebuffer can have multiple attachments.
@@ -106,7 +208,15 @@ class ForwardRenderer : public RendererInterface
     Ref<Pipeline> EmissiveObjectPipeline;
     Ref<Pipeline> finalPassPipeline;
     Ref<Pipeline> pipeline;
+    Ref<Pipeline> depthEqualPipeline; // PBR pipeline used after the depth pre-pass.
+
+    // Permutations of the pipelines above and of bokehPassPipeline. RenderFrame picks the ones matching the settings.
+    PipelineVariants PBRVariants;
+    PipelineVariants depthEqualVariants;
+    PipelineVariants bokehPassVariants;
+    Ref<Pipeline> depthPrepassPipeline;
     Ref<Pipeline> pointShadowPassPipeline;
+    Ref<Pipeline> pointShadowPassPerFacePipeline;
     Ref<Pipeline> shadowPassPipeline;
     Ref<Pipeline> skyboxPipeline;
     Ref<Pipeline> cubePipeline;
@@ -130,17 +240,23 @@ class ForwardRenderer : public RendererInterface
     Ref<ParticleSystem> fireSparks4;
     Ref<ParticleSystem> ambientParticles;
 
-    GlobalParametersUBO globalParametersUBO;
-    VkBuffer            globalParametersUBOBuffer;
-    VkDeviceMemory      globalParametersUBOBufferMemory;
-    void*               mappedGlobalParametersModelUBOBuffer;
+    ViewUBO        viewUBO;
+    FrameUBO       frameUBO;
+    PointShadowUBO pointShadowUBO;
+    StaticUBO      staticUBO;
+
+    // Point lights of the scene. Shaders see them through the clustered light buffers and the shadow pass push constants.
+    glm::vec4 pointLightPositions[MAX_POINT_LIGHT_COUNT];
+    glm::vec4 pointLightIntensities[MAX_POINT_LIGHT_COUNT];
+    glm::vec4 pointLightColors[MAX_POINT_LIGHT_COUNT];
+    int       pointLightCount = 0;
 
     // Others
     VkCommandBuffer cmdBuffers[MAX_FRAMES_IN_FLIGHT];
     VkCommandPool   cmdPool;
     Ref<Bloom>      bloomAgent;
-    VkSampler       finalPassSampler;
-    VkDescriptorSet finalPassDescriptorSet;
+    Ref<Sampler>    postProcessSampler;
+    VkDescriptorSet finalPassDescriptorSet = VK_NULL_HANDLE;
 
     std::random_device               rd; // obtain a random number from hardware
     std::mt19937                     gen; // seed the generator
@@ -167,14 +283,10 @@ class ForwardRenderer : public RendererInterface
     int       currentAnimationFrame    = 0;
     float     timer                    = 0.0f;
     glm::vec4 directionalLightPosition = glm::vec4(-10.0f, 35.0f, -22.0f, 1.0f);
-    float     directionalNearPlane     = 1.0f;
-    float     directionalFarPlane      = 100.0f;
     float     pointNearPlane           = 0.1f;
     float     pointFarPlane            = 100.0f;
     int       frameCount               = 0;
 
-    glm::mat4 directionalLightProjectionMatrix =
-        glm::perspective(glm::radians(45.0f), 1.0f, directionalNearPlane, directionalFarPlane);
     glm::mat4 pointLightProjectionMatrix = glm::perspective(glm::radians(90.0f), 1.0f, pointNearPlane, pointFarPlane);
 
     // Experimental
@@ -185,9 +297,7 @@ class ForwardRenderer : public RendererInterface
     Ref<Pipeline>         bokehPassPipeline;
 
     VkRenderPassBeginInfo    bokehRenderPassBeginInfo;
-    VkSampler                bokehPassSceneSampler;
-    VkSampler                bokehPassDepthSampler;
-    VkDescriptorSet          bokehDescriptorSet;
+    VkDescriptorSet          bokehDescriptorSet = VK_NULL_HANDLE;
     Ref<DescriptorSetLayout> bokehPassLayout;
 
    private:
@@ -196,9 +306,11 @@ class ForwardRenderer : public RendererInterface
     void CreateBokehFramebuffer();
 
     void SetupPBRPipeline();
+    void SetupDepthPrepassPipeline();
     void SetupFinalPassPipeline();
     void SetupShadowPassPipeline();
     void SetupPointShadowPassPipeline();
+    void SetupPointShadowPassPerFacePipeline();
     void SetupBokehPassPipeline();
     void SetupSkyboxPipeline();
     void SetupCubePipeline();
@@ -212,11 +324,26 @@ class ForwardRenderer : public RendererInterface
     void CreatePointShadowRenderPass();
 
     void SetupParticleSystems();
-    void EnableDepthOfField();
-    void DisableDepthOfField();
+    // (Re)allocates the final and bokeh pass descriptor sets for the current post process images. Sets they replace are
+    // freed through the deletion queue.
+    void AllocatePostProcessDescriptorSets();
+    // Brings the active post process and shadow passes in line with the toggles. Runs between frames, never idles the
+    // device.
+    void ApplyFeatureToggles();
+    void ApplyQualityPreset(int InPreset);
+
+    // Returns a bitmask of the cubemap faces (bit N = face N) to render this frame for every point light.
+    std::vector<uint32_t> SchedulePointShadowFaces(const glm::vec3& InCameraPosition);
+    // Fits the cascades to the camera frustum and returns a bitmask of the cascades that need to be rendered this frame.
+    uint32_t UpdateShadowCascades(const glm::mat4& InCameraView, const glm::mat4& InCameraProjection);
+    // Rebuilds the pipelines whose shader sources changed on disk. Checked a few times per second.
+    void ReloadChangedShaders();
+    // Samples input, moves the camera and writes the view block of the frame. Runs right before the frame is submitted.
+    void LatchCamera();
 
    public:
-    ForwardRenderer(VulkanContext& InContext, Ref<Swapchain> InSwapchain, Ref<Camera> InCamera);
+    // A random seed of 0 seeds the particles and the light flicker from the clock, anything else repeats them exactly.
+    ForwardRenderer(VulkanContext& InContext, Ref<Swapchain> InSwapchain, Ref<Camera> InCamera, uint32_t InRandomSeed = 0);
 
     void Init();
     bool BeginFrame();
@@ -229,26 +356,59 @@ class ForwardRenderer : public RendererInterface
     void CreateSynchronizationPrimitives();
     void PollEvents();
     void RenderImGui();
-    void HandleWindowResize(VkResult InResult);
+    void HandleWindowResize();
+    // Waits for the device. Only headless frames keep their images readable after rendering.
+    bool SaveLastFrame(const std::string& InPath);
+
+    GPUProfiler* GetGPUProfiler()
+    {
+        return _GPUProfiler.get();
+    }
 
    private:
     VulkanContext& _Context;
     Ref<Swapchain> _Swapchain;
     Ref<Camera>    _Camera;
 
+    Unique<GPUCulling>      _GPUCulling;
+    Ref<BindlessMaterials>  _BindlessMaterials; // Null when descriptor indexing is unsupported.
+    Unique<ClusteredLights> _ClusteredLights;
+    Unique<FramePacer>      _FramePacer;
+    Unique<GPUProfiler>     _GPUProfiler;
+    Unique<UniformBlocks>   _GlobalUniforms;
+    VkDeviceSize            _UniformUploadSize = 0; // Bytes of global uniform data written last frame.
+
+    // xyz: position, w: intensity of the decorative lights. Generated once with a fixed seed.
+    std::vector<glm::vec4> _DecorativeLightPositions;
+    std::vector<glm::vec3> _DecorativeLightColors;
+
     Unique<RenderPass> _PointShadowRenderPass;
+    Unique<RenderPass> _PointShadowPartialRenderPass; // Loads the cubemap so untouched faces survive.
     Unique<RenderPass> _HDRRenderPass;
     Unique<RenderPass> _ShadowMapRenderPass;
     Unique<RenderPass> _SwapchainRenderPass;
 
-    Ref<Framebuffer>              _DirectionalShadowMapFramebuffer;
     Ref<Framebuffer>              _HDRFramebuffer;
+    std::vector<Ref<Framebuffer>> _CascadeShadowMapFramebuffers;
     std::vector<Ref<Framebuffer>> _PointShadowMapFramebuffers;
+    // One framebuffer per cubemap face, used by the per-face point shadow path.
+    std::vector<std::array<Ref<Framebuffer>, 6>> _PointShadowFaceFramebuffers;
     std::vector<Ref<Framebuffer>> _SwapchainFramebuffers;
 
     VkViewport _DynamicViewport{};
     VkRect2D   _DynamicScissor;
 
+    // Point shadow time slicing state, one entry per point light.
+    std::vector<std::array<uint32_t, 6>> _PointShadowFaceAges; // Frames since each face was last rendered.
+    std::vector<glm::vec3>               _PointShadowCachedPositions;
+    std::vector<bool>                    _PointShadowMapInitialized;
+
+    // Cascade cache. Matrices and bounding spheres (xyz: center, w: radius) of the last time each cascade was rendered.
+    std::array<glm::mat4, CASCADE_COUNT> _CascadeViewProjMatrices{};
+    std::array<glm::vec4, CASCADE_COUNT> _CascadeBounds{};
+    glm::vec3                            _CascadeLightDirection = glm::vec3(0.0f);
+    bool                                 _CascadesInitialized   = false;
+
     uint32_t                 _ConcurrentAllowedFrameCount = MAX_FRAMES_IN_FLIGHT;
     uint32_t                 _CurrentBufferIndex          = 0;
     std::vector<VkSemaphore> _RenderingCompleteSemaphores;
@@ -256,6 +416,19 @@ class ForwardRenderer : public RendererInterface
     std::vector<VkFence>     _InFlightFences;
 
     uint32_t _CurrentSwapchainImageIndex = 0;
+    bool     _SwapchainOutOfDate         = false; // Recreated before the next acquire.
+
+    // The toggles as of the frame being recorded. Bloom and depth of field only own render targets while active.
+    bool _BloomActive        = true;
+    bool _DepthOfFieldActive = true;
+    bool _PointShadowsActive = true;
+
+    float    _DeltaTime;
+    double   _LastShaderPollTime = 0.0;
+    uint32_t _RandomSeed         = 0;
 
-    float _DeltaTime;
+    // Camera path recorded from the live camera for the benchmark mode. Null unless recording.
+    Unique<CameraPath> _RecordedPath;
+    float              _RecordingTime    = 0.0f;
+    float              _NextKeyframeTime = 0.0f;
 };
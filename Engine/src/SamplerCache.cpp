@@ -0,0 +1,120 @@
+#include "SamplerCache.h"
+#include "LogicalDevice.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <functional>
+
+Sampler::Sampler(VulkanContext& InContext, const VkSamplerCreateInfo& InCreateInfo) : _Context(InContext)
+{
+    ASSERT(
+        vkCreateSampler(_Context.GetDevice()->GetVKDevice(), &InCreateInfo, nullptr, &_Sampler) == VK_SUCCESS,
+        "Failed to create texture sampler!");
+}
+
+Sampler::~Sampler()
+{
+    vkDestroySampler(_Context.GetDevice()->GetVKDevice(), _Sampler, nullptr);
+}
+
+SamplerCache::SamplerCache(VulkanContext& InContext) : _Context(InContext)
+{
+}
+
+Ref<Sampler> SamplerCache::Get(const VkSamplerCreateInfo& InCreateInfo)
+{
+    ASSERT(InCreateInfo.pNext == nullptr, "Sampler create infos with a pNext chain can't be cached.");
+
+    Key key;
+    key.Flags                   = InCreateInfo.flags;
+    key.MagFilter               = InCreateInfo.magFilter;
+    key.MinFilter               = InCreateInfo.minFilter;
+    key.MipmapMode              = InCreateInfo.mipmapMode;
+    key.AddressModeU            = InCreateInfo.addressModeU;
+    key.AddressModeV            = InCreateInfo.addressModeV;
+    key.AddressModeW            = InCreateInfo.addressModeW;
+    key.MipLodBias              = InCreateInfo.mipLodBias;
+    key.AnisotropyEnable        = InCreateInfo.anisotropyEnable;
+    key.MaxAnisotropy           = InCreateInfo.anisotropyEnable ? InCreateInfo.maxAnisotropy : 0.0f;
+    key.CompareEnable           = InCreateInfo.compareEnable;
+    key.CompareOp               = InCreateInfo.compareEnable ? InCreateInfo.compareOp : VK_COMPARE_OP_NEVER;
+    key.MinLod                  = InCreateInfo.minLod;
+    key.MaxLod                  = InCreateInfo.maxLod;
+    key.BorderColor             = InCreateInfo.borderColor;
+    key.UnnormalizedCoordinates = InCreateInfo.unnormalizedCoordinates;
+
+    std::lock_guard<std::mutex> lock(_Mutex);
+
+    auto it = _Samplers.find(key);
+    if (it != _Samplers.end())
+    {
+        if (Ref<Sampler> sampler = it->second.lock())
+            return sampler;
+    }
+
+    Ref<Sampler> sampler = make_s<Sampler>(_Context, InCreateInfo);
+    _Samplers[key]       = sampler;
+    return sampler;
+}
+
+Ref<Sampler> SamplerCache::GetTextureSampler(
+    ImageType            InImageType,
+    VkFilter             InMagFilter,
+    VkFilter             InMinFilter,
+    VkSamplerAddressMode InAddressMode,
+    VkBool32             InAnisotropy)
+{
+    return Get(Utils::GetSamplerCreateInfo(InImageType, InMagFilter, InMinFilter, InAddressMode, InAnisotropy, VK_LOD_CLAMP_NONE));
+}
+
+Ref<Sampler> SamplerCache::GetCubemapSampler()
+{
+    return Get(Utils::GetCubemapSamplerCreateInfo());
+}
+
+uint32_t SamplerCache::GetSamplerCount()
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+
+    uint32_t count = 0;
+    for (const auto& [key, sampler] : _Samplers)
+    {
+        if (!sampler.expired())
+            count++;
+    }
+    return count;
+}
+
+bool SamplerCache::Key::operator==(const Key& InOther) const
+{
+    return Flags == InOther.Flags && MagFilter == InOther.MagFilter && MinFilter == InOther.MinFilter &&
+        MipmapMode == InOther.MipmapMode && AddressModeU == InOther.AddressModeU && AddressModeV == InOther.AddressModeV &&
+        AddressModeW == InOther.AddressModeW && MipLodBias == InOther.MipLodBias && AnisotropyEnable == InOther.AnisotropyEnable &&
+        MaxAnisotropy == InOther.MaxAnisotropy && CompareEnable == InOther.CompareEnable && CompareOp == InOther.CompareOp &&
+        MinLod == InOther.MinLod && MaxLod == InOther.MaxLod && BorderColor == InOther.BorderColor &&
+        UnnormalizedCoordinates == InOther.UnnormalizedCoordinates;
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& InKey) const
+{
+    size_t hash    = 0;
+    auto   combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+
+    combine(std::hash<uint32_t>()(InKey.Flags));
+    combine(std::hash<int>()(InKey.MagFilter));
+    combine(std::hash<int>()(InKey.MinFilter));
+    combine(std::hash<int>()(InKey.MipmapMode));
+    combine(std::hash<int>()(InKey.AddressModeU));
+    combine(std::hash<int>()(InKey.AddressModeV));
+    combine(std::hash<int>()(InKey.AddressModeW));
+    combine(std::hash<float>()(InKey.MipLodBias));
+    combine(std::hash<uint32_t>()(InKey.AnisotropyEnable));
+    combine(std::hash<float>()(InKey.MaxAnisotropy));
+    combine(std::hash<uint32_t>()(InKey.CompareEnable));
+    combine(std::hash<int>()(InKey.CompareOp));
+    combine(std::hash<float>()(InKey.MinLod));
+    combine(std::hash<float>()(InKey.MaxLod));
+    combine(std::hash<int>()(InKey.BorderColor));
+    combine(std::hash<uint32_t>()(InKey.UnnormalizedCoordinates));
+    return hash;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "core.h"
+#include "Image.h"
+
+// External
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// A VkSampler shared by everyone who requested the same sampler state. Destroyed when the last reference goes away.
+class Sampler
+{
+   public:
+    Sampler(VulkanContext& InContext, const VkSamplerCreateInfo& InCreateInfo);
+    ~Sampler();
+
+    VkSampler GetHandle() const
+    {
+        return _Sampler;
+    }
+
+   private:
+    VulkanContext& _Context;
+    VkSampler      _Sampler = VK_NULL_HANDLE;
+};
+
+// Deduplicates samplers by their create state. Samplers do not depend on the image they sample, so every texture with the
+// same filtering, addressing, anisotropy and compare state can use the same one. The cache only holds weak references,
+// holders keep their samplers alive.
+class SamplerCache
+{
+   public:
+    SamplerCache(VulkanContext& InContext);
+
+    // pNext chains are not supported.
+    Ref<Sampler> Get(const VkSamplerCreateInfo& InCreateInfo);
+
+    // Same states as Utils::CreateSampler and Utils::CreateCubemapSampler. Color samplers don't clamp the mip range, the
+    // image view already limits it, so textures with different mip counts share a sampler.
+    Ref<Sampler> GetTextureSampler(
+        ImageType            InImageType,
+        VkFilter             InMagFilter,
+        VkFilter             InMinFilter,
+        VkSamplerAddressMode InAddressMode,
+        VkBool32             InAnisotropy);
+    Ref<Sampler> GetCubemapSampler();
+
+    // Number of samplers currently alive.
+    uint32_t GetSamplerCount();
+
+   private:
+    struct Key
+    {
+        VkSamplerCreateFlags Flags;
+        VkFilter             MagFilter;
+        VkFilter             MinFilter;
+        VkSamplerMipmapMode  MipmapMode;
+        VkSamplerAddressMode AddressModeU;
+        VkSamplerAddressMode AddressModeV;
+        VkSamplerAddressMode AddressModeW;
+        float                MipLodBias;
+        VkBool32             AnisotropyEnable;
+        float                MaxAnisotropy;
+        VkBool32             CompareEnable;
+        VkCompareOp          CompareOp;
+        float                MinLod;
+        float                MaxLod;
+        VkBorderColor        BorderColor;
+        VkBool32             UnnormalizedCoordinates;
+
+        bool operator==(const Key& InOther) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& InKey) const;
+    };
+
+   private:
+    VulkanContext&                                           _Context;
+    std::mutex                                               _Mutex;
+    std::unordered_map<Key, std::weak_ptr<Sampler>, KeyHash> _Samplers;
+};
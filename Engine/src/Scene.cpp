@@ -4,6 +4,8 @@
 #include "ParticleSystem.h"
 #include "Scene.h"
 
+#include <algorithm>
+
 void Scene::SetCamera(Ref<Camera> InCamera)
 {
     _Camera = InCamera;
@@ -24,6 +26,14 @@ const std::vector<Ref<Model>>& Scene::GetModels() const
     return _Models;
 }
 
+uint32_t Scene::AddModelInstance(Ref<Model> InModel, const glm::mat4& InTransform, const glm::vec4& InTint)
+{
+    if (std::find(_Models.begin(), _Models.end(), InModel) == _Models.end())
+        _Models.push_back(InModel);
+
+    return InModel->AddInstance(InTransform, InTint);
+}
+
 void Scene::AddLight(const Light& InLight)
 {
     _Lights.push_back(InLight);
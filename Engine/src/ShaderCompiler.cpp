@@ -0,0 +1,529 @@
+#include "ShaderCompiler.h"
+#include "Tracer.h"
+
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <shaderc/shaderc.h>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+// Part of every cache key. Bump when the compile options change in a way the key doesn't capture.
+#define SHADER_CACHE_VERSION 1
+
+struct ShaderCompiler::Functions
+{
+    decltype(&shaderc_compiler_initialize)                    CompilerInitialize    = nullptr;
+    decltype(&shaderc_compiler_release)                       CompilerRelease       = nullptr;
+    decltype(&shaderc_compile_options_initialize)             OptionsInitialize     = nullptr;
+    decltype(&shaderc_compile_options_release)                OptionsRelease        = nullptr;
+    decltype(&shaderc_compile_options_add_macro_definition)   AddMacroDefinition    = nullptr;
+    decltype(&shaderc_compile_options_set_optimization_level) SetOptimizationLevel  = nullptr;
+    decltype(&shaderc_compile_options_set_target_env)         SetTargetEnv          = nullptr;
+    decltype(&shaderc_compile_options_set_include_callbacks)  SetIncludeCallbacks   = nullptr;
+    decltype(&shaderc_compile_into_spv)                       CompileIntoSpv        = nullptr;
+    decltype(&shaderc_result_release)                         ResultRelease         = nullptr;
+    decltype(&shaderc_result_get_compilation_status)          ResultGetStatus       = nullptr;
+    decltype(&shaderc_result_get_bytes)                       ResultGetBytes        = nullptr;
+    decltype(&shaderc_result_get_length)                      ResultGetLength       = nullptr;
+    decltype(&shaderc_result_get_error_message)               ResultGetErrorMessage = nullptr;
+};
+
+namespace
+{
+struct IncludeResult
+{
+    shaderc_include_result Result; // First, so the pointer handed to shaderc converts back.
+    std::string            Name;
+    std::string            Content;
+};
+
+void* OpenSharedLibrary(const std::string& InPath)
+{
+#ifdef _WIN32
+    return (void*)LoadLibraryA(InPath.c_str());
+#else
+    return dlopen(InPath.c_str(), RTLD_NOW);
+#endif
+}
+
+void* GetSymbol(void* InLibrary, const char* InName)
+{
+#ifdef _WIN32
+    return (void*)GetProcAddress((HMODULE)InLibrary, InName);
+#else
+    return dlsym(InLibrary, InName);
+#endif
+}
+
+void CloseSharedLibrary(void* InLibrary)
+{
+#ifdef _WIN32
+    FreeLibrary((HMODULE)InLibrary);
+#else
+    dlclose(InLibrary);
+#endif
+}
+
+bool ReadText(const std::filesystem::path& InPath, std::string& OutText)
+{
+    std::ifstream file(InPath, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    OutText = stream.str();
+    return true;
+}
+
+// The manifest and the pipelines name the same files with different case and separators, and Windows paths match
+// regardless of either.
+std::string NormalizeKey(const std::string& InPath)
+{
+    std::string key = InPath;
+    for (char& c : key)
+        c = c == '\\' ? '/' : (char)std::tolower((unsigned char)c);
+    return key;
+}
+
+// FNV-1a
+void HashBytes(uint64_t& InOutHash, const void* InData, size_t InSize)
+{
+    const uint8_t* bytes = (const uint8_t*)InData;
+    for (size_t i = 0; i < InSize; i++)
+        InOutHash = (InOutHash ^ bytes[i]) * 1099511628211ull;
+}
+} // namespace
+
+ShaderCompiler::ShaderCompiler(const std::string& InManifestPath, const std::string& InCacheDirectory)
+    : _Functions(make_u<Functions>())
+{
+    _EngineDirectory = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/");
+    _CacheDirectory  = _EngineDirectory / InCacheDirectory;
+
+    ParseManifest(InManifestPath);
+    LoadShaderc();
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+    if (_Compiler)
+        _Functions->CompilerRelease((shaderc_compiler_t)_Compiler);
+    if (_Library)
+        CloseSharedLibrary(_Library);
+}
+
+void ShaderCompiler::LoadShaderc()
+{
+#ifdef _WIN32
+    std::vector<std::string> candidates = {
+        "shaderc_shared.dll", (_EngineDirectory / "vendor/VULKAN/1.4.328.1/Bin/shaderc_shared.dll").string()
+    };
+#else
+    std::vector<std::string> candidates = { "libshaderc_shared.so", "libshaderc_shared.so.1" };
+#endif
+    for (const std::string& candidate : candidates)
+    {
+        _Library = OpenSharedLibrary(candidate);
+        if (_Library)
+            break;
+    }
+    if (!_Library)
+    {
+        PrintWarning("shaderc was not found, using the precompiled SPIR-V files.");
+        ReportOutdatedSpirv();
+        return;
+    }
+
+    auto resolve = [this](auto& function, const char* name)
+    {
+        function = reinterpret_cast<std::remove_reference_t<decltype(function)>>(GetSymbol(_Library, name));
+        return function != nullptr;
+    };
+    bool resolved = resolve(_Functions->CompilerInitialize, "shaderc_compiler_initialize") &&
+        resolve(_Functions->CompilerRelease, "shaderc_compiler_release") &&
+        resolve(_Functions->OptionsInitialize, "shaderc_compile_options_initialize") &&
+        resolve(_Functions->OptionsRelease, "shaderc_compile_options_release") &&
+        resolve(_Functions->AddMacroDefinition, "shaderc_compile_options_add_macro_definition") &&
+        resolve(_Functions->SetOptimizationLevel, "shaderc_compile_options_set_optimization_level") &&
+        resolve(_Functions->SetTargetEnv, "shaderc_compile_options_set_target_env") &&
+        resolve(_Functions->SetIncludeCallbacks, "shaderc_compile_options_set_include_callbacks") &&
+        resolve(_Functions->CompileIntoSpv, "shaderc_compile_into_spv") &&
+        resolve(_Functions->ResultRelease, "shaderc_result_release") &&
+        resolve(_Functions->ResultGetStatus, "shaderc_result_get_compilation_status") &&
+        resolve(_Functions->ResultGetBytes, "shaderc_result_get_bytes") &&
+        resolve(_Functions->ResultGetLength, "shaderc_result_get_length") &&
+        resolve(_Functions->ResultGetErrorMessage, "shaderc_result_get_error_message");
+
+    if (resolved)
+        _Compiler = _Functions->CompilerInitialize();
+
+    if (!_Compiler)
+    {
+        PrintWarning("Failed to initialize shaderc, using the precompiled SPIR-V files.");
+        CloseSharedLibrary(_Library);
+        _Library = nullptr;
+        ReportOutdatedSpirv();
+        return;
+    }
+
+    PrintInfo("Compiling shaders at runtime, " + std::to_string(_Rules.size()) + " shaders known.");
+}
+
+void ShaderCompiler::ParseManifest(const std::filesystem::path& InManifestPath)
+{
+    std::string text;
+    if (!ReadText(_EngineDirectory / InManifestPath, text))
+    {
+        PrintWarning("Failed to read the shader manifest " + InManifestPath.generic_string() + ".");
+        return;
+    }
+
+    // Lines look like: <path to>glslc.exe [-DNAME[=VALUE]]... source -o output.spv
+    std::string        directory = InManifestPath.parent_path().generic_string();
+    std::istringstream lines(text);
+    std::string        line;
+    while (std::getline(lines, line))
+    {
+        std::istringstream       tokens(line);
+        std::vector<std::string> words;
+        std::string              word;
+        while (tokens >> word)
+            words.push_back(word);
+
+        if (words.empty() || words[0].find("glslc") == std::string::npos)
+            continue;
+
+        Rule        rule;
+        std::string output;
+        for (size_t i = 1; i < words.size(); i++)
+        {
+            if (words[i] == "-o" && i + 1 < words.size())
+                output = words[++i];
+            else if (words[i] == "-D" && i + 1 < words.size())
+                rule.Defines.push_back(words[++i]);
+            else if (words[i].rfind("-D", 0) == 0)
+                rule.Defines.push_back(words[i].substr(2));
+            else if (words[i][0] != '-')
+                rule.Source = _EngineDirectory / directory / words[i];
+        }
+
+        if (!output.empty() && !rule.Source.empty())
+        {
+            rule.Output                                    = _EngineDirectory / directory / output;
+            _Rules[NormalizeKey(directory + "/" + output)] = rule;
+        }
+    }
+}
+
+bool ShaderCompiler::GetSpirv(const std::string& InSpirvPath, std::vector<char>& OutCode, uint64_t& OutHash)
+{
+    auto rule = _Rules.find(NormalizeKey(InSpirvPath));
+    if (!IsAvailable() || rule == _Rules.end())
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+
+        auto it = _Shaders.find(InSpirvPath);
+        if (it != _Shaders.end() && !IsStale(it->second))
+        {
+            OutCode = it->second.Code;
+            OutHash = it->second.Hash;
+            return true;
+        }
+    }
+
+    // Built without holding the lock, pipelines compiling on other threads build their shaders at the same time.
+    CompiledShader shader;
+    bool           built = Build(rule->second, shader);
+
+    std::lock_guard<std::mutex> lock(_Mutex);
+
+    auto it = _Shaders.find(InSpirvPath);
+    if (built)
+    {
+        OutCode               = shader.Code;
+        OutHash               = shader.Hash;
+        _Shaders[InSpirvPath] = std::move(shader);
+        return true;
+    }
+    if (it != _Shaders.end())
+    {
+        // Keep the last good build. Its dependencies move on, so the broken edit isn't reported as changed again.
+        it->second.Dependencies = shader.Dependencies;
+        OutCode                 = it->second.Code;
+        OutHash                 = it->second.Hash;
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::string> ShaderCompiler::CollectChangedShaders()
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+
+    std::vector<std::string> changed;
+    for (const auto& [path, shader] : _Shaders)
+    {
+        if (IsStale(shader))
+            changed.push_back(path);
+    }
+    return changed;
+}
+
+void ShaderCompiler::SetOptimization(bool InOptimize)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    if (_Optimize == InOptimize)
+        return;
+
+    // Every shader is built again with the new setting the next time it is requested.
+    _Optimize = InOptimize;
+    for (auto& [path, shader] : _Shaders)
+        shader.Dependencies.clear();
+}
+
+bool ShaderCompiler::IsStale(const CompiledShader& InShader) const
+{
+    if (InShader.Dependencies.empty())
+        return true;
+
+    for (const auto& [file, writeTime] : InShader.Dependencies)
+    {
+        std::error_code error;
+        if (std::filesystem::last_write_time(file, error) != writeTime || error)
+            return true;
+    }
+    return false;
+}
+
+void ShaderCompiler::ReportOutdatedSpirv() const
+{
+    uint32_t outdatedCount = 0;
+    for (const auto& [key, rule] : _Rules)
+    {
+        std::error_code                 error;
+        std::filesystem::file_time_type spirvTime = std::filesystem::last_write_time(rule.Output, error);
+
+        std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> dependencies;
+        uint64_t                                                                       hash = 0;
+        if (error || !CollectDependencies(rule.Source, dependencies, hash))
+        {
+            PrintWarning("Can't tell whether " + key + " is up to date, it or its source is missing.");
+            outdatedCount++;
+            continue;
+        }
+
+        for (const auto& [file, writeTime] : dependencies)
+        {
+            if (writeTime > spirvTime)
+            {
+                PrintWarning(key + " is older than " + file.filename().generic_string() + ".");
+                outdatedCount++;
+                break;
+            }
+        }
+    }
+    if (outdatedCount > 0)
+        PrintWarning(std::to_string(outdatedCount) + " SPIR-V files may be outdated, run compileShaders.bat and commit them.");
+}
+
+bool ShaderCompiler::Build(const Rule& InRule, CompiledShader& OutShader)
+{
+    bool optimize;
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        optimize = _Optimize;
+    }
+
+    // The key covers everything that goes into the SPIR-V: the sources, the macro set and the options.
+    uint64_t hash    = 14695981039346656037ull;
+    uint32_t version = SHADER_CACHE_VERSION;
+    HashBytes(hash, &version, sizeof(version));
+    HashBytes(hash, &optimize, sizeof(optimize));
+    for (const std::string& define : InRule.Defines)
+        HashBytes(hash, define.c_str(), define.size() + 1);
+
+    if (!CollectDependencies(InRule.Source, OutShader.Dependencies, hash))
+    {
+        PrintError("Failed to read the shader source " + InRule.Source.generic_string() + " or one of its includes.");
+        return false;
+    }
+
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".spv";
+    std::filesystem::path cachePath = _CacheDirectory / name.str();
+
+    std::string cached;
+    if (ReadText(cachePath, cached) && !cached.empty())
+    {
+        OutShader.Code.assign(cached.begin(), cached.end());
+        OutShader.Hash = hash;
+        _DiskCacheHitCount++;
+        return true;
+    }
+
+    std::string source;
+    ReadText(InRule.Source, source);
+    if (!Compile(InRule, source, optimize, OutShader.Code))
+        return false;
+    OutShader.Hash = hash;
+    _CompileCount++;
+
+    // Written next to the target and renamed over it, other threads may be reading the same entry.
+    std::error_code error;
+    std::filesystem::create_directories(_CacheDirectory, error);
+
+    std::filesystem::path tempPath = cachePath;
+    tempPath += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (file.is_open())
+    {
+        file.write(OutShader.Code.data(), OutShader.Code.size());
+        file.close();
+        std::filesystem::rename(tempPath, cachePath, error);
+    }
+    return true;
+}
+
+bool ShaderCompiler::Compile(const Rule& InRule, const std::string& InSource, bool InOptimize, std::vector<char>& OutCode)
+{
+    TRACE_FUNCTION();
+
+    std::string         extension = InRule.Source.extension().string();
+    shaderc_shader_kind kind;
+    if (extension == ".vert")
+        kind = shaderc_vertex_shader;
+    else if (extension == ".frag")
+        kind = shaderc_fragment_shader;
+    else if (extension == ".geom")
+        kind = shaderc_geometry_shader;
+    else if (extension == ".comp")
+        kind = shaderc_compute_shader;
+    else
+    {
+        PrintError("Unknown shader stage of " + InRule.Source.generic_string() + ".");
+        return false;
+    }
+
+    shaderc_compile_options_t options = _Functions->OptionsInitialize();
+    _Functions->SetTargetEnv(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+    _Functions->SetOptimizationLevel(
+        options, InOptimize ? shaderc_optimization_level_performance : shaderc_optimization_level_zero);
+    _Functions->SetIncludeCallbacks(options, &ShaderCompiler::ResolveInclude, &ShaderCompiler::ReleaseInclude, this);
+    for (const std::string& define : InRule.Defines)
+    {
+        size_t      separator = define.find('=');
+        std::string name      = define.substr(0, separator);
+        std::string value     = separator == std::string::npos ? "" : define.substr(separator + 1);
+        _Functions->AddMacroDefinition(options, name.c_str(), name.size(), value.c_str(), value.size());
+    }
+
+    std::string                  sourceName = InRule.Source.generic_string();
+    shaderc_compilation_result_t result     = _Functions->CompileIntoSpv(
+        (shaderc_compiler_t)_Compiler, InSource.c_str(), InSource.size(), kind, sourceName.c_str(), "main", options);
+
+    bool success = _Functions->ResultGetStatus(result) == shaderc_compilation_status_success;
+    if (success)
+    {
+        const char* bytes = _Functions->ResultGetBytes(result);
+        OutCode.assign(bytes, bytes + _Functions->ResultGetLength(result));
+    }
+    else
+    {
+        PrintError("Failed to compile " + sourceName + ":\n" + _Functions->ResultGetErrorMessage(result));
+    }
+
+    _Functions->ResultRelease(result);
+    _Functions->OptionsRelease(options);
+    return success;
+}
+
+bool ShaderCompiler::CollectDependencies(
+    const std::filesystem::path&                                                    InFile,
+    std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>>& OutDependencies,
+    uint64_t&                                                                       InOutHash) const
+{
+    for (const auto& [file, writeTime] : OutDependencies)
+    {
+        if (file == InFile)
+            return true;
+    }
+
+    // The write time is taken before reading, a write in between shows up as a change on the next poll.
+    std::error_code                 error;
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(InFile, error);
+
+    std::string text;
+    if (error || !ReadText(InFile, text))
+        return false;
+
+    OutDependencies.emplace_back(InFile, writeTime);
+    HashBytes(InOutHash, text.data(), text.size());
+
+    // A textual scan for includes. Includes inside inactive #if blocks are collected too, which only costs a hash.
+    std::istringstream lines(text);
+    std::string        line;
+    while (std::getline(lines, line))
+    {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+            continue;
+
+        size_t open  = line.find_first_of("\"<", start + 8);
+        size_t close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+        if (close == std::string::npos)
+            continue;
+
+        std::filesystem::path include = InFile.parent_path() / line.substr(open + 1, close - open - 1);
+        if (!CollectDependencies(include.lexically_normal(), OutDependencies, InOutHash))
+            return false;
+    }
+    return true;
+}
+
+shaderc_include_result* ShaderCompiler::ResolveInclude(
+    void* /*InUserData*/,
+    const char* InRequestedSource,
+    int /*InType*/,
+    const char* InRequestingSource,
+    size_t /*InIncludeDepth*/)
+{
+    // Both "" and <> includes resolve relative to the including file, like the dependency scan above.
+    std::filesystem::path path =
+        (std::filesystem::path(InRequestingSource).parent_path() / InRequestedSource).lexically_normal();
+
+    IncludeResult* include = new IncludeResult();
+    if (ReadText(path, include->Content))
+        include->Name = path.generic_string();
+    else
+        include->Content = "Failed to open " + path.generic_string();
+
+    include->Result.source_name        = include->Name.c_str();
+    include->Result.source_name_length = include->Name.size();
+    include->Result.content            = include->Content.c_str();
+    include->Result.content_length     = include->Content.size();
+    include->Result.user_data          = nullptr;
+    return &include->Result;
+}
+
+void ShaderCompiler::ReleaseInclude(void* /*InUserData*/, shaderc_include_result* InResult)
+{
+    delete reinterpret_cast<IncludeResult*>(InResult);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct shaderc_include_result;
+
+// Compiles GLSL to optimized SPIR-V at runtime with the shaderc library of the Vulkan SDK.
+//
+// Pipelines keep naming the .spv files they use. How each of them is built, its source and macro definitions, is read from
+// the glslc calls in compileShaders.bat, so the script stays the one list of shaders and their permutations. Requesting a
+// .spv that has a rule compiles its source instead of loading the checked in file.
+//
+// Results are cached in memory and on disk. The disk cache is keyed by the hash of the source, of every file it includes
+// and of the macro set, so a warm start does not invoke the compiler at all. Changed sources are picked up by
+// CollectChangedShaders, which the renderer polls to hot reload shaders.
+//
+// shaderc is loaded at runtime. When it can't be found, or a shader fails to compile on the first try, the checked in .spv
+// files are used as before. That makes the checked in files what ships and what runs without the SDK, so every source edit
+// still needs compileShaders.bat run and its output committed. Without shaderc, the .spv files that are older than their
+// sources are reported at startup.
+class ShaderCompiler
+{
+   public:
+    // Paths are relative to the Engine directory.
+    ShaderCompiler(const std::string& InManifestPath, const std::string& InCacheDirectory);
+    ~ShaderCompiler();
+
+    bool IsAvailable() const
+    {
+        return _Library != nullptr;
+    }
+
+    // Fills OutCode and OutHash with the SPIR-V built from the rule for InSpirvPath. Returns false when there is no rule for
+    // it or the shader could not be built, the caller loads the file from disk then. If a shader that built before fails
+    // after an edit, the last good SPIR-V is returned so a typo doesn't take the pipeline down.
+    bool GetSpirv(const std::string& InSpirvPath, std::vector<char>& OutCode, uint64_t& OutHash);
+
+    // SPIR-V paths whose source or includes changed on disk since they were last built.
+    std::vector<std::string> CollectChangedShaders();
+
+    void SetOptimization(bool InOptimize);
+    bool GetOptimization() const
+    {
+        return _Optimize;
+    }
+
+    // Statistics of the current run. Safe to read while other threads compile.
+    uint32_t GetCompileCount() const
+    {
+        return _CompileCount;
+    }
+    uint32_t GetDiskCacheHitCount() const
+    {
+        return _DiskCacheHitCount;
+    }
+
+   private:
+    struct Rule
+    {
+        std::filesystem::path    Source;
+        std::filesystem::path    Output;
+        std::vector<std::string> Defines;
+    };
+
+    struct CompiledShader
+    {
+        // Source and every included file with their write time at the last build.
+        std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>> Dependencies;
+        std::vector<char>                                                              Code;
+        uint64_t                                                                       Hash = 0;
+    };
+
+    void LoadShaderc();
+    void ParseManifest(const std::filesystem::path& InManifestPath);
+    bool Build(const Rule& InRule, CompiledShader& OutShader);
+    bool Compile(const Rule& InRule, const std::string& InSource, bool InOptimize, std::vector<char>& OutCode);
+    bool IsStale(const CompiledShader& InShader) const;
+    void ReportOutdatedSpirv() const;
+
+    // Adds InFile and, recursively, the files it includes to OutDependencies. Returns false if a file can't be read.
+    bool CollectDependencies(
+        const std::filesystem::path&                                                    InFile,
+        std::vector<std::pair<std::filesystem::path, std::filesystem::file_time_type>>& OutDependencies,
+        uint64_t&                                                                       InOutHash) const;
+
+    static shaderc_include_result* ResolveInclude(
+        void*       InUserData,
+        const char* InRequestedSource,
+        int         InType,
+        const char* InRequestingSource,
+        size_t      InIncludeDepth);
+    static void ReleaseInclude(void* InUserData, shaderc_include_result* InResult);
+
+   private:
+    std::filesystem::path _EngineDirectory;
+    std::filesystem::path _CacheDirectory;
+    bool                  _Optimize = true;
+
+    std::unordered_map<std::string, Rule> _Rules; // Keyed by the lower case .spv path with forward slashes.
+
+    std::mutex                                      _Mutex;
+    std::unordered_map<std::string, CompiledShader> _Shaders;
+    std::atomic<uint32_t>                           _CompileCount      = 0;
+    std::atomic<uint32_t>                           _DiskCacheHitCount = 0;
+
+    // shaderc entry points, resolved from the shared library.
+    void* _Library  = nullptr;
+    void* _Compiler = nullptr;
+    struct Functions;
+    Unique<Functions> _Functions;
+};
@@ -0,0 +1,104 @@
+#include "LogicalDevice.h"
+#include "ShaderCompiler.h"
+#include "ShaderModuleCache.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <functional>
+
+ShaderModule::ShaderModule(VulkanContext& InContext, const std::vector<char>& InCode) : _Context(InContext)
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = InCode.size();
+    createInfo.pCode    = reinterpret_cast<const uint32_t*>(InCode.data());
+
+    ASSERT(
+        vkCreateShaderModule(_Context.GetDevice()->GetVKDevice(), &createInfo, nullptr, &_Module) == VK_SUCCESS,
+        "Failed to create shader module!");
+}
+
+ShaderModule::~ShaderModule()
+{
+    vkDestroyShaderModule(_Context.GetDevice()->GetVKDevice(), _Module, nullptr);
+}
+
+ShaderModuleCache::ShaderModuleCache(VulkanContext& InContext) : _Context(InContext)
+{
+}
+
+Ref<ShaderModule> ShaderModuleCache::Get(const std::string& InPath)
+{
+    // Shaders the runtime compiler knows are built from source. Their hash covers the sources and the macro set.
+    std::vector<char> code;
+    uint64_t          hash     = 0;
+    bool              compiled = _Context.GetShaderCompiler()->GetSpirv(InPath, code, hash);
+
+    std::error_code                 error;
+    std::filesystem::file_time_type writeTime;
+    if (!compiled)
+    {
+        writeTime =
+            std::filesystem::last_write_time(Utils::NormalizePath(std::string(SOLUTION_DIR) + "Engine/" + InPath), error);
+    }
+
+    std::lock_guard<std::mutex> lock(_Mutex);
+
+    // Precompiled files are only read when they are new or changed on disk. Otherwise the hash of their last read stands
+    // in for them.
+    if (!compiled)
+    {
+        auto file = _Files.find(InPath);
+        if (error || file == _Files.end() || file->second.WriteTime != writeTime)
+        {
+            code = Utils::ReadFile(InPath);
+
+            // FNV-1a
+            uint64_t fileHash = 14695981039346656037ull;
+            for (char byte : code)
+                fileHash = (fileHash ^ (uint8_t)byte) * 1099511628211ull;
+
+            _Files[InPath] = FileEntry{ writeTime, fileHash };
+            file           = _Files.find(InPath);
+        }
+        hash = file->second.Hash;
+    }
+
+    Key  key{ InPath, hash };
+    auto it = _Modules.find(key);
+    if (it != _Modules.end())
+    {
+        if (Ref<ShaderModule> module = it->second.lock())
+            return module;
+    }
+
+    if (code.empty())
+        code = Utils::ReadFile(InPath);
+
+    Ref<ShaderModule> module = make_s<ShaderModule>(_Context, code);
+    _Modules[key]            = module;
+    return module;
+}
+
+uint32_t ShaderModuleCache::GetModuleCount()
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+
+    uint32_t count = 0;
+    for (const auto& [key, module] : _Modules)
+    {
+        if (!module.expired())
+            count++;
+    }
+    return count;
+}
+
+bool ShaderModuleCache::Key::operator==(const Key& InOther) const
+{
+    return Hash == InOther.Hash && Path == InOther.Path;
+}
+
+size_t ShaderModuleCache::KeyHash::operator()(const Key& InKey) const
+{
+    return std::hash<std::string>()(InKey.Path) ^ (size_t)InKey.Hash;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// A VkShaderModule shared by every pipeline that uses the same SPIR-V. Destroyed when the last reference goes away.
+class ShaderModule
+{
+   public:
+    ShaderModule(VulkanContext& InContext, const std::vector<char>& InCode);
+    ~ShaderModule();
+
+    VkShaderModule GetHandle() const
+    {
+        return _Module;
+    }
+
+   private:
+    VulkanContext& _Context;
+    VkShaderModule _Module = VK_NULL_HANDLE;
+};
+
+// Deduplicates shader modules by the content of their SPIR-V. Shaders known to the ShaderCompiler are built from source,
+// other files are only read again when their modification time changed since the last request, so pipelines that share
+// shaders neither reload nor recreate them. Like the sampler cache, only weak references are held. Pipelines keep their
+// modules alive.
+class ShaderModuleCache
+{
+   public:
+    ShaderModuleCache(VulkanContext& InContext);
+
+    // InPath is relative to the Engine directory, the same as for Utils::ReadFile.
+    Ref<ShaderModule> Get(const std::string& InPath);
+
+    // Number of shader modules currently alive.
+    uint32_t GetModuleCount();
+
+   private:
+    struct FileEntry
+    {
+        std::filesystem::file_time_type WriteTime;
+        uint64_t                        Hash = 0;
+    };
+
+    struct Key
+    {
+        std::string Path;
+        uint64_t    Hash;
+
+        bool operator==(const Key& InOther) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& InKey) const;
+    };
+
+   private:
+    VulkanContext&                                                _Context;
+    std::mutex                                                    _Mutex;
+    std::unordered_map<std::string, FileEntry>                    _Files;
+    std::unordered_map<Key, std::weak_ptr<ShaderModule>, KeyHash> _Modules;
+};
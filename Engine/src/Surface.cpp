@@ -45,6 +45,19 @@ Surface::Surface(
         found          = true;
     }
 }
+Surface::Surface(VkExtent2D InExtent)
+{
+    _SurfaceFormat                    = { VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+    _Capabilities                     = {};
+    _Capabilities.minImageCount       = 3;
+    _Capabilities.maxImageCount       = 3;
+    _Capabilities.currentExtent       = InExtent;
+    _Capabilities.minImageExtent      = InExtent;
+    _Capabilities.maxImageExtent      = InExtent;
+    _Capabilities.maxImageArrayLayers = 1;
+    _Capabilities.currentTransform    = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    _Capabilities.supportedUsageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+}
 Surface::Surface()
 {
     ASSERT(
@@ -84,11 +97,15 @@ Surface::Surface()
 
 Surface::~Surface()
 {
-    vkDestroySurfaceKHR(_Instance->GetVkInstance(), _Surface, nullptr);
+    if (_Surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(_Instance->GetVkInstance(), _Surface, nullptr);
 }
 
 VkExtent2D Surface::GetVKExtent()
 {
+    if (_Surface == VK_NULL_HANDLE)
+        return _Capabilities.currentExtent;
+
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_PhysicalDevice->GetVKPhysicalDevice(), _Surface, &_Capabilities);
 
     if (_Capabilities.currentExtent.width != (std::numeric_limits<uint32_t>::max)())
@@ -15,6 +15,8 @@ class Surface
         Ref<Instance>       InInstance,
         Ref<Window>         InWindow,
         Ref<PhysicalDevice> InPhysicalDevice);
+    // Headless surface without a VkSurfaceKHR. Reports a fixed extent and format for the offscreen swapchain images.
+    explicit Surface(VkExtent2D InExtent);
     Surface();
     ~Surface();
 
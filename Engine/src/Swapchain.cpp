@@ -1,13 +1,21 @@
+#include "CommandBuffer.h"
+#include "DeletionQueue.h"
 #include "LogicalDevice.h"
 #include "PhysicalDevice.h"
 #include "Surface.h"
 #include "Swapchain.h"
+#include "Tracer.h"
+#include "Utils.h"
 #include "VulkanContext.h"
 
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 
 Swapchain::Swapchain(VulkanContext& InContext) : _Context(InContext)
 {
+    TRACE_FUNCTION();
+
     Create();
 }
 
@@ -36,36 +44,59 @@ const uint32_t Swapchain::GetImageCount() const noexcept
 {
     return _ImageCount;
 }
+const std::vector<VkPresentModeKHR>& Swapchain::GetSupportedPresentModes() const noexcept
+{
+    return _SupportedPresentModes;
+}
 
-void Swapchain::Create()
+void Swapchain::SetPreferredPresentMode(VkPresentModeKHR InPresentMode)
 {
+    _PreferredPresentMode = InPresentMode;
+}
+
+void Swapchain::Create(VkSwapchainKHR InOldSwapchain)
+{
+    if (_Context.IsHeadless())
+    {
+        _SupportedPresentModes = { VK_PRESENT_MODE_FIFO_KHR };
+        _PresentMode           = VK_PRESENT_MODE_FIFO_KHR;
+        _ImageCount            = _Context.GetSurface()->GetVKSurfaceCapabilities().minImageCount;
+        _Format                = _Context.GetSurface()->GetVKSurfaceFormat().format;
+        CreateOffscreenImages();
+        CreateImageViews();
+        return;
+    }
+
     // Query present modes
     uint32_t presentModeCount = 0;
     vkGetPhysicalDeviceSurfacePresentModesKHR(
         _Context.GetPhysicalDevice()->GetVKPhysicalDevice(), _Context.GetSurface()->GetVKSurface(), &presentModeCount, nullptr);
 
-    std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+    _SupportedPresentModes.resize(presentModeCount);
     if (presentModeCount > 0)
     {
         vkGetPhysicalDeviceSurfacePresentModesKHR(
             _Context.GetPhysicalDevice()->GetVKPhysicalDevice(),
             _Context.GetSurface()->GetVKSurface(),
             &presentModeCount,
-            presentModes.data());
+            _SupportedPresentModes.data());
     }
 
     _PresentMode = VK_PRESENT_MODE_FIFO_KHR; // fallback
-    for (const auto& mode : presentModes)
+    for (const auto& mode : _SupportedPresentModes)
     {
-        if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
+        if (mode == _PreferredPresentMode)
         {
             _PresentMode = mode;
             break;
         }
     }
 
-    // Determine image count
-    _ImageCount         = _Context.GetSurface()->GetVKSurfaceCapabilities().minImageCount + 1;
+    // Determine image count. Mailbox needs a spare image to replace queued ones without blocking. FIFO queues every image it
+    // is given, so the minimum keeps the display queue, and the latency it adds, short.
+    _ImageCount = _Context.GetSurface()->GetVKSurfaceCapabilities().minImageCount;
+    if (_PresentMode != VK_PRESENT_MODE_FIFO_KHR && _PresentMode != VK_PRESENT_MODE_FIFO_RELAXED_KHR)
+        _ImageCount++;
     const auto maxCount = _Context.GetSurface()->GetVKSurfaceCapabilities().maxImageCount;
     if (maxCount > 0 && _ImageCount > maxCount)
         _ImageCount = maxCount;
@@ -85,7 +116,7 @@ void Swapchain::Create()
     ci.compositeAlpha   = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     ci.presentMode      = _PresentMode;
     ci.clipped          = VK_TRUE;
-    ci.oldSwapchain     = VK_NULL_HANDLE;
+    ci.oldSwapchain     = InOldSwapchain;
 
     ASSERT(
         vkCreateSwapchainKHR(_Context.GetDevice()->GetVKDevice(), &ci, nullptr, &_Swapchain) == VK_SUCCESS,
@@ -99,7 +130,48 @@ void Swapchain::Create()
 
     _Format = _Context.GetSurface()->GetVKSurfaceFormat().format;
 
-    // Create image views
+    CreateImageViews();
+}
+void Swapchain::CreateOffscreenImages()
+{
+    VkDevice   device = _Context.GetDevice()->GetVKDevice();
+    VkExtent2D extent = _Context.GetSurface()->GetVKExtent();
+
+    _Images.resize(_ImageCount);
+    _ImageMemory.resize(_ImageCount);
+    for (uint32_t i = 0; i < _ImageCount; i++)
+    {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+        imageInfo.format        = _Format;
+        imageInfo.extent        = { extent.width, extent.height, 1 };
+        imageInfo.mipLevels     = 1;
+        imageInfo.arrayLayers   = 1;
+        imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        ASSERT(vkCreateImage(device, &imageInfo, nullptr, &_Images[i]) == VK_SUCCESS, "Failed to create an offscreen image.");
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, _Images[i], &memRequirements);
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize  = memRequirements.size;
+        allocInfo.memoryTypeIndex = Utils::FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        ASSERT(
+            vkAllocateMemory(device, &allocInfo, nullptr, &_ImageMemory[i]) == VK_SUCCESS,
+            "Failed to allocate offscreen image memory.");
+        vkBindImageMemory(device, _Images[i], _ImageMemory[i], 0);
+    }
+    PrintInfo("Created " + std::to_string(_ImageCount) + " offscreen images for headless rendering.");
+}
+void Swapchain::CreateImageViews()
+{
     _ImageViews.resize(_Images.size());
     for (size_t i = 0; i < _Images.size(); ++i)
     {
@@ -129,16 +201,130 @@ void Swapchain::Cleanup()
     {
         vkDestroyImageView(_Context.GetDevice()->GetVKDevice(), imageView, nullptr);
     }
+    _ImageViews.clear();
+
+    for (size_t i = 0; i < _ImageMemory.size(); i++)
+    {
+        vkDestroyImage(_Context.GetDevice()->GetVKDevice(), _Images[i], nullptr);
+        vkFreeMemory(_Context.GetDevice()->GetVKDevice(), _ImageMemory[i], nullptr);
+    }
+    _ImageMemory.clear();
 
     if (_Swapchain != VK_NULL_HANDLE)
     {
         vkDestroySwapchainKHR(_Context.GetDevice()->GetVKDevice(), _Swapchain, nullptr);
+        _Swapchain = VK_NULL_HANDLE;
     }
 }
 void Swapchain::Recreate()
 {
-    Cleanup();
-    Create();
+    // Offscreen images have a fixed size and are only recreated while idle.
+    if (_Context.IsHeadless())
+    {
+        vkDeviceWaitIdle(_Context.GetDevice()->GetVKDevice());
+        Cleanup();
+        Create();
+        return;
+    }
+
+    // The new swapchain takes over from the old one. Frames in flight may still present to the old one, so it is retired
+    // instead of destroyed.
+    VkDevice                 device        = _Context.GetDevice()->GetVKDevice();
+    VkSwapchainKHR           oldSwapchain  = _Swapchain;
+    std::vector<VkImageView> oldImageViews = std::move(_ImageViews);
+    _ImageViews.clear();
+
+    Create(oldSwapchain);
+
+    _Context.GetDeletionQueue()->Retire(
+        [device, oldSwapchain, oldImageViews]()
+        {
+            for (VkImageView imageView : oldImageViews)
+                vkDestroyImageView(device, imageView, nullptr);
+            vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+        });
+}
+
+bool Swapchain::SaveImage(uint32_t InIndex, const std::string& InPath)
+{
+    ASSERT(InIndex < _Images.size(), "Swapchain image index out of range.");
+    ASSERT(_Format == VK_FORMAT_R8G8B8A8_UNORM, "Only RGBA8 images can be saved.");
+
+    VkDevice     device = _Context.GetDevice()->GetVKDevice();
+    VkExtent2D   extent = _Context.GetSurface()->GetVKExtent();
+    VkDeviceSize size   = (VkDeviceSize)extent.width * extent.height * 4;
+
+    VkBuffer       stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    Utils::CreateVKBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        stagingBuffer,
+        stagingMemory);
+
+    VkCommandPool   singleCmdPool;
+    VkCommandBuffer singleCmdBuffer;
+    CommandBuffer::CreateCommandBufferPool(_Context._QueueFamilies.GraphicsFamily, singleCmdPool);
+    CommandBuffer::CreateCommandBuffer(singleCmdBuffer, singleCmdPool);
+    CommandBuffer::BeginRecording(singleCmdBuffer);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent                 = { extent.width, extent.height, 1 };
+    vkCmdCopyImageToBuffer(
+        singleCmdBuffer, _Images[InIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, stagingBuffer, 1, &region);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(
+        singleCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    CommandBuffer::EndRecording(singleCmdBuffer);
+    CommandBuffer::Submit(singleCmdBuffer, _Context.GetDevice()->GetGraphicsQueue());
+    CommandBuffer::FreeCommandBuffer(singleCmdBuffer, singleCmdPool, _Context.GetDevice()->GetGraphicsQueue());
+    CommandBuffer::DestroyCommandPool(singleCmdPool);
+
+    std::filesystem::path fullPath = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/" + InPath);
+    std::error_code       error;
+    std::filesystem::create_directories(fullPath.parent_path(), error);
+
+    bool          saved = false;
+    std::ofstream file(fullPath, std::ios::binary | std::ios::trunc);
+    if (file.is_open())
+    {
+        const uint8_t* pixels = nullptr;
+        vkMapMemory(device, stagingMemory, 0, size, 0, (void**)&pixels);
+
+        file << "P6\n" << extent.width << " " << extent.height << "\n255\n";
+        std::vector<uint8_t> row(extent.width * 3);
+        for (uint32_t y = 0; y < extent.height; y++)
+        {
+            for (uint32_t x = 0; x < extent.width; x++)
+            {
+                const uint8_t* pixel = pixels + ((size_t)y * extent.width + x) * 4;
+                row[x * 3 + 0]       = pixel[0];
+                row[x * 3 + 1]       = pixel[1];
+                row[x * 3 + 2]       = pixel[2];
+            }
+            file.write((const char*)row.data(), row.size());
+        }
+
+        vkUnmapMemory(device, stagingMemory);
+        saved = true;
+        PrintInfo("Saved frame to " + fullPath.string());
+    }
+    else
+    {
+        PrintWarning("Failed to open " + fullPath.string() + " for writing.");
+    }
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingMemory, nullptr);
+    return saved;
 }
 
 Swapchain::~Swapchain() noexcept
@@ -2,9 +2,12 @@
 #include "core.h"
 #include "VulkanContext.h"
 
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.h>
 
+// In headless mode there is no VkSwapchainKHR. The swapchain then owns plain offscreen images of the surface's size and
+// format, which frames cycle through in order instead of acquiring them.
 class Swapchain
 {
    public:
@@ -17,23 +20,37 @@ class Swapchain
     void Recreate();
     void Cleanup();
 
+    // Takes effect with the next Recreate. Falls back to FIFO, which every device supports, if the mode is unavailable.
+    void SetPreferredPresentMode(VkPresentModeKHR InPresentMode);
+
+    // Writes an image as a binary PPM. The image must be idle and in TRANSFER_SRC_OPTIMAL, which only headless frames leave
+    // it in. The path is relative to the Engine directory.
+    bool SaveImage(uint32_t InIndex, const std::string& InPath);
+
    public:
-    const VkSwapchainKHR            GetHandle() const noexcept;
-    const VkFormat                  GetImageFormat() const noexcept;
-    const VkPresentModeKHR          GetPresentMode() const noexcept;
-    const std::vector<VkImage>&     GetImages() const noexcept;
-    const std::vector<VkImageView>& GetImageViews() const noexcept;
-    const uint32_t                  GetImageCount() const noexcept;
+    const VkSwapchainKHR                 GetHandle() const noexcept;
+    const VkFormat                       GetImageFormat() const noexcept;
+    const VkPresentModeKHR               GetPresentMode() const noexcept;
+    const std::vector<VkImage>&          GetImages() const noexcept;
+    const std::vector<VkImageView>&      GetImageViews() const noexcept;
+    const uint32_t                       GetImageCount() const noexcept;
+    const std::vector<VkPresentModeKHR>& GetSupportedPresentModes() const noexcept;
 
    private:
-    void Create();
+    void Create(VkSwapchainKHR InOldSwapchain = VK_NULL_HANDLE);
+    void CreateOffscreenImages();
+    void CreateImageViews();
 
    private:
-    VulkanContext&           _Context;
-    VkSwapchainKHR           _Swapchain = VK_NULL_HANDLE;
-    std::vector<VkImage>     _Images;
-    std::vector<VkImageView> _ImageViews;
-    uint32_t                 _ImageCount;
-    VkFormat                 _Format;
-    VkPresentModeKHR         _PresentMode;
+    VulkanContext&              _Context;
+    VkSwapchainKHR              _Swapchain = VK_NULL_HANDLE;
+    std::vector<VkImage>        _Images;
+    std::vector<VkImageView>    _ImageViews;
+    std::vector<VkDeviceMemory> _ImageMemory; // Headless only.
+    uint32_t                    _ImageCount;
+    VkFormat                    _Format;
+    VkPresentModeKHR            _PresentMode;
+    VkPresentModeKHR            _PreferredPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+    std::vector<VkPresentModeKHR> _SupportedPresentModes;
 };
@@ -0,0 +1,60 @@
+#include "ThreadPool.h"
+#include "Tracer.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t InThreadCount)
+{
+    uint32_t threadCount = InThreadCount;
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+    for (uint32_t i = 0; i < threadCount; i++)
+        _Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    // Jobs that are already queued still run, their futures may be waited on by whoever is being destroyed next.
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _Stopping = true;
+    }
+    _JobAvailable.notify_all();
+
+    for (std::thread& worker : _Workers)
+        worker.join();
+}
+
+std::shared_future<void> ThreadPool::Submit(std::function<void()> InJob)
+{
+    std::packaged_task<void()> task(std::move(InJob));
+    std::shared_future<void>   future = task.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _Jobs.push_back(std::move(task));
+    }
+    _JobAvailable.notify_one();
+    return future;
+}
+
+void ThreadPool::WorkerLoop(uint32_t InIndex)
+{
+    TRACE_THREAD_NAME("Worker " + std::to_string(InIndex));
+
+    while (true)
+    {
+        std::packaged_task<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_Mutex);
+            _JobAvailable.wait(lock, [this] { return _Stopping || !_Jobs.empty(); });
+            if (_Jobs.empty())
+                return;
+
+            job = std::move(_Jobs.front());
+            _Jobs.pop_front();
+        }
+        TRACE_ZONE("Job");
+        job();
+    }
+}
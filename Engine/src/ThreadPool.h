@@ -0,0 +1,38 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running jobs in submission order. Used for work that only touches thread safe Vulkan
+// objects, like pipeline creation at startup.
+class ThreadPool
+{
+   public:
+    // 0 picks one thread less than the hardware has, so the submitting thread keeps a core.
+    ThreadPool(uint32_t InThreadCount = 0);
+    ~ThreadPool();
+
+    std::shared_future<void> Submit(std::function<void()> InJob);
+
+    uint32_t GetThreadCount() const
+    {
+        return (uint32_t)_Workers.size();
+    }
+
+   private:
+    void WorkerLoop(uint32_t InIndex);
+
+   private:
+    std::vector<std::thread>               _Workers;
+    std::deque<std::packaged_task<void()>> _Jobs;
+    std::mutex                             _Mutex;
+    std::condition_variable                _JobAvailable;
+    bool                                   _Stopping = false;
+};
@@ -0,0 +1,257 @@
+#include "Tracer.h"
+
+// External
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+constexpr uint32_t CHUNK_SIZE = 4096;
+constexpr uint32_t MAX_CHUNKS = 64; // Caps a thread at 256k events per capture.
+
+struct TraceEvent
+{
+    const char*               Name;
+    Tracer::Clock::time_point Start;
+    Tracer::Clock::time_point End;
+    uint32_t                  Frame; // UINT32_MAX for zones.
+};
+
+// Written by its thread only. Chunks are allocated on demand and kept for later captures. An event is published by the
+// release store of Count, the exporter never reads past it.
+struct ThreadBuffer
+{
+    std::array<std::atomic<TraceEvent*>, MAX_CHUNKS> Chunks{};
+    std::atomic<uint32_t>                            Count{ 0 };
+    std::atomic<uint32_t>                            Dropped{ 0 };
+    std::atomic<uint32_t>                            Generation{ 0 }; // Capture the events belong to.
+    uint32_t                                         Id = 0;
+    std::string                                      Name; // Guarded by TracerState::Mutex.
+
+    ~ThreadBuffer()
+    {
+        for (std::atomic<TraceEvent*>& chunk : Chunks)
+            delete[] chunk.load();
+    }
+};
+
+struct TracerState
+{
+    std::mutex                                 Mutex; // Guards Buffers and the thread names.
+    std::vector<std::unique_ptr<ThreadBuffer>> Buffers; // Outlive their threads, so workers that exited still export.
+    std::atomic<uint32_t>                      Generation{ 0 };
+
+    // Only touched by the thread running the frame loop.
+    Tracer::Clock::time_point CaptureStart;
+    uint32_t                  FramesLeft = 0;
+    uint32_t                  FrameIndex = 0;
+};
+
+TracerState& GetState()
+{
+    static TracerState state;
+    return state;
+}
+
+// The lock is only taken the first time a thread records anything.
+ThreadBuffer& GetThreadBuffer()
+{
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        TracerState&                state = GetState();
+        std::lock_guard<std::mutex> lock(state.Mutex);
+        state.Buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer       = state.Buffers.back().get();
+        buffer->Id   = (uint32_t)state.Buffers.size();
+        buffer->Name = "Thread " + std::to_string(buffer->Id);
+    }
+    return *buffer;
+}
+
+void Append(const TraceEvent& InEvent)
+{
+    ThreadBuffer& buffer     = GetThreadBuffer();
+    uint32_t      generation = GetState().Generation.load(std::memory_order_acquire);
+
+    // The first event of a new capture drops what the thread recorded for the previous one.
+    if (buffer.Generation.load(std::memory_order_relaxed) != generation)
+    {
+        buffer.Count.store(0, std::memory_order_relaxed);
+        buffer.Dropped.store(0, std::memory_order_relaxed);
+        buffer.Generation.store(generation, std::memory_order_release);
+    }
+
+    uint32_t index = buffer.Count.load(std::memory_order_relaxed);
+    if (index == CHUNK_SIZE * MAX_CHUNKS)
+    {
+        buffer.Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::atomic<TraceEvent*>& chunkSlot = buffer.Chunks[index / CHUNK_SIZE];
+    TraceEvent*               chunk     = chunkSlot.load(std::memory_order_relaxed);
+    if (!chunk)
+    {
+        chunk = new TraceEvent[CHUNK_SIZE];
+        chunkSlot.store(chunk, std::memory_order_release);
+    }
+    chunk[index % CHUNK_SIZE] = InEvent;
+    buffer.Count.store(index + 1, std::memory_order_release);
+}
+
+void WriteJSONString(std::ostream& InStream, const std::string& InString)
+{
+    InStream << '"';
+    for (char c : InString)
+    {
+        if (c == '"' || c == '\\')
+            InStream << '\\';
+        InStream << c;
+    }
+    InStream << '"';
+}
+} // namespace
+
+void Tracer::BeginCapture(uint32_t InFrameCount)
+{
+    TracerState& state = GetState();
+    state.CaptureStart = Clock::now();
+    state.FramesLeft   = InFrameCount;
+    state.FrameIndex   = 0;
+    state.Generation.fetch_add(1, std::memory_order_release);
+    s_Capturing.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::EndCapture()
+{
+    s_Capturing.store(false, std::memory_order_relaxed);
+}
+
+void Tracer::MarkFrame()
+{
+    if (!IsCapturing())
+        return;
+
+    TracerState&      state = GetState();
+    Clock::time_point now   = Clock::now();
+    Append(TraceEvent{ "Frame", now, now, state.FrameIndex++ });
+
+    if (state.FramesLeft > 0 && --state.FramesLeft == 0)
+        EndCapture();
+}
+
+void Tracer::SetThreadName(const std::string& InName)
+{
+    ThreadBuffer&               buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(GetState().Mutex);
+    buffer.Name = InName;
+}
+
+void Tracer::RecordZone(const char* InName, Clock::time_point InStart, Clock::time_point InEnd)
+{
+    Append(TraceEvent{ InName, InStart, InEnd, UINT32_MAX });
+}
+
+uint64_t Tracer::GetEventCount()
+{
+    TracerState&                state      = GetState();
+    uint32_t                    generation = state.Generation.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(state.Mutex);
+
+    uint64_t count = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : state.Buffers)
+    {
+        if (buffer->Generation.load(std::memory_order_acquire) == generation)
+            count += buffer->Count.load(std::memory_order_acquire);
+    }
+    return count;
+}
+
+uint64_t Tracer::GetDroppedEventCount()
+{
+    TracerState&                state      = GetState();
+    uint32_t                    generation = state.Generation.load(std::memory_order_acquire);
+    std::lock_guard<std::mutex> lock(state.Mutex);
+
+    uint64_t count = 0;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : state.Buffers)
+    {
+        if (buffer->Generation.load(std::memory_order_acquire) == generation)
+            count += buffer->Dropped.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+bool Tracer::Export(const std::string& InPath)
+{
+    EndCapture();
+
+    std::filesystem::path fullPath = std::filesystem::path(std::string(SOLUTION_DIR) + "Engine/" + InPath);
+    std::error_code       error;
+    std::filesystem::create_directories(fullPath.parent_path(), error);
+
+    std::ofstream file(fullPath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        PrintWarning("Failed to open " + fullPath.string() + " for writing.");
+        return false;
+    }
+
+    TracerState& state      = GetState();
+    uint32_t     generation = state.Generation.load(std::memory_order_acquire);
+
+    // Microseconds since the capture started.
+    auto toMicroseconds = [&state](Clock::time_point time)
+    { return std::chrono::duration<double, std::micro>(time - state.CaptureStart).count(); };
+
+    file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Engine\"}}";
+
+    uint64_t eventCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(state.Mutex);
+        for (const std::unique_ptr<ThreadBuffer>& buffer : state.Buffers)
+        {
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->Id << ",\"args\":{\"name\":";
+            WriteJSONString(file, buffer->Name);
+            file << "}}";
+
+            if (buffer->Generation.load(std::memory_order_acquire) != generation)
+                continue;
+
+            uint32_t count = buffer->Count.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const TraceEvent& event = buffer->Chunks[i / CHUNK_SIZE].load(std::memory_order_acquire)[i % CHUNK_SIZE];
+
+                // Zones that were already open when the capture started.
+                if (event.Start < state.CaptureStart)
+                    continue;
+
+                file << ",\n{\"name\":";
+                if (event.Frame == UINT32_MAX)
+                {
+                    WriteJSONString(file, event.Name);
+                    file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":" << toMicroseconds(event.Start)
+                         << ",\"dur\":" << toMicroseconds(event.End) - toMicroseconds(event.Start);
+                }
+                else
+                {
+                    file << "\"Frame " << event.Frame << "\",\"cat\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":"
+                         << toMicroseconds(event.Start);
+                }
+                file << ",\"pid\":1,\"tid\":" << buffer->Id << "}";
+                eventCount++;
+            }
+        }
+    }
+    file << "\n]}\n";
+
+    PrintInfo("Exported " + std::to_string(eventCount) + " CPU trace events to " + fullPath.string());
+    return true;
+}
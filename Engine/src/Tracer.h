@@ -0,0 +1,86 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// CPU zones are compiled in unless the build defines ENABLE_CPU_TRACING as 0, in which case the macros below expand to
+// nothing and their arguments aren't evaluated.
+#ifndef ENABLE_CPU_TRACING
+#define ENABLE_CPU_TRACING 1
+#endif
+
+// Records scoped CPU zones and frame markers into per thread buffers while a capture is running, and writes them out as
+// Chrome trace event JSON, which chrome://tracing and ui.perfetto.dev both open.
+//
+// Every thread appends to its own buffer, so recording takes no lock. Events only become visible to the exporter once
+// fully written, which keeps exporting safe while worker threads are still busy. A capture ends on its own after a given
+// number of frames. Zone names must outlive the capture, string literals or __FUNCTION__.
+class Tracer
+{
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    // Discards the previous capture. 0 frames records until EndCapture.
+    static void BeginCapture(uint32_t InFrameCount = 0);
+    static void EndCapture();
+    static bool IsCapturing()
+    {
+        return s_Capturing.load(std::memory_order_relaxed);
+    }
+
+    // Ends the frame on the timeline and counts down the frames left in the capture.
+    static void MarkFrame();
+    static void SetThreadName(const std::string& InName);
+
+    static void RecordZone(const char* InName, Clock::time_point InStart, Clock::time_point InEnd);
+
+    // Ends a running capture first. The path is relative to the Engine directory.
+    static bool Export(const std::string& InPath);
+
+    // Events of the current or last capture, and events lost because a thread's buffer was full.
+    static uint64_t GetEventCount();
+    static uint64_t GetDroppedEventCount();
+
+   private:
+    inline static std::atomic<bool> s_Capturing{ false };
+};
+
+class TraceZone
+{
+   public:
+    explicit TraceZone(const char* InName) : _Name(InName), _Active(Tracer::IsCapturing())
+    {
+        if (_Active)
+            _Start = Tracer::Clock::now();
+    }
+    ~TraceZone()
+    {
+        if (_Active)
+            Tracer::RecordZone(_Name, _Start, Tracer::Clock::now());
+    }
+
+    TraceZone(const TraceZone&)            = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+   private:
+    const char*               _Name;
+    bool                      _Active;
+    Tracer::Clock::time_point _Start;
+};
+
+#if ENABLE_CPU_TRACING
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b)       TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name)         TraceZone TRACE_CONCAT(_TraceZone, __LINE__)(name)
+#define TRACE_FUNCTION()         TRACE_ZONE(__FUNCTION__)
+#define TRACE_FRAME_MARK()       Tracer::MarkFrame()
+#define TRACE_THREAD_NAME(name)  Tracer::SetThreadName(name)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_FUNCTION()
+#define TRACE_FRAME_MARK()
+#define TRACE_THREAD_NAME(name)
+#endif
@@ -0,0 +1,62 @@
+#include "UniformBlocks.h"
+#include "LogicalDevice.h"
+#include "PhysicalDevice.h"
+#include "Utils.h"
+#include "VulkanContext.h"
+
+#include <cstring>
+
+UniformBlocks::UniformBlocks(VulkanContext& InContext, const std::vector<VkDeviceSize>& InBlockSizes, uint32_t InFramesInFlight)
+    : _Context(InContext), _Sizes(InBlockSizes)
+{
+    // Slots follow each other, so the slot size has to keep every block of every slot aligned.
+    VkDeviceSize alignment = _Context.GetPhysicalDevice()->GetVKProperties().limits.minUniformBufferOffsetAlignment;
+    for (VkDeviceSize size : _Sizes)
+    {
+        _Offsets.push_back(_SlotSize);
+        _SlotSize += (size + alignment - 1) / alignment * alignment;
+    }
+    VkDeviceSize bufferSize = _SlotSize * InFramesInFlight;
+
+    Utils::CreateVKBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        _Buffer,
+        _BufferMemory);
+    vkMapMemory(_Context.GetDevice()->GetVKDevice(), _BufferMemory, 0, bufferSize, 0, (void**)&_MappedBuffer);
+
+    // Both copies start out zeroed so the first upload of a block only writes what is set.
+    memset(_MappedBuffer, 0, bufferSize);
+    _Uploaded.assign(bufferSize, 0);
+}
+
+UniformBlocks::~UniformBlocks()
+{
+    vkUnmapMemory(_Context.GetDevice()->GetVKDevice(), _BufferMemory);
+    vkDestroyBuffer(_Context.GetDevice()->GetVKDevice(), _Buffer, nullptr);
+    vkFreeMemory(_Context.GetDevice()->GetVKDevice(), _BufferMemory, nullptr);
+}
+
+VkDeviceSize UniformBlocks::Upload(uint32_t InBlock, uint32_t InFrameIndex, const void* InData)
+{
+    const uint8_t* data     = (const uint8_t*)InData;
+    VkDeviceSize   offset   = _SlotSize * InFrameIndex + _Offsets[InBlock];
+    uint8_t*       uploaded = _Uploaded.data() + offset;
+    VkDeviceSize   size     = _Sizes[InBlock];
+
+    // Narrow the copy down to the first and last byte that differ.
+    VkDeviceSize first = 0;
+    while (first < size && data[first] == uploaded[first])
+        first++;
+    if (first == size)
+        return 0;
+
+    VkDeviceSize last = size;
+    while (data[last - 1] == uploaded[last - 1])
+        last--;
+
+    memcpy(uploaded + first, data + first, last - first);
+    memcpy(_MappedBuffer + offset + first, data + first, last - first);
+    return last - first;
+}
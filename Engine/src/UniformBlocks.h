@@ -0,0 +1,57 @@
+#pragma once
+#include "core.h"
+
+// External
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// One host visible uniform buffer split into blocks that change at different rates. Every frame in flight has its own slot
+// holding all blocks, so writing a block never races a frame that is still reading it. Within a slot every block starts at
+// an offset aligned to minUniformBufferOffsetAlignment, so shaders can bind exactly the blocks they read. Descriptors point
+// at the blocks of slot 0 as dynamic uniform buffers, and GetDynamicOffset selects the frame's slot when the set is bound.
+// Uploads compare a block against what was last written to the same slot and only copy the range that changed, so blocks
+// that rarely change cost nothing per frame.
+class UniformBlocks
+{
+   public:
+    UniformBlocks(VulkanContext& InContext, const std::vector<VkDeviceSize>& InBlockSizes, uint32_t InFramesInFlight);
+    ~UniformBlocks();
+
+    // InData must point to the full block. Only the slot of a frame whose fence has been waited on may be written. Returns
+    // the number of bytes written to the buffer.
+    VkDeviceSize Upload(uint32_t InBlock, uint32_t InFrameIndex, const void* InData);
+
+    VkBuffer GetBuffer() const
+    {
+        return _Buffer;
+    }
+    // Offset of the block within a slot. Add GetDynamicOffset to address a specific frame's copy.
+    VkDeviceSize GetOffset(uint32_t InBlock) const
+    {
+        return _Offsets[InBlock];
+    }
+    VkDeviceSize GetSize(uint32_t InBlock) const
+    {
+        return _Sizes[InBlock];
+    }
+    // The same for every block, so one value serves all dynamic uniform buffers of a set.
+    uint32_t GetDynamicOffset(uint32_t InFrameIndex) const
+    {
+        return (uint32_t)(_SlotSize * InFrameIndex);
+    }
+
+   private:
+    VulkanContext& _Context;
+
+    VkBuffer       _Buffer       = VK_NULL_HANDLE;
+    VkDeviceMemory _BufferMemory = VK_NULL_HANDLE;
+    uint8_t*       _MappedBuffer = nullptr;
+
+    std::vector<VkDeviceSize> _Offsets;
+    std::vector<VkDeviceSize> _Sizes;
+    VkDeviceSize              _SlotSize = 0;
+    // Copy of the buffer contents, all slots. Compared against instead of the mapped memory, which may be slow to read.
+    std::vector<uint8_t> _Uploaded;
+};
@@ -6,6 +6,7 @@
 #include "Utils.h"
 #include "VulkanContext.h"
 
+#include <ctime>
 #include <fstream>
 #include <iostream>
 void Utils::PopulateDebugMessengerCreateInfo(
@@ -25,6 +26,19 @@ std::string Utils::NormalizePath(std::string path)
     std::replace(path.begin(), path.end(), '\\', '/');
     return path;
 }
+std::string Utils::GetTimestampString()
+{
+    std::time_t now = std::time(nullptr);
+    std::tm     local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y%m%d_%H%M%S", &local);
+    return buffer;
+}
 std::vector<char> Utils::ReadFile(const std::string& filePath)
 {
     // ate : Start reading at the end of the file
@@ -135,15 +149,14 @@ void Utils::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size
     CommandBuffer::DestroyCommandPool(singleCmdPool);
 }
 
-VkSampler Utils::CreateSampler(
-    Ref<Image>           image,
+VkSamplerCreateInfo Utils::GetSamplerCreateInfo(
     ImageType            imageType,
     VkFilter             magFilter,
     VkFilter             minFilter,
     VkSamplerAddressMode addressMode,
-    VkBool32             anisotrophy)
+    VkBool32             anisotrophy,
+    float                maxLod)
 {
-    VkSampler           sampler;
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType     = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -166,14 +179,9 @@ VkSampler Utils::CreateSampler(
         samplerInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias              = 0.0f;
         samplerInfo.minLod                  = 0.0f;
-        samplerInfo.maxLod                  = static_cast<float>(image->GetMipLevel());
+        samplerInfo.maxLod                  = maxLod;
         samplerInfo.magFilter               = magFilter;
         samplerInfo.minFilter               = minFilter;
-
-        ASSERT(
-            vkCreateSampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), &samplerInfo, nullptr, &sampler) ==
-                VK_SUCCESS,
-            "Failed to create texture sampler!");
     }
     else // Depth
     {
@@ -188,19 +196,12 @@ VkSampler Utils::CreateSampler(
         samplerInfo.minLod        = 0.0f;
         samplerInfo.maxLod        = 1.0f;
         samplerInfo.borderColor   = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-
-        ASSERT(
-            vkCreateSampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), &samplerInfo, nullptr, &sampler) ==
-                VK_SUCCESS,
-            "Failed to create texture sampler!");
     }
-
-    return sampler;
+    return samplerInfo;
 }
 
-VkSampler Utils::CreateCubemapSampler()
+VkSamplerCreateInfo Utils::GetCubemapSamplerCreateInfo()
 {
-    VkSampler           sampler;
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType     = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -221,6 +222,31 @@ VkSampler Utils::CreateCubemapSampler()
     samplerInfo.mipLodBias              = 0.0f;
     samplerInfo.minLod                  = 0.0f;
     samplerInfo.maxLod                  = 0.0f;
+    return samplerInfo;
+}
+
+VkSampler Utils::CreateSampler(
+    Ref<Image>           image,
+    ImageType            imageType,
+    VkFilter             magFilter,
+    VkFilter             minFilter,
+    VkSamplerAddressMode addressMode,
+    VkBool32             anisotrophy)
+{
+    VkSampler           sampler;
+    VkSamplerCreateInfo samplerInfo = GetSamplerCreateInfo(
+        imageType, magFilter, minFilter, addressMode, anisotrophy, static_cast<float>(image->GetMipLevel()));
+
+    ASSERT(
+        vkCreateSampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), &samplerInfo, nullptr, &sampler) == VK_SUCCESS,
+        "Failed to create texture sampler!");
+
+    return sampler;
+}
+VkSampler Utils::CreateCubemapSampler()
+{
+    VkSampler           sampler;
+    VkSamplerCreateInfo samplerInfo = GetCubemapSamplerCreateInfo();
 
     ASSERT(
         vkCreateSampler(EngineInternal::GetContext().GetDevice()->GetVKDevice(), &samplerInfo, nullptr, &sampler) == VK_SUCCESS,
@@ -284,7 +310,8 @@ void Utils::UpdateDescriptorSet(
     const VkBuffer&        buffer,
     VkDeviceSize           offset,
     VkDeviceSize           range,
-    uint32_t               bindingIndex)
+    uint32_t               bindingIndex,
+    VkDescriptorType       descriptorType)
 {
     // Write the descriptor set.
     VkWriteDescriptorSet   descriptorWrite{};
@@ -298,7 +325,7 @@ void Utils::UpdateDescriptorSet(
     descriptorWrite.dstSet           = dscSet;
     descriptorWrite.dstBinding       = bindingIndex;
     descriptorWrite.dstArrayElement  = 0;
-    descriptorWrite.descriptorType   = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrite.descriptorType   = descriptorType;
     descriptorWrite.descriptorCount  = 1;
     descriptorWrite.pBufferInfo      = &bufferInfo;
     descriptorWrite.pImageInfo       = nullptr; // Optional
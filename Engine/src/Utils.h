@@ -11,6 +11,8 @@ struct Utils
         PFN_vkDebugUtilsMessengerCallbackEXT callbackFNC);
     static std::vector<char> ReadFile(const std::string& filePath);
     static std::string       NormalizePath(std::string path);
+    // Local time as YYYYMMDD_HHMMSS, for file names that shouldn't overwrite each other.
+    static std::string       GetTimestampString();
     static void              CreateVKBuffer(
                      VkDeviceSize          size,
                      VkBufferUsageFlags    usage,
@@ -27,6 +29,15 @@ struct Utils
         VkSamplerAddressMode addressMode,
         VkBool32             anisotrophy);
     static VkSampler CreateCubemapSampler();
+    // Create infos used by the functions above. Handy for requesting shared samplers from the SamplerCache.
+    static VkSamplerCreateInfo GetSamplerCreateInfo(
+        ImageType            imageType,
+        VkFilter             magFilter,
+        VkFilter             minFilter,
+        VkSamplerAddressMode addressMode,
+        VkBool32             anisotrophy,
+        float                maxLod);
+    static VkSamplerCreateInfo GetCubemapSamplerCreateInfo();
     static VkFormat  FindDepthFormat();
     static VkFormat  FindSupportedFormat(
          const std::vector<VkFormat>& candidates,
@@ -44,5 +55,6 @@ struct Utils
         const VkBuffer&        buffer,
         VkDeviceSize           offset,
         VkDeviceSize           range,
-        uint32_t               bindingIndex);
+        uint32_t               bindingIndex,
+        VkDescriptorType       descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 };
@@ -1,7 +1,14 @@
+#include "DeletionQueue.h"
 #include "Instance.h"
 #include "LogicalDevice.h"
 #include "PhysicalDevice.h"
+#include "PipelineCache.h"
+#include "SamplerCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderModuleCache.h"
 #include "Surface.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
 #include "VulkanContext.h"
 #include "Window.h"
 
@@ -12,14 +19,18 @@ VulkanContext::~VulkanContext()
     Shutdown();
 }
 
-void VulkanContext::Init()
+void VulkanContext::Init(bool InHeadless, VkExtent2D InExtent)
 {
-    // 1. Create window
-    auto test = make_s<Window>("Vulkan Engine", 1920, 1080);
-    _Window   = test;
+    TRACE_FUNCTION();
+
+    _Headless = InHeadless;
+
+    // 1. Create window. Headless runs never touch GLFW.
+    if (!_Headless)
+        _Window = make_s<Window>("Vulkan Engine", InExtent.width, InExtent.height);
 
     // 2. Create instance
-    _Instance = make_s<Instance>();
+    _Instance = make_s<Instance>(_Headless);
 
     // 3. Enumerate and pick physical device
     PickPhysicalDevice();
@@ -28,14 +39,36 @@ void VulkanContext::Init()
     _MSAASamples = GetMaxUsableSampleCount(_PhysicalDevice);
 
     // 5. Create surface (depends on instance + window)
-    _Surface = make_s<Surface>(_Instance, _Window, _PhysicalDevice);
+    if (_Headless)
+        _Surface = make_s<Surface>(InExtent);
+    else
+        _Surface = make_s<Surface>(_Instance, _Window, _PhysicalDevice);
 
     // 6. Setup queue families
     SetupQueueFamilies();
 
-    // 7. Create logical device
+    // 7. Create logical device. Nothing is presented without a window.
+    if (_Headless)
+        _RequiredExtensions.clear();
     CreateLogicalDevice();
 
+    // 8. Samplers are shared by everything that samples with the same state.
+    _SamplerCache = make_s<SamplerCache>(*this);
+
+    // 9. Shaders are compiled from source when shaderc is available. Shader modules are shared by every pipeline using the
+    // same SPIR-V.
+    _ShaderCompiler    = make_s<ShaderCompiler>("assets/shaders/compileShaders.bat", "cache/shaders");
+    _ShaderModuleCache = make_s<ShaderModuleCache>(*this);
+
+    // 10. Pipelines compiled by earlier runs are loaded from disk.
+    _PipelineCache = make_s<PipelineCache>(*this, std::string(SOLUTION_DIR) + "Engine/cache/pipeline_cache.bin");
+
+    // 11. Workers for startup jobs like pipeline compilation.
+    _ThreadPool = make_s<ThreadPool>();
+
+    // 12. Resources replaced while frames are in flight, e.g. on resize, are destroyed once those frames are done.
+    _DeletionQueue = make_s<DeletionQueue>();
+
     PrintInfo("VulkanContext initialized successfully.");
 }
 
@@ -98,7 +131,7 @@ void VulkanContext::SetupQueueFamilies()
     // Check whether the graphics queue we just got also supports present
     // operations.
     ASSERT(
-        _PhysicalDevice->CheckPresentSupport(_QueueFamilies.GraphicsFamily, _Surface->GetVKSurface()),
+        _Headless || _PhysicalDevice->CheckPresentSupport(_QueueFamilies.GraphicsFamily, _Surface->GetVKSurface()),
         "Present operations are not supported by the graphics queue. Might "
         "want to search for it manually.");
 
@@ -128,6 +161,30 @@ Ref<LogicalDevice> VulkanContext::GetDevice() const
 {
     return _Device;
 }
+Ref<SamplerCache> VulkanContext::GetSamplerCache() const
+{
+    return _SamplerCache;
+}
+Ref<PipelineCache> VulkanContext::GetPipelineCache() const
+{
+    return _PipelineCache;
+}
+Ref<ThreadPool> VulkanContext::GetThreadPool() const
+{
+    return _ThreadPool;
+}
+Ref<ShaderModuleCache> VulkanContext::GetShaderModuleCache() const
+{
+    return _ShaderModuleCache;
+}
+Ref<ShaderCompiler> VulkanContext::GetShaderCompiler() const
+{
+    return _ShaderCompiler;
+}
+Ref<DeletionQueue> VulkanContext::GetDeletionQueue() const
+{
+    return _DeletionQueue;
+}
 
 Ref<PhysicalDevice> VulkanContext::GetPhysicalDevice() const
 {
@@ -187,6 +244,12 @@ void VulkanContext::Shutdown()
     }
 
     // 2. Reset objects in reverse creation order
+    _DeletionQueue.reset(); // Releases what is still retired, the device is idle now
+    _ThreadPool.reset(); // Finishes the queued jobs, which may still create pipelines
+    _SamplerCache.reset();
+    _ShaderModuleCache.reset();
+    _ShaderCompiler.reset();
+    _PipelineCache.reset(); // Writes the cache back to disk
     _Device.reset(); // LogicalDevice first (frees queues, semaphores, command pools)
     _Surface.reset(); // Surface next (depends on instance + window)
     _PhysicalDevice.reset(); // Usually safe to reset next
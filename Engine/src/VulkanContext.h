@@ -8,6 +8,12 @@ class PhysicalDevice;
 class Surface;
 class Window;
 class LogicalDevice;
+class SamplerCache;
+class PipelineCache;
+class ThreadPool;
+class ShaderModuleCache;
+class ShaderCompiler;
+class DeletionQueue;
 
 struct QueueFamilyIndices
 {
@@ -29,14 +35,28 @@ class VulkanContext
     VulkanContext() = default;
     ~VulkanContext();
 
-    void Init();
+    // Headless contexts have no window and no presentable surface. The surface then only stands for the fixed size and
+    // format of the offscreen images the swapchain renders into.
+    void Init(bool InHeadless = false, VkExtent2D InExtent = { 1920, 1080 });
     void Shutdown();
 
-    Ref<Instance>       GetInstance() const;
-    Ref<LogicalDevice>  GetDevice() const;
-    Ref<PhysicalDevice> GetPhysicalDevice() const;
-    Ref<Surface>        GetSurface() const;
+    bool IsHeadless() const
+    {
+        return _Headless;
+    }
+
+    Ref<Instance>          GetInstance() const;
+    Ref<LogicalDevice>     GetDevice() const;
+    Ref<PhysicalDevice>    GetPhysicalDevice() const;
+    Ref<Surface>           GetSurface() const;
+    Ref<SamplerCache>      GetSamplerCache() const;
+    Ref<PipelineCache>     GetPipelineCache() const;
+    Ref<ThreadPool>        GetThreadPool() const;
+    Ref<ShaderModuleCache> GetShaderModuleCache() const;
+    Ref<ShaderCompiler>    GetShaderCompiler() const;
+    Ref<DeletionQueue>     GetDeletionQueue() const;
     // TO DO: Move this out of here;
+    // Null in headless mode.
     Ref<Window> GetWindow() const;
 
     QueueFamilyIndices _QueueFamilies;
@@ -48,13 +68,20 @@ class VulkanContext
 
     VkSampleCountFlagBits GetMaxUsableSampleCount(const Ref<PhysicalDevice>& physDevice);
 
-    Ref<Window>         _Window;
-    Ref<Instance>       _Instance;
-    Ref<PhysicalDevice> _PhysicalDevice;
-    Ref<Surface>        _Surface;
-    Ref<LogicalDevice>  _Device;
+    Ref<Window>            _Window;
+    Ref<Instance>          _Instance;
+    Ref<PhysicalDevice>    _PhysicalDevice;
+    Ref<Surface>           _Surface;
+    Ref<LogicalDevice>     _Device;
+    Ref<SamplerCache>      _SamplerCache;
+    Ref<PipelineCache>     _PipelineCache;
+    Ref<ThreadPool>        _ThreadPool;
+    Ref<ShaderModuleCache> _ShaderModuleCache;
+    Ref<ShaderCompiler>    _ShaderCompiler;
+    Ref<DeletionQueue>     _DeletionQueue;
 
     VkSampleCountFlagBits _MSAASamples           = VK_SAMPLE_COUNT_1_BIT;
+    bool                  _Headless              = false;
 
     std::vector<const char*> _RequiredExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 };
\ No newline at end of file